@@ -4,8 +4,9 @@
  * Monitors the WXYC mixing board's AUX relay contact to detect when the
  * auto DJ system (AzuraCast/Liquidsoap at remote.wxyc.org) is active.
  * When active, polls AzuraCast for currently-playing track data and writes
- * entries to the tubafrenzy flowsheet (wxyc.info), bridging the gap in
- * the station's playback history.
+ * entries to the flowsheet -- tubafrenzy (wxyc.info) or Backend-Service
+ * (api.wxyc.org), as FLOWSHEET_BACKEND selects -- bridging the gap in the
+ * station's playback history.
  *
  * Hardware: Arduino Giga R1 WiFi
  * Wiring:   See docs/wiring.md
@@ -19,116 +20,634 @@
 #include "secrets.h"
 #include "relay_monitor.h"
 #include "wifi_manager.h"
+#include "network_manager.h"
 #include "azuracast_client.h"
 #include "flowsheet_client.h"
+#include "backend_service_client.h"
 #include "utils.h"
 #include "state_machine.h"
+#include "log_buffer.h"
+#include "mem_stats.h"
+#include "checkpoint.h"
+#include "stall_detector.h"
+#include "firmware_update.h"
+#include "play_history.h"
+#include "metrics_server.h"
 
 // ========== Global State ==========
 
-Context ctx = { BOOTING, -1, 0, 0 };
+Context ctx = { BOOTING, -1, 0, 0, false, 0 };
 unsigned long lastNtpSync = 0;
+unsigned long lastWarmPoll = 0;
+
+// Relay-edge-to-first-entry latency, logged once per show
+bool awaitingFirstEntry = false;
+unsigned long relayEdgeAt = 0;
+unsigned long entriesBeforeShow = 0;
+
+// Loop timing (memory report and /metrics) and retries scheduled (/metrics)
+LoopHistogram loopTimes;
+unsigned long retriesScheduled = 0;
 
 // ========== Modules ==========
 
-RelayMonitor relayMonitor(RELAY_PIN, STATUS_LED_PIN, DEBOUNCE_MS);
+RelayMonitor relayMonitor(RELAY_PIN, STATUS_LED_PIN, DEBOUNCE_MS, DEBOUNCE_MIN_MS,
+                          DEBOUNCE_MAX_MS);
 WifiManager wifiManager(WIFI_SSID, WIFI_PASS, WIFI_RETRY_INTERVAL_MS);
-AzuraCastClient azuracast(AZURACAST_HOST, AZURACAST_PORT, AZURACAST_PATH);
-FlowsheetClient flowsheet(TUBAFRENZY_HOST, TUBAFRENZY_PORT, AUTO_DJ_API_KEY);
+WifiTransport wifiTransport(wifiManager);
+#if ENABLE_ETHERNET
+const uint8_t ethernetMac[] = ETHERNET_MAC;
+EthernetTransport ethernetTransport(ETHERNET_CS_PIN, ethernetMac, ETHERNET_ENTROPY_PIN);
+#endif
+NetworkManager network(LINK_FAILURE_THRESHOLD, LINK_COOLDOWN_MS, LINK_PREFERENCE_MS);
+AzuraCastClient azuracast(network, AZURACAST_HOST, AZURACAST_PORT, AZURACAST_PATH);
+#if FLOWSHEET_BACKEND == BACKEND_SERVICE
+BackendServiceClient flowsheet(network, BACKEND_SERVICE_HOST, BACKEND_SERVICE_PORT,
+                               BACKEND_SERVICE_TOKEN, BACKEND_SERVICE_DJ_ID);
+#else
+FlowsheetClient flowsheet(network, TUBAFRENZY_HOST, TUBAFRENZY_PORT, AUTO_DJ_API_KEY);
+#endif
+
+// ========== Firmware Update ==========
+
+#if ENABLE_OTA
+FirmwareUpdater firmware(network, FIRMWARE_HOST, FIRMWARE_PORT);
+unsigned long lastFirmwareCheck = 0;
+bool firmwareChecked = false;
+#endif
+
+// ========== Play History ==========
+
+#if ENABLE_PLAY_HISTORY
+PlayHistory playHistory;
+bool playHistoryFailing = false;
+#endif
+
+// ========== Checkpoint ==========
+
+CheckpointStore checkpoints;
+
+// ========== Memory Stats ==========
+
+MemStats memStats;
+unsigned long lastMemSample = 0;
+unsigned long lastMemReport = 0;
 
 // ========== Logging ==========
 
+char logStorage[LOG_BUFFER_SIZE];
+LogBuffer serialLog(logStorage, sizeof(logStorage));
+unsigned long reportedLogDrops = 0;
+
+/**
+ * Moves buffered log text to Serial without blocking: writes only what the
+ * TX buffer can accept right now, capped per call so a large backlog is
+ * spread over several loop iterations.
+ */
+void drainLog() {
+    MemScope memScope(MEM_LOG);
+    if (serialLog.droppedCount() != reportedLogDrops && serialLog.pending() == 0) {
+        serialLog.print("[Log] Dropped ");
+        serialLog.print(serialLog.droppedCount() - reportedLogDrops);
+        serialLog.println(" lines (buffer full)");
+        reportedLogDrops = serialLog.droppedCount();
+    }
+
+    int room = Serial.availableForWrite();
+    if (room > LOG_DRAIN_MAX_PER_LOOP) room = LOG_DRAIN_MAX_PER_LOOP;
+    while (room > 0) {
+        const char* chunk;
+        size_t n = serialLog.peek(&chunk, room);
+        if (n == 0) break;
+        Serial.write((const uint8_t*)chunk, n);
+        serialLog.consume(n);
+        room -= n;
+    }
+}
+
+/**
+ * Blocking drain, for setup() where stalling on the UART is harmless.
+ */
+void flushLog() {
+    const char* chunk;
+    size_t n;
+    while ((n = serialLog.peek(&chunk, serialLog.pending())) > 0) {
+        Serial.write((const uint8_t*)chunk, n);
+        serialLog.consume(n);
+    }
+}
+
 void logTransition(State prev, State next) {
+    MemScope memScope(MEM_LOG);
     if (prev != next) {
-        Serial.print("[State] ");
-        Serial.print(stateName(prev));
-        Serial.print(" -> ");
-        Serial.println(stateName(next));
+        serialLog.print("[State] ");
+        serialLog.print(stateName(prev));
+        serialLog.print(" -> ");
+        serialLog.println(stateName(next));
+    }
+}
+
+/**
+ * Cheap heap and stack high-water sampling, every MEM_SAMPLE_INTERVAL_MS.
+ */
+void sampleMemory() {
+    if (millis() - lastMemSample < MEM_SAMPLE_INTERVAL_MS) return;
+    lastMemSample = millis();
+    memStats.sampleHeap(readHeapCounters());
+    memStats.sampleStack(stackFreeBytes());
+}
+
+void logRoundTrips(const char* tag, const RttEstimator& rtt) {
+    serialLog.print(tag);
+    serialLog.print(" response timeout ");
+    serialLog.print(rtt.timeoutMs());
+    serialLog.print(" ms (srtt ");
+    serialLog.print(rtt.smoothedMs());
+    serialLog.print(", deviation ");
+    serialLog.print(rtt.deviationMs());
+    serialLog.print(" ms; ");
+    serialLog.print(rtt.sampleCount());
+    serialLog.print(" answered, ");
+    serialLog.print(rtt.timeoutCount());
+    serialLog.println(" timed out)");
+}
+
+/**
+ * Periodic memory report: heap, fragmentation, stack headroom, and
+ * per-module allocations. The largest-free-block probe runs only here.
+ * Also reports the watchdog near misses and the relay contact's quality,
+ * and each link's and endpoint's round trips.
+ */
+void reportMemStats() {
+    if (millis() - lastMemReport < MEM_STATS_INTERVAL_MS) return;
+    lastMemReport = millis();
+    MemScope memScope(MEM_LOG);
+
+    memStats.sampleHeap(readHeapCounters());
+    memStats.sampleLargestFree(largestFreeBlock());
+    memStats.sampleStack(stackFreeBytes());
+
+    serialLog.print("[Mem] heap ");
+    serialLog.print(memStats.heapInUse());
+    serialLog.print(" B (peak ");
+    serialLog.print(memStats.heapPeak());
+    serialLog.print("), largest free ");
+    serialLog.print(memStats.largestFree());
+    serialLog.print(" B (min ");
+    serialLog.print(memStats.minLargestFree());
+    serialLog.print("), stack free ");
+    serialLog.print(memStats.stackFree());
+    serialLog.print(" B (min ");
+    serialLog.print(memStats.minStackFree());
+    serialLog.println(")");
+
+    for (int i = 0; i < MEM_MODULE_COUNT; i++) {
+        const ModuleMemStats& m = memStats.module((MemModule)i);
+        serialLog.print("[Mem]   ");
+        serialLog.print(memModuleName((MemModule)i));
+        serialLog.print(": ");
+        serialLog.print(m.allocs);
+        serialLog.print(" allocs, ");
+        serialLog.print(m.frees);
+        serialLog.print(" frees, retained ");
+        serialLog.print(m.retained);
+        serialLog.print(" B, peak ");
+        serialLog.print(m.peak);
+        serialLog.println(" B");
+    }
+
+    // How close each operation has come to the watchdog timeout
+    serialLog.print("[Watchdog] longest:");
+    for (int i = STALL_NONE + 1; i < STALL_OP_COUNT; i++) {
+        serialLog.print(" ");
+        serialLog.print(stallOpName((StallOp)i));
+        serialLog.print(" ");
+        serialLog.print(stallDetector.longestMs((StallOp)i));
+        serialLog.print(" ms");
+    }
+    serialLog.println();
+    serialLog.print("[Loop] ");
+    serialLog.print(loopTimes.count());
+    serialLog.print(" iterations, longest ");
+    serialLog.print(loopTimes.maxMs());
+    serialLog.println(" ms");
+
+    // Relay contact bounce, and the settle window learned from it
+    const DebounceFilter& debounce = relayMonitor.debounce();
+    const DebounceStats& contact = debounce.stats();
+    serialLog.print("[Relay] settle ");
+    serialLog.print(debounce.settleMs());
+    serialLog.print(" ms, ");
+    serialLog.print(contact.transitions);
+    serialLog.print(" transitions, ");
+    serialLog.print(contact.glitches);
+    serialLog.print(" glitches, longest bounce ");
+    serialLog.print(contact.longestBounceMs);
+    serialLog.print(" ms; bounces");
+    for (int i = 0; i < DEBOUNCE_HISTOGRAM_BINS; i++) {
+        unsigned long upper = DebounceFilter::binUpperMs(i);
+        serialLog.print(upper ? " <" : " >=");
+        serialLog.print(upper ? upper : DebounceFilter::binUpperMs(i - 1));
+        serialLog.print(":");
+        serialLog.print(contact.histogram[i]);
+    }
+    serialLog.println();
+
+    // Link conditions, and the response timeouts derived from them
+    const LinkSelector& links = network.links();
+    for (int i = 0; i < links.linkCount(); i++) {
+        serialLog.print("[Net] ");
+        serialLog.print(network.linkName(i));
+        serialLog.print(": srtt ");
+        serialLog.print(links.smoothedRttMs(i));
+        serialLog.print(" ms");
+        if (links.signalDbm(i) != 0) {
+            serialLog.print(", signal ");
+            serialLog.print(links.signalDbm(i));
+            serialLog.print(" dBm (weakest ");
+            serialLog.print(links.weakestSignalDbm(i));
+            serialLog.print(")");
+        }
+        serialLog.println();
+    }
+    logRoundTrips("[AzuraCast]", azuracast.roundTrips());
+    logRoundTrips("[Flowsheet]", flowsheet.roundTrips());
+}
+
+// ========== Watchdog ==========
+
+StallDetector stallDetector(WATCHDOG_TIMEOUT_MS);
+
+/**
+ * Reports what the last run was doing if the watchdog (or anything else)
+ * reset it mid-operation, then arms the watchdog. From here on loop() and
+ * every StallScope must kick it within WATCHDOG_TIMEOUT_MS.
+ */
+void startWatchdog() {
+    StallReport stall;
+    if (stallDetector.attach(persistentStallRecord(), resetByWatchdog(), &stall)) {
+        serialLog.print(stall.watchdog ? "[Watchdog] Watchdog reset" : "[Watchdog] Reset");
+        if (stall.op == STALL_NONE) {
+            serialLog.println(" outside any tracked operation.");
+        } else {
+            serialLog.print(" during ");
+            serialLog.print(stallOpName(stall.op));
+            serialLog.print(stall.watchdog ? ", in flight " : ", in flight at least ");
+            serialLog.print(stall.inFlightMs);
+            serialLog.println(" ms.");
+        }
+    }
+    watchdogStart(WATCHDOG_TIMEOUT_MS);
+}
+
+// ========== Checkpoint ==========
+
+/**
+ * Boot-time Context from the flash checkpoint: an open show is carried into
+ * CONNECTING_WIFI (see resumeContext()) along with the last track logged and
+ * the poll deadline.
+ */
+void restoreCheckpoint() {
+    FlashRegion* flash = checkpointFlashRegion();
+    Checkpoint saved;
+    bool restored = flash && checkpoints.begin(*flash, &saved);
+    if (!flash) {
+        serialLog.println("[Checkpoint] No flash region; state will not survive a reset.");
+    }
+
+    unsigned long pollDueInMs = 0;
+    unsigned long epoch = network.getEpochTime();
+    if (restored && epoch > 0 && saved.pollDueEpoch > epoch) {
+        pollDueInMs = (saved.pollDueEpoch - epoch) * 1000UL;
+    }
+    ctx = resumeContext(restored ? &saved : nullptr, millis(), pollDueInMs, POLL_INTERVAL_MS);
+    azuracast.restoreShId(restored ? saved.lastShId : 0);
+
+    if (ctx.radioShowID > 0) {
+        serialLog.print("[Checkpoint] Open show radioShowID=");
+        serialLog.print(ctx.radioShowID);
+        serialLog.print(", last sh_id=");
+        serialLog.println(saved.lastShId);
+    }
+}
+
+/**
+ * Writes a checkpoint when state, show or last track changed (the store
+ * skips anything else). A track whose entry is still held in the flowsheet
+ * queue is not recorded yet, so a reset before it is sent logs it again
+ * instead of losing it.
+ */
+void saveCheckpoint(unsigned long epoch) {
+    int shId = azuracast.getShId();
+    if (flowsheet.queuedEntries() > 0 && checkpoints.hasRecord()) {
+        shId = checkpoints.last().lastShId;
+    }
+
+    uint32_t pollDueEpoch = 0;
+    if (epoch > 0 && ctx.state == AUTO_DJ_ACTIVE) {
+        unsigned long sincePoll = millis() - ctx.lastPollTime;
+        unsigned long dueInMs = sincePoll >= POLL_INTERVAL_MS ? 0 : POLL_INTERVAL_MS - sincePoll;
+        pollDueEpoch = epoch + dueInMs / 1000;
+    }
+
+    if (checkpoints.isReady() && !checkpoints.save(makeCheckpoint(ctx, shId, pollDueEpoch))) {
+        serialLog.println("[Checkpoint] Flash write failed.");
     }
 }
 
+// ========== Play History ==========
+
+#if ENABLE_PLAY_HISTORY
+/**
+ * Opens the play history on the SD card and has the flowsheet record each
+ * entry's outcome in it.
+ */
+void startPlayHistory() {
+    HistoryFile* records;
+    HistoryFile* index;
+    if (!playHistoryFiles(&records, &index) || !playHistory.begin(*records, *index)) {
+        serialLog.println("[History] No SD card; plays will not be recorded.");
+        return;
+    }
+    flowsheet.recordTo(&playHistory);
+    serialLog.print("[History] ");
+    serialLog.print(playHistory.count());
+    serialLog.println(" plays on the SD card.");
+}
+
+/**
+ * Writes the waiting batch of plays when it is due, from loop()'s idle
+ * time only.
+ */
+void writePlayHistory() {
+    if (playHistory.pending() == 0) return;
+    StallScope stallScope(STALL_HISTORY);
+    bool ok = playHistory.update(millis());
+    if (!ok && !playHistoryFailing) serialLog.println("[History] SD write failed.");
+    playHistoryFailing = !ok;
+}
+#endif
+
+// ========== Metrics ==========
+
+#if ENABLE_METRICS
+bool metricsListening = false;
+
+/**
+ * What a scrape reports, read from the modules' own counters when its
+ * request has arrived.
+ */
+void sampleMetrics(MetricsSample* sample) {
+    const AzuraCastClient::PollStats& polls = azuracast.stats();
+    sample->state = ctx.state;
+    sample->uptimeS = millis() / 1000;
+    sample->polls = polls.polls;
+    sample->pollsUnchanged = polls.unchanged;
+    sample->pollsFailed = polls.failed;
+    for (int i = 0; i < PLAY_STATUS_COUNT; i++) {
+        sample->entries[i] = flowsheet.entryCount((PlayStatus)i);
+    }
+    sample->retries = retriesScheduled;
+    sample->heapInUse = memStats.heapInUse();
+    sample->heapPeak = memStats.heapPeak();
+    sample->stackFree = memStats.stackFree();
+    const LinkSelector& links = network.links();
+    sample->linkCount = links.linkCount();
+    for (int i = 0; i < links.linkCount(); i++) {
+        sample->linkNames[i] = network.linkName(i);
+        sample->linkSignalDbm[i] = links.signalDbm(i);
+    }
+    sample->loop = &loopTimes;
+}
+
+MetricsServer metrics(sampleMetrics);
+
+/**
+ * Listens once a link is up, takes a waiting scraper when none is being
+ * served, and moves the scrape in progress along by one step.
+ */
+void serviceMetrics() {
+    if (!metricsListening) {
+        if (!network.isConnected()) return;
+        metricsListening = metricsListen();
+    }
+    if (!metrics.busy()) {
+        Client* scraper = metricsAccept();
+        if (scraper) metrics.begin(scraper, millis());
+    }
+    metrics.update(millis());
+}
+#endif
+
 // ========== Setup ==========
 
 void setup() {
     Serial.begin(115200);
     while (!Serial && millis() < 3000); // Wait up to 3s for Serial
-    Serial.println();
-    Serial.println("=== WXYC Auto DJ Arduino Switch ===");
+    serialLog.println();
+    serialLog.println("=== WXYC Auto DJ Arduino Switch ===");
+    serialLog.println("[Firmware] Version " FIRMWARE_VERSION);
+    startWatchdog();
 
     pinMode(LED_BUILTIN, OUTPUT);
     relayMonitor.setUp();
+    randomSeed(analogRead(ETHERNET_ENTROPY_PIN) ^ micros()); // retry backoff jitter
 
     ctx.state = CONNECTING_WIFI;
     ctx.retryCount = 0;
-    Serial.print("[State] BOOTING -> CONNECTING_WIFI");
-    Serial.println();
+    serialLog.print("[State] BOOTING -> CONNECTING_WIFI");
+    serialLog.println();
+    flushLog();
+
+    // Preference order: Ethernet first, WiFi as fallback
+#if ENABLE_ETHERNET
+    network.addTransport(ethernetTransport);
+#endif
+    network.addTransport(wifiTransport);
+    network.setUp();
 
-    wifiManager.setUp();
+    restoreCheckpoint();
+#if ENABLE_PLAY_HISTORY
+    startPlayHistory();
+#endif
 
-    if (wifiManager.isConnected()) {
+    if (network.isConnected()) {
         lastNtpSync = millis();
-        Serial.print("[Time] Epoch: ");
-        Serial.println(wifiManager.getEpochTime());
-        ctx.state = IDLE;
+        serialLog.print("[Time] Epoch: ");
+        serialLog.println(network.getEpochTime());
+        // Relay level, not a change event: it may have moved while powered down
+        ctx.state = reconnectState(ctx.radioShowID, relayMonitor.isAutoDJActive());
         ctx.retryCount = 0;
-        Serial.println("[State] CONNECTING_WIFI -> IDLE");
+        logTransition(CONNECTING_WIFI, ctx.state);
+    }
+
+    flushLog();
+}
+
+// ========== Warm-up ==========
+
+/**
+ * While IDLE: keeps the track now playing warm at a low rate, and once the
+ * relay has closed but is still settling, refreshes it if stale and opens
+ * the flowsheet connection. The show then starts without a handshake and
+ * logs that track as soon as it exists, instead of a poll later.
+ */
+void warmUp(const Inputs& inputs) {
+    bool closing = relayMonitor.activationPending() ||
+                   (inputs.relayStateChanged && inputs.autoDJActive);
+    if (closing) {
+        if (!awaitingFirstEntry) {
+            awaitingFirstEntry = true;
+            relayEdgeAt = inputs.currentMillis;
+            entriesBeforeShow = flowsheet.entriesAdded();
+        }
+        if (!azuracast.isWarm(WARM_TRACK_MAX_AGE_MS)) azuracast.warm();
+        flowsheet.preconnect(); // last: a link hands out one client at a time
+        return;
+    }
+    awaitingFirstEntry = false; // the contact bounced back open
+
+    if (inputs.currentMillis - lastWarmPoll >= IDLE_WARM_INTERVAL_MS) {
+        lastWarmPoll = inputs.currentMillis;
+        azuracast.warm();
     }
 }
 
+/**
+ * Logs how long the show's first entry took from the relay closing.
+ */
+void reportFirstEntry() {
+    if (!awaitingFirstEntry) return;
+    if (ctx.state != STARTING_SHOW && ctx.state != AUTO_DJ_ACTIVE) {
+        awaitingFirstEntry = false;
+        return;
+    }
+    if (flowsheet.entriesAdded() == entriesBeforeShow) return;
+    awaitingFirstEntry = false;
+    serialLog.print("[Flowsheet] First entry ");
+    serialLog.print(millis() - relayEdgeAt);
+    serialLog.println(" ms after the relay closed.");
+}
+
+// ========== Firmware Update ==========
+
+#if ENABLE_OTA
+/**
+ * While IDLE with the relay open: checks for a newer release every
+ * FIRMWARE_CHECK_INTERVAL_MS and streams it into the spare flash bank one
+ * window per loop. A show pauses the download where it is; once the image
+ * is verified the board switches banks and resets into it.
+ */
+void updateFirmware(const Inputs& inputs) {
+    switch (firmware.status()) {
+        case FIRMWARE_DOWNLOADING:
+            firmware.update();
+            break;
+        case FIRMWARE_VERIFIED:
+            serialLog.print("[Firmware] Restarting into version ");
+            serialLog.println(firmware.version());
+            flushLog();
+            firmwareActivate();
+            break;
+        default: {
+            if (firmwareChecked &&
+                inputs.currentMillis - lastFirmwareCheck < FIRMWARE_CHECK_INTERVAL_MS) {
+                break;
+            }
+            firmwareChecked = true;
+            lastFirmwareCheck = inputs.currentMillis;
+            FlashRegion* slot = firmwareFlashRegion();
+            FirmwareManifest manifest;
+            if (slot && firmware.check(FIRMWARE_MANIFEST_PATH, FIRMWARE_VERSION, &manifest)) {
+                firmware.begin(manifest, *slot);
+            }
+            break;
+        }
+    }
+}
+#endif
+
 // ========== Main Loop ==========
 
 void loop() {
+    feedWatchdog();
+    unsigned long loopStart = millis();
+
     // Always update hardware monitors
     relayMonitor.update();
-    wifiManager.update();
+    network.update();
 
     // Heartbeat LED
     digitalWrite(LED_BUILTIN, (millis() / 1000) % 2 == 0 ? HIGH : LOW);
 
     // Periodic NTP re-sync
-    if (wifiManager.isConnected() && (millis() - lastNtpSync > NTP_SYNC_INTERVAL_MS)) {
+    if (network.isConnected() && (millis() - lastNtpSync > NTP_SYNC_INTERVAL_MS)) {
         lastNtpSync = millis();
-        Serial.print("[Time] NTP re-sync, epoch: ");
-        Serial.println(wifiManager.getEpochTime());
+        serialLog.print("[Time] NTP re-sync, epoch: ");
+        serialLog.println(network.getEpochTime());
     }
 
     // ---- GATHER INPUTS ----
     Inputs inputs;
     inputs.relayStateChanged = relayMonitor.stateChanged();
     inputs.autoDJActive = relayMonitor.isAutoDJActive();
-    inputs.wifiConnected = wifiManager.isConnected();
-    inputs.epochTime = wifiManager.getEpochTime();
+    inputs.wifiConnected = network.isConnected(); // any link, not just WiFi
+    inputs.epochTime = network.getEpochTime();
     inputs.currentMillis = millis();
     inputs.pollIntervalMs = POLL_INTERVAL_MS;
     inputs.maxRetries = MAX_RETRIES;
-    inputs.retryBackoffMs = RETRY_BACKOFF_MS;
+    // Retries are never paced faster than the flowsheet host is now
+    // given to answer, which tracks its round trips and the link's signal
+    unsigned long responseTimeout = flowsheet.responseTimeoutMs();
+    inputs.retryBackoffMs = responseTimeout > RETRY_BACKOFF_MS ? responseTimeout : RETRY_BACKOFF_MS;
+    inputs.retryBackoffMaxMs = RETRY_BACKOFF_MAX_MS;
+    inputs.jitter = random(RETRY_BACKOFF_MAX_MS);
 
     // Default I/O results
     inputs.startShowResult = -1;
     inputs.endShowResult = false;
+    inputs.breakerWaitMs = 0;
     inputs.pollNewTrack = false;
     inputs.pollLiveDJ = false;
+    inputs.pollShId = 0;
 
     // ---- PRE-TICK I/O ----
+    bool attemptDue = retryDue(ctx, inputs.currentMillis);
     switch (ctx.state) {
+        case IDLE:
+            if (inputs.wifiConnected) warmUp(inputs);
+#if ENABLE_OTA
+            // Not while the relay is closing: the show needs the link
+            if (inputs.wifiConnected && !awaitingFirstEntry) updateFirmware(inputs);
+#endif
+            break;
         case STARTING_SHOW: {
+            if (!attemptDue) break;
+            inputs.breakerWaitMs = flowsheet.circuitBreaker().refusingForMs(inputs.currentMillis);
+            if (inputs.breakerWaitMs > 0) break;
             unsigned long hourMs = currentHourMs(inputs.epochTime);
             if (hourMs > 0) {
                 inputs.startShowResult = flowsheet.startShow(hourMs);
             }
+            // The track already playing is logged with the new show
+            if (inputs.startShowResult > 0 && azuracast.takeWarm(WARM_TRACK_MAX_AGE_MS)) {
+                inputs.pollNewTrack = true;
+                inputs.pollLiveDJ = azuracast.isLiveDJ();
+                inputs.pollShId = azuracast.getShId();
+            }
             break;
         }
         case AUTO_DJ_ACTIVE:
             if (inputs.currentMillis - ctx.lastPollTime >= POLL_INTERVAL_MS) {
                 inputs.pollNewTrack = azuracast.poll();
                 inputs.pollLiveDJ = azuracast.isLiveDJ();
-                inputs.artist = azuracast.getArtist();
-                inputs.title = azuracast.getTitle();
-                inputs.album = azuracast.getAlbum();
+                inputs.pollShId = azuracast.getShId();
             }
             break;
         case ENDING_SHOW:
-            inputs.endShowResult = flowsheet.endShow(ctx.radioShowID);
+            if (!attemptDue) break;
+            inputs.breakerWaitMs = flowsheet.circuitBreaker().refusingForMs(inputs.currentMillis);
+            if (inputs.breakerWaitMs == 0) inputs.endShowResult = flowsheet.endShow(ctx.radioShowID);
             break;
         default:
             break;
@@ -136,16 +655,40 @@ void loop() {
 
     // ---- TICK ----
     State prevState = ctx.state;
+    int prevRetryCount = ctx.retryCount;
     TickResult result = tick(ctx, inputs);
     ctx = result.context;
     logTransition(prevState, ctx.state);
+    if (ctx.retryCount > prevRetryCount) retriesScheduled++;
 
     // ---- POST-TICK I/O ----
-    if (result.addEntry) {
-        flowsheet.addEntry(ctx.radioShowID, result.addEntryHourMs,
-            result.addEntryArtist, result.addEntryTitle, result.addEntryAlbum);
+    if (ctx.state == AUTO_DJ_ACTIVE) {
+        flowsheet.update(); // held entries, unless ENDING_SHOW takes them along
+    } else if (prevState == ENDING_SHOW && ctx.radioShowID < 0) {
+        flowsheet.discardEntries(); // sign-off gave up; their show is gone
     }
-    if (result.delayMs > 0) {
-        delay(result.delayMs);
+    if (result.addEntry) {
+        // Read straight from the client's slot, once, as the entry is queued
+        const NowPlayingTrack* track = azuracast.track(result.addEntryShId);
+        if (track) {
+            flowsheet.queueEntry(ctx.radioShowID, result.addEntryHourMs,
+                track->artist, track->title, track->album, track->shId);
+        }
+        // Only later entries are held for a sign-off to join
+        if (prevState == STARTING_SHOW) flowsheet.flush();
     }
+    saveCheckpoint(inputs.epochTime);
+    reportFirstEntry();
+
+    // ---- IDLE TIME ----
+#if ENABLE_PLAY_HISTORY
+    writePlayHistory();
+#endif
+    sampleMemory();
+    reportMemStats();
+#if ENABLE_METRICS
+    serviceMetrics();
+#endif
+    drainLog();
+    loopTimes.observe(millis() - loopStart);
 }
@@ -1,45 +1,85 @@
 #include "azuracast_client.h"
 #include "config.h"
+#include "log_buffer.h"
+#include "mem_stats.h"
+#include "stall_detector.h"
 
-#include <WiFi.h>
-#include <WiFiSSLClient.h>
 #include <ArduinoHttpClient.h>
 #include <ArduinoJson.h>
+#include <string.h>
 
-AzuraCastClient::AzuraCastClient(const char* host, int port, const char* path)
-    : host(host)
+AzuraCastClient::AzuraCastClient(NetworkManager& network, const char* host, int port,
+                                 const char* path)
+    : network(network)
+    , host(host)
     , port(port)
     , path(path)
-    , lastShId(0)
+    , breaker(BREAKER_FAILURE_THRESHOLD, BREAKER_OPEN_MS)
+    , rtt(HTTP_RESPONSE_TIMEOUT_MS, HTTP_TIMEOUT_MIN_MS, HTTP_TIMEOUT_MAX_MS)
     , liveDJ(false)
+    , following(false)
+    , delivered(false)
+    , hasWarm(false)
+    , warmAt(0)
 {
+    current.shId = 0;
+    current.liveDJ = false;
+    pending.shId = 0;
+    pending.liveDJ = false;
+    warmTrack.shId = 0;
+    warmTrack.liveDJ = false;
+    pollStats.polls = 0;
+    pollStats.unchanged = 0;
+    pollStats.failed = 0;
 }
 
-bool AzuraCastClient::poll() {
-    // Create SSL client locally to avoid the Giga R1 global WiFiClient crash bug.
-    // Must call stop() before going out of scope to prevent socket leak.
-    WiFiSSLClient ssl;
-    HttpClient http(ssl, host, port);
-    http.setHttpResponseTimeout(HTTP_RESPONSE_TIMEOUT_MS);
+// Outcome of one GET attempt over a single link
+enum FetchResult {
+    FETCH_OK,
+    FETCH_CONNECTION_ERROR, // never reached the server; try another link
+    FETCH_FAILED            // server answered, but not with usable JSON
+};
+
+// Sends the GET and reads the status line, leaving the body unread. The
+// wait for the status line is timed into rtt, which also sets its timeout.
+static FetchResult request(HttpClient& http, const char* path, NetworkManager& network,
+                           RttEstimator& rtt) {
+    http.setHttpResponseTimeout(network.responseTimeoutMs(rtt.timeoutMs()));
 
-    Serial.print("[AzuraCast] Polling...");
     int err = http.get(path);
     if (err != 0) {
-        Serial.print(" connection error: ");
-        Serial.println(err);
-        http.stop();
-        return false;
+        serialLog.print(" connection error: ");
+        serialLog.print(err);
+        return FETCH_CONNECTION_ERROR;
     }
 
+    unsigned long sent = millis();
     int statusCode = http.responseStatusCode();
+    if (statusCode > 0) {
+        rtt.sample(millis() - sent);
+    } else if (statusCode == HTTP_ERROR_TIMED_OUT) {
+        rtt.timedOut();
+    }
+    if (statusCode < 0) {
+        serialLog.print(" no response: ");
+        serialLog.print(statusCode);
+        return FETCH_CONNECTION_ERROR;
+    }
     if (statusCode != 200) {
-        Serial.print(" HTTP ");
-        Serial.println(statusCode);
-        // Must fully read response body before stop() to avoid socket leak
-        http.responseBody();
-        http.stop();
-        return false;
+        serialLog.print(" HTTP ");
+        serialLog.println(statusCode);
+        // The error page is left unread rather than copied into a String:
+        // the connection is closed after every poll, which drops it
+        return FETCH_FAILED;
     }
+    return FETCH_OK;
+}
+
+static FetchResult fetch(Client& client, const char* host, int port, const char* path,
+                         NetworkManager& network, RttEstimator& rtt, JsonDocument& doc) {
+    HttpClient http(client, host, port);
+    FetchResult result = request(http, path, network, rtt);
+    if (result != FETCH_OK) return result;
 
     // Filter document: parse only the fields we need from the ~10KB response.
     // This keeps ArduinoJson memory usage under 1KB.
@@ -50,47 +90,336 @@ bool AzuraCastClient::poll() {
     filter["now_playing"]["song"]["album"] = true;
     filter["live"]["is_live"] = true;
 
-    JsonDocument doc;
     DeserializationError jsonErr = deserializeJson(doc, http.responseStream(),
         DeserializationOption::Filter(filter));
 
-    http.stop();
-
     if (jsonErr) {
-        Serial.print(" JSON parse error: ");
-        Serial.println(jsonErr.c_str());
-        return false;
+        serialLog.print(" JSON parse error: ");
+        serialLog.println(jsonErr.c_str());
+        return FETCH_FAILED;
+    }
+
+    return FETCH_OK;
+}
+
+// Whether the breaker lets a poll through; logs the skip if not
+static bool breakerAllows(CircuitBreaker& breaker) {
+    if (breaker.allow(millis())) return true;
+    serialLog.println(" circuit breaker open, skipped.");
+    return false;
+}
+
+// Any poll that yields no usable document counts against the server, but
+// only if a link was up to reach it
+static void recordPoll(CircuitBreaker& breaker, bool tried, FetchResult result) {
+    if (!tried) return;
+    if (breaker.record(result == FETCH_OK, millis())) {
+        serialLog.print("[AzuraCast] Circuit breaker ");
+        serialLog.println(CircuitBreaker::stateName(breaker.state()));
+    }
+}
+
+bool AzuraCastClient::follow(NowPlayingFanout& fanout, const char* shortcode) {
+    if (!fanout.subscribe(shortcode, *this)) return false;
+    following = true;
+    return true;
+}
+
+void AzuraCastClient::onTrackChange(const char*, const NowPlayingTrack& track) {
+    pending = track;
+    delivered = true;
+}
+
+bool AzuraCastClient::poll() {
+    MemScope memScope(MEM_AZURACAST);
+    StallScope stallScope(STALL_POLL);
+    serialLog.print("[AzuraCast] Polling...");
+    pollStats.polls++;
+
+    const NowPlayingTrack* track = &pending;
+    NowPlayingTrack fetched;
+    if (following) {
+        if (!delivered) {
+            serialLog.println(" same track.");
+            pollStats.unchanged++;
+            return false;
+        }
+        delivered = false;
+    } else {
+        if (!fetchTrack(&fetched)) {
+            pollStats.failed++;
+            return false;
+        }
+        track = &fetched;
+    }
+
+    liveDJ = track->liveDJ;
+    if (accept(*track)) return true;
+    if (track->shId == 0) {
+        pollStats.failed++;
+    } else {
+        pollStats.unchanged++;
+    }
+    return false;
+}
+
+bool AzuraCastClient::warm() {
+    if (following) return delivered; // the fan-out keeps `pending` current
+
+    MemScope memScope(MEM_AZURACAST);
+    StallScope stallScope(STALL_POLL);
+    serialLog.print("[AzuraCast] Warming...");
+
+    NowPlayingTrack track;
+    if (!fetchTrack(&track)) return false;
+    warmTrack = track;
+    warmAt = millis();
+    hasWarm = true;
+    serialLog.print(" now playing: ");
+    serialLog.print(track.artist);
+    serialLog.print(" - ");
+    serialLog.println(track.title);
+    return true;
+}
+
+bool AzuraCastClient::isWarm(unsigned long maxAgeMs) const {
+    if (following) return delivered;
+    return hasWarm && millis() - warmAt <= maxAgeMs;
+}
+
+bool AzuraCastClient::takeWarm(unsigned long maxAgeMs) {
+    if (following) return delivered && poll();
+    if (!isWarm(maxAgeMs)) return false;
+
+    MemScope memScope(MEM_AZURACAST);
+    hasWarm = false;
+    serialLog.print("[AzuraCast] Warm track:");
+    liveDJ = warmTrack.liveDJ;
+    return accept(warmTrack);
+}
+
+// Fetches the document on the best link and reads the track from it
+bool AzuraCastClient::fetchTrack(NowPlayingTrack* track) {
+    if (!breakerAllows(breaker)) return false;
+
+    JsonDocument doc;
+    FetchResult result = FETCH_CONNECTION_ERROR;
+    bool tried = false;
+    for (Client* client = network.open(); client; client = network.failover()) {
+        tried = true;
+        result = fetch(*client, host, port, path, network, rtt, doc);
+        if (result != FETCH_CONNECTION_ERROR) {
+            network.close(true);
+            break;
+        }
     }
 
-    liveDJ = doc["live"]["is_live"] | false;
+    if (result == FETCH_CONNECTION_ERROR) serialLog.println(" no link available.");
+    recordPoll(breaker, tried, result);
+    if (result != FETCH_OK) return false;
 
-    int shId = doc["now_playing"]["sh_id"] | 0;
-    if (shId == 0) {
-        Serial.println(" no sh_id in response.");
+    track->shId = doc["now_playing"]["sh_id"] | 0;
+    track->liveDJ = doc["live"]["is_live"] | false;
+    track->artist = doc["now_playing"]["song"]["artist"].as<String>();
+    track->title = doc["now_playing"]["song"]["title"].as<String>();
+    track->album = doc["now_playing"]["song"]["album"].as<String>();
+    return true;
+}
+
+// Records a fetched or delivered track; true if it is a new one
+bool AzuraCastClient::accept(const NowPlayingTrack& track) {
+    if (track.shId == 0) {
+        serialLog.println(" no sh_id in response.");
         return false;
     }
 
-    if (shId == lastShId) {
-        Serial.println(" same track.");
+    if (track.shId == current.shId) {
+        serialLog.println(" same track.");
         return false;
     }
 
-    // New track detected
-    lastShId = shId;
-    artist = doc["now_playing"]["song"]["artist"].as<String>();
-    title = doc["now_playing"]["song"]["title"].as<String>();
-    album = doc["now_playing"]["song"]["album"].as<String>();
+    // New track detected: the one copy into the slot
+    current = track;
 
-    Serial.print(" new track: ");
-    Serial.print(artist);
-    Serial.print(" - ");
-    Serial.println(title);
+    serialLog.print(" new track: ");
+    serialLog.print(current.artist);
+    serialLog.print(" - ");
+    serialLog.println(current.title);
 
     return true;
 }
 
-String AzuraCastClient::getArtist() const { return artist; }
-String AzuraCastClient::getTitle() const { return title; }
-String AzuraCastClient::getAlbum() const { return album; }
-int AzuraCastClient::getShId() const { return lastShId; }
+const NowPlayingTrack* AzuraCastClient::track(int shId) const {
+    if (shId == 0 || shId != current.shId) return nullptr;
+    return &current;
+}
+
+int AzuraCastClient::getShId() const { return current.shId; }
 bool AzuraCastClient::isLiveDJ() const { return liveDJ; }
+
+void AzuraCastClient::restoreShId(int shId) { current.shId = shId; }
+
+// ========== NowPlayingFanout ==========
+
+NowPlayingFanout::NowPlayingFanout(NetworkManager& network, const char* host, int port,
+                                   const char* path)
+    : network(network)
+    , host(host)
+    , port(port)
+    , path(path)
+    , breaker(BREAKER_FAILURE_THRESHOLD, BREAKER_OPEN_MS)
+    , rtt(HTTP_RESPONSE_TIMEOUT_MS, HTTP_TIMEOUT_MIN_MS, HTTP_TIMEOUT_MAX_MS)
+    , subscriptionCount(0)
+    , stationsSeen(0)
+{
+}
+
+bool NowPlayingFanout::subscribe(const char* shortcode, NowPlayingConsumer& consumer) {
+    if (subscriptionCount >= NOWPLAYING_FANOUT_MAX) return false;
+    Subscription& sub = subscriptions[subscriptionCount++];
+    sub.shortcode = shortcode;
+    sub.consumer = &consumer;
+    sub.lastShId = 0;
+    return true;
+}
+
+/**
+ * The response stream with one character of push-back, so the '{' that
+ * opens an array element can be found and then handed to deserializeJson().
+ * Reads wait on the underlying stream's timeout, not a second one of ours.
+ */
+class ElementStream : public Stream {
+public:
+    explicit ElementStream(Stream& in) : in(in), pushed(-1) { setTimeout(0); }
+
+    // Next non-whitespace character, or -1 at the end of the body
+    int nextToken() {
+        char c;
+        while (in.readBytes(&c, 1) == 1) {
+            if (c != ' ' && c != '\t' && c != '\r' && c != '\n') return (unsigned char)c;
+        }
+        return -1;
+    }
+    void unread(int c) { pushed = c; }
+
+    int available() override { return (pushed >= 0 ? 1 : 0) + in.available(); }
+    int read() override {
+        if (pushed < 0) {
+            char c;
+            return in.readBytes(&c, 1) == 1 ? (unsigned char)c : -1;
+        }
+        int c = pushed;
+        pushed = -1;
+        return c;
+    }
+    int peek() override { return pushed >= 0 ? pushed : in.peek(); }
+    size_t write(uint8_t) override { return 0; }
+
+private:
+    Stream& in;
+    int pushed;
+};
+
+/**
+ * Walks the array one element at a time. Returns the number of track
+ * changes delivered, or -1 if the document is not a well-formed array.
+ */
+int NowPlayingFanout::dispatch(Stream& body) {
+    JsonDocument filter;
+    filter["station"]["shortcode"] = true;
+    filter["now_playing"]["sh_id"] = true;
+    filter["now_playing"]["song"]["artist"] = true;
+    filter["now_playing"]["song"]["title"] = true;
+    filter["now_playing"]["song"]["album"] = true;
+    filter["live"]["is_live"] = true;
+
+    ElementStream stream(body);
+    if (stream.nextToken() != '[') {
+        serialLog.println(" not a station array.");
+        return -1;
+    }
+
+    int changes = 0;
+    int stations = 0;
+    int c = stream.nextToken();
+    if (c == ']') {
+        stationsSeen = 0;
+        return 0;
+    }
+    for (;;) {
+        stream.unread(c);
+        JsonDocument doc;
+        DeserializationError jsonErr = deserializeJson(doc, stream,
+            DeserializationOption::Filter(filter));
+        if (jsonErr) {
+            serialLog.print(" JSON parse error: ");
+            serialLog.println(jsonErr.c_str());
+            return -1;
+        }
+        stations++;
+
+        const char* shortcode = doc["station"]["shortcode"] | "";
+        int shId = doc["now_playing"]["sh_id"] | 0;
+        for (int i = 0; i < subscriptionCount; i++) {
+            Subscription& sub = subscriptions[i];
+            if (shId == 0 || shId == sub.lastShId || strcmp(sub.shortcode, shortcode) != 0) {
+                continue;
+            }
+            NowPlayingTrack track;
+            track.shId = shId;
+            track.liveDJ = doc["live"]["is_live"] | false;
+            track.artist = doc["now_playing"]["song"]["artist"].as<String>();
+            track.title = doc["now_playing"]["song"]["title"].as<String>();
+            track.album = doc["now_playing"]["song"]["album"].as<String>();
+            sub.lastShId = shId;
+            sub.consumer->onTrackChange(sub.shortcode, track);
+            changes++;
+        }
+
+        c = stream.nextToken();
+        if (c == ']') break;
+        if (c != ',') {
+            serialLog.println(" malformed station array.");
+            return -1;
+        }
+        c = stream.nextToken();
+    }
+    stationsSeen = stations;
+    return changes;
+}
+
+int NowPlayingFanout::poll() {
+    MemScope memScope(MEM_AZURACAST);
+    StallScope stallScope(STALL_POLL);
+    serialLog.print("[AzuraCast] Polling all stations...");
+
+    if (!breakerAllows(breaker)) return -1;
+
+    FetchResult result = FETCH_CONNECTION_ERROR;
+    int changes = -1;
+    bool tried = false;
+    for (Client* client = network.open(); client; client = network.failover()) {
+        tried = true;
+        HttpClient http(*client, host, port);
+        result = request(http, path, network, rtt);
+        if (result == FETCH_OK) {
+            changes = dispatch(http.responseStream());
+            if (changes < 0) result = FETCH_FAILED;
+        }
+        if (result != FETCH_CONNECTION_ERROR) {
+            network.close(true);
+            break;
+        }
+    }
+
+    if (result == FETCH_CONNECTION_ERROR) serialLog.println(" no link available.");
+    recordPoll(breaker, tried, result);
+    if (result != FETCH_OK) return -1;
+
+    serialLog.print(" ");
+    serialLog.print(stationsSeen);
+    serialLog.print(" stations, ");
+    serialLog.print(changes);
+    serialLog.println(" changed.");
+    return changes;
+}
@@ -2,6 +2,29 @@
 #define AZURACAST_CLIENT_H
 
 #include <Arduino.h>
+#include "config.h"
+#include "network_manager.h"
+#include "retry_policy.h"
+
+/** One station's current track, as read from a now-playing document. */
+struct NowPlayingTrack {
+    int shId;
+    bool liveDJ;
+    String artist;
+    String title;
+    String album;
+};
+
+/**
+ * Receives a station's track changes from a NowPlayingFanout.
+ */
+class NowPlayingConsumer {
+public:
+    virtual ~NowPlayingConsumer() {}
+    virtual void onTrackChange(const char* shortcode, const NowPlayingTrack& track) = 0;
+};
+
+class NowPlayingFanout;
 
 /**
  * Polls the AzuraCast now-playing API and detects track changes.
@@ -14,33 +37,168 @@
  * Track changes are detected by comparing now_playing.sh_id (a monotonically
  * increasing song history ID that is unique per play event).
  */
-class AzuraCastClient {
+class AzuraCastClient : public NowPlayingConsumer {
 public:
-    AzuraCastClient(const char* host, int port, const char* path);
+    /** poll() outcomes since power-on; warm() and takeWarm() are not counted. */
+    struct PollStats {
+        unsigned long polls;
+        unsigned long unchanged; // answered with the track already seen
+        unsigned long failed;    // no answer, or none with a sh_id
+    };
+
+    AzuraCastClient(NetworkManager& network, const char* host, int port, const char* path);
+
+    /**
+     * Takes this station's tracks from a shared fan-out instead of fetching
+     * its own document: poll() then reports the latest track the fan-out
+     * delivered, without touching the network. Returns false if the fan-out
+     * has no room for another subscription.
+     */
+    bool follow(NowPlayingFanout& fanout, const char* shortcode);
 
     /**
      * Polls the AzuraCast API. Returns true if a new track is detected.
-     * Creates and destroys the SSL client within the call to avoid
-     * the Giga R1 global WiFiClient crash bug.
+     * The SSL client comes from the NetworkManager for the duration of the
+     * call. The GET is idempotent, so a connection-level failure on one
+     * link is retried on the other. Polls that keep failing open a
+     * CircuitBreaker, and polls are skipped until it lets a probe through.
+     * The response is waited for as long as an RttEstimator fed by earlier
+     * polls allows.
      */
     bool poll();
 
-    String getArtist() const;
-    String getTitle() const;
-    String getAlbum() const;
+    /**
+     * Background fetch while no show is on (IDLE_WARM_INTERVAL_MS): keeps
+     * the track now playing in a warm slot, without taking it as the
+     * current track, so a show can log it the moment it starts instead of
+     * waiting for its first poll. Returns true if the slot was refreshed.
+     * When following a fan-out, the delivered track is the warm slot and
+     * nothing is fetched.
+     */
+    bool warm();
+
+    /**
+     * Whether the warm slot holds a track fetched within maxAgeMs.
+     */
+    bool isWarm(unsigned long maxAgeMs) const;
+
+    /**
+     * Takes the warm track as if poll() had just fetched it: returns true
+     * if it is a new track (see getArtist() etc.). Returns false, touching
+     * nothing, if the slot is empty or older than maxAgeMs.
+     */
+    bool takeWarm(unsigned long maxAgeMs);
+
+    /**
+     * The slot holding the current track, if it is still the track shId;
+     * nullptr once a newer track has replaced it. tick() passes only the
+     * sh_id along, so the orchestrator reads the metadata here once, when
+     * it posts the entry. Valid until the next poll() or takeWarm().
+     */
+    const NowPlayingTrack* track(int shId) const;
+
+    const String& getArtist() const { return current.artist; }
+    const String& getTitle() const { return current.title; }
+    const String& getAlbum() const { return current.album; }
     int getShId() const;
     bool isLiveDJ() const;
+    const CircuitBreaker& circuitBreaker() const { return breaker; }
+    const RttEstimator& roundTrips() const { return rtt; }
+    const PollStats& stats() const { return pollStats; }
+
+    /**
+     * Sets the sh_id of the last track seen, e.g. from a checkpoint after a
+     * reset, so that track is not reported as new again.
+     */
+    void restoreShId(int shId);
+
+    void onTrackChange(const char* shortcode, const NowPlayingTrack& track) override;
 
 private:
+    NetworkManager& network;
     const char* host;
     int port;
     const char* path;
+    CircuitBreaker breaker;
+    RttEstimator rtt;
+    PollStats pollStats;
 
-    int lastShId;
-    String artist;
-    String title;
-    String album;
-    bool liveDJ;
+    NowPlayingTrack current; // the last new track; shId 0 until one is seen
+    bool liveDJ;             // from the latest poll, new track or not
+
+    bool following;
+    bool delivered;      // a fan-out track not yet taken by poll()
+    NowPlayingTrack pending;
+
+    bool hasWarm;        // warm() fetched a track not yet taken
+    unsigned long warmAt;
+    NowPlayingTrack warmTrack;
+
+    bool fetchTrack(NowPlayingTrack* track);
+
+    bool accept(const NowPlayingTrack& track);
+};
+
+/**
+ * Polls AzuraCast's all-stations now-playing document (AZURACAST_ALL_PATH)
+ * once per call and hands each subscribed station's track changes to its
+ * consumers, so the request count stays at one per interval however many
+ * stations are watched.
+ *
+ * The document is a JSON array with one ~10KB object per station. It is
+ * never held whole: each element is deserialized on its own from the
+ * response stream through the same kind of filter AzuraCastClient uses, so
+ * memory is bounded by one filtered element (~1KB) regardless of the
+ * station count. Elements whose shortcode nobody subscribed to are parsed
+ * and dropped.
+ *
+ * A consumer hears about a station when its sh_id differs from the last one
+ * delivered for that subscription, including on the first poll. Failing
+ * polls open a CircuitBreaker, and responses are timed out by an
+ * RttEstimator, as for AzuraCastClient.
+ */
+class NowPlayingFanout {
+public:
+    NowPlayingFanout(NetworkManager& network, const char* host, int port, const char* path);
+
+    /**
+     * Adds a consumer for a station's shortcode (not copied; must outlive the
+     * fan-out). Several consumers may follow the same station. Returns false
+     * once NOWPLAYING_FANOUT_MAX subscriptions exist.
+     */
+    bool subscribe(const char* shortcode, NowPlayingConsumer& consumer);
+
+    /**
+     * Fetches the document and dispatches. Returns the number of track
+     * changes delivered, or -1 if the document could not be fetched or was
+     * malformed (changes before the fault are still delivered).
+     */
+    int poll();
+
+    /** Stations seen in the last successful poll, subscribed or not. */
+    int stationCount() const { return stationsSeen; }
+
+    const CircuitBreaker& circuitBreaker() const { return breaker; }
+    const RttEstimator& roundTrips() const { return rtt; }
+
+private:
+    struct Subscription {
+        const char* shortcode;
+        NowPlayingConsumer* consumer;
+        int lastShId;
+    };
+
+    NetworkManager& network;
+    const char* host;
+    int port;
+    const char* path;
+    CircuitBreaker breaker;
+    RttEstimator rtt;
+    Subscription subscriptions[NOWPLAYING_FANOUT_MAX];
+    int subscriptionCount;
+    int stationsSeen;
+
+    int dispatch(Stream& body);
 };
 
 #endif
@@ -0,0 +1,135 @@
+#include "backend_service_client.h"
+#include "config.h"
+#include "log_buffer.h"
+#include "mem_stats.h"
+#include "stall_detector.h"
+
+#include "http_response.h"
+
+#include <ArduinoJson.h>
+#include <stdio.h>
+
+// ========== Compile-time request parts ==========
+
+#define JSON_REQUEST_LINE(path) "POST " path " HTTP/1.1\r\n"
+
+static const char JOIN_LINE[] = JSON_REQUEST_LINE(BACKEND_SERVICE_PATH_JOIN);
+static const char ENTRY_LINE[] = JSON_REQUEST_LINE(BACKEND_SERVICE_PATH_ENTRY);
+static const char END_LINE[] = JSON_REQUEST_LINE(BACKEND_SERVICE_PATH_END);
+
+static_assert(sizeof(JOIN_LINE) <= FLOWSHEET_REQUEST_LINE_MAX, "request line too long");
+static_assert(sizeof(ENTRY_LINE) <= FLOWSHEET_REQUEST_LINE_MAX, "request line too long");
+static_assert(sizeof(END_LINE) <= FLOWSHEET_REQUEST_LINE_MAX, "request line too long");
+
+BackendServiceClient::BackendServiceClient(NetworkManager& network, const char* host, int port,
+                                           const char* token, long djID)
+    : FLOWSHEET_BASE(BackendServiceClient)(network, host, port, 200, true)
+    , token(token)
+    , djID(djID)
+    , entryHourMs(0)
+{
+    // Built once; ends with the Content-Length name so FormRequest can
+    // append the value
+    char portSuffix[8] = "";
+    if (port != 80 && port != 443) snprintf(portSuffix, sizeof(portSuffix), ":%d", port);
+    snprintf(headers, sizeof(headers),
+        "Host: %s%s\r\n"
+        "User-Agent: Arduino/2.2.0\r\n"
+        "Content-Type: application/json\r\n"
+        "Authorization: Bearer %s\r\n"
+        "Content-Length: ",
+        host, portSuffix, token);
+}
+
+// ========== Requests ==========
+
+const char* BackendServiceClient::composeEntry(const QueuedEntry& entry, FormRequest& form) {
+    if (entry.breakpoint) {
+        form.append("{\"message\":\"BREAKPOINT\"}");
+        return ENTRY_LINE;
+    }
+    form.append("{\"artist_name\":").appendJsonString(entry.artist.c_str(), FLOWSHEET_FIELD_MAX)
+        .append(",\"album_title\":").appendJsonString(entry.album.c_str(), FLOWSHEET_FIELD_MAX)
+        .append(",\"track_title\":").appendJsonString(entry.title.c_str(), FLOWSHEET_FIELD_MAX)
+        .append(",\"request_flag\":false,\"record_label\":\"\"}");
+    return ENTRY_LINE;
+}
+
+const char* BackendServiceClient::composeEnd(int, FormRequest& form) {
+    // The server tracks the DJ's open show; the sign-off names the DJ
+    form.append("{\"dj_id\":").appendNumber(djID).append("}");
+    return END_LINE;
+}
+
+/**
+ * Returns the "id" of a Show response body, or -1 if there is none.
+ */
+static int parseShowID(const char* body, size_t length) {
+    JsonDocument filter;
+    filter["id"] = true;
+    JsonDocument doc;
+    DeserializationError jsonErr = deserializeJson(doc, body, length,
+        DeserializationOption::Filter(filter));
+    if (jsonErr || !doc["id"].is<int>()) return -1;
+    int id = doc["id"].as<int>();
+    return id > 0 ? id : -1;
+}
+
+// ========== Public API ==========
+
+int BackendServiceClient::startShow(unsigned long startingHourMs) {
+    MemScope memScope(MEM_FLOWSHEET);
+    StallScope stallScope(STALL_START_SHOW);
+    serialLog.println("[Flowsheet] Joining show...");
+
+    FormRequest form = newRequest();
+    form.append("{\"dj_id\":").appendNumber(djID)
+        .append(",\"show_name\":").appendJsonString(AUTO_DJ_SHOW_NAME)
+        .append("}");
+    const char* request;
+    size_t length;
+    if (!form.finish(JOIN_LINE, headers, &request, &length)) {
+        serialLog.println("[Flowsheet] Request too large for buffer.");
+        return -1;
+    }
+
+    // Only a failure to connect is retried: a join the server may have
+    // seen is not resent (see FlowsheetClient::post())
+    Client* client = connect();
+    if (!client) return -1;
+    client->write((const uint8_t*)request, length);
+
+    HttpResponseReader response(*client, responseTimeoutMs());
+    char body[BACKEND_SERVICE_RESPONSE_MAX];
+    size_t bodyLength = 0;
+    int statusCode = readStatus(response);
+    if (statusCode > 0 && !response.readBody(body, sizeof(body), &bodyLength)) {
+        statusCode = HTTP_RESPONSE_TIMED_OUT;
+    }
+    release(statusCode > 0, statusCode > 0 && !response.closeRequested());
+
+    if (statusCode != 200) {
+        serialLog.print("[Flowsheet] Failed to join show, HTTP ");
+        serialLog.println(statusCode);
+        return -1;
+    }
+
+    int showID = parseShowID(body, bodyLength);
+    if (showID < 0) {
+        serialLog.print("[Flowsheet] Failed to parse show id from: ");
+        serialLog.println(body);
+        return -1;
+    }
+
+    entryHourMs = startingHourMs;
+    serialLog.print("[Flowsheet] Show joined, id=");
+    serialLog.println(showID);
+    return showID;
+}
+
+void BackendServiceClient::beforeEntry(int radioShowID, unsigned long workingHourMs) {
+    if (entryHourMs != 0 && workingHourMs != entryHourMs) {
+        queueBreakpoint(radioShowID, workingHourMs);
+    }
+    entryHourMs = workingHourMs;
+}
@@ -0,0 +1,56 @@
+#ifndef BACKEND_SERVICE_CLIENT_H
+#define BACKEND_SERVICE_CLIENT_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "flowsheet_backend.h"
+#include "network_manager.h"
+#include "request_template.h"
+
+/**
+ * Manages HTTP POST calls to the Backend-Service flowsheet API
+ * (docs/networking-spec.md sections 3.4 and 6.3).
+ *
+ * All requests authenticate with "Authorization: Bearer <token>", the Auto
+ * DJ account's Personal Access Token, and carry JSON bodies. Each body is
+ * written straight into the request buffer behind the constant header
+ * block -- no JsonDocument is built -- and the request leaves in a single
+ * write. Every operation answers 200; the show id comes from the join
+ * response's JSON body.
+ *
+ * The server keeps connections alive, and so does this client: a
+ * connection whose responses all arrived is left open, and the next
+ * request within FLOWSHEET_KEEPALIVE_MS reuses it instead of paying for
+ * another TCP and TLS handshake.
+ *
+ * Backend-Service does not insert hourly breakpoints the way tubafrenzy's
+ * autoBreakpoint=true does, so an entry whose working hour differs from
+ * the previous one (or the show's starting hour) is preceded by an
+ * explicit {"message":"BREAKPOINT"} entry. After a reset the previous hour
+ * is unknown, and the first entry goes without one.
+ */
+class BackendServiceClient : public FLOWSHEET_BASE(BackendServiceClient) {
+public:
+    BackendServiceClient(NetworkManager& network, const char* host, int port,
+                         const char* token, long djID);
+
+    /**
+     * Joins a new show (POST /flowsheet/join). Returns the show id from the
+     * response body, or -1 on failure.
+     */
+    int startShow(unsigned long startingHourMs) FLOWSHEET_HOOK;
+
+protected:
+    friend class FLOWSHEET_BASE(BackendServiceClient);
+
+    const char* composeEntry(const QueuedEntry& entry, FormRequest& form) FLOWSHEET_HOOK;
+    const char* composeEnd(int showID, FormRequest& form) FLOWSHEET_HOOK;
+    void beforeEntry(int radioShowID, unsigned long workingHourMs) FLOWSHEET_HOOK;
+
+private:
+    const char* token;
+    long djID;
+    unsigned long entryHourMs; // working hour of the latest entry, 0 if unknown
+};
+
+#endif
@@ -0,0 +1,221 @@
+#include "checkpoint.h"
+
+#include <string.h>
+
+// ========== Record format ==========
+//
+//   0  magic         "CKP1"
+//   4  sequence      uint32, +1 per record
+//   8  state         uint8
+//   9  (reserved)    3 bytes, 0
+//  12  radioShowID   int32
+//  16  lastShId      int32
+//  20  pollDueEpoch  uint32
+//  24  (reserved)    4 bytes, 0
+//  28  crc           CRC-32 of bytes 0-27
+//
+// All little-endian. An erased slot reads as all 0xFF.
+
+static const uint8_t RECORD_MAGIC[4] = {'C', 'K', 'P', '1'};
+#define RECORD_CRC_OFFSET 28
+
+static void putU32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t getU32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+static void encodeRecord(uint8_t* r, uint32_t sequence, const Checkpoint& cp) {
+    memset(r, 0, CHECKPOINT_RECORD_SIZE);
+    memcpy(r, RECORD_MAGIC, sizeof(RECORD_MAGIC));
+    putU32(r + 4, sequence);
+    r[8] = (uint8_t)cp.state;
+    putU32(r + 12, (uint32_t)cp.radioShowID);
+    putU32(r + 16, (uint32_t)cp.lastShId);
+    putU32(r + 20, cp.pollDueEpoch);
+    putU32(r + RECORD_CRC_OFFSET, crc32Ieee(r, RECORD_CRC_OFFSET));
+}
+
+static bool decodeRecord(const uint8_t* r, uint32_t* sequence, Checkpoint* cp) {
+    if (memcmp(r, RECORD_MAGIC, sizeof(RECORD_MAGIC)) != 0) return false;
+    if (getU32(r + RECORD_CRC_OFFSET) != crc32Ieee(r, RECORD_CRC_OFFSET)) return false;
+    if (r[8] > ERROR_STATE) return false;
+    *sequence = getU32(r + 4);
+    cp->state = (State)r[8];
+    cp->radioShowID = (int32_t)getU32(r + 12);
+    cp->lastShId = (int32_t)getU32(r + 16);
+    cp->pollDueEpoch = getU32(r + 20);
+    return true;
+}
+
+static bool isErased(const uint8_t* r) {
+    for (size_t i = 0; i < CHECKPOINT_RECORD_SIZE; i++) {
+        if (r[i] != 0xFF) return false;
+    }
+    return true;
+}
+
+uint32_t crc32Ieee(const void* data, size_t len, uint32_t crc) {
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+// ========== MemoryFlashRegion ==========
+
+MemoryFlashRegion::MemoryFlashRegion(uint8_t* storage, size_t sectorSize, int sectorCount)
+    : storage(storage)
+    , sectorBytes(sectorSize)
+    , sectors(sectorCount)
+    , erases(0)
+{
+}
+
+bool MemoryFlashRegion::read(size_t offset, void* buf, size_t len) {
+    if (offset + len > sectorBytes * sectors) return false;
+    memcpy(buf, storage + offset, len);
+    return true;
+}
+
+bool MemoryFlashRegion::program(size_t offset, const void* data, size_t len) {
+    if (offset + len > sectorBytes * sectors) return false;
+    const uint8_t* src = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) storage[offset + i] &= src[i];
+    return true;
+}
+
+bool MemoryFlashRegion::erase(int sector) {
+    if (sector < 0 || sector >= sectors) return false;
+    memset(storage + sector * sectorBytes, 0xFF, sectorBytes);
+    erases++;
+    return true;
+}
+
+// ========== CheckpointStore ==========
+
+CheckpointStore::CheckpointStore()
+    : flash(nullptr)
+    , slotsPerSector(0)
+    , sector(0)
+    , slot(0)
+    , sequence(0)
+    , haveLast(false)
+    , lastSaved()
+    , writes(0)
+{
+}
+
+bool CheckpointStore::begin(FlashRegion& region, Checkpoint* restored) {
+    flash = nullptr;
+    haveLast = false;
+    slotsPerSector = (int)(region.sectorSize() / CHECKPOINT_RECORD_SIZE);
+    if (slotsPerSector < 1 || region.sectorCount() < 2) return false;
+
+    // Newest valid record anywhere; the next write goes after the last used
+    // slot of its sector
+    uint8_t r[CHECKPOINT_RECORD_SIZE];
+    int newestSector = 0;
+    for (int s = 0; s < region.sectorCount(); s++) {
+        for (int i = 0; i < slotsPerSector; i++) {
+            if (!region.read((size_t)s * region.sectorSize() + (size_t)i * CHECKPOINT_RECORD_SIZE,
+                             r, sizeof(r))) {
+                return false;
+            }
+            if (isErased(r)) continue;
+            uint32_t seq;
+            Checkpoint cp;
+            if (decodeRecord(r, &seq, &cp) && (!haveLast || seq > sequence)) {
+                haveLast = true;
+                sequence = seq;
+                lastSaved = cp;
+                newestSector = s;
+            }
+        }
+    }
+
+    flash = &region;
+    sector = newestSector;
+    slot = 0;
+    if (haveLast) {
+        for (int i = 0; i < slotsPerSector; i++) {
+            region.read((size_t)sector * region.sectorSize() + (size_t)i * CHECKPOINT_RECORD_SIZE,
+                        r, sizeof(r));
+            if (!isErased(r)) slot = i + 1;
+        }
+    } else {
+        slot = slotsPerSector; // unknown contents: start on a freshly erased sector
+        sector = region.sectorCount() - 1;
+    }
+
+    if (haveLast && restored) *restored = lastSaved;
+    return haveLast;
+}
+
+bool CheckpointStore::save(const Checkpoint& cp) {
+    if (!flash) return false;
+    if (haveLast && cp.state == lastSaved.state && cp.radioShowID == lastSaved.radioShowID &&
+        cp.lastShId == lastSaved.lastShId) {
+        return true;
+    }
+
+    uint8_t r[CHECKPOINT_RECORD_SIZE];
+    uint8_t check[CHECKPOINT_RECORD_SIZE];
+    encodeRecord(r, sequence + 1, cp);
+
+    for (int attempt = 0; attempt < CHECKPOINT_WRITE_ATTEMPTS; attempt++) {
+        if (slot >= slotsPerSector) {
+            sector = (sector + 1) % flash->sectorCount();
+            slot = 0;
+            if (!flash->erase(sector)) return false;
+        }
+        size_t offset = (size_t)sector * flash->sectorSize() + (size_t)slot * CHECKPOINT_RECORD_SIZE;
+        slot++; // used even if the write fails
+        if (flash->program(offset, r, sizeof(r)) && flash->read(offset, check, sizeof(check)) &&
+            memcmp(r, check, sizeof(r)) == 0) {
+            sequence++;
+            lastSaved = cp;
+            haveLast = true;
+            writes++;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ========== Context mapping ==========
+
+Checkpoint makeCheckpoint(const Context& ctx, int lastShId, uint32_t pollDueEpoch) {
+    Checkpoint cp;
+    cp.state = ctx.state;
+    cp.radioShowID = ctx.radioShowID;
+    cp.lastShId = lastShId;
+    cp.pollDueEpoch = pollDueEpoch;
+    return cp;
+}
+
+Context resumeContext(const Checkpoint* saved, unsigned long currentMillis,
+                      unsigned long pollDueInMs, unsigned long pollIntervalMs) {
+    Context ctx;
+    ctx.state = CONNECTING_WIFI;
+    ctx.radioShowID = saved && saved->radioShowID > 0 ? saved->radioShowID : -1;
+    ctx.retryCount = 0;
+    ctx.backingOff = false;
+    ctx.retryAt = 0;
+    // tick() polls once currentMillis - lastPollTime reaches the interval;
+    // unsigned wrap-around makes this work right after boot too
+    if (pollDueInMs > pollIntervalMs) pollDueInMs = pollIntervalMs;
+    ctx.lastPollTime = currentMillis + pollDueInMs - pollIntervalMs;
+    return ctx;
+}
@@ -0,0 +1,131 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "state_machine.h"
+
+#define CHECKPOINT_RECORD_SIZE 32
+#define CHECKPOINT_WRITE_ATTEMPTS 3 // Slots tried before a save gives up
+
+/**
+ * The part of the sketch's state worth surviving a reset: enough to resume
+ * an open show instead of starting a new one.
+ */
+struct Checkpoint {
+    State state;
+    int32_t radioShowID;   // -1 = no open show
+    int32_t lastShId;      // last track logged, so it is not logged twice
+    uint32_t pollDueEpoch; // epoch seconds the next poll is due, 0 = unknown
+};
+
+/**
+ * A region of NOR flash: erase sets a whole sector to 0xFF, and programming
+ * can only clear bits. Offsets are relative to the start of the region.
+ */
+class FlashRegion {
+public:
+    virtual ~FlashRegion() {}
+    virtual size_t sectorSize() const = 0;
+    virtual int sectorCount() const = 0;
+    virtual bool read(size_t offset, void* buf, size_t len) = 0;
+    virtual bool program(size_t offset, const void* data, size_t len) = 0;
+    virtual bool erase(int sector) = 0;
+};
+
+/**
+ * FlashRegion over a RAM buffer, with NOR semantics (programming ANDs into
+ * the existing bytes). For tests and for boards without spare flash.
+ */
+class MemoryFlashRegion : public FlashRegion {
+public:
+    MemoryFlashRegion(uint8_t* storage, size_t sectorSize, int sectorCount);
+
+    size_t sectorSize() const { return sectorBytes; }
+    int sectorCount() const { return sectors; }
+    bool read(size_t offset, void* buf, size_t len);
+    bool program(size_t offset, const void* data, size_t len);
+    bool erase(int sector);
+
+    unsigned long eraseCount() const { return erases; }
+
+private:
+    uint8_t* storage;
+    size_t sectorBytes;
+    int sectors;
+    unsigned long erases;
+};
+
+/**
+ * Crash-safe store for the latest Checkpoint.
+ *
+ * Records are fixed-size, CRC-32 checked and carry a sequence number; each
+ * save appends one to the next free slot, so a sector is erased only once
+ * per sectorSize / CHECKPOINT_RECORD_SIZE saves and wear moves round all
+ * sectors of the region (at least two). The newest valid record always
+ * survives: the sector after the current one is erased only when the
+ * current one is full, and a record torn by a reset mid-write fails its
+ * CRC, so begin() falls back to the one before it.
+ *
+ * save() writes only when state, show or track differ from the last record;
+ * the poll deadline alone is not worth a flash write.
+ */
+class CheckpointStore {
+public:
+    CheckpointStore();
+
+    /**
+     * Scans the region for the newest valid record. Returns true and fills
+     * `restored` if there is one. Must be called before save().
+     */
+    bool begin(FlashRegion& flash, Checkpoint* restored);
+
+    /**
+     * Appends a record if the checkpoint changed meaningfully. Returns
+     * false if the write failed (or begin() was not called).
+     */
+    bool save(const Checkpoint& checkpoint);
+
+    bool isReady() const { return flash != nullptr; }
+    bool hasRecord() const { return haveLast; }
+    const Checkpoint& last() const { return lastSaved; }
+    unsigned long writeCount() const { return writes; }
+
+private:
+    FlashRegion* flash;
+    int slotsPerSector;
+    int sector;     // sector of the next write
+    int slot;       // slot of the next write; slotsPerSector = sector full
+    uint32_t sequence;
+    bool haveLast;
+    Checkpoint lastSaved;
+    unsigned long writes;
+};
+
+/**
+ * CRC-32 (IEEE 802.3, as used by zlib), bitwise.
+ */
+uint32_t crc32Ieee(const void* data, size_t len, uint32_t crc = 0);
+
+/**
+ * Snapshot of ctx for CheckpointStore::save().
+ */
+Checkpoint makeCheckpoint(const Context& ctx, int lastShId, uint32_t pollDueEpoch);
+
+/**
+ * Boot-time Context: CONNECTING_WIFI, carrying a saved open show if there
+ * is one, so that reconnectState() resumes it (or signs it off if the relay
+ * has opened) instead of starting a new show. The first poll of a resumed
+ * show is due pollDueInMs from now.
+ */
+Context resumeContext(const Checkpoint* saved, unsigned long currentMillis,
+                      unsigned long pollDueInMs, unsigned long pollIntervalMs);
+
+/**
+ * Platform: the flash region reserved for checkpoints, or nullptr if the
+ * board has none (checkpoint_platform.cpp on the Giga, the test shim on
+ * the host).
+ */
+FlashRegion* checkpointFlashRegion();
+
+#endif
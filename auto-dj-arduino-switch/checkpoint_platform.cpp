@@ -0,0 +1,55 @@
+/**
+ * Checkpoint flash for the Giga R1 (mbed OS): the last CHECKPOINT_SECTORS
+ * erase sectors (4 KB each) of the 16 MB QSPI flash, reached through the
+ * default block device. This is the tail of partition 4 in the layout the
+ * QSPIFormat example creates; keep any filesystem there clear of it.
+ */
+#if defined(ARDUINO_ARCH_MBED)
+
+#include "checkpoint.h"
+#include "config.h"
+
+#include "BlockDevice.h"
+
+class BlockDeviceFlashRegion : public FlashRegion {
+public:
+    BlockDeviceFlashRegion() : device(nullptr), start(0), sectorBytes(0) {}
+
+    bool begin() {
+        device = mbed::BlockDevice::get_default_instance();
+        if (!device || device->init() != 0) return false;
+        sectorBytes = (size_t)device->get_erase_size();
+        mbed::bd_size_t bytes = (mbed::bd_size_t)sectorBytes * CHECKPOINT_SECTORS;
+        if (sectorBytes == 0 || device->size() < bytes) return false;
+        start = device->size() - bytes;
+        return true;
+    }
+
+    size_t sectorSize() const { return sectorBytes; }
+    int sectorCount() const { return CHECKPOINT_SECTORS; }
+
+    bool read(size_t offset, void* buf, size_t len) {
+        return device->read(buf, start + offset, len) == 0;
+    }
+
+    bool program(size_t offset, const void* data, size_t len) {
+        return device->program(data, start + offset, len) == 0;
+    }
+
+    bool erase(int sector) {
+        return device->erase(start + (mbed::bd_addr_t)sector * sectorBytes, sectorBytes) == 0;
+    }
+
+private:
+    mbed::BlockDevice* device;
+    mbed::bd_addr_t start;
+    size_t sectorBytes;
+};
+
+FlashRegion* checkpointFlashRegion() {
+    static BlockDeviceFlashRegion region;
+    static bool ready = region.begin();
+    return ready ? &region : nullptr;
+}
+
+#endif
@@ -4,21 +4,61 @@
 // ========== Pin Assignments ==========
 #define RELAY_PIN 2        // Mixing board AUX relay contact (INPUT_PULLUP)
 #define STATUS_LED_PIN 3   // External status LED
+#define ETHERNET_CS_PIN 10 // Ethernet Shield 2 (W5500) SPI chip select
+#define ETHERNET_ENTROPY_PIN A0 // Floating analog pin seeding SSLClient's RNG
 
 // ========== Timing (milliseconds) ==========
-#define DEBOUNCE_MS 50
+#define DEBOUNCE_MS 50                 // Relay settle window until the contact's bounce is learned
+#define DEBOUNCE_MIN_MS 10             // Adaptive settle window bounds
+#define DEBOUNCE_MAX_MS 80
 #define POLL_INTERVAL_MS 20000         // 20s AzuraCast poll
+#define IDLE_WARM_INTERVAL_MS 60000    // Background now-playing fetch while IDLE
+#define WARM_TRACK_MAX_AGE_MS 5000     // Older warm tracks are refetched on a relay edge
 #define WIFI_RETRY_INTERVAL_MS 5000    // 5s WiFi reconnect delay
-#define HTTP_RESPONSE_TIMEOUT_MS 10000 // 10s HTTP timeout
+#define HTTP_RESPONSE_TIMEOUT_MS 10000 // 10s HTTP timeout until an endpoint's RTT is measured
+#define HTTP_TIMEOUT_MIN_MS 2000       // Bounds on the RTT-derived timeout; the maximum
+#define HTTP_TIMEOUT_MAX_MS 20000      // stays well inside the watchdog
 #define NTP_SYNC_INTERVAL_MS 3600000UL // Re-sync NTP every hour
 #define MAX_RETRIES 3
-#define RETRY_BACKOFF_MS 2000          // Base backoff between retries
+#define WATCHDOG_TIMEOUT_MS 30000     // Hardware watchdog; the Giga's longest is ~32s
+#define WIFI_CONNECT_TIMEOUT_MS 20000  // Bound on WiFi.begin(), well inside the watchdog
+#define RETRY_BACKOFF_MS 2000          // Base backoff between retries (doubled per retry, jittered)
+#define RETRY_BACKOFF_MAX_MS 30000     // Cap on the doubled backoff
+#define BREAKER_FAILURE_THRESHOLD 3    // Consecutive failures that open an endpoint's circuit breaker
+#define BREAKER_OPEN_MS 60000          // Open breaker refuses requests this long, then lets a probe through
+
+// ========== Network Transports ==========
+// Ethernet (W5500 shield + software TLS) is the primary link when enabled;
+// WiFi is the fallback. Enabling Ethernet requires the Ethernet, SSLClient
+// and NTPClient libraries and a generated trust_anchors.h (see README).
+#define ENABLE_ETHERNET 0
+#define ETHERNET_MAC { 0xA8, 0x61, 0x0A, 0xAE, 0x00, 0x01 } // Printed on the shield
+#define ETHERNET_DHCP_TIMEOUT_MS 10000
+#define LINK_FAILURE_THRESHOLD 2       // Consecutive failures before benching a link
+#define LINK_COOLDOWN_MS 60000         // Bench time before a failed link is probed again
+#define LINK_PREFERENCE_MS 250         // RTT advantage a fallback link needs to take over
+#define LINK_SIGNAL_SAMPLE_MS 10000    // WiFi RSSI sampling
+#define LINK_WEAK_SIGNAL_DBM -75       // Response timeouts are doubled on a link weaker than this
 
 // ========== AzuraCast ==========
 // Use the static JSON endpoint (Nginx-cached, lower server load)
 #define AZURACAST_HOST "remote.wxyc.org"
 #define AZURACAST_PORT 443
 #define AZURACAST_PATH "/api/nowplaying_static/main.json"
+// All stations in one document, for NowPlayingFanout (one GET per interval
+// however many stations are watched)
+#define AZURACAST_ALL_PATH "/api/nowplaying"
+#ifndef NOWPLAYING_FANOUT_MAX
+#define NOWPLAYING_FANOUT_MAX 16       // Subscriptions per NowPlayingFanout (the daemon raises it)
+#endif
+
+// ========== Flowsheet Backend ==========
+// Which flowsheet the Auto DJ logs to (docs/networking-spec.md section 6)
+#define TUBAFRENZY 1
+#define BACKEND_SERVICE 2
+#ifndef FLOWSHEET_BACKEND
+#define FLOWSHEET_BACKEND TUBAFRENZY   // or BACKEND_SERVICE
+#endif
 
 // ========== tubafrenzy ==========
 #define TUBAFRENZY_HOST "www.wxyc.info"
@@ -26,6 +66,20 @@
 #define TUBAFRENZY_PATH_START_SHOW "/playlists/startRadioShow"
 #define TUBAFRENZY_PATH_ADD_ENTRY  "/playlists/flowsheetEntryAdd"
 #define TUBAFRENZY_PATH_END_SHOW   "/playlists/finishRadioShow"
+#define FLOWSHEET_HEADERS_MAX 256      // Host/User-Agent/Content-Type/key header block
+#define FLOWSHEET_REQUEST_MAX 1536     // Whole request: line + headers + form body
+#define FLOWSHEET_FIELD_MAX 320        // Encoded artist/title/album each; longer ones are clipped
+#define FLOWSHEET_QUEUE_MAX 4          // Entries held for pipelining or a link outage
+#define FLOWSHEET_ENTRY_HOLD_MS 3000   // Hold an entry in case the sign-off follows
+#define FLOWSHEET_KEEPALIVE_MS 15000   // Reuse an idle kept-alive connection this long (Backend-Service)
+
+// ========== Backend-Service ==========
+#define BACKEND_SERVICE_HOST "api.wxyc.org"
+#define BACKEND_SERVICE_PORT 443
+#define BACKEND_SERVICE_PATH_JOIN  "/flowsheet/join"
+#define BACKEND_SERVICE_PATH_ENTRY "/flowsheet"
+#define BACKEND_SERVICE_PATH_END   "/flowsheet/end"
+#define BACKEND_SERVICE_RESPONSE_MAX 512 // Join response kept for its show id
 
 // ========== Auto DJ Identity ==========
 // These are written directly to the FLOWSHEET_RADIO_SHOW_PROD table --
@@ -35,6 +89,54 @@
 #define AUTO_DJ_HANDLE "AutoDJ"
 #define AUTO_DJ_SHOW_NAME "Auto DJ"
 
+// ========== Logging ==========
+#define LOG_BUFFER_SIZE 4096           // Ring buffer for Serial log output
+#define LOG_DRAIN_MAX_PER_LOOP 256     // Max bytes moved to Serial per loop()
+
+// ========== Memory Stats ==========
+#define MEM_SAMPLE_INTERVAL_MS 1000    // Heap/stack high-water sampling
+#define MEM_STATS_INTERVAL_MS 300000   // Stats dump to the log (5 min)
+
+// ========== Checkpoint ==========
+#define CHECKPOINT_SECTORS 4           // 4 KB QSPI sectors at the end of flash (see checkpoint_platform.cpp)
+
+// ========== Firmware Update ==========
+// Pull-based OTA (docs/remote-access-roadmap.md Phase 5): while IDLE, the
+// manifest is checked every FIRMWARE_CHECK_INTERVAL_MS, and a newer image
+// is downloaded a window at a time into the inactive flash bank, verified
+// and booted (see firmware_update.h and firmware_platform.cpp).
+#define ENABLE_OTA 0
+#define FIRMWARE_VERSION "1.0.0"
+#define FIRMWARE_HOST "www.wxyc.info"
+#define FIRMWARE_PORT 443
+#define FIRMWARE_MANIFEST_PATH "/auto-dj/firmware/manifest.json"
+#define FIRMWARE_CHECK_INTERVAL_MS 86400000UL // Daily
+#define FIRMWARE_WINDOW_BYTES 65536UL  // Bytes per Range request, one per loop()
+#define FIRMWARE_CHUNK_BYTES 1024      // RAM buffer between the socket and flash
+#define FIRMWARE_MAX_FAILURES 8        // Interrupted windows in a row before giving up
+#define FIRMWARE_KEEPALIVE_MS 5000     // Reuse the connection for the next window this long
+
+// ========== Play History ==========
+// Append-only record of every flowsheet entry's outcome on the Ethernet
+// shield's SD card, indexed by hour (see play_history.h and
+// history_platform.cpp). Writes are batched and made in loop()'s idle time.
+#define ENABLE_PLAY_HISTORY 0
+#define SD_CS_PIN 4                    // The Ethernet Shield Rev2's SD slot
+#define PLAY_HISTORY_PATH "PLAYS.DAT"
+#define PLAY_HISTORY_INDEX_PATH "PLAYS.IDX"
+#define PLAY_HISTORY_BATCH 4           // Records per SD write (4 x 128 B, one 512 B block)
+#define PLAY_HISTORY_FLUSH_MS 60000    // A partial batch is written after this long
+
+// ========== Metrics ==========
+// Prometheus text-format endpoint (GET /metrics) on the local network,
+// served a piece per loop() from fixed buffers (see metrics_server.h and
+// metrics_platform.cpp).
+#define ENABLE_METRICS 0
+#define METRICS_PORT 9100
+#define METRICS_TIMEOUT_MS 2000        // A scrape not done in this long is dropped
+#define METRICS_REQUEST_MAX 128        // Request line kept; the rest of the request is skipped
+#define METRICS_CHUNK_MAX 1024         // Response buffer: one metric family per loop()
+
 // ========== NTP ==========
 #define NTP_SERVER "pool.ntp.org"
 #define UTC_OFFSET_SECONDS -18000 // Eastern Time (UTC-5)
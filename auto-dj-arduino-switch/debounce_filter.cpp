@@ -0,0 +1,95 @@
+#include "debounce_filter.h"
+
+static const unsigned long BIN_UPPER_MS[DEBOUNCE_HISTOGRAM_BINS - 1] = {
+    1, 2, 5, 10, 20, 50, 100
+};
+
+DebounceFilter::DebounceFilter(unsigned long settleMs, unsigned long minMs,
+                               unsigned long maxMs)
+    : minMs(minMs)
+    , maxMs(maxMs)
+    , window(settleMs)
+    , learnedHoldMs(settleMs / 2)
+    , stable(1)
+    , inEpisode(false)
+    , reading(1)
+    , episodeStart(0)
+    , levelSince(0)
+    , longestHold(0)
+    , lastBounce(0)
+{
+    counters.transitions = 0;
+    counters.glitches = 0;
+    counters.edges = 0;
+    counters.longestBounceMs = 0;
+    for (int i = 0; i < DEBOUNCE_HISTOGRAM_BINS; i++) counters.histogram[i] = 0;
+}
+
+void DebounceFilter::reset(int level) {
+    stable = level;
+    reading = level;
+    inEpisode = false;
+}
+
+bool DebounceFilter::update(int sample, unsigned long nowMs) {
+    if (!inEpisode) {
+        if (sample == stable) return false;
+        inEpisode = true;
+        counters.edges++;
+        reading = sample;
+        episodeStart = nowMs;
+        levelSince = nowMs;
+        longestHold = 0;
+        return false;
+    }
+
+    if (sample != reading) {
+        counters.edges++;
+        unsigned long held = nowMs - levelSince;
+        if (held > longestHold) longestHold = held;
+        reading = sample;
+        levelSince = nowMs;
+    }
+
+    if (nowMs - levelSince <= window) return false;
+
+    bool changed = reading != stable;
+    endEpisode();
+    if (changed) {
+        stable = reading;
+        counters.transitions++;
+        int bin = 0;
+        while (bin < DEBOUNCE_HISTOGRAM_BINS - 1 && lastBounce >= BIN_UPPER_MS[bin]) bin++;
+        counters.histogram[bin]++;
+        if (lastBounce > counters.longestBounceMs) counters.longestBounceMs = lastBounce;
+    } else {
+        counters.glitches++;
+    }
+    return changed;
+}
+
+void DebounceFilter::endEpisode() {
+    inEpisode = false;
+    lastBounce = levelSince - episodeStart;
+    learn(longestHold);
+}
+
+void DebounceFilter::learn(unsigned long holdMs) {
+    if (holdMs >= learnedHoldMs) {
+        learnedHoldMs = holdMs;
+    } else {
+        learnedHoldMs -= (learnedHoldMs - holdMs + (1UL << DEBOUNCE_DECAY_SHIFT) - 1) >>
+                         DEBOUNCE_DECAY_SHIFT;
+    }
+
+    // Hold for twice the longest mid-episode hold before trusting a level
+    unsigned long settle = learnedHoldMs * 2;
+    if (settle < minMs) settle = minMs;
+    if (settle > maxMs) settle = maxMs;
+    window = settle;
+}
+
+unsigned long DebounceFilter::binUpperMs(int bin) {
+    if (bin < 0 || bin >= DEBOUNCE_HISTOGRAM_BINS - 1) return 0;
+    return BIN_UPPER_MS[bin];
+}
@@ -0,0 +1,89 @@
+#ifndef DEBOUNCE_FILTER_H
+#define DEBOUNCE_FILTER_H
+
+#define DEBOUNCE_HISTOGRAM_BINS 8 // bounce lengths <1, <2, <5, <10, <20, <50, <100, >=100 ms
+#define DEBOUNCE_DECAY_SHIFT 3    // the learned hold falls 1/8 of the way per quieter episode
+
+/**
+ * Contact-quality counters kept by DebounceFilter.
+ */
+struct DebounceStats {
+    unsigned long transitions;     // accepted changes of the debounced level
+    unsigned long glitches;        // excursions that returned to the old level
+    unsigned long edges;           // raw level changes seen, bounces included
+    unsigned long longestBounceMs; // first to last edge of a transition
+    unsigned long histogram[DEBOUNCE_HISTOGRAM_BINS]; // transitions by bounce length
+};
+
+/**
+ * Debounces a two-level contact with a settle window learned from the
+ * contact itself.
+ *
+ * A change of the raw level opens an episode; the episode ends once one
+ * level has held for the settle window. Ending on the other level is a
+ * transition, ending on the old one a glitch. Either way the longest time
+ * the contact held a level mid-episode is what a shorter window would
+ * have mistaken for settling, so the window is kept at twice the largest
+ * such hold seen lately, within [minMs, maxMs]: a clean contact is
+ * accepted after minMs instead of a fixed worst case, and a contact that
+ * starts bouncing longer widens the window on its first long bounce. The
+ * learned hold rises at once and decays slowly, so one quiet episode does
+ * not undo a bad one.
+ *
+ * Pure logic with no I/O; the caller samples the pin and passes the time.
+ */
+class DebounceFilter {
+public:
+    /**
+     * settleMs is the starting window, before any episode is seen.
+     */
+    DebounceFilter(unsigned long settleMs, unsigned long minMs, unsigned long maxMs);
+
+    /**
+     * Starts from a known settled level, e.g. the pin at power-on.
+     */
+    void reset(int level);
+
+    /**
+     * Feeds one sample. Returns true if the debounced level changed.
+     */
+    bool update(int reading, unsigned long nowMs);
+
+    int level() const { return stable; }
+
+    /**
+     * True while the raw level differs from the debounced one, i.e. a
+     * transition may be about to be accepted.
+     */
+    bool settling() const { return inEpisode && reading != stable; }
+
+    unsigned long settleMs() const { return window; }
+    unsigned long lastBounceMs() const { return lastBounce; }
+    const DebounceStats& stats() const { return counters; }
+
+    /**
+     * Upper bound (exclusive) of a histogram bin, 0 for the open-ended last.
+     */
+    static unsigned long binUpperMs(int bin);
+
+private:
+    unsigned long minMs;
+    unsigned long maxMs;
+    unsigned long window;
+    unsigned long learnedHoldMs;
+
+    int stable;
+    bool inEpisode;
+    int reading;
+    unsigned long episodeStart; // first edge
+    unsigned long levelSince;   // latest edge
+    unsigned long longestHold;  // within the episode
+    unsigned long lastBounce;
+
+    DebounceStats counters;
+
+    void endEpisode();
+    void learn(unsigned long holdMs);
+};
+
+#endif
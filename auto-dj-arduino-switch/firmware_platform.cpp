@@ -0,0 +1,75 @@
+/**
+ * Firmware slot for the Giga R1 (mbed OS): the STM32H747's second 1 MB
+ * flash bank, written through mbed::FlashIAP, and the option-byte bank
+ * swap that boots it.
+ *
+ * Whichever bank is running is mapped at 0x08000000 and the other at
+ * 0x08100000, so the slot is always the inactive bank. A published image
+ * is therefore a whole bank: bootloader and sketch together, within 1 MB.
+ * This needs the flash split that gives the M4 core no flash ("2MB M7"),
+ * so nothing else lives in the second bank.
+ */
+#if defined(ARDUINO_ARCH_MBED)
+
+#include "firmware_update.h"
+
+#include "FlashIAP.h"
+#include "stm32h7xx_hal.h"
+
+#define FIRMWARE_BANK_ADDRESS 0x08100000UL
+#define FIRMWARE_BANK_SIZE 0x00100000UL
+
+class BankFlashRegion : public FlashRegion {
+public:
+    BankFlashRegion() : sectorBytes(0) {}
+
+    bool begin() {
+        if (flash.init() != 0) return false;
+        sectorBytes = flash.get_sector_size(FIRMWARE_BANK_ADDRESS);
+        return sectorBytes != 0 && flash.get_page_size() <= FIRMWARE_PROGRAM_ALIGN;
+    }
+
+    size_t sectorSize() const { return sectorBytes; }
+    int sectorCount() const { return (int)(FIRMWARE_BANK_SIZE / sectorBytes); }
+
+    bool read(size_t offset, void* buf, size_t len) {
+        return flash.read(buf, FIRMWARE_BANK_ADDRESS + offset, len) == 0;
+    }
+
+    bool program(size_t offset, const void* data, size_t len) {
+        return flash.program(data, FIRMWARE_BANK_ADDRESS + offset, len) == 0;
+    }
+
+    bool erase(int sector) {
+        return flash.erase(FIRMWARE_BANK_ADDRESS + (uint32_t)sector * sectorBytes,
+                           sectorBytes) == 0;
+    }
+
+private:
+    mbed::FlashIAP flash;
+    uint32_t sectorBytes;
+};
+
+FlashRegion* firmwareFlashRegion() {
+    static BankFlashRegion region;
+    static bool ready = region.begin();
+    return ready ? &region : nullptr;
+}
+
+void firmwareActivate() {
+    FLASH_OBProgramInitTypeDef ob = {};
+    ob.Banks = FLASH_BANK_1;
+    HAL_FLASH_Unlock();
+    HAL_FLASH_OB_Unlock();
+    HAL_FLASHEx_OBGetConfig(&ob);
+
+    ob.OptionType = OPTIONBYTE_USER;
+    ob.USERType = OB_USER_SWAP_BANK;
+    ob.USERConfig = (ob.USERConfig & OB_SWAP_BANK_ENABLE) ? OB_SWAP_BANK_DISABLE
+                                                          : OB_SWAP_BANK_ENABLE;
+    HAL_FLASHEx_OBProgram(&ob);
+    HAL_FLASH_OB_Launch(); // reloads the option bytes, which resets
+    NVIC_SystemReset();
+}
+
+#endif
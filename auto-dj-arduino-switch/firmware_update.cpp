@@ -0,0 +1,348 @@
+#include "firmware_update.h"
+#include "http_response.h"
+#include "log_buffer.h"
+#include "stall_detector.h"
+
+#include <ArduinoJson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static_assert(FIRMWARE_CHUNK_BYTES % FIRMWARE_PROGRAM_ALIGN == 0,
+              "a padded last chunk must fit the chunk buffer");
+static_assert(FIRMWARE_WINDOW_BYTES % FIRMWARE_CHUNK_BYTES == 0,
+              "windows must end on a chunk, so a resumed window starts on one");
+
+// ========== Manifest ==========
+
+static bool copyField(char* field, size_t size, const char* value) {
+    if (!value || strlen(value) >= size) return false;
+    strcpy(field, value);
+    return true;
+}
+
+bool parseFirmwareManifest(const char* json, size_t length, FirmwareManifest* out) {
+    JsonDocument filter;
+    filter["version"] = true;
+    filter["url"] = true;
+    filter["size"] = true;
+    filter["sha256"] = true;
+    JsonDocument doc;
+    DeserializationError jsonErr = deserializeJson(doc, json, length,
+        DeserializationOption::Filter(filter));
+    if (jsonErr) return false;
+
+    if (!doc["version"].is<const char*>() || !doc["url"].is<const char*>() ||
+        !doc["sha256"].is<const char*>() || !doc["size"].is<unsigned long>()) {
+        return false;
+    }
+    if (!copyField(out->version, sizeof(out->version), doc["version"].as<const char*>()) ||
+        !copyField(out->path, sizeof(out->path), doc["url"].as<const char*>()) ||
+        out->path[0] != '/' ||
+        !sha256FromHex(doc["sha256"].as<const char*>(), out->sha256)) {
+        return false;
+    }
+    unsigned long size = doc["size"].as<unsigned long>();
+    if (size == 0 || size > 0xFFFFFFFFUL) return false;
+    out->size = (uint32_t)size;
+    return true;
+}
+
+int compareFirmwareVersions(const char* a, const char* b) {
+    while (*a || *b) {
+        char* end;
+        unsigned long x = strtoul(a, &end, 10);
+        a = *end == '.' ? end + 1 : end;
+        unsigned long y = strtoul(b, &end, 10);
+        b = *end == '.' ? end + 1 : end;
+        if (x != y) return x < y ? -1 : 1;
+        // Stop at anything that is not a dotted number
+        if ((*a && (*a < '0' || *a > '9')) || (*b && (*b < '0' || *b > '9'))) break;
+    }
+    return 0;
+}
+
+// ========== FirmwareUpdater ==========
+
+FirmwareUpdater::FirmwareUpdater(NetworkManager& network, const char* host, int port)
+    : network(network)
+    , host(host)
+    , port(port)
+    , rtt(HTTP_RESPONSE_TIMEOUT_MS, HTTP_TIMEOUT_MIN_MS, HTTP_TIMEOUT_MAX_MS)
+    , state(FIRMWARE_IDLE)
+    , slot(nullptr)
+    , programmed(0)
+    , failures(0)
+    , failedAt(0)
+    , backoffMs(0)
+    , kept(false)
+    , requests(0)
+    , resumes(0)
+{
+    memset(&image, 0, sizeof(image));
+}
+
+/**
+ * Writes a GET for path (with a Range header if range is given) on the
+ * connection kept from the last window if it is still good, else a new
+ * one, failing over to the other link if it cannot be made.
+ */
+Client* FirmwareUpdater::get(const char* path, const char* range) {
+    char portSuffix[8] = "";
+    if (port != 80 && port != 443) snprintf(portSuffix, sizeof(portSuffix), ":%d", port);
+    char request[FIRMWARE_REQUEST_MAX];
+    int length = snprintf(request, sizeof(request),
+        "GET %s HTTP/1.1\r\n"
+        "Host: %s%s\r\n"
+        "%s%s%s"
+        "\r\n",
+        path, host, portSuffix,
+        range ? "Range: " : "", range ? range : "", range ? "\r\n" : "");
+    if (length <= 0 || (size_t)length >= sizeof(request)) return nullptr;
+
+    Client* client = nullptr;
+    if (kept) {
+        kept = false;
+        client = network.resume(FIRMWARE_KEEPALIVE_MS);
+    }
+    if (!client) {
+        for (Client* c = network.open(); c; c = network.failover()) {
+            if (c->connect(host, port)) {
+                client = c;
+                break;
+            }
+        }
+    }
+    if (!client) return nullptr;
+    client->write((const uint8_t*)request, (size_t)length);
+    requests++;
+    return client;
+}
+
+// Reads the status line, timing the wait into rtt
+static int readStatus(HttpResponseReader& response, RttEstimator& rtt) {
+    unsigned long start = millis();
+    int statusCode = response.readStatus();
+    if (statusCode > 0) {
+        rtt.sample(millis() - start);
+    } else if (statusCode == HTTP_RESPONSE_TIMED_OUT) {
+        rtt.timedOut();
+    }
+    return statusCode;
+}
+
+bool FirmwareUpdater::check(const char* path, const char* runningVersion,
+                            FirmwareManifest* manifest) {
+    StallScope stallScope(STALL_FIRMWARE);
+    serialLog.print("[Firmware] Checking for an update...");
+
+    Client* client = get(path, nullptr);
+    if (!client) {
+        serialLog.println(" no link.");
+        return false;
+    }
+    HttpResponseReader response(*client, network.responseTimeoutMs(rtt.timeoutMs()));
+    char body[FIRMWARE_MANIFEST_MAX];
+    size_t bodyLength = 0;
+    int statusCode = readStatus(response, rtt);
+    bool read = statusCode > 0 && response.readBody(body, sizeof(body), &bodyLength);
+    network.close(statusCode > 0);
+
+    if (statusCode != 200 || !read) {
+        serialLog.print(" HTTP ");
+        serialLog.println(statusCode);
+        return false;
+    }
+    FirmwareManifest latest;
+    if (!parseFirmwareManifest(body, bodyLength, &latest)) {
+        serialLog.println(" malformed manifest.");
+        return false;
+    }
+    if (compareFirmwareVersions(latest.version, runningVersion) <= 0) {
+        serialLog.print(" up to date (");
+        serialLog.print(runningVersion);
+        serialLog.println(").");
+        return false;
+    }
+    serialLog.print(" version ");
+    serialLog.print(latest.version);
+    serialLog.print(" available, ");
+    serialLog.print((unsigned long)latest.size);
+    serialLog.println(" bytes.");
+    *manifest = latest;
+    return true;
+}
+
+bool FirmwareUpdater::begin(const FirmwareManifest& manifest, FlashRegion& region) {
+    image = manifest;
+    slot = &region;
+    hash.reset();
+    programmed = 0;
+    failures = 0;
+    state = FIRMWARE_DOWNLOADING;
+
+    if ((unsigned long)manifest.size > (unsigned long)region.sectorSize() * region.sectorCount()) {
+        fail("image larger than the flash slot");
+        return false;
+    }
+    return true;
+}
+
+FirmwareStatus FirmwareUpdater::update() {
+    if (state != FIRMWARE_DOWNLOADING) return state;
+    if (failures > 0 && millis() - failedAt < backoffMs) return state;
+
+    StallScope stallScope(STALL_FIRMWARE);
+    if (fetchWindow()) {
+        failures = 0;
+    } else if (state == FIRMWARE_DOWNLOADING) {
+        failures++;
+        if (failures >= FIRMWARE_MAX_FAILURES) {
+            fail("too many interrupted downloads");
+        } else {
+            failedAt = millis();
+            backoffMs = backoffDelayMs(RETRY_BACKOFF_MS, RETRY_BACKOFF_MAX_MS, failures,
+                                       random(RETRY_BACKOFF_MAX_MS));
+        }
+    }
+    if (state == FIRMWARE_DOWNLOADING && programmed == image.size) verify();
+    return state;
+}
+
+/**
+ * Fetches the next window into the slot. Returns false if it was cut
+ * short; whatever whole chunks arrived stay programmed and hashed.
+ */
+bool FirmwareUpdater::fetchWindow() {
+    uint32_t from = programmed;
+    uint32_t end = image.size;
+    if (end - from > FIRMWARE_WINDOW_BYTES) end = from + FIRMWARE_WINDOW_BYTES;
+    char range[32];
+    snprintf(range, sizeof(range), "bytes=%lu-%lu", (unsigned long)from, (unsigned long)end - 1);
+
+    Client* client = get(image.path, range);
+    if (!client) {
+        serialLog.println("[Firmware] No link for the download.");
+        return false;
+    }
+    HttpResponseReader response(*client, network.responseTimeoutMs(rtt.timeoutMs()));
+    int statusCode = readStatus(response, rtt);
+    bool headers = statusCode > 0 && response.readHeaders();
+    bool ranged = headers && statusCode == 206 && response.rangeStart() == (long)from;
+    // Range ignored: usable only if the whole image is this one window
+    bool whole = headers && statusCode == 200 && from == 0 && end == image.size;
+    if (!ranged && !whole) {
+        network.close(statusCode > 0);
+        if (headers && statusCode == 200) {
+            fail("the server ignores Range requests");
+        } else {
+            serialLog.print("[Firmware] Download failed, HTTP ");
+            serialLog.println(statusCode);
+        }
+        return false;
+    }
+    if (from > 0 && failures > 0) {
+        resumes++;
+        serialLog.print("[Firmware] Resuming at ");
+        serialLog.print((unsigned long)from);
+        serialLog.println(" bytes.");
+    }
+
+    while (programmed < end) {
+        feedWatchdog(); // on a slow link a window outlasts the watchdog
+        size_t want = end - programmed;
+        if (want > FIRMWARE_CHUNK_BYTES) want = FIRMWARE_CHUNK_BYTES;
+        int got = response.readBodyBytes(chunk, want);
+        if (got != (int)want) {
+            network.close(false);
+            serialLog.print("[Firmware] Interrupted at ");
+            serialLog.print((unsigned long)programmed);
+            serialLog.print(" of ");
+            serialLog.print((unsigned long)image.size);
+            serialLog.println(" bytes.");
+            return false;
+        }
+        if (!program(want)) {
+            network.close(true);
+            fail("flash write failed");
+            return false;
+        }
+        hash.update(chunk, want);
+        programmed += want;
+    }
+
+    if (response.bodyComplete() && !response.closeRequested()) {
+        network.keep(true);
+        kept = true;
+    } else {
+        network.close(true);
+    }
+    serialLog.print("[Firmware] ");
+    serialLog.print((unsigned long)programmed);
+    serialLog.print(" of ");
+    serialLog.print((unsigned long)image.size);
+    serialLog.println(" bytes.");
+    return true;
+}
+
+/**
+ * Programs the chunk at `programmed`, first erasing any sector that starts
+ * within it. The last chunk is padded with erased bytes to a whole flash
+ * word.
+ */
+bool FirmwareUpdater::program(size_t length) {
+    size_t sectorSize = slot->sectorSize();
+    uint32_t end = programmed + length;
+    for (uint32_t sector = (programmed + sectorSize - 1) / sectorSize;
+         sector * sectorSize < end; sector++) {
+        if (!slot->erase((int)sector)) return false;
+    }
+    size_t padded = (length + FIRMWARE_PROGRAM_ALIGN - 1) / FIRMWARE_PROGRAM_ALIGN *
+                    FIRMWARE_PROGRAM_ALIGN;
+    memset(chunk + length, 0xFF, padded - length);
+    return slot->program(programmed, chunk, padded);
+}
+
+bool FirmwareUpdater::verify() {
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    hash.finish(digest);
+    if (memcmp(digest, image.sha256, sizeof(digest)) != 0) {
+        fail("SHA-256 mismatch");
+        return false;
+    }
+
+    // What counts is what flash holds: hash it again from the slot
+    hash.reset();
+    for (uint32_t at = 0; at < image.size;) {
+        size_t n = image.size - at;
+        if (n > FIRMWARE_CHUNK_BYTES) n = FIRMWARE_CHUNK_BYTES;
+        if (!slot->read(at, chunk, n)) {
+            fail("flash read failed");
+            return false;
+        }
+        hash.update(chunk, n);
+        at += n;
+    }
+    hash.finish(digest);
+    if (memcmp(digest, image.sha256, sizeof(digest)) != 0) {
+        fail("flash does not match the image");
+        return false;
+    }
+
+    state = FIRMWARE_VERIFIED;
+    serialLog.print("[Firmware] Version ");
+    serialLog.print(image.version);
+    serialLog.print(" verified, ");
+    serialLog.print((unsigned long)image.size);
+    serialLog.println(" bytes.");
+    return true;
+}
+
+void FirmwareUpdater::fail(const char* reason) {
+    state = FIRMWARE_FAILED;
+    serialLog.print("[Firmware] Update to ");
+    serialLog.print(image.version);
+    serialLog.print(" failed: ");
+    serialLog.print(reason);
+    serialLog.println(".");
+}
@@ -0,0 +1,145 @@
+#ifndef FIRMWARE_UPDATE_H
+#define FIRMWARE_UPDATE_H
+
+#include <Arduino.h>
+#include "checkpoint.h"
+#include "config.h"
+#include "network_manager.h"
+#include "retry_policy.h"
+#include "sha256.h"
+
+#define FIRMWARE_VERSION_MAX 24
+#define FIRMWARE_PATH_MAX 96
+#define FIRMWARE_MANIFEST_MAX 384      // Manifest body kept for parsing
+#define FIRMWARE_PROGRAM_ALIGN 32      // The H747's flash word; the last chunk is padded to it
+#define FIRMWARE_REQUEST_MAX 256
+
+/**
+ * What the firmware host's manifest says about the latest release
+ * (docs/networking-spec.md Section 7.6):
+ *
+ *   {"version": "1.3.0", "url": "/auto-dj/firmware/v1.3.0.bin",
+ *    "size": 612345, "sha256": "abcd..."}
+ *
+ * url is a path on the same host.
+ */
+struct FirmwareManifest {
+    char version[FIRMWARE_VERSION_MAX];
+    char path[FIRMWARE_PATH_MAX];
+    uint32_t size;
+    uint8_t sha256[SHA256_DIGEST_SIZE];
+};
+
+/**
+ * Parses a manifest body. Returns false if a field is missing, too long,
+ * or malformed.
+ */
+bool parseFirmwareManifest(const char* json, size_t length, FirmwareManifest* out);
+
+/**
+ * Compares dotted numeric versions ("1.10.0" > "1.9.2"; a missing
+ * component counts as 0). Returns <0, 0 or >0 like strcmp.
+ */
+int compareFirmwareVersions(const char* a, const char* b);
+
+enum FirmwareStatus {
+    FIRMWARE_IDLE,        // nothing begun
+    FIRMWARE_DOWNLOADING, // more of the image to fetch
+    FIRMWARE_VERIFIED,    // the whole image is in the slot and hashes right
+    FIRMWARE_FAILED       // gave up; begin() again to start over
+};
+
+/**
+ * Streams a firmware image into an inactive flash slot over the same
+ * NetworkManager links the clients use.
+ *
+ * The image is fetched FIRMWARE_WINDOW_BYTES at a time, one Range request
+ * per update(), so a download spread over many loop() iterations never
+ * holds up the relay for long and the connection is reused between
+ * windows while it stays open. Each window is read FIRMWARE_CHUNK_BYTES at
+ * a time into one RAM buffer, programmed into the slot (erasing each
+ * sector as the write reaches it) and fed to a running SHA-256; nothing
+ * larger than the chunk is ever held in RAM. The watchdog is fed per
+ * chunk, so a slow link only makes a window take longer. A server that
+ * answers the Range request with the whole image (200) fails the download
+ * at once, unless the image is a single window.
+ *
+ * A window cut short loses only its unprogrammed partial chunk: the next
+ * update(), after a jittered backoff, asks for a window starting at the
+ * first byte not yet programmed, which resumes the hash where it stopped.
+ * FIRMWARE_MAX_FAILURES interruptions in a row give up.
+ *
+ * Once every byte is in, the streamed hash must match the manifest's, and
+ * then the slot is read back and hashed again, so what is verified is what
+ * flash holds, not what was received. Only then does update() report
+ * FIRMWARE_VERIFIED and the caller may firmwareActivate() the slot.
+ */
+class FirmwareUpdater {
+public:
+    FirmwareUpdater(NetworkManager& network, const char* host, int port);
+
+    /**
+     * Fetches the manifest at path. Returns true and fills *manifest if it
+     * names a version newer than runningVersion.
+     */
+    bool check(const char* path, const char* runningVersion, FirmwareManifest* manifest);
+
+    /**
+     * Starts downloading the manifest's image into slot. Returns false if
+     * the image does not fit it.
+     */
+    bool begin(const FirmwareManifest& manifest, FlashRegion& slot);
+
+    /**
+     * Fetches the next window, unless the last attempt failed less than a
+     * backoff ago. Call every loop() while the status is
+     * FIRMWARE_DOWNLOADING.
+     */
+    FirmwareStatus update();
+
+    FirmwareStatus status() const { return state; }
+    uint32_t received() const { return programmed; }
+    uint32_t imageSize() const { return image.size; }
+    const char* version() const { return image.version; }
+    unsigned long requestCount() const { return requests; }
+    unsigned long resumeCount() const { return resumes; }
+
+private:
+    NetworkManager& network;
+    const char* host;
+    int port;
+    RttEstimator rtt;
+
+    FirmwareStatus state;
+    FirmwareManifest image;
+    FlashRegion* slot;
+    Sha256 hash;
+    uint32_t programmed;   // bytes in the slot and hashed
+    int failures;          // interrupted windows in a row
+    unsigned long failedAt;
+    unsigned long backoffMs;
+    bool kept;             // the last window left its connection open
+    unsigned long requests;
+    unsigned long resumes;
+    uint8_t chunk[FIRMWARE_CHUNK_BYTES];
+
+    Client* get(const char* path, const char* range);
+    bool fetchWindow();
+    bool program(size_t length);
+    bool verify();
+    void fail(const char* reason);
+};
+
+/**
+ * Platform: the flash slot a new image is written to, or nullptr if the
+ * board has none (firmware_platform.cpp on the Giga).
+ */
+FlashRegion* firmwareFlashRegion();
+
+/**
+ * Platform: boots the image in firmwareFlashRegion() from the next reset,
+ * and resets. Does not return.
+ */
+void firmwareActivate();
+
+#endif
@@ -0,0 +1,250 @@
+#ifndef FLOWSHEET_BACKEND_H
+#define FLOWSHEET_BACKEND_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "http_response.h"
+#include "network_manager.h"
+#include "play_history.h"
+#include "request_template.h"
+#include "retry_policy.h"
+
+#define FLOWSHEET_REQUEST_LINE_MAX 64 // Longest request line a backend composes
+
+#ifndef FLOWSHEET_DISPATCH_VIRTUAL
+#define FLOWSHEET_DISPATCH_VIRTUAL 0 // 1: backend hooks as virtual functions, for comparison
+#endif
+
+/**
+ * The flowsheet interface the sketch talks to, whichever backend
+ * FLOWSHEET_BACKEND selects (docs/networking-spec.md section 6.5):
+ * FlowsheetClient for tubafrenzy, BackendServiceClient for Backend-Service.
+ *
+ * Entry queueing and pipelining are shared. Entries are queued and held
+ * briefly (FLOWSHEET_ENTRY_HOLD_MS) before being sent, so that an entry
+ * closely followed by the sign-off -- the relay opening just after a new
+ * track -- goes out with it. Queued requests for one show are pipelined:
+ * written back to back on one keep-alive connection and their responses
+ * read in order.
+ *
+ * A backend composes each request body into a fixed buffer (FormRequest),
+ * behind the header block it builds once in its constructor, and names the
+ * status that means success. A backend constructed with keepAlive leaves
+ * its connection open after an exchange whose responses all arrived, and
+ * its next request within FLOWSHEET_KEEPALIVE_MS goes out on it without a
+ * new TCP and TLS handshake. Each track field is clipped to
+ * FLOWSHEET_FIELD_MAX encoded bytes on a character boundary, so an entry
+ * always fits the buffer and is posted, if need be truncated.
+ *
+ * A CircuitBreaker guards the flowsheet host: after BREAKER_FAILURE_THRESHOLD
+ * exchanges in a row that could not connect or went unanswered, requests
+ * fail at once without touching the network until BREAKER_OPEN_MS has
+ * passed and a probe gets through. Having no link up at all is not held
+ * against the host. A server that answers, even with an error status, is
+ * up: retrying sooner or later would not change its answer.
+ *
+ * With a PlayHistory attached (recordTo()), what became of every track
+ * entry -- added, refused, unanswered, or dropped unsent -- is recorded
+ * there as it is settled.
+ *
+ * Each response is waited for as long as an RttEstimator fed by the host's
+ * earlier responses allows (see NetworkManager::responseTimeoutMs()), rather
+ * than a fixed HTTP_RESPONSE_TIMEOUT_MS.
+ *
+ * The backend is a template parameter rather than a virtual interface: a
+ * backend derives from FlowsheetBackend<itself> (FLOWSHEET_BASE) and the
+ * shared code calls its hooks through backend(), so a build compiles only
+ * the backend FLOWSHEET_BACKEND selects, with its hooks inlined and no
+ * vtable. Each backend declares its own startShow(). Building with
+ * FLOWSHEET_DISPATCH_VIRTUAL=1 routes the hooks through FlowsheetHooks'
+ * virtual functions instead, for comparing the two (test/size/).
+ */
+template <class Backend>
+class FlowsheetBackend {
+public:
+    /**
+     * Queues a flowsheet entry for the track shId (-1 if unknown). It is
+     * sent by update(), flush() or endShow(). When the queue is full the
+     * oldest entry is dropped.
+     */
+    void queueEntry(int radioShowID, unsigned long workingHourMs,
+                    const String& artist, const String& title, const String& album,
+                    int shId = -1);
+
+    /**
+     * Sends queued entries once they have been held FLOWSHEET_ENTRY_HOLD_MS.
+     * Call every loop() while the show is active.
+     */
+    void update();
+
+    /**
+     * Sends all queued entries now, pipelined on one connection. Entries that
+     * could not be sent because no link was up stay queued. Returns true if
+     * every entry was added.
+     */
+    bool flush();
+
+    /**
+     * Drops queued entries, e.g. when their show has been abandoned.
+     */
+    void discardEntries();
+
+    int queuedEntries() const { return queueCount; }
+
+    /**
+     * Queues an entry and sends it (with anything already queued) right away.
+     */
+    bool addEntry(int radioShowID, unsigned long workingHourMs,
+                  const String& artist, const String& title, const String& album,
+                  int shId = -1);
+
+    /**
+     * Ends the show, sending any queued entries first on the same
+     * connection.
+     */
+    bool endShow(int radioShowID);
+
+    /**
+     * Opens the connection the next request will use, e.g. while the relay
+     * is still settling, so startShow() does not wait for the TCP and TLS
+     * handshake. Calling it again keeps the same connection while it is
+     * good. Does nothing unless the circuit breaker is closed.
+     */
+    void preconnect();
+
+    /**
+     * Records the outcome of each track entry in history from now on
+     * (nullptr stops).
+     */
+    void recordTo(PlayHistory* history) { playHistory = history; }
+
+    /** Track entries the server has accepted since power-on. */
+    unsigned long entriesAdded() const { return added; }
+
+    /** Track entries that ended as status since power-on, recorded or not. */
+    unsigned long entryCount(PlayStatus status) const { return outcomes[status]; }
+
+    const CircuitBreaker& circuitBreaker() const { return breaker; }
+    const RttEstimator& roundTrips() const { return rtt; }
+
+    /**
+     * How long the next response will be waited for.
+     */
+    unsigned long responseTimeoutMs() const;
+
+protected:
+    struct QueuedEntry {
+        int radioShowID;
+        unsigned long workingHourMs;
+        bool breakpoint; // an hour marker rather than a track
+        int shId;        // AzuraCast sh_id, -1 if unknown
+        String artist;
+        String title;
+        String album;
+    };
+
+    FlowsheetBackend(NetworkManager& network, const char* host, int port,
+                     int successStatus, bool keepAlive);
+
+    NetworkManager& network;
+    const char* host;
+    int port;
+    char headers[FLOWSHEET_HEADERS_MAX]; // built by the backend; ends with "Content-Length: "
+
+    /**
+     * Backend hooks, called through backend():
+     *
+     *   const char* composeEntry(const QueuedEntry& entry, FormRequest& form);
+     *     Composes the request that adds `entry`. Returns its request line.
+     *   const char* composeEnd(int showID, FormRequest& form);
+     *     Composes the sign-off for showID. Returns its request line.
+     *   void beforeEntry(int radioShowID, unsigned long workingHourMs);
+     *     Optional. Called before each entry is queued, e.g. to queue a
+     *     breakpoint ahead of it with queueBreakpoint().
+     */
+    void beforeEntry(int, unsigned long) {}
+
+    void queueBreakpoint(int radioShowID, unsigned long workingHourMs);
+
+    FormRequest newRequest();
+
+    /**
+     * Returns a connection to the flowsheet host, or nullptr (nothing sent)
+     * if no link gets through or the circuit breaker is open.
+     */
+    Client* connect();
+
+    /**
+     * Ends an exchange on the client from connect(). reusable says every
+     * response was read in full and the server did not ask to close.
+     */
+    void release(bool answered, bool reusable);
+
+    /**
+     * Reads a response's status line within responseTimeoutMs(), feeding
+     * the wait into the host's RTT estimate. A pipelined response after the
+     * first has usually arrived already, so its wait is not a sample.
+     */
+    int readStatus(HttpResponseReader& response, bool sample = true);
+
+private:
+    Backend& backend() { return static_cast<Backend&>(*this); }
+
+    int successStatus;
+    bool keepAlive;
+    char requestStorage[FLOWSHEET_REQUEST_MAX];
+    CircuitBreaker breaker;
+    RttEstimator rtt;
+
+    QueuedEntry queue[FLOWSHEET_QUEUE_MAX]; // ring, oldest at queueHead
+    int queueHead;
+    int queueCount;
+    unsigned long heldSince;
+    bool preconnected; // connect() takes the kept connection even without keepAlive
+    unsigned long added;
+    unsigned long outcomes[PLAY_STATUS_COUNT];
+    PlayHistory* playHistory;
+
+    void recordOutcome(bool ok);
+    void recordPlay(const QueuedEntry& entry, PlayStatus status);
+    QueuedEntry& queuedEntry(int i);
+    QueuedEntry& enqueue();
+    void dequeue();
+    const char* compose(int index, int finishShowID, FormRequest& form);
+    void pipeline(int count, int finishShowID, int* statuses);
+    bool settleEntries(const int* statuses, int entryCount);
+};
+
+#if FLOWSHEET_DISPATCH_VIRTUAL
+/**
+ * The hooks as virtual functions, for the comparison build: every backend
+ * shares the one FlowsheetBackend<FlowsheetHooks> and is reached through
+ * its vtable, as a runtime-polymorphic client stack would be.
+ */
+class FlowsheetHooks : public FlowsheetBackend<FlowsheetHooks> {
+public:
+    virtual ~FlowsheetHooks() {}
+    virtual int startShow(unsigned long startingHourMs) = 0;
+
+protected:
+    friend class FlowsheetBackend<FlowsheetHooks>;
+
+    FlowsheetHooks(NetworkManager& network, const char* host, int port,
+                   int successStatus, bool keepAlive)
+        : FlowsheetBackend<FlowsheetHooks>(network, host, port, successStatus, keepAlive) {}
+
+    virtual const char* composeEntry(const QueuedEntry& entry, FormRequest& form) = 0;
+    virtual const char* composeEnd(int showID, FormRequest& form) = 0;
+    virtual void beforeEntry(int, unsigned long) {}
+};
+
+#define FLOWSHEET_BASE(Self) FlowsheetHooks
+#define FLOWSHEET_HOOK override
+#else
+#define FLOWSHEET_BASE(Self) FlowsheetBackend<Self>
+#define FLOWSHEET_HOOK
+#endif
+
+#include "flowsheet_backend_impl.h"
+
+#endif
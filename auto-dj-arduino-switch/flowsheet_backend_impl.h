@@ -0,0 +1,404 @@
+#ifndef FLOWSHEET_BACKEND_IMPL_H
+#define FLOWSHEET_BACKEND_IMPL_H
+
+// FlowsheetBackend's definitions, included at the end of flowsheet_backend.h so
+// each build instantiates them for the backend it constructs and no other
+
+#include "log_buffer.h"
+#include "mem_stats.h"
+#include "stall_detector.h"
+
+// Room in front of the body for the request line, header block and
+// Content-Length value
+#define FORM_HEADER_ROOM (FLOWSHEET_REQUEST_LINE_MAX + FLOWSHEET_HEADERS_MAX + 24)
+
+// An entry's body besides its three track fields, in either backend
+#define FLOWSHEET_ENTRY_FIXED_MAX 192
+
+// With each track field clipped to FLOWSHEET_FIELD_MAX, every entry fits
+static_assert(3 * FLOWSHEET_FIELD_MAX + FLOWSHEET_ENTRY_FIXED_MAX <=
+                  FLOWSHEET_REQUEST_MAX - FORM_HEADER_ROOM,
+              "FLOWSHEET_REQUEST_MAX too small for FLOWSHEET_FIELD_MAX");
+
+// Pipeline slot states besides an HTTP status (> 0) or a reader error (< 0)
+#define PIPELINE_NOT_SENT 0      // safe to send (again)
+#define PIPELINE_UNANSWERED -1   // sent; the server may or may not have acted
+#define PIPELINE_TOO_LARGE -5    // did not fit FLOWSHEET_REQUEST_MAX
+
+template <class Backend>
+FlowsheetBackend<Backend>::FlowsheetBackend(NetworkManager& network, const char* host, int port,
+                                            int successStatus, bool keepAlive)
+    : network(network)
+    , host(host)
+    , port(port)
+    , successStatus(successStatus)
+    , keepAlive(keepAlive)
+    , breaker(BREAKER_FAILURE_THRESHOLD, BREAKER_OPEN_MS)
+    , rtt(HTTP_RESPONSE_TIMEOUT_MS, HTTP_TIMEOUT_MIN_MS, HTTP_TIMEOUT_MAX_MS)
+    , queueHead(0)
+    , queueCount(0)
+    , heldSince(0)
+    , preconnected(false)
+    , added(0)
+    , playHistory(nullptr)
+{
+    headers[0] = '\0';
+    for (int i = 0; i < PLAY_STATUS_COUNT; i++) outcomes[i] = 0;
+}
+
+// ========== HTTP Helpers ==========
+
+template <class Backend>
+FormRequest FlowsheetBackend<Backend>::newRequest() {
+    return FormRequest(requestStorage, sizeof(requestStorage), FORM_HEADER_ROOM);
+}
+
+/**
+ * The connection is the one kept from the last exchange (or opened by
+ * preconnect()) if it is still good, else a new one, failing over to the
+ * other link if it cannot be made.
+ */
+template <class Backend>
+Client* FlowsheetBackend<Backend>::connect() {
+    if (!breaker.allow(millis())) {
+        serialLog.println("[Flowsheet] Circuit breaker open, request not sent.");
+        return nullptr;
+    }
+    if (keepAlive || preconnected) {
+        preconnected = false;
+        Client* kept = network.resume(FLOWSHEET_KEEPALIVE_MS);
+        if (kept) return kept;
+    }
+    bool tried = false;
+    for (Client* client = network.open(); client; client = network.failover()) {
+        if (client->connect(host, port)) return client;
+        tried = true;
+    }
+    if (tried) recordOutcome(false); // a link was up; the host did not answer
+    serialLog.println("[Flowsheet] No link available.");
+    return nullptr;
+}
+
+template <class Backend>
+void FlowsheetBackend<Backend>::release(bool answered, bool reusable) {
+    recordOutcome(answered);
+    if (keepAlive && answered && reusable) {
+        network.keep(true);
+    } else {
+        network.close(answered);
+    }
+}
+
+template <class Backend>
+unsigned long FlowsheetBackend<Backend>::responseTimeoutMs() const {
+    return network.responseTimeoutMs(rtt.timeoutMs());
+}
+
+template <class Backend>
+int FlowsheetBackend<Backend>::readStatus(HttpResponseReader& response, bool sample) {
+    unsigned long start = millis();
+    int statusCode = response.readStatus();
+    if (statusCode > 0) {
+        if (sample) rtt.sample(millis() - start);
+    } else if (statusCode == HTTP_RESPONSE_TIMED_OUT) {
+        rtt.timedOut();
+    }
+    return statusCode;
+}
+
+template <class Backend>
+void FlowsheetBackend<Backend>::recordOutcome(bool ok) {
+    if (breaker.record(ok, millis())) {
+        serialLog.print("[Flowsheet] Circuit breaker ");
+        serialLog.println(CircuitBreaker::stateName(breaker.state()));
+    }
+}
+
+template <class Backend>
+void FlowsheetBackend<Backend>::recordPlay(const QueuedEntry& entry, PlayStatus status) {
+    if (entry.breakpoint) return;
+    outcomes[status]++;
+    if (!playHistory) return;
+    playHistory->record(network.getEpochTime(), entry.shId, entry.radioShowID, status,
+                        entry.artist.c_str(), entry.title.c_str(), entry.album.c_str());
+}
+
+// ========== Queue ==========
+
+template <class Backend>
+typename FlowsheetBackend<Backend>::QueuedEntry& FlowsheetBackend<Backend>::queuedEntry(int i) {
+    return queue[(queueHead + i) % FLOWSHEET_QUEUE_MAX];
+}
+
+static void logEntry(const String& artist, const String& title, bool breakpoint) {
+    if (breakpoint) {
+        serialLog.println("BREAKPOINT");
+        return;
+    }
+    serialLog.print(artist);
+    serialLog.print(" - ");
+    serialLog.println(title);
+}
+
+/**
+ * Makes room for one more entry, dropping the oldest if the queue is full,
+ * and returns the new slot.
+ */
+template <class Backend>
+typename FlowsheetBackend<Backend>::QueuedEntry& FlowsheetBackend<Backend>::enqueue() {
+    if (queueCount == FLOWSHEET_QUEUE_MAX) {
+        QueuedEntry& oldest = queuedEntry(0);
+        serialLog.print("[Flowsheet] Entry queue full, dropping: ");
+        logEntry(oldest.artist, oldest.title, oldest.breakpoint);
+        recordPlay(oldest, PLAY_DROPPED);
+        dequeue();
+    }
+    if (queueCount == 0) heldSince = millis();
+    queueCount++;
+    return queuedEntry(queueCount - 1);
+}
+
+template <class Backend>
+void FlowsheetBackend<Backend>::dequeue() {
+    QueuedEntry& entry = queuedEntry(0);
+    entry.artist = String();
+    entry.title = String();
+    entry.album = String();
+    queueHead = (queueHead + 1) % FLOWSHEET_QUEUE_MAX;
+    queueCount--;
+}
+
+// ========== Pipelining ==========
+
+/**
+ * Composes request `index` of a pipeline: the queued entries in order,
+ * then the sign-off for finishShowID if it is positive. Returns the
+ * request line.
+ */
+template <class Backend>
+const char* FlowsheetBackend<Backend>::compose(int index, int finishShowID, FormRequest& form) {
+    if (index < queueCount) return backend().composeEntry(queuedEntry(index), form);
+    return backend().composeEnd(finishShowID, form);
+}
+
+/**
+ * Sends `count` requests (see compose()) back to back on one connection,
+ * then reads their responses in order. statuses[i] receives the HTTP
+ * status of request i, or one of the PIPELINE_* states.
+ *
+ * Partial failure follows the rule single requests use: a request the
+ * server may have seen is never resent. If the connection breaks, the
+ * request being read and everything after it stay PIPELINE_UNANSWERED. If
+ * the server announces "Connection: close", it will not process anything
+ * after that response, so the rest are resent on a fresh connection.
+ *
+ * Each request is composed and sized before the connection is made, so
+ * requests too large to send cost no connection, and if none is left the
+ * network is not touched and neither the link nor the host is blamed.
+ */
+template <class Backend>
+void FlowsheetBackend<Backend>::pipeline(int count, int finishShowID, int* statuses) {
+    for (int i = 0; i < count; i++) statuses[i] = PIPELINE_NOT_SENT;
+
+    int next = 0; // first request still waiting for its response
+    while (next < count) {
+        Client* client = nullptr;
+        for (int i = next; i < count; i++) {
+            if (statuses[i] != PIPELINE_NOT_SENT) continue;
+            FormRequest form = newRequest();
+            const char* requestLine = compose(i, finishShowID, form);
+            const char* request;
+            size_t length;
+            if (!form.finish(requestLine, headers, &request, &length)) {
+                statuses[i] = PIPELINE_TOO_LARGE;
+                continue;
+            }
+            if (!client) {
+                client = connect(); // leaves the composed request in place
+                if (!client) return;
+            }
+            client->write((const uint8_t*)request, length);
+            statuses[i] = PIPELINE_UNANSWERED;
+        }
+        if (!client) return; // nothing fit; no bytes went out
+
+        bool answered = false;
+        bool reconnect = false;
+        bool intact = true;
+        for (; next < count; next++) {
+            if (statuses[next] == PIPELINE_TOO_LARGE) continue;
+            feedWatchdog(); // each response has its own timeout
+            HttpResponseReader response(*client, responseTimeoutMs());
+            int statusCode = readStatus(response, !answered); // the first answer is the round trip
+            if (statusCode > 0 && !response.skipBody()) statusCode = HTTP_RESPONSE_TIMED_OUT;
+            statuses[next] = statusCode;
+            if (statusCode <= 0) {
+                intact = false;
+                break;
+            }
+            answered = true;
+            if (response.closeRequested()) {
+                for (int i = next + 1; i < count; i++) {
+                    if (statuses[i] == PIPELINE_UNANSWERED) statuses[i] = PIPELINE_NOT_SENT;
+                }
+                reconnect = true;
+                intact = false;
+                next++;
+                break;
+            }
+        }
+
+        release(answered, intact);
+        if (!reconnect) return;
+    }
+}
+
+/**
+ * Logs the outcome of the first entryCount pipeline slots and removes every
+ * entry that was sent (or cannot be); entries that never left stay queued
+ * for the next attempt. Returns true if every entry was added.
+ */
+template <class Backend>
+bool FlowsheetBackend<Backend>::settleEntries(const int* statuses, int entryCount) {
+    bool allAdded = true;
+    int settled = 0;
+    for (; settled < entryCount; settled++) {
+        int status = statuses[settled];
+        if (status == PIPELINE_NOT_SENT) {
+            allAdded = false;
+            break;
+        }
+
+        const QueuedEntry& entry = queuedEntry(0);
+        if (status == successStatus) {
+            if (!entry.breakpoint) added++;
+            serialLog.print("[Flowsheet] Entry added: ");
+            recordPlay(entry, PLAY_POSTED);
+        } else {
+            allAdded = false;
+            if (status == PIPELINE_TOO_LARGE) {
+                serialLog.print("[Flowsheet] Entry too large for buffer, dropped: ");
+                recordPlay(entry, PLAY_DROPPED);
+            } else if (status < 0) {
+                serialLog.print("[Flowsheet] Entry sent but unanswered, not resent: ");
+                recordPlay(entry, PLAY_UNANSWERED);
+            } else {
+                serialLog.print("[Flowsheet] Failed to add entry, HTTP ");
+                serialLog.print(status);
+                serialLog.print(": ");
+                recordPlay(entry, PLAY_REJECTED);
+            }
+        }
+        logEntry(entry.artist, entry.title, entry.breakpoint);
+        dequeue();
+    }
+    return allAdded;
+}
+
+// ========== Public API ==========
+
+template <class Backend>
+void FlowsheetBackend<Backend>::preconnect() {
+    // A half-open breaker's single probe is left to the real request
+    if (breaker.state() != CircuitBreaker::CLOSED) return;
+    MemScope memScope(MEM_FLOWSHEET);
+    bool fresh = !preconnected;
+    Client* client = connect();
+    if (!client) return;
+    network.keep(true);
+    preconnected = true;
+    if (fresh) serialLog.println("[Flowsheet] Connection opened ahead of the show.");
+}
+
+template <class Backend>
+void FlowsheetBackend<Backend>::queueEntry(int radioShowID, unsigned long workingHourMs,
+                                           const String& artist, const String& title,
+                                           const String& album, int shId) {
+    MemScope memScope(MEM_FLOWSHEET);
+    backend().beforeEntry(radioShowID, workingHourMs);
+    QueuedEntry& entry = enqueue();
+    entry.radioShowID = radioShowID;
+    entry.workingHourMs = workingHourMs;
+    entry.breakpoint = false;
+    entry.shId = shId;
+    entry.artist = artist;
+    entry.title = title;
+    entry.album = album;
+
+    serialLog.print("[Flowsheet] Queued entry: ");
+    logEntry(artist, title, false);
+}
+
+template <class Backend>
+void FlowsheetBackend<Backend>::queueBreakpoint(int radioShowID, unsigned long workingHourMs) {
+    QueuedEntry& entry = enqueue();
+    entry.radioShowID = radioShowID;
+    entry.workingHourMs = workingHourMs;
+    entry.breakpoint = true;
+    entry.shId = -1;
+}
+
+template <class Backend>
+void FlowsheetBackend<Backend>::update() {
+    if (queueCount > 0 && millis() - heldSince >= FLOWSHEET_ENTRY_HOLD_MS) {
+        flush();
+    }
+}
+
+template <class Backend>
+bool FlowsheetBackend<Backend>::flush() {
+    MemScope memScope(MEM_FLOWSHEET);
+    if (queueCount == 0) return true;
+    StallScope stallScope(STALL_ADD_ENTRY);
+    heldSince = millis(); // a failed attempt waits another hold period
+
+    int statuses[FLOWSHEET_QUEUE_MAX];
+    pipeline(queueCount, 0, statuses);
+    return settleEntries(statuses, queueCount);
+}
+
+template <class Backend>
+void FlowsheetBackend<Backend>::discardEntries() {
+    if (queueCount == 0) return;
+    serialLog.print("[Flowsheet] Discarding ");
+    serialLog.print(queueCount);
+    serialLog.println(" unsent entries.");
+    while (queueCount > 0) {
+        recordPlay(queuedEntry(0), PLAY_DROPPED);
+        dequeue();
+    }
+}
+
+template <class Backend>
+bool FlowsheetBackend<Backend>::addEntry(int radioShowID, unsigned long workingHourMs,
+                                         const String& artist, const String& title,
+                                         const String& album, int shId) {
+    queueEntry(radioShowID, workingHourMs, artist, title, album, shId);
+    return flush();
+}
+
+template <class Backend>
+bool FlowsheetBackend<Backend>::endShow(int radioShowID) {
+    MemScope memScope(MEM_FLOWSHEET);
+    StallScope stallScope(STALL_END_SHOW);
+    serialLog.println("[Flowsheet] Ending show...");
+
+    // Held entries go first, on the same connection as the sign-off
+    int entryCount = queueCount;
+    int statuses[FLOWSHEET_QUEUE_MAX + 1];
+    pipeline(entryCount + 1, radioShowID, statuses);
+    settleEntries(statuses, entryCount);
+
+    int status = statuses[entryCount] == PIPELINE_NOT_SENT ? -1 : statuses[entryCount];
+    if (status == successStatus) {
+        serialLog.print("[Flowsheet] Show ended, radioShowID=");
+        serialLog.println(radioShowID);
+        return true;
+    }
+
+    serialLog.print("[Flowsheet] Failed to end show, HTTP ");
+    serialLog.println(status);
+    return false;
+}
+
+#endif
@@ -1,156 +1,157 @@
 #include "flowsheet_client.h"
 #include "config.h"
 #include "utils.h"
+#include "log_buffer.h"
+#include "mem_stats.h"
+#include "stall_detector.h"
 
-#include <WiFi.h>
-#include <WiFiSSLClient.h>
-#include <ArduinoHttpClient.h>
+#include "http_response.h"
 
-FlowsheetClient::FlowsheetClient(const char* host, int port, const char* apiKey)
-    : host(host)
-    , port(port)
+#include <stdio.h>
+#include <string.h>
+
+// ========== Compile-time request parts ==========
+
+#define FORM_REQUEST_LINE(path) "POST " path " HTTP/1.1\r\n"
+
+static const char START_SHOW_LINE[] = FORM_REQUEST_LINE(TUBAFRENZY_PATH_START_SHOW);
+static const char ADD_ENTRY_LINE[] = FORM_REQUEST_LINE(TUBAFRENZY_PATH_ADD_ENTRY);
+static const char END_SHOW_LINE[] = FORM_REQUEST_LINE(TUBAFRENZY_PATH_END_SHOW);
+
+static_assert(sizeof(START_SHOW_LINE) <= FLOWSHEET_REQUEST_LINE_MAX, "request line too long");
+static_assert(sizeof(ADD_ENTRY_LINE) <= FLOWSHEET_REQUEST_LINE_MAX, "request line too long");
+static_assert(sizeof(END_SHOW_LINE) <= FLOWSHEET_REQUEST_LINE_MAX, "request line too long");
+
+static constexpr auto ENCODED_DJ_NAME = urlEncodeLiteral(AUTO_DJ_NAME);
+static constexpr auto ENCODED_DJ_HANDLE = urlEncodeLiteral(AUTO_DJ_HANDLE);
+static constexpr auto ENCODED_SHOW_NAME = urlEncodeLiteral(AUTO_DJ_SHOW_NAME);
+
+FlowsheetClient::FlowsheetClient(NetworkManager& network, const char* host, int port,
+                                 const char* apiKey)
+    : FLOWSHEET_BASE(FlowsheetClient)(network, host, port, 302, false)
     , apiKey(apiKey)
 {
+    // Same header set ArduinoHttpClient sent, minus "Connection: close" so
+    // pipelined requests can share the connection; built once, and ends with
+    // the Content-Length name so FormRequest can append the value
+    char portSuffix[8] = "";
+    if (port != 80 && port != 443) snprintf(portSuffix, sizeof(portSuffix), ":%d", port);
+    snprintf(headers, sizeof(headers),
+        "Host: %s%s\r\n"
+        "User-Agent: Arduino/2.2.0\r\n"
+        "Content-Type: application/x-www-form-urlencoded\r\n"
+        "X-Auto-DJ-Key: %s\r\n"
+        "Content-Length: ",
+        host, portSuffix, apiKey);
 }
 
 // ========== HTTP Helpers ==========
 
 /**
- * POSTs a form-encoded body and returns the HTTP status code, or -1 on error.
- * Fully reads the response body and stops the client to prevent socket leaks.
+ * Reads one response's status and headers. The body (a redirect or error
+ * page) is left unread: the connection is closed after the exchange, not
+ * reused. Returns the status, or a negative reader error if the headers
+ * did not arrive in full.
  */
-int FlowsheetClient::postForm(const char* path, const String& body) {
-    WiFiSSLClient ssl;
-    HttpClient http(ssl, host, port);
-    http.setHttpResponseTimeout(HTTP_RESPONSE_TIMEOUT_MS);
-
-    http.beginRequest();
-    http.post(path);
-    http.sendHeader("Content-Type", "application/x-www-form-urlencoded");
-    http.sendHeader("Content-Length", body.length());
-    http.sendHeader("X-Auto-DJ-Key", apiKey);
-    http.beginBody();
-    http.print(body);
-    http.endRequest();
-
-    int statusCode = http.responseStatusCode();
-    http.responseBody(); // drain response to prevent socket leak
-    http.stop();
+int FlowsheetClient::readResponse(HttpResponseReader& response) {
+    int statusCode = readStatus(response);
+    if (statusCode <= 0) return statusCode;
+    if (!response.finish(false)) return HTTP_RESPONSE_TIMED_OUT;
     return statusCode;
 }
 
 /**
- * POSTs a form-encoded body and returns the Location header from a 302 redirect.
- * Returns empty string on failure.
+ * Sends a composed form POST over the best available link and returns the
+ * HTTP status code, or -1 on error. location (of locationSize bytes)
+ * receives the Location header, or "" if there was none.
+ *
+ * Only a failure to connect is retried on the other link: once the request
+ * has been sent, the server may have acted on it, and resending could create
+ * a duplicate show or entry.
  */
-String FlowsheetClient::getLocationHeader(const char* path, const String& body) {
-    WiFiSSLClient ssl;
-    HttpClient http(ssl, host, port);
-    http.setHttpResponseTimeout(HTTP_RESPONSE_TIMEOUT_MS);
-
-    http.beginRequest();
-    http.post(path);
-    http.sendHeader("Content-Type", "application/x-www-form-urlencoded");
-    http.sendHeader("Content-Length", body.length());
-    http.sendHeader("X-Auto-DJ-Key", apiKey);
-    http.beginBody();
-    http.print(body);
-    http.endRequest();
-
-    int statusCode = http.responseStatusCode();
-
-    // Read the Location header before draining the body
-    String location;
-    while (http.headerAvailable()) {
-        String headerName = http.readHeaderName();
-        String headerValue = http.readHeaderValue();
-        if (headerName.equalsIgnoreCase("Location")) {
-            location = headerValue;
-        }
+int FlowsheetClient::post(const char* requestLine, FormRequest& form, char* location,
+                          size_t locationSize) {
+    location[0] = '\0';
+    const char* request;
+    size_t length;
+    if (!form.finish(requestLine, headers, &request, &length)) {
+        serialLog.println("[Flowsheet] Request too large for buffer.");
+        return -1;
     }
 
-    http.responseBody(); // drain
-    http.stop();
+    Client* client = connect();
+    if (!client) return -1;
+    client->write((const uint8_t*)request, length);
+
+    HttpResponseReader response(*client, responseTimeoutMs());
+    int statusCode = readResponse(response);
+    if (statusCode > 0) snprintf(location, locationSize, "%s", response.location());
+    release(statusCode > 0, false);
+    return statusCode;
+}
+
+/**
+ * Sends a form POST and stores the Location header from a 302 redirect in
+ * location. Returns false (location "") on failure.
+ */
+bool FlowsheetClient::getLocationHeader(const char* requestLine, FormRequest& form,
+                                        char* location, size_t locationSize) {
+    int statusCode = post(requestLine, form, location, locationSize);
 
     if (statusCode != 302) {
-        Serial.print("[Flowsheet] Expected 302, got ");
-        Serial.println(statusCode);
-        return "";
+        serialLog.print("[Flowsheet] Expected 302, got ");
+        serialLog.println(statusCode);
+        location[0] = '\0';
+        return false;
     }
 
-    return location;
+    return location[0] != '\0';
 }
 
-// ========== Public API ==========
+// ========== Requests ==========
 
-int FlowsheetClient::startShow(unsigned long startingHourMs) {
-    Serial.println("[Flowsheet] Starting show...");
+const char* FlowsheetClient::composeEntry(const QueuedEntry& entry, FormRequest& form) {
+    form.append("radioShowID=").appendNumber(entry.radioShowID)
+        .append("&workingHour=").appendNumber(entry.workingHourMs)
+        .append("&artistName=").appendEncoded(entry.artist.c_str(), FLOWSHEET_FIELD_MAX)
+        .append("&songTitle=").appendEncoded(entry.title.c_str(), FLOWSHEET_FIELD_MAX)
+        .append("&releaseTitle=").appendEncoded(entry.album.c_str(), FLOWSHEET_FIELD_MAX)
+        .append("&releaseType=otherRelease&autoBreakpoint=true");
+    return ADD_ENTRY_LINE;
+}
+
+const char* FlowsheetClient::composeEnd(int radioShowID, FormRequest& form) {
+    form.append("radioShowID=").appendNumber(radioShowID).append("&mode=signoffConfirm");
+    return END_SHOW_LINE;
+}
 
-    String body = "djID=" + String(AUTO_DJ_ID)
-        + "&djName=" + urlEncode(AUTO_DJ_NAME)
-        + "&djHandle=" + urlEncode(AUTO_DJ_HANDLE)
-        + "&showName=" + urlEncode(AUTO_DJ_SHOW_NAME)
-        + "&startingHour=" + String(startingHourMs);
+// ========== Public API ==========
 
-    String location = getLocationHeader(TUBAFRENZY_PATH_START_SHOW, body);
-    if (location.length() == 0) {
-        Serial.println("[Flowsheet] Failed to start show (no Location header).");
+int FlowsheetClient::startShow(unsigned long startingHourMs) {
+    MemScope memScope(MEM_FLOWSHEET);
+    StallScope stallScope(STALL_START_SHOW);
+    serialLog.println("[Flowsheet] Starting show...");
+
+    FormRequest form = newRequest();
+    form.append("djID=" AUTO_DJ_ID "&djName=").append(ENCODED_DJ_NAME)
+        .append("&djHandle=").append(ENCODED_DJ_HANDLE)
+        .append("&showName=").append(ENCODED_SHOW_NAME)
+        .append("&startingHour=").appendNumber(startingHourMs);
+
+    char location[HTTP_LOCATION_MAX];
+    if (!getLocationHeader(START_SHOW_LINE, form, location, sizeof(location))) {
+        serialLog.println("[Flowsheet] Failed to start show (no Location header).");
         return -1;
     }
 
     int radioShowID = parseRadioShowID(location);
     if (radioShowID < 0) {
-        Serial.print("[Flowsheet] Failed to parse radioShowID from: ");
-        Serial.println(location);
+        serialLog.print("[Flowsheet] Failed to parse radioShowID from: ");
+        serialLog.println(location);
         return -1;
     }
 
-    Serial.print("[Flowsheet] Show started, radioShowID=");
-    Serial.println(radioShowID);
+    serialLog.print("[Flowsheet] Show started, radioShowID=");
+    serialLog.println(radioShowID);
     return radioShowID;
 }
-
-bool FlowsheetClient::addEntry(int radioShowID, unsigned long workingHourMs,
-                                const String& artist, const String& title,
-                                const String& album) {
-    Serial.print("[Flowsheet] Adding entry: ");
-    Serial.print(artist);
-    Serial.print(" - ");
-    Serial.println(title);
-
-    String body = "radioShowID=" + String(radioShowID)
-        + "&workingHour=" + String(workingHourMs)
-        + "&artistName=" + urlEncode(artist)
-        + "&songTitle=" + urlEncode(title)
-        + "&releaseTitle=" + urlEncode(album)
-        + "&releaseType=otherRelease"
-        + "&autoBreakpoint=true";
-
-    int status = postForm(TUBAFRENZY_PATH_ADD_ENTRY, body);
-    if (status == 302) {
-        Serial.println("[Flowsheet] Entry added.");
-        return true;
-    }
-
-    Serial.print("[Flowsheet] Failed to add entry, HTTP ");
-    Serial.println(status);
-    return false;
-}
-
-bool FlowsheetClient::endShow(int radioShowID) {
-    Serial.println("[Flowsheet] Ending show...");
-
-    String body = "radioShowID=" + String(radioShowID)
-        + "&mode=signoffConfirm";
-
-    int status = postForm(TUBAFRENZY_PATH_END_SHOW, body);
-    if (status == 302) {
-        Serial.print("[Flowsheet] Show ended, radioShowID=");
-        Serial.println(radioShowID);
-        return true;
-    }
-
-    Serial.print("[Flowsheet] Failed to end show, HTTP ");
-    Serial.println(status);
-    return false;
-}
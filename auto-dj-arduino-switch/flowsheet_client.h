@@ -2,6 +2,10 @@
 #define FLOWSHEET_CLIENT_H
 
 #include <Arduino.h>
+#include "config.h"
+#include "flowsheet_backend.h"
+#include "network_manager.h"
+#include "request_template.h"
 
 /**
  * Manages HTTP POST calls to the tubafrenzy flowsheet API.
@@ -9,40 +13,49 @@
  * All requests authenticate via the X-Auto-DJ-Key header, which is checked
  * by XYCCatalogServlet.validateControlRoomAccess() on the server side.
  *
- * The servlets respond with HTTP 302 redirects on success. ArduinoHttpClient
- * does not follow redirects by default, so we read the Location header
- * directly (needed for extracting radioShowID from startRadioShow).
+ * The servlets respond with HTTP 302 redirects on success, which are not
+ * followed; the Location header is read directly (needed for extracting
+ * radioShowID from startRadioShow).
+ *
+ * Each request is composed in full (request line, headers, form body) in a
+ * fixed buffer and sent with a single write. Everything constant is prepared
+ * ahead: request lines and the encoded AUTO_DJ_* fields at compile time, the
+ * Host/key header block once in the constructor. Only the variable form
+ * fields are formatted per request. Responses are read with
+ * HttpResponseReader. Queueing and pipelining come from FlowsheetBackend;
+ * the connection is closed after each exchange.
  */
-class FlowsheetClient {
+class FlowsheetClient : public FLOWSHEET_BASE(FlowsheetClient) {
 public:
-    FlowsheetClient(const char* host, int port, const char* apiKey);
+    FlowsheetClient(NetworkManager& network, const char* host, int port, const char* apiKey);
 
     /**
      * Starts a new radio show. Returns the radioShowID on success, or -1 on failure.
      * Parses the radioShowID from the Location header of the 302 redirect.
      */
-    int startShow(unsigned long startingHourMs);
+    int startShow(unsigned long startingHourMs) FLOWSHEET_HOOK;
+
+protected:
+    friend class FLOWSHEET_BASE(FlowsheetClient);
 
     /**
-     * Adds a flowsheet entry with autoBreakpoint=true (server handles hourly
+     * Entries are added with autoBreakpoint=true (server handles hourly
      * breakpoints automatically via FlowsheetEntryService.createEntryWithAutoBreakpoints()).
      */
-    bool addEntry(int radioShowID, unsigned long workingHourMs,
-                  const String& artist, const String& title, const String& album);
+    const char* composeEntry(const QueuedEntry& entry, FormRequest& form) FLOWSHEET_HOOK;
 
     /**
-     * Ends the radio show. Uses mode=signoffConfirm to skip the interactive JSP
-     * confirmation page.
+     * Uses mode=signoffConfirm to skip the interactive JSP confirmation page.
      */
-    bool endShow(int radioShowID);
+    const char* composeEnd(int radioShowID, FormRequest& form) FLOWSHEET_HOOK;
 
 private:
-    const char* host;
-    int port;
     const char* apiKey;
 
-    int postForm(const char* path, const String& body);
-    String getLocationHeader(const char* path, const String& body);
+    int readResponse(HttpResponseReader& response);
+    int post(const char* requestLine, FormRequest& form, char* location, size_t locationSize);
+    bool getLocationHeader(const char* requestLine, FormRequest& form, char* location,
+                           size_t locationSize);
 };
 
 #endif
@@ -0,0 +1,48 @@
+/**
+ * Play history files for the Giga R1: two files on the Ethernet Shield
+ * Rev2's SD card, through the SD library. Each write is flushed to the
+ * card at once, so a reset loses at most the batch being written.
+ */
+#include "config.h"
+
+#if defined(ARDUINO_ARCH_MBED) && ENABLE_PLAY_HISTORY
+
+#include "play_history.h"
+
+#include <SD.h>
+
+class SdHistoryFile : public HistoryFile {
+public:
+    bool open(const char* path) {
+        file = SD.open(path, O_RDWR | O_CREAT); // not O_APPEND: a torn record is overwritten
+        return (bool)file;
+    }
+
+    uint32_t size() { return file.size(); }
+
+    bool read(uint32_t offset, void* buf, size_t len) {
+        return file.seek(offset) && file.read(buf, len) == (int)len;
+    }
+
+    bool write(uint32_t offset, const void* data, size_t len) {
+        if (!file.seek(offset) || file.write((const uint8_t*)data, len) != len) return false;
+        file.flush();
+        return true;
+    }
+
+private:
+    File file;
+};
+
+bool playHistoryFiles(HistoryFile** records, HistoryFile** index) {
+    static SdHistoryFile recordFile;
+    static SdHistoryFile indexFile;
+    static bool ready = SD.begin(SD_CS_PIN) && recordFile.open(PLAY_HISTORY_PATH) &&
+                        indexFile.open(PLAY_HISTORY_INDEX_PATH);
+    if (!ready) return false;
+    *records = &recordFile;
+    *index = &indexFile;
+    return true;
+}
+
+#endif
@@ -0,0 +1,283 @@
+#include "http_response.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+HttpResponseReader::HttpResponseReader(Client& client, unsigned long timeoutMs)
+    : client(client)
+    , timeoutMs(timeoutMs)
+    , stage(STATUS)
+    , length(-1)
+    , rangeFrom(-1)
+    , bodyRead(0)
+    , chunked(false)
+    , closing(false)
+    , sink(nullptr)
+    , sinkRoom(0)
+    , sinkLen(0)
+{
+    line[0] = '\0';
+    locationValue[0] = '\0';
+    etagValue[0] = '\0';
+}
+
+// ========== Low-level reads ==========
+
+/**
+ * Next byte, waiting up to timeoutMs for it. -1 on timeout or when the
+ * connection has closed with nothing left to read.
+ */
+int HttpResponseReader::readByte() {
+    unsigned long start = millis();
+    for (;;) {
+        if (client.available() > 0) {
+            int c = client.read();
+            if (c >= 0) return c;
+        }
+        if (!client.connected()) return -1;
+        if (millis() - start >= timeoutMs) return -1;
+        delay(HTTP_WAIT_FOR_DATA_MS);
+    }
+}
+
+/**
+ * Reads one CRLF- (or LF-) terminated line into `line`, without the
+ * terminator. Excess characters are dropped.
+ */
+bool HttpResponseReader::readLine() {
+    size_t n = 0;
+    for (;;) {
+        int c = readByte();
+        if (c < 0) {
+            line[n] = '\0';
+            return false;
+        }
+        if (c == '\n') break;
+        if (c != '\r' && n < sizeof(line) - 1) line[n++] = (char)c;
+    }
+    line[n] = '\0';
+    return true;
+}
+
+bool HttpResponseReader::skipBytes(unsigned long count) {
+    uint8_t buf[64];
+    while (count > 0) {
+        if (client.available() <= 0) {
+            int c = readByte(); // wait for more
+            if (c < 0) return false;
+            buf[0] = (uint8_t)c;
+            store(buf, 1);
+            count--;
+            continue;
+        }
+        size_t want = count < sizeof(buf) ? count : sizeof(buf);
+        int n = client.read(buf, want);
+        if (n <= 0) continue;
+        store(buf, (size_t)n);
+        count -= (unsigned long)n;
+    }
+    return true;
+}
+
+/**
+ * Copies body bytes into readBody()'s buffer while it has room.
+ */
+void HttpResponseReader::store(const uint8_t* data, size_t count) {
+    if (!sink) return;
+    size_t room = sinkRoom - 1 - sinkLen;
+    if (count > room) count = room;
+    memcpy(sink + sinkLen, data, count);
+    sinkLen += count;
+    sink[sinkLen] = '\0';
+}
+
+/**
+ * Keeps a header value in a fixed field if it fits whole; a truncated
+ * Location or ETag would be worse than none.
+ */
+static void keep(char* field, size_t size, const char* value) {
+    size_t n = strlen(value);
+    if (n >= size) n = 0;
+    memcpy(field, value, n);
+    field[n] = '\0';
+}
+
+// ========== Status and headers ==========
+
+int HttpResponseReader::readStatus() {
+    if (stage != STATUS) return HTTP_RESPONSE_INVALID;
+
+    for (;;) {
+        if (!readLine()) {
+            stage = FAILED;
+            return HTTP_RESPONSE_TIMED_OUT;
+        }
+        if (strncmp(line, "HTTP/", 5) != 0) {
+            stage = FAILED;
+            return HTTP_RESPONSE_INVALID;
+        }
+        const char* space = strchr(line, ' ');
+        int status = space ? atoi(space + 1) : 0;
+        if (status < 100 || status > 999) {
+            stage = FAILED;
+            return HTTP_RESPONSE_INVALID;
+        }
+        closing = strncmp(line, "HTTP/1.0", 8) == 0;
+
+        if (status != 100) {
+            stage = HEADERS;
+            return status;
+        }
+        // Skip the interim response's headers
+        do {
+            if (!readLine()) {
+                stage = FAILED;
+                return HTTP_RESPONSE_TIMED_OUT;
+            }
+        } while (line[0] != '\0');
+    }
+}
+
+bool HttpResponseReader::readHeader(const char** name, const char** value) {
+    if (stage != HEADERS) return false;
+    if (!readLine()) {
+        stage = FAILED;
+        return false;
+    }
+    if (line[0] == '\0') {
+        stage = BODY;
+        return false;
+    }
+
+    char* colon = strchr(line, ':');
+    char* v = line + strlen(line);
+    if (colon) {
+        *colon = '\0';
+        v = colon + 1;
+        while (*v == ' ' || *v == '\t') v++;
+        char* end = v + strlen(v);
+        while (end > v && (end[-1] == ' ' || end[-1] == '\t')) *--end = '\0';
+    }
+
+    if (strcasecmp(line, "Content-Length") == 0) {
+        length = atol(v);
+    } else if (strcasecmp(line, "Transfer-Encoding") == 0) {
+        chunked = strcasecmp(v, "chunked") == 0;
+    } else if (strcasecmp(line, "Connection") == 0) {
+        closing = strcasecmp(v, "close") == 0;
+    } else if (strcasecmp(line, "Location") == 0) {
+        keep(locationValue, sizeof(locationValue), v);
+    } else if (strcasecmp(line, "ETag") == 0) {
+        keep(etagValue, sizeof(etagValue), v);
+    } else if (strcasecmp(line, "Content-Range") == 0 && strncasecmp(v, "bytes ", 6) == 0 &&
+               v[6] >= '0' && v[6] <= '9') {
+        rangeFrom = atol(v + 6);
+    }
+
+    *name = line;
+    *value = v;
+    return true;
+}
+
+bool HttpResponseReader::readHeaders() {
+    const char* name;
+    const char* value;
+    while (readHeader(&name, &value)) {}
+    return stage == BODY;
+}
+
+// ========== Body ==========
+
+bool HttpResponseReader::skipBody() {
+    return readBody(nullptr, 0, nullptr);
+}
+
+bool HttpResponseReader::readBody(char* buffer, size_t size, size_t* stored) {
+    if (buffer && size > 0) {
+        sink = buffer;
+        sinkRoom = size;
+        sinkLen = 0;
+        buffer[0] = '\0';
+    }
+    if (!readHeaders()) {
+        sink = nullptr;
+        return false;
+    }
+
+    bool ok = true;
+    if (chunked) {
+        for (;;) {
+            if (!readLine()) {
+                ok = false;
+                break;
+            }
+            unsigned long size = strtoul(line, nullptr, 16);
+            if (size == 0) {
+                // Trailer section, ended by a blank line
+                while ((ok = readLine()) && line[0] != '\0') {}
+                break;
+            }
+            if (!skipBytes(size) || !readLine()) {
+                ok = false;
+                break;
+            }
+        }
+    } else if (length >= 0) {
+        ok = skipBytes((unsigned long)length);
+    } else {
+        // Delimited by the server closing the connection
+        closing = true;
+        for (int c; (c = readByte()) >= 0;) {
+            uint8_t b = (uint8_t)c;
+            store(&b, 1);
+        }
+    }
+
+    sink = nullptr;
+    if (stored) *stored = sinkLen;
+    stage = ok ? DONE : FAILED;
+    return ok;
+}
+
+bool HttpResponseReader::finish(bool reuse) {
+    if (reuse) return skipBody();
+    if (!readHeaders()) return false;
+    stage = DONE;
+    return true;
+}
+
+int HttpResponseReader::readBodyBytes(uint8_t* buffer, size_t size) {
+    if (stage == HEADERS && !readHeaders()) return -1;
+    if (stage == DONE) return 0;
+    if (stage != BODY || chunked) {
+        stage = FAILED;
+        return -1;
+    }
+
+    size_t want = size;
+    if (length >= 0 && (unsigned long)length - bodyRead < want) {
+        want = (size_t)((unsigned long)length - bodyRead);
+    }
+    size_t got = 0;
+    while (got < want) {
+        if (client.available() <= 0) {
+            int c = readByte(); // wait for more
+            if (c < 0) break;
+            buffer[got++] = (uint8_t)c;
+            continue;
+        }
+        int n = client.read(buffer + got, want - got);
+        if (n > 0) got += (size_t)n;
+    }
+    bodyRead += got;
+
+    if (length >= 0 && bodyRead == (unsigned long)length) {
+        stage = DONE;
+    } else if (got < want) {
+        // Ended early: the end of a close-delimited body, else a failure
+        closing = true;
+        stage = length < 0 ? DONE : FAILED;
+    }
+    return (int)got;
+}
@@ -0,0 +1,133 @@
+#ifndef HTTP_RESPONSE_H
+#define HTTP_RESPONSE_H
+
+#include <Arduino.h>
+#include <Client.h>
+
+#define HTTP_LINE_MAX 256          // Longer status/header lines are truncated
+#define HTTP_LOCATION_MAX 128      // Longer Location headers are dropped
+#define HTTP_ETAG_MAX 64           // Longer ETag headers are dropped
+#define HTTP_WAIT_FOR_DATA_MS 1    // Poll interval while waiting for bytes
+
+#define HTTP_RESPONSE_TIMED_OUT -3 // Same values as ArduinoHttpClient's errors
+#define HTTP_RESPONSE_INVALID -4
+
+/**
+ * Minimal HTTP/1.1 response reader for requests written directly to a
+ * Client (see FormRequest), which HttpClient cannot read the response of.
+ *
+ * Reads the status line (skipping 100 Continue), then headers one at a time
+ * into a fixed line buffer, then discards the body (or keeps its start in a
+ * caller's buffer), whether delimited by Content-Length, chunked encoding,
+ * or the server closing the connection. The few headers the clients act on
+ * (Content-Length, Transfer-Encoding, Connection, Location, ETag,
+ * Content-Range) are matched as they pass and kept in fixed fields; the rest are dropped
+ * without being copied anywhere. Nothing is allocated. The timeout applies
+ * to each wait for data, so a slow but steady response is not cut off.
+ */
+class HttpResponseReader {
+public:
+    HttpResponseReader(Client& client, unsigned long timeoutMs);
+
+    /**
+     * Returns the status code, or HTTP_RESPONSE_TIMED_OUT /
+     * HTTP_RESPONSE_INVALID.
+     */
+    int readStatus();
+
+    /**
+     * Reads the next header. Returns false at the blank line ending the
+     * headers (or on error). name and value point into an internal buffer
+     * that the next call overwrites.
+     */
+    bool readHeader(const char** name, const char** value);
+
+    /**
+     * Reads the remaining headers, keeping only the ones listed above.
+     * Returns false if the connection failed before they ended.
+     */
+    bool readHeaders();
+
+    /**
+     * Reads any remaining headers and discards the body. Returns false if
+     * the connection failed before the body ended.
+     */
+    bool skipBody();
+
+    /**
+     * Like skipBody(), but keeps the first size - 1 bytes of the body in
+     * buffer, NUL-terminated, and their count in *stored. The rest is
+     * discarded, so the connection stays usable for the next response.
+     */
+    bool readBody(char* buffer, size_t size, size_t* stored);
+
+    /**
+     * Ends a response whose body the caller does not need. If the
+     * connection will be reused, the body is skipped (see skipBody());
+     * otherwise only the headers are read and the body is left for the
+     * close to drop, which saves waiting for an error or redirect page.
+     */
+    bool finish(bool reuse);
+
+    /**
+     * Reads the next body bytes into buffer, waiting until it is full or
+     * the body ends, for a caller that streams the body somewhere rather
+     * than keeping it. Returns the count read: less than size only at the
+     * end of the body, or if the connection failed first (the body ends at
+     * Content-Length, so a short read before that is a failure). 0 once the
+     * body has been read. Chunked bodies are not supported and fail (-1).
+     */
+    int readBodyBytes(uint8_t* buffer, size_t size);
+
+    /**
+     * True once a Content-Length body has been read in full by
+     * readBodyBytes(), so the connection can carry another request.
+     */
+    bool bodyComplete() const { return stage == DONE; }
+
+    long contentLength() const { return length; }
+    bool isChunked() const { return chunked; }
+
+    /**
+     * True if the server will close the connection after this response
+     * ("Connection: close" or an HTTP/1.0 response).
+     */
+    bool closeRequested() const { return closing; }
+
+    /**
+     * The Location and ETag headers, or "" if absent or too long to keep.
+     */
+    const char* location() const { return locationValue; }
+    const char* etag() const { return etagValue; }
+
+    /**
+     * First byte offset of a 206 response's Content-Range, or -1 if there
+     * was none.
+     */
+    long rangeStart() const { return rangeFrom; }
+
+private:
+    enum Stage { STATUS, HEADERS, BODY, DONE, FAILED };
+
+    Client& client;
+    unsigned long timeoutMs;
+    Stage stage;
+    long length;
+    long rangeFrom;
+    unsigned long bodyRead; // by readBodyBytes()
+    bool chunked;
+    bool closing;
+    char line[HTTP_LINE_MAX];
+    char locationValue[HTTP_LOCATION_MAX];
+    char etagValue[HTTP_ETAG_MAX];
+    char* sink;      // readBody()'s buffer, or nullptr
+    size_t sinkRoom;
+    size_t sinkLen;
+
+    int readByte();
+    bool readLine();
+    bool skipBytes(unsigned long count);
+    void store(const uint8_t* data, size_t count);
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include "link_selector.h"
+
+LinkSelector::LinkSelector(int failureThreshold, unsigned long cooldownMs,
+                           unsigned long preferenceMs)
+    : count(0)
+    , failureThreshold(failureThreshold)
+    , cooldownMs(cooldownMs)
+    , preferenceMs(preferenceMs)
+    , lastSelected(-1)
+    , failovers(0)
+{
+}
+
+int LinkSelector::addLink() {
+    if (count >= LINK_SELECTOR_MAX_LINKS) return -1;
+    Link& l = links[count];
+    l.up = false;
+    l.consecutiveFailures = 0;
+    l.benchedAt = 0;
+    l.srttMs = 0;
+    l.hasRtt = false;
+    l.signalDbm = 0;
+    l.weakestDbm = 0;
+    return count++;
+}
+
+void LinkSelector::setLinkUp(int link, bool up) {
+    if (link < 0 || link >= count) return;
+    links[link].up = up;
+}
+
+void LinkSelector::recordSuccess(int link, unsigned long rttMs) {
+    if (link < 0 || link >= count) return;
+    Link& l = links[link];
+    l.consecutiveFailures = 0;
+    if (!l.hasRtt) {
+        l.srttMs = rttMs;
+        l.hasRtt = true;
+    } else {
+        // Same 1/8 gain as TCP's SRTT
+        long delta = (long)rttMs - (long)l.srttMs;
+        l.srttMs = (unsigned long)((long)l.srttMs + delta / 8);
+    }
+}
+
+void LinkSelector::recordFailure(int link, unsigned long nowMs) {
+    if (link < 0 || link >= count) return;
+    Link& l = links[link];
+    l.consecutiveFailures++;
+    if (l.consecutiveFailures >= failureThreshold) {
+        // (Re)bench; a failed probation probe restarts the cooldown
+        l.benchedAt = nowMs;
+        l.consecutiveFailures = failureThreshold;
+    }
+}
+
+void LinkSelector::recordSignal(int link, int dbm) {
+    if (link < 0 || link >= count || dbm >= 0) return;
+    Link& l = links[link];
+    if (l.signalDbm == 0) {
+        l.signalDbm = dbm;
+        l.weakestDbm = dbm;
+        return;
+    }
+    l.signalDbm += (dbm - l.signalDbm) / 4;
+    if (dbm < l.weakestDbm) l.weakestDbm = dbm;
+}
+
+bool LinkSelector::isHealthy(int link, unsigned long nowMs) const {
+    if (link < 0 || link >= count) return false;
+    const Link& l = links[link];
+    if (!l.up) return false;
+    if (l.consecutiveFailures < failureThreshold) return true;
+    return nowMs - l.benchedAt >= cooldownMs; // probation
+}
+
+int LinkSelector::best(int exclude, unsigned long nowMs, bool allowBenched) const {
+    int chosen = -1;
+    for (int i = 0; i < count; i++) {
+        if (i == exclude || !links[i].up) continue;
+        if (!allowBenched && !isHealthy(i, nowMs)) continue;
+        if (chosen < 0) {
+            chosen = i;
+            continue;
+        }
+        // i is less preferred than chosen; it must be clearly faster
+        if (links[i].srttMs + preferenceMs < links[chosen].srttMs) {
+            chosen = i;
+        }
+    }
+    return chosen;
+}
+
+int LinkSelector::select(unsigned long nowMs) {
+    int chosen = best(-1, nowMs, false);
+    if (chosen < 0) chosen = best(-1, nowMs, true);
+    if (chosen >= 0 && lastSelected >= 0 && chosen != lastSelected) {
+        failovers++;
+    }
+    if (chosen >= 0) lastSelected = chosen;
+    return chosen;
+}
+
+int LinkSelector::selectExcluding(int exclude, unsigned long nowMs) {
+    int chosen = best(exclude, nowMs, false);
+    if (chosen < 0) chosen = best(exclude, nowMs, true);
+    if (chosen >= 0 && chosen != lastSelected) {
+        failovers++;
+        lastSelected = chosen;
+    }
+    return chosen;
+}
+
+int LinkSelector::linkCount() const { return count; }
+
+bool LinkSelector::isUp(int link) const {
+    return link >= 0 && link < count && links[link].up;
+}
+
+unsigned long LinkSelector::smoothedRttMs(int link) const {
+    return (link >= 0 && link < count) ? links[link].srttMs : 0;
+}
+
+int LinkSelector::consecutiveFailures(int link) const {
+    return (link >= 0 && link < count) ? links[link].consecutiveFailures : 0;
+}
+
+int LinkSelector::signalDbm(int link) const {
+    return (link >= 0 && link < count) ? links[link].signalDbm : 0;
+}
+
+int LinkSelector::weakestSignalDbm(int link) const {
+    return (link >= 0 && link < count) ? links[link].weakestDbm : 0;
+}
+
+unsigned long LinkSelector::failoverCount() const { return failovers; }
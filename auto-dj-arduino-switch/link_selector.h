@@ -0,0 +1,96 @@
+#ifndef LINK_SELECTOR_H
+#define LINK_SELECTOR_H
+
+#define LINK_SELECTOR_MAX_LINKS 2
+
+/**
+ * Chooses which network link (Ethernet, WiFi) carries the next request.
+ *
+ * Each link reports whether it is up (cable/association), and every request
+ * reports its outcome and round-trip time. A link that fails
+ * failureThreshold requests in a row is benched for cooldownMs, after which
+ * it is eligible again on probation: one more failure benches it again,
+ * one success clears it.
+ *
+ * Among healthy links the lowest smoothed RTT wins. Links are registered in
+ * preference order, and a less preferred link must beat a more preferred
+ * one by more than preferenceMs to take over, which keeps the selection
+ * from flapping on RTT noise. Unmeasured links have an RTT of 0, so a link
+ * that just came up is tried promptly.
+ *
+ * Links that report a signal strength (WiFi RSSI) have it smoothed, for
+ * telemetry and for the caller to judge the link by; it does not affect
+ * the selection.
+ *
+ * Pure logic with no I/O; time is passed in by the caller.
+ */
+class LinkSelector {
+public:
+    LinkSelector(int failureThreshold, unsigned long cooldownMs,
+                 unsigned long preferenceMs);
+
+    /**
+     * Registers a link and returns its index. Call in preference order.
+     * Returns -1 if LINK_SELECTOR_MAX_LINKS links are already registered.
+     */
+    int addLink();
+
+    void setLinkUp(int link, bool up);
+    void recordSuccess(int link, unsigned long rttMs);
+    void recordFailure(int link, unsigned long nowMs);
+
+    /**
+     * Records a signal strength sample in dBm (negative).
+     */
+    void recordSignal(int link, int dbm);
+
+    /**
+     * Returns the index of the best link for a new request, or -1 if no link
+     * is up. Benched links are returned only when no healthy link is up.
+     */
+    int select(unsigned long nowMs);
+
+    /**
+     * Returns the best link other than `exclude`, for failing a request over
+     * after `exclude` just failed it. -1 if there is none.
+     */
+    int selectExcluding(int exclude, unsigned long nowMs);
+
+    int linkCount() const;
+    bool isUp(int link) const;
+    bool isHealthy(int link, unsigned long nowMs) const;
+    unsigned long smoothedRttMs(int link) const;
+    int consecutiveFailures(int link) const;
+
+    /**
+     * Smoothed (gain 1/4) and weakest signal strength in dBm, or 0 if the
+     * link has reported none.
+     */
+    int signalDbm(int link) const;
+    int weakestSignalDbm(int link) const;
+    unsigned long failoverCount() const;
+
+private:
+    struct Link {
+        bool up;
+        int consecutiveFailures;
+        unsigned long benchedAt;
+        unsigned long srttMs;
+        bool hasRtt;
+        int signalDbm;  // 0 until the first sample
+        int weakestDbm;
+    };
+
+    Link links[LINK_SELECTOR_MAX_LINKS];
+    int count;
+    int failureThreshold;
+    unsigned long cooldownMs;
+    unsigned long preferenceMs;
+
+    int lastSelected;
+    unsigned long failovers;
+
+    int best(int exclude, unsigned long nowMs, bool allowBenched) const;
+};
+
+#endif
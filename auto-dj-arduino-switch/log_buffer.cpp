@@ -0,0 +1,97 @@
+#include "log_buffer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+LogBuffer::LogBuffer(char* storage, size_t size)
+    : storage(storage)
+    , size(size)
+    , head(0)
+    , count(0)
+    , lineLen(0)
+    , dropped(0)
+{
+}
+
+// ========== Staging ==========
+
+void LogBuffer::stage(const char* s, size_t len) {
+    // Leave room for the terminating newline added by println()
+    size_t room = (LOG_LINE_MAX - 1) - lineLen;
+    if (len > room) {
+        len = room;
+    }
+    memcpy(line + lineLen, s, len);
+    lineLen += len;
+}
+
+void LogBuffer::print(const char* s) {
+    if (s) stage(s, strlen(s));
+}
+
+void LogBuffer::print(const String& s) {
+    stage(s.c_str(), s.length());
+}
+
+void LogBuffer::print(char c) {
+    stage(&c, 1);
+}
+
+void LogBuffer::print(int value) {
+    print((long)value);
+}
+
+void LogBuffer::print(unsigned int value) {
+    print((unsigned long)value);
+}
+
+void LogBuffer::print(long value) {
+    char buf[21]; // fits a 64-bit long
+    int n = snprintf(buf, sizeof(buf), "%ld", value);
+    stage(buf, (size_t)n);
+}
+
+void LogBuffer::print(unsigned long value) {
+    char buf[21]; // fits a 64-bit long
+    int n = snprintf(buf, sizeof(buf), "%lu", value);
+    stage(buf, (size_t)n);
+}
+
+// ========== Commit ==========
+
+void LogBuffer::println() {
+    line[lineLen++] = '\n';
+
+    if (lineLen > size - count) {
+        dropped++;
+    } else {
+        size_t tail = (head + count) % size;
+        size_t first = size - tail;
+        if (first > lineLen) first = lineLen;
+        memcpy(storage + tail, line, first);
+        memcpy(storage, line + first, lineLen - first);
+        count += lineLen;
+    }
+
+    lineLen = 0;
+}
+
+// ========== Draining ==========
+
+size_t LogBuffer::peek(const char** data, size_t maxLen) const {
+    size_t len = count;
+    if (head + len > size) len = size - head; // stop at the wrap point
+    if (len > maxLen) len = maxLen;
+    *data = storage + head;
+    return len;
+}
+
+void LogBuffer::consume(size_t len) {
+    if (len > count) len = count;
+    head = (head + len) % size;
+    count -= len;
+}
+
+size_t LogBuffer::pending() const { return count; }
+size_t LogBuffer::capacity() const { return size; }
+unsigned long LogBuffer::droppedCount() const { return dropped; }
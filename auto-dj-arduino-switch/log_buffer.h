@@ -0,0 +1,75 @@
+#ifndef LOG_BUFFER_H
+#define LOG_BUFFER_H
+
+#include <Arduino.h>
+
+#define LOG_LINE_MAX 192
+
+/**
+ * Non-blocking log sink backed by a fixed ring buffer.
+ *
+ * Mirrors the print()/println() subset of Serial that the sketch uses, but
+ * never touches the UART. Text is staged in a line buffer and committed to
+ * the ring as a whole line on println(), so a full ring drops complete lines
+ * (counted by droppedCount()) rather than interleaving fragments. Lines
+ * longer than LOG_LINE_MAX are truncated.
+ *
+ * The orchestrator drains the ring to Serial from loop() with peek()/consume(),
+ * writing only as much as Serial.availableForWrite() reports, so a log call
+ * costs a memcpy regardless of baud rate.
+ */
+class LogBuffer {
+public:
+    LogBuffer(char* storage, size_t size);
+
+    void print(const char* s);
+    void print(const String& s);
+    void print(char c);
+    void print(int value);
+    void print(unsigned int value);
+    void print(long value);
+    void print(unsigned long value);
+
+    void println();
+    template <typename T>
+    void println(const T& value) {
+        print(value);
+        println();
+    }
+
+    /**
+     * Returns up to maxLen bytes of committed text as one contiguous chunk
+     * (shorter than pending() when the data wraps). Does not remove it.
+     */
+    size_t peek(const char** data, size_t maxLen) const;
+
+    /**
+     * Removes len bytes previously returned by peek().
+     */
+    void consume(size_t len);
+
+    size_t pending() const;
+    size_t capacity() const;
+    unsigned long droppedCount() const;
+
+private:
+    char* storage;
+    size_t size;
+    size_t head;  // next byte to read
+    size_t count; // committed bytes in the ring
+
+    char line[LOG_LINE_MAX];
+    size_t lineLen;
+
+    unsigned long dropped;
+
+    void stage(const char* s, size_t len);
+};
+
+/**
+ * The sketch-wide log sink, defined in the .ino. Modules log here instead
+ * of calling Serial directly.
+ */
+extern LogBuffer serialLog;
+
+#endif
@@ -0,0 +1,115 @@
+/**
+ * Heap and stack readings for the Giga R1 (mbed OS, newlib).
+ *
+ * Heap bytes in use come from mallinfo(), which covers every allocator the
+ * sketch reaches (String and ArduinoJson call malloc directly). Allocation
+ * counts come from operator new/delete, replaced here, so they cover C++
+ * objects only; mbed's driver threads allocate too, so they are atomic.
+ *
+ * The heap peak is taken from mallinfo() at every reading -- MemScope entry
+ * and exit, and the periodic sample -- not in operator new: mallinfo()
+ * takes the malloc lock and walks the allocator's bins, too slow for every
+ * allocation. Heap taken and given back between two readings is missed.
+ */
+#if defined(ARDUINO_ARCH_MBED)
+
+#include "mem_stats.h"
+
+#include <malloc.h>
+#include <stdlib.h>
+#include <new>
+#include "cmsis_os2.h"
+#include "platform/mbed_atomic.h"
+#include "platform/mbed_error.h"
+
+static uint32_t newCount = 0;
+static uint32_t deleteCount = 0;
+static unsigned long peakMark = 0; // loop thread only
+
+// Size header keeps the new/delete pair balanced without sized delete
+struct alignas(8) AllocHeader {
+    size_t size;
+};
+
+static void* countedNew(size_t size) {
+    AllocHeader* h = (AllocHeader*)malloc(sizeof(AllocHeader) + size);
+    if (!h) return nullptr;
+    h->size = size;
+    core_util_atomic_incr_u32(&newCount, 1);
+    return h + 1;
+}
+
+// Out of memory halts through mbed's error handler, as mbed's own operator
+// new does (the core is built without exceptions); only the nothrow forms
+// return nullptr.
+void* operator new(size_t size) {
+    void* p = countedNew(size);
+    if (!p) {
+        MBED_ERROR1(MBED_MAKE_ERROR(MBED_MODULE_PLATFORM, MBED_ERROR_CODE_OUT_OF_MEMORY),
+                    "Operator new out of memory\r\n", size);
+    }
+    return p;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedNew(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedNew(size); }
+
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    core_util_atomic_incr_u32(&deleteCount, 1);
+    free((AllocHeader*)p - 1);
+}
+
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { operator delete(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { operator delete(p); }
+
+HeapCounters readHeapCounters() {
+    struct mallinfo mi = mallinfo();
+    HeapCounters c;
+    c.allocs = core_util_atomic_load_u32(&newCount);
+    c.frees = core_util_atomic_load_u32(&deleteCount);
+    c.inUse = (unsigned long)mi.uordblks;
+    if (c.inUse > peakMark) peakMark = c.inUse;
+    c.peak = peakMark; // highest reading since the last setHeapPeak()
+    return c;
+}
+
+void setHeapPeak(unsigned long bytes) {
+    peakMark = bytes;
+}
+
+/**
+ * Largest single allocation that would succeed right now, found by binary
+ * search with trial mallocs. About 20 malloc/free pairs; call it from the
+ * periodic stats dump, not every loop.
+ */
+unsigned long largestFreeBlock() {
+    unsigned long lo = 0;
+    unsigned long hi = 512UL * 1024UL;
+    while (lo < hi) {
+        unsigned long mid = (lo + hi + 1) / 2;
+        void* p = malloc(mid);
+        if (p) {
+            free(p);
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+/**
+ * Never-touched stack of the calling (loop) thread. mbed fills thread stacks
+ * with a watermark pattern, so this is a high-water mark, not the current
+ * depth.
+ */
+unsigned long stackFreeBytes() {
+    return osThreadGetStackSpace(osThreadGetId());
+}
+
+#endif
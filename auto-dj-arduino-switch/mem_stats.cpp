@@ -0,0 +1,126 @@
+#include "mem_stats.h"
+
+const char* memModuleName(MemModule module) {
+    switch (module) {
+        case MEM_OTHER:     return "other";
+        case MEM_AZURACAST: return "azuracast";
+        case MEM_FLOWSHEET: return "flowsheet";
+        case MEM_NETWORK:   return "network";
+        case MEM_LOG:       return "log";
+        default:            return "unknown";
+    }
+}
+
+MemStats::MemStats() {
+    reset();
+}
+
+void MemStats::reset() {
+    for (int i = 0; i < MEM_MODULE_COUNT; i++) {
+        modules[i] = ModuleMemStats{0, 0, 0, 0, 0};
+    }
+    depth = 0;
+    overflow = 0;
+    inUse = 0;
+    peak = 0;
+    allocs = 0;
+    frees = 0;
+    lastLargestFree = 0;
+    minFree = 0;
+    lastStackFree = 0;
+    minStack = 0;
+}
+
+void MemStats::enter(MemModule module, const HeapCounters& now) {
+    if (depth >= MEM_SCOPE_MAX_DEPTH) {
+        overflow++;
+        return;
+    }
+    Scope& s = scopes[depth++];
+    s.module = module;
+    s.entry = now;
+    s.outerPeak = now.peak;
+    s.childAllocs = 0;
+    s.childFrees = 0;
+    s.childRetained = 0;
+    modules[module].scopes++;
+}
+
+unsigned long MemStats::exit(const HeapCounters& now) {
+    if (overflow > 0) {
+        overflow--;
+        return now.peak;
+    }
+    if (depth == 0) return now.peak;
+
+    Scope& s = scopes[--depth];
+    unsigned long dAllocs = now.allocs - s.entry.allocs;
+    unsigned long dFrees = now.frees - s.entry.frees;
+    long dRetained = (long)now.inUse - (long)s.entry.inUse;
+
+    ModuleMemStats& m = modules[s.module];
+    m.allocs += dAllocs - s.childAllocs;
+    m.frees += dFrees - s.childFrees;
+    m.retained += dRetained - s.childRetained;
+    if (now.peak > s.entry.inUse && now.peak - s.entry.inUse > m.peak) {
+        m.peak = now.peak - s.entry.inUse;
+    }
+
+    if (depth > 0) {
+        Scope& parent = scopes[depth - 1];
+        parent.childAllocs += dAllocs;
+        parent.childFrees += dFrees;
+        parent.childRetained += dRetained;
+    }
+
+    sampleHeap(now);
+    return now.peak > s.outerPeak ? now.peak : s.outerPeak;
+}
+
+void MemStats::sampleHeap(const HeapCounters& now) {
+    inUse = now.inUse;
+    if (now.peak > peak) peak = now.peak;
+    if (now.inUse > peak) peak = now.inUse;
+    allocs = now.allocs;
+    frees = now.frees;
+    updateOther();
+}
+
+/**
+ * Whatever the scoped modules do not account for belongs to MEM_OTHER.
+ */
+void MemStats::updateOther() {
+    unsigned long scopedAllocs = 0;
+    unsigned long scopedFrees = 0;
+    long scopedRetained = 0;
+    for (int i = MEM_OTHER + 1; i < MEM_MODULE_COUNT; i++) {
+        scopedAllocs += modules[i].allocs;
+        scopedFrees += modules[i].frees;
+        scopedRetained += modules[i].retained;
+    }
+    ModuleMemStats& other = modules[MEM_OTHER];
+    other.allocs = allocs > scopedAllocs ? allocs - scopedAllocs : 0;
+    other.frees = frees > scopedFrees ? frees - scopedFrees : 0;
+    other.retained = (long)inUse - scopedRetained;
+    if (other.retained > 0 && (unsigned long)other.retained > other.peak) {
+        other.peak = (unsigned long)other.retained;
+    }
+}
+
+void MemStats::sampleLargestFree(unsigned long bytes) {
+    lastLargestFree = bytes;
+    if (minFree == 0 || bytes < minFree) minFree = bytes;
+}
+
+void MemStats::sampleStack(unsigned long freeBytes) {
+    lastStackFree = freeBytes;
+    if (minStack == 0 || freeBytes < minStack) minStack = freeBytes;
+}
+
+MemModule MemStats::currentModule() const {
+    return depth > 0 ? scopes[depth - 1].module : MEM_OTHER;
+}
+
+const ModuleMemStats& MemStats::module(MemModule module) const {
+    return modules[module];
+}
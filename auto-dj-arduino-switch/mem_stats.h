@@ -0,0 +1,143 @@
+#ifndef MEM_STATS_H
+#define MEM_STATS_H
+
+#define MEM_SCOPE_MAX_DEPTH 4
+
+/**
+ * Modules that heap use is attributed to. Allocations outside any MemScope
+ * count as MEM_OTHER.
+ */
+enum MemModule {
+    MEM_OTHER,
+    MEM_AZURACAST,
+    MEM_FLOWSHEET,
+    MEM_NETWORK,
+    MEM_LOG,
+    MEM_MODULE_COUNT
+};
+
+const char* memModuleName(MemModule module);
+
+/**
+ * A reading of the platform's heap counters (see readHeapCounters()).
+ * `peak` is the high-water mark of `inUse` since it was last set with
+ * setHeapPeak(); MemScope uses that to measure each scope's own peak. The
+ * platform raises it at least at every reading (the host shim on every
+ * allocation as well).
+ */
+struct HeapCounters {
+    unsigned long allocs; // cumulative
+    unsigned long frees;  // cumulative
+    unsigned long inUse;  // bytes
+    unsigned long peak;   // bytes
+};
+
+struct ModuleMemStats {
+    unsigned long scopes;  // times entered
+    unsigned long allocs;
+    unsigned long frees;
+    long retained;         // net bytes still held from this module's scopes
+    unsigned long peak;    // largest heap growth above scope entry
+};
+
+/**
+ * Heap and stack high-water-mark bookkeeping.
+ *
+ * Per-module attribution works by diffing heap counters across a scope:
+ * enter() records a reading when a module starts work, exit() charges the
+ * difference to it. Nested scopes are charged to the innermost module only.
+ * Global figures (heap in use and peak, fragmentation as the largest free
+ * block, stack headroom) are fed in by periodic samples and keep their
+ * worst-case values until reset.
+ *
+ * Pure logic; readings come from the platform functions below, which the
+ * sketch links for the Giga (mem_platform.cpp) and the test shim for the
+ * host.
+ */
+class MemStats {
+public:
+    MemStats();
+
+    void enter(MemModule module, const HeapCounters& now);
+
+    /**
+     * Closes the innermost scope. `now.peak` must be the peak since the
+     * matching enter(). Returns the peak to restore for the enclosing scope.
+     */
+    unsigned long exit(const HeapCounters& now);
+
+    void sampleHeap(const HeapCounters& now);
+    void sampleLargestFree(unsigned long bytes);
+    void sampleStack(unsigned long freeBytes);
+
+    MemModule currentModule() const;
+    const ModuleMemStats& module(MemModule module) const;
+
+    unsigned long heapInUse() const { return inUse; }
+    unsigned long heapPeak() const { return peak; }
+    unsigned long totalAllocs() const { return allocs; }
+    unsigned long totalFrees() const { return frees; }
+    unsigned long largestFree() const { return lastLargestFree; }
+    unsigned long minLargestFree() const { return minFree; }
+    unsigned long stackFree() const { return lastStackFree; }
+    unsigned long minStackFree() const { return minStack; }
+
+    void reset();
+
+private:
+    struct Scope {
+        MemModule module;
+        HeapCounters entry;
+        unsigned long outerPeak;
+        unsigned long childAllocs;
+        unsigned long childFrees;
+        long childRetained;
+    };
+
+    ModuleMemStats modules[MEM_MODULE_COUNT];
+    Scope scopes[MEM_SCOPE_MAX_DEPTH];
+    int depth;
+    int overflow; // scopes opened past MEM_SCOPE_MAX_DEPTH, ignored
+
+    unsigned long inUse;
+    unsigned long peak;
+    unsigned long allocs;
+    unsigned long frees;
+    unsigned long lastLargestFree;
+    unsigned long minFree;
+    unsigned long lastStackFree;
+    unsigned long minStack;
+
+    void updateOther();
+};
+
+// ========== Platform readings ==========
+
+HeapCounters readHeapCounters();
+void setHeapPeak(unsigned long bytes);
+unsigned long largestFreeBlock();
+unsigned long stackFreeBytes();
+
+extern MemStats memStats;
+
+/**
+ * Attributes heap use within a C++ scope to a module:
+ *
+ *     bool AzuraCastClient::poll() {
+ *         MemScope scope(MEM_AZURACAST);
+ *         ...
+ */
+class MemScope {
+public:
+    explicit MemScope(MemModule module) {
+        HeapCounters now = readHeapCounters();
+        memStats.enter(module, now);
+        setHeapPeak(now.inUse);
+    }
+    ~MemScope() { setHeapPeak(memStats.exit(readHeapCounters())); }
+
+    MemScope(const MemScope&) = delete;
+    MemScope& operator=(const MemScope&) = delete;
+};
+
+#endif
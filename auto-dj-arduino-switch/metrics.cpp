@@ -0,0 +1,225 @@
+#include "metrics.h"
+
+#include <string.h>
+
+// ========== LoopHistogram ==========
+
+static const unsigned long BUCKET_UPPER_MS[METRICS_LOOP_BUCKETS] = {
+    1, 2, 5, 10, 20, 50, 100, 500, 1000, 5000
+};
+
+LoopHistogram::LoopHistogram()
+    : total(0)
+    , sum(0)
+    , longest(0)
+{
+    for (int i = 0; i < METRICS_LOOP_BUCKETS; i++) buckets[i] = 0;
+}
+
+void LoopHistogram::observe(unsigned long ms) {
+    total++;
+    sum += ms;
+    if (ms > longest) longest = ms;
+    for (int i = 0; i < METRICS_LOOP_BUCKETS; i++) {
+        if (ms <= BUCKET_UPPER_MS[i]) {
+            buckets[i]++;
+            return;
+        }
+    }
+    // Longer than the last bound: only in +Inf, i.e. the total
+}
+
+unsigned long LoopHistogram::bucketUpperMs(int bucket) {
+    return BUCKET_UPPER_MS[bucket];
+}
+
+// ========== MetricsWriter ==========
+
+// Writes value's decimal digits at out; returns how many
+static size_t formatUnsigned(unsigned long value, char* out) {
+    char digits[20];
+    size_t n = 0;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    for (size_t i = 0; i < n; i++) out[i] = digits[n - 1 - i];
+    return n;
+}
+
+MetricsWriter::MetricsWriter(char* buf, size_t capacity)
+    : buf(buf)
+    , capacity(capacity)
+    , len(0)
+    , overflow(false)
+{
+}
+
+void MetricsWriter::clear() {
+    len = 0;
+    overflow = false;
+}
+
+void MetricsWriter::family(const char* name, const char* type, const char* help) {
+    if (overflow) return;
+    size_t start = len;
+    const char* parts[] = {"# HELP ", name, " ", help, "\n# TYPE ", name, " ", type, "\n"};
+    for (const char* part : parts) {
+        size_t n = strlen(part);
+        if (len + n > capacity) {
+            len = start;
+            overflow = true;
+            return;
+        }
+        memcpy(buf + len, part, n);
+        len += n;
+    }
+}
+
+void MetricsWriter::line(const char* name, const char* suffix, const char* labelName,
+                         const char* labelValue, bool negative, unsigned long value) {
+    if (overflow) return;
+    char number[21];
+    size_t numberLen = 0;
+    if (negative) number[numberLen++] = '-';
+    numberLen += formatUnsigned(value, number + numberLen);
+
+    size_t nameLen = strlen(name);
+    size_t suffixLen = suffix ? strlen(suffix) : 0;
+    size_t labelNameLen = labelName ? strlen(labelName) : 0;
+    size_t labelValueLen = labelName ? strlen(labelValue) : 0;
+    // name suffix {label="value"} number\n
+    size_t need = nameLen + suffixLen + (labelName ? labelNameLen + labelValueLen + 5 : 0) +
+                  1 + numberLen + 1;
+    if (len + need > capacity) {
+        overflow = true;
+        return;
+    }
+
+    char* p = buf + len;
+    memcpy(p, name, nameLen);
+    p += nameLen;
+    if (suffixLen) {
+        memcpy(p, suffix, suffixLen);
+        p += suffixLen;
+    }
+    if (labelName) {
+        *p++ = '{';
+        memcpy(p, labelName, labelNameLen);
+        p += labelNameLen;
+        *p++ = '=';
+        *p++ = '"';
+        memcpy(p, labelValue, labelValueLen);
+        p += labelValueLen;
+        *p++ = '"';
+        *p++ = '}';
+    }
+    *p++ = ' ';
+    memcpy(p, number, numberLen);
+    p += numberLen;
+    *p++ = '\n';
+    len += need;
+}
+
+void MetricsWriter::sample(const char* name, const char* labelName, const char* labelValue,
+                           long value) {
+    bool negative = value < 0;
+    unsigned long magnitude = negative ? 0UL - (unsigned long)value : (unsigned long)value;
+    line(name, nullptr, labelName, labelValue, negative, magnitude);
+}
+
+void MetricsWriter::value(const char* name, const char* labelName, const char* labelValue,
+                          unsigned long v) {
+    line(name, nullptr, labelName, labelValue, false, v);
+}
+
+void MetricsWriter::histogram(const char* name, const LoopHistogram& h) {
+    unsigned long cumulative = 0;
+    char bound[21];
+    for (int i = 0; i < METRICS_LOOP_BUCKETS; i++) {
+        cumulative += h.bucketCount(i);
+        bound[formatUnsigned(LoopHistogram::bucketUpperMs(i), bound)] = '\0';
+        line(name, "_bucket", "le", bound, false, cumulative);
+    }
+    line(name, "_bucket", "le", "+Inf", false, h.count());
+    line(name, "_sum", nullptr, nullptr, false, h.sumMs());
+    line(name, "_count", nullptr, nullptr, false, h.count());
+}
+
+// ========== Rendering ==========
+
+static const char* const POLL_RESULTS[] = {"new", "unchanged", "failed"};
+
+bool renderMetrics(int section, const MetricsSample& s, MetricsWriter& w) {
+    switch (section) {
+        case 0:
+            w.family("auto_dj_uptime_seconds", "gauge", "Seconds since boot.");
+            w.value("auto_dj_uptime_seconds", s.uptimeS);
+            return true;
+        case 1:
+            w.family("auto_dj_state", "gauge", "1 for the state machine's current state.");
+            for (int i = BOOTING; i <= ERROR_STATE; i++) {
+                w.sample("auto_dj_state", "state", stateName((State)i), s.state == i ? 1 : 0);
+            }
+            return true;
+        case 2: {
+            w.family("auto_dj_polls_total", "counter",
+                     "AzuraCast now-playing polls by result (unchanged: the track already seen).");
+            unsigned long counts[] = {s.polls - s.pollsUnchanged - s.pollsFailed,
+                                      s.pollsUnchanged, s.pollsFailed};
+            for (int i = 0; i < 3; i++) {
+                w.value("auto_dj_polls_total", "result", POLL_RESULTS[i], counts[i]);
+            }
+            return true;
+        }
+        case 3:
+            w.family("auto_dj_flowsheet_entries_total", "counter",
+                     "Flowsheet entries by outcome.");
+            for (int i = 0; i < PLAY_STATUS_COUNT; i++) {
+                w.value("auto_dj_flowsheet_entries_total", "result",
+                        playStatusName((PlayStatus)i), s.entries[i]);
+            }
+            return true;
+        case 4:
+            w.family("auto_dj_retries_total", "counter",
+                     "Show start and sign-off retries scheduled after a failure.");
+            w.value("auto_dj_retries_total", s.retries);
+            return true;
+        case 5:
+            w.family("auto_dj_loop_duration_milliseconds", "histogram",
+                     "Time taken by each loop() iteration.");
+            if (s.loop) w.histogram("auto_dj_loop_duration_milliseconds", *s.loop);
+            return true;
+        case 6:
+            w.family("auto_dj_loop_longest_milliseconds", "gauge",
+                     "Longest loop() iteration since boot.");
+            w.value("auto_dj_loop_longest_milliseconds", s.loop ? s.loop->maxMs() : 0);
+            return true;
+        case 7:
+            w.family("auto_dj_heap_in_use_bytes", "gauge", "Heap bytes allocated.");
+            w.value("auto_dj_heap_in_use_bytes", s.heapInUse);
+            return true;
+        case 8:
+            w.family("auto_dj_heap_peak_bytes", "gauge", "Most heap bytes allocated at once.");
+            w.value("auto_dj_heap_peak_bytes", s.heapPeak);
+            return true;
+        case 9:
+            w.family("auto_dj_stack_free_bytes", "gauge", "Unused bytes of the loop's stack.");
+            w.value("auto_dj_stack_free_bytes", s.stackFree);
+            return true;
+        case 10:
+            w.family("auto_dj_link_signal_dbm", "gauge",
+                     "Signal strength of each wireless link.");
+            for (int i = 0; i < s.linkCount && i < LINK_SELECTOR_MAX_LINKS; i++) {
+                if (s.linkSignalDbm[i] == 0) continue;
+                w.sample("auto_dj_link_signal_dbm", "link", s.linkNames[i], s.linkSignalDbm[i]);
+            }
+            return true;
+        case 11:
+            w.family("auto_dj_scrapes_total", "counter", "Metrics requests served.");
+            w.value("auto_dj_scrapes_total", s.scrapes);
+            return true;
+        default:
+            return false;
+    }
+}
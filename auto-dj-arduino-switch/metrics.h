@@ -0,0 +1,107 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include "link_selector.h"
+#include "play_history.h"
+#include "state_machine.h"
+
+#define METRICS_LOOP_BUCKETS 10 // loop durations <=1, 2, 5, 10, 20, 50, 100, 500, 1000, 5000 ms
+
+/**
+ * Cumulative-on-render histogram of millisecond durations with fixed
+ * upper bounds (Prometheus "le" buckets; +Inf is the total count).
+ */
+class LoopHistogram {
+public:
+    LoopHistogram();
+
+    void observe(unsigned long ms);
+
+    /** Upper bound (inclusive) of bucket i. */
+    static unsigned long bucketUpperMs(int bucket);
+
+    unsigned long bucketCount(int bucket) const { return buckets[bucket]; }
+    unsigned long count() const { return total; }
+    unsigned long sumMs() const { return sum; }
+    unsigned long maxMs() const { return longest; }
+
+private:
+    unsigned long buckets[METRICS_LOOP_BUCKETS]; // this bucket only, not cumulative
+    unsigned long total;
+    unsigned long sum;
+    unsigned long longest;
+};
+
+/**
+ * What one scrape reports, gathered by the sketch when a request comes in.
+ * Counters are totals since boot.
+ */
+struct MetricsSample {
+    State state;
+    unsigned long uptimeS;
+    unsigned long polls;           // AzuraCast polls made
+    unsigned long pollsUnchanged;  // answered with the track already seen
+    unsigned long pollsFailed;     // no usable answer
+    unsigned long entries[PLAY_STATUS_COUNT]; // flowsheet entries by outcome
+    unsigned long retries;         // startShow/endShow retries scheduled after a failure
+    unsigned long heapInUse;
+    unsigned long heapPeak;
+    unsigned long stackFree;
+    int linkCount;
+    const char* linkNames[LINK_SELECTOR_MAX_LINKS];  // the transports' own names
+    int linkSignalDbm[LINK_SELECTOR_MAX_LINKS];      // 0: not reported (wired, or no sample yet)
+    unsigned long scrapes;         // including this one
+    const LoopHistogram* loop;
+};
+
+/**
+ * Appends Prometheus text exposition (version 0.0.4) to a caller's fixed
+ * buffer. Nothing is allocated and nothing is formatted with printf; if a
+ * line does not fit, the writer stops and overflowed() says so, leaving
+ * only whole lines in the buffer.
+ */
+class MetricsWriter {
+public:
+    MetricsWriter(char* buf, size_t capacity);
+
+    /** # HELP and # TYPE lines for a family. */
+    void family(const char* name, const char* type, const char* help);
+
+    /**
+     * One sample line: name, then {labelName="labelValue"} if labelName is
+     * not null, then the value. Label values are written as given; the
+     * sketch only uses fixed names. sample() is for values that may be
+     * negative, value() for counts and sizes.
+     */
+    void sample(const char* name, const char* labelName, const char* labelValue, long value);
+    void value(const char* name, const char* labelName, const char* labelValue,
+               unsigned long v);
+    void value(const char* name, unsigned long v) { value(name, nullptr, nullptr, v); }
+
+    /** _bucket lines (cumulative, then +Inf), _sum and _count. */
+    void histogram(const char* name, const LoopHistogram& h);
+
+    size_t length() const { return len; }
+    bool overflowed() const { return overflow; }
+    void clear();
+
+private:
+    char* buf;
+    size_t capacity;
+    size_t len;
+    bool overflow;
+
+    void line(const char* name, const char* suffix, const char* labelName,
+              const char* labelValue, bool negative, unsigned long value);
+};
+
+/**
+ * Renders family `section` of the sample (one # HELP/# TYPE block and its
+ * samples) into w. Returns false once section is past the last family.
+ * Rendering family by family lets a caller send a whole scrape through a
+ * buffer the size of the largest family.
+ */
+bool renderMetrics(int section, const MetricsSample& sample, MetricsWriter& w);
+
+#endif
@@ -0,0 +1,42 @@
+/**
+ * Metrics listeners for the Giga R1: METRICS_PORT on the WiFi interface,
+ * and on the Ethernet Shield 2 as well when ENABLE_ETHERNET, whichever
+ * link the scraper reaches. Plain HTTP on the local network; the W5500's
+ * sockets are shared with the clients' connections.
+ */
+#include "config.h"
+
+#if defined(ARDUINO_ARCH_MBED) && ENABLE_METRICS
+
+#include "metrics_server.h"
+
+#include <WiFi.h>
+#if ENABLE_ETHERNET
+#include <Ethernet.h>
+#endif
+
+static WiFiServer wifiListener(METRICS_PORT);
+static WiFiClient wifiClient;
+#if ENABLE_ETHERNET
+static EthernetServer ethernetListener(METRICS_PORT);
+static EthernetClient ethernetClient;
+#endif
+
+bool metricsListen() {
+    wifiListener.begin();
+#if ENABLE_ETHERNET
+    ethernetListener.begin();
+#endif
+    return true;
+}
+
+Client* metricsAccept() {
+#if ENABLE_ETHERNET
+    ethernetClient = ethernetListener.accept();
+    if (ethernetClient) return &ethernetClient;
+#endif
+    wifiClient = wifiListener.accept();
+    return wifiClient ? &wifiClient : nullptr;
+}
+
+#endif
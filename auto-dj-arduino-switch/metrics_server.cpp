@@ -0,0 +1,145 @@
+#include "metrics_server.h"
+#include "log_buffer.h"
+
+#include <string.h>
+
+static const char OK_HEAD[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/plain; version=0.0.4\r\n"
+    "Connection: close\r\n"
+    "\r\n";
+
+static const char NOT_FOUND_RESPONSE[] =
+    "HTTP/1.1 404 Not Found\r\n"
+    "Content-Type: text/plain\r\n"
+    "Connection: close\r\n"
+    "\r\n"
+    "Not found\n";
+
+static_assert(sizeof(NOT_FOUND_RESPONSE) <= METRICS_CHUNK_MAX, "METRICS_CHUNK_MAX too small");
+
+MetricsServer::MetricsServer(Sampler sampler)
+    : sampler(sampler)
+    , client(nullptr)
+    , phase(READING)
+    , startedAt(0)
+    , requestLen(0)
+    , lineLen(0)
+    , inFirstLine(true)
+    , section(-1)
+    , found(false)
+    , chunkLen(0)
+    , chunkSent(0)
+    , scrapes(0)
+    , drops(0)
+{
+    request[0] = '\0';
+}
+
+bool MetricsServer::begin(Client* accepted, unsigned long nowMs) {
+    if (client) return false;
+    client = accepted;
+    phase = READING;
+    startedAt = nowMs;
+    requestLen = 0;
+    lineLen = 0;
+    inFirstLine = true;
+    return true;
+}
+
+void MetricsServer::update(unsigned long nowMs) {
+    if (!client) return;
+    if (nowMs - startedAt >= METRICS_TIMEOUT_MS) {
+        serialLog.println("[Metrics] Scrape timed out.");
+        drops++;
+        finish();
+        return;
+    }
+
+    if (phase == READING) {
+        if (readRequest()) {
+            respond();
+        } else if (!client->connected()) {
+            finish(); // the scraper gave up before asking
+        }
+        return;
+    }
+
+    if (chunkSent == chunkLen && !fill()) {
+        finish();
+        return;
+    }
+    size_t n = client->write((const uint8_t*)chunk + chunkSent, chunkLen - chunkSent);
+    chunkSent += n;
+    if (n == 0 && !client->connected()) {
+        drops++;
+        finish();
+    }
+}
+
+// Reads what has arrived, at most METRICS_REQUEST_MAX bytes, keeping the
+// request line. Returns true at the blank line that ends the headers.
+bool MetricsServer::readRequest() {
+    for (int i = 0; i < METRICS_REQUEST_MAX && client->available() > 0; i++) {
+        int c = client->read();
+        if (c < 0) break;
+        if (c == '\r') continue;
+        if (c == '\n') {
+            if (lineLen == 0) return true;
+            lineLen = 0;
+            inFirstLine = false;
+            continue;
+        }
+        lineLen++;
+        if (inFirstLine && requestLen < sizeof(request) - 1) request[requestLen++] = (char)c;
+    }
+    return false;
+}
+
+// Decides the answer and, for a scrape, takes the sample it reports
+void MetricsServer::respond() {
+    request[requestLen] = '\0';
+    const char* path = "GET /metrics";
+    size_t pathLen = strlen(path);
+    found = strncmp(request, path, pathLen) == 0 &&
+            (request[pathLen] == ' ' || request[pathLen] == '?' || request[pathLen] == '\0');
+    if (found) {
+        scrapes++;
+        sampler(&sample);
+        sample.scrapes = scrapes;
+    }
+    phase = WRITING;
+    section = -1;
+    chunkLen = 0;
+    chunkSent = 0;
+}
+
+// Puts the next piece of the response in the chunk. Returns false once
+// all of it has been sent.
+bool MetricsServer::fill() {
+    chunkSent = 0;
+    if (section < 0) {
+        const char* head = found ? OK_HEAD : NOT_FOUND_RESPONSE;
+        chunkLen = strlen(head);
+        memcpy(chunk, head, chunkLen);
+        section = 0;
+        return true;
+    }
+    if (!found) return false;
+
+    MetricsWriter writer(chunk, sizeof(chunk));
+    if (!renderMetrics(section, sample, writer)) return false;
+    if (writer.overflowed()) {
+        serialLog.print("[Metrics] Family ");
+        serialLog.print(section);
+        serialLog.println(" cut short; raise METRICS_CHUNK_MAX.");
+    }
+    section++;
+    chunkLen = writer.length();
+    return true;
+}
+
+void MetricsServer::finish() {
+    client->stop();
+    client = nullptr;
+}
@@ -0,0 +1,90 @@
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include "config.h"
+#include "metrics.h"
+
+/**
+ * Serves GET /metrics to one scraper at a time, cooperatively: begin()
+ * takes an accepted connection and every update() does one bounded step of
+ * it -- read what request bytes have arrived, or write one metric family --
+ * so a scrape is spread over several loop() iterations and never holds up
+ * the relay.
+ *
+ * The response is rendered family by family into one METRICS_CHUNK_MAX
+ * buffer and written straight to the client; there is no Content-Length
+ * and the connection closes when the last family is sent. Nothing is
+ * allocated. The sample is taken once per scrape, when the request has
+ * been read, so every family in a response describes the same moment.
+ *
+ * Anything but GET /metrics is answered 404, and a scrape not finished
+ * within METRICS_TIMEOUT_MS is dropped.
+ */
+class MetricsServer {
+public:
+    /** Fills a sample; scrapes is filled in by the server. */
+    typedef void (*Sampler)(MetricsSample* sample);
+
+    explicit MetricsServer(Sampler sampler);
+
+    /**
+     * Takes a newly accepted connection. Returns false, touching nothing,
+     * while a scrape is already in progress.
+     */
+    bool begin(Client* client, unsigned long nowMs);
+
+    /** One step of the scrape in progress, if any. Call every loop(). */
+    void update(unsigned long nowMs);
+
+    bool busy() const { return client != nullptr; }
+    unsigned long scrapeCount() const { return scrapes; }
+    unsigned long dropCount() const { return drops; }
+
+private:
+    enum Phase {
+        READING, // waiting for the end of the request headers
+        WRITING  // sending the response a chunk at a time
+    };
+
+    Sampler sampler;
+    Client* client;
+    Phase phase;
+    unsigned long startedAt;
+
+    char request[METRICS_REQUEST_MAX]; // the request line, cut to fit
+    size_t requestLen;
+    size_t lineLen;    // bytes of the current header line, CR excluded
+    bool inFirstLine;
+
+    MetricsSample sample;
+    int section;       // next family to render; -1 for the status and headers
+    bool found;        // the request was GET /metrics
+    char chunk[METRICS_CHUNK_MAX];
+    size_t chunkLen;
+    size_t chunkSent;
+
+    unsigned long scrapes;
+    unsigned long drops;
+
+    bool readRequest();
+    void respond();
+    bool fill();
+    void finish();
+};
+
+/**
+ * Platform: starts listening on METRICS_PORT on each enabled interface.
+ * Returns false if there is nothing to listen on (metrics_platform.cpp on
+ * the Giga).
+ */
+bool metricsListen();
+
+/**
+ * Platform: a connection waiting to be served, or nullptr. Valid until the
+ * next call.
+ */
+Client* metricsAccept();
+
+#endif
@@ -0,0 +1,562 @@
+#include "mgmt_codec.h"
+#include "msgpack.h"
+
+#include <ArduinoJson.h>
+#include <string.h>
+
+// MessagePack keys and enum values (see mgmt_codec.h)
+enum {
+    KEY_TYPE = 0,
+
+    HB_STATE = 1,
+    HB_TRANSPORT,
+    HB_UPTIME,
+    HB_WIFI_RSSI,
+    HB_FREE_RAM,
+    HB_RADIO_SHOW_ID,
+    HB_LAST_TRACK,
+    HB_LAST_ERROR,
+    HB_FIRMWARE,
+    HB_CONFIG_HASH,
+    HB_LOOP_MAX,
+    HB_RECONNECTS,
+    HB_DETECTED,
+    HB_POSTED,
+    HB_ERRORS,
+    HB_SEQ,
+    HB_BASE,
+
+    TRACK_ARTIST = 0,
+    TRACK_TITLE,
+    TRACK_POSTED_AT,
+
+    CMD_ID = 1,
+    CMD_ACTION,
+    CMD_KEY,
+    CMD_VALUE,
+
+    ACK_ID = 1,
+    ACK_STATUS,
+    ACK_ERROR
+};
+
+enum { TYPE_HEARTBEAT = 0, TYPE_COMMAND = 1, TYPE_ACK = 2 };
+
+static const char* const ACTION_NAMES[] = {
+    "set_config", "pause", "resume", "end_show", "restart", "ping"
+};
+static const char* const ACK_STATUS_NAMES[] = { "ok", "error", "unknown_command" };
+
+MgmtEncoding mgmtEncodingFor(const char* subprotocol) {
+    return subprotocol && strcmp(subprotocol, MGMT_SUBPROTOCOL_MSGPACK) == 0 ? MGMT_MSGPACK
+                                                                             : MGMT_JSON;
+}
+
+// ========== Helpers ==========
+
+/**
+ * Length of s as sent in MessagePack: at most MGMT_STRING_MAX - 1 bytes,
+ * cut at a UTF-8 character boundary.
+ */
+static size_t clippedLength(const char* s) {
+    size_t n = strlen(s);
+    if (n < MGMT_STRING_MAX) return n;
+    n = MGMT_STRING_MAX - 1;
+    while (n > 0 && ((uint8_t)s[n] & 0xC0) == 0x80) n--;
+    return n;
+}
+
+static void writeClipped(MsgPackWriter& w, const char* s) {
+    w.writeStr(s, clippedLength(s));
+}
+
+/**
+ * Whether `s`, clipped, equals `kept` (a string stored by keepString()).
+ */
+static bool sameString(const char* s, const char* kept) {
+    if (!s || !kept) return s == kept;
+    size_t n = clippedLength(s);
+    return strlen(kept) == n && memcmp(s, kept, n) == 0;
+}
+
+/**
+ * Stores s, clipped, in a MGMT_STRING_MAX buffer for later comparison.
+ */
+static const char* keepString(const char* s, char* storage) {
+    if (!s) return nullptr;
+    size_t n = clippedLength(s);
+    memcpy(storage, s, n);
+    storage[n] = '\0';
+    return storage;
+}
+
+/**
+ * Copies a MessagePack string into a fixed buffer, NUL-terminated. Fails if
+ * it does not fit.
+ */
+static bool copyStr(MsgPackReader& r, char* storage, size_t size) {
+    const char* s;
+    size_t n;
+    if (!r.readStr(&s, &n) || n >= size) return false;
+    memcpy(storage, s, n);
+    storage[n] = '\0';
+    return true;
+}
+
+static bool copyJsonStr(JsonVariant v, char* storage, size_t size) {
+    const char* s = v.as<const char*>();
+    if (!s) {
+        storage[0] = '\0';
+        return true;
+    }
+    size_t n = strlen(s);
+    if (n >= size) return false;
+    memcpy(storage, s, n + 1);
+    return true;
+}
+
+static size_t finishJson(JsonDocument& doc, uint8_t* buf, size_t capacity) {
+    size_t needed = measureJson(doc);
+    if (needed + 1 > capacity) return 0;
+    return serializeJson(doc, (char*)buf, capacity);
+}
+
+// ========== Heartbeat encoder ==========
+
+HeartbeatEncoder::HeartbeatEncoder(int keyframeInterval)
+    : enc(MGMT_JSON)
+    , keyframeInterval(keyframeInterval)
+    , sinceKeyframe(-1)
+    , seq(0)
+    , base()
+{
+}
+
+void HeartbeatEncoder::reset(MgmtEncoding encoding) {
+    enc = encoding;
+    sinceKeyframe = -1;
+    seq = 0;
+}
+
+size_t HeartbeatEncoder::encode(const Heartbeat& hb, uint8_t* buf, size_t capacity) {
+    if (enc == MGMT_MSGPACK) {
+        bool keyframe = sinceKeyframe < 0 || sinceKeyframe + 1 >= keyframeInterval ||
+                        hb.uptimeS < base.uptimeS || hb.reconnectCount < base.reconnectCount ||
+                        hb.tracksDetected < base.tracksDetected ||
+                        hb.tracksPosted < base.tracksPosted ||
+                        hb.errorsSinceBoot < base.errorsSinceBoot;
+        size_t n = encodeMsgPack(hb, keyframe, buf, capacity);
+        if (n == 0) return 0;
+        seq++;
+        sinceKeyframe = keyframe ? 0 : sinceKeyframe + 1;
+        remember(hb);
+        return n;
+    }
+
+    JsonDocument doc;
+    doc["type"] = "heartbeat";
+    doc["state"] = stateName(hb.state);
+    doc["transport"] = hb.transport == MGMT_TRANSPORT_ETHERNET ? "ethernet" : "wifi";
+    doc["uptime_s"] = (unsigned long)hb.uptimeS;
+    if (hb.hasWifiRssi) {
+        doc["wifi_rssi"] = (long)hb.wifiRssi;
+    } else {
+        doc["wifi_rssi"] = nullptr;
+    }
+    doc["free_ram"] = (unsigned long)hb.freeRam;
+    if (hb.radioShowID >= 0) {
+        doc["radio_show_id"] = (long)hb.radioShowID;
+    } else {
+        doc["radio_show_id"] = nullptr;
+    }
+    if (hb.lastTrackArtist) {
+        doc["last_track"]["artist"] = hb.lastTrackArtist;
+        doc["last_track"]["title"] = hb.lastTrackTitle ? hb.lastTrackTitle : "";
+        doc["last_track"]["posted_at"] = (unsigned long)hb.lastTrackPostedAt;
+    } else {
+        doc["last_track"] = nullptr;
+    }
+    doc["last_error"] = hb.lastError;
+    doc["firmware_version"] = hb.firmwareVersion ? hb.firmwareVersion : "";
+    doc["config_hash"] = hb.configHash ? hb.configHash : "";
+    doc["loop_max_ms"] = (unsigned long)hb.loopMaxMs;
+    doc["reconnect_count"] = (unsigned long)hb.reconnectCount;
+    doc["tracks_detected"] = (unsigned long)hb.tracksDetected;
+    doc["tracks_posted"] = (unsigned long)hb.tracksPosted;
+    doc["errors_since_boot"] = (unsigned long)hb.errorsSinceBoot;
+    return finishJson(doc, buf, capacity);
+}
+
+size_t HeartbeatEncoder::encodeMsgPack(const Heartbeat& hb, bool keyframe, uint8_t* buf,
+                                       size_t capacity) {
+    MsgPackWriter w(buf, capacity);
+    size_t map = w.beginMap();
+    size_t count = 0;
+
+    w.writeUint(KEY_TYPE); w.writeUint(TYPE_HEARTBEAT); count++;
+    w.writeUint(HB_SEQ); w.writeUint(seq + 1); count++;
+    if (!keyframe) {
+        w.writeUint(HB_BASE); w.writeUint(seq); count++;
+    }
+
+    if (keyframe || hb.state != base.state) {
+        w.writeUint(HB_STATE); w.writeUint((uint32_t)hb.state); count++;
+    }
+    if (keyframe || hb.transport != base.transport) {
+        w.writeUint(HB_TRANSPORT); w.writeUint((uint32_t)hb.transport); count++;
+    }
+    if (keyframe || hb.hasWifiRssi != base.hasWifiRssi ||
+        (hb.hasWifiRssi && hb.wifiRssi != base.wifiRssi)) {
+        w.writeUint(HB_WIFI_RSSI);
+        if (hb.hasWifiRssi) {
+            w.writeInt(hb.wifiRssi);
+        } else {
+            w.writeNil();
+        }
+        count++;
+    }
+    if (keyframe || hb.freeRam != base.freeRam) {
+        w.writeUint(HB_FREE_RAM); w.writeUint(hb.freeRam); count++;
+    }
+    if (keyframe || hb.radioShowID != base.radioShowID) {
+        w.writeUint(HB_RADIO_SHOW_ID);
+        if (hb.radioShowID >= 0) {
+            w.writeInt(hb.radioShowID);
+        } else {
+            w.writeNil();
+        }
+        count++;
+    }
+    if (keyframe || !sameString(hb.lastTrackArtist, base.lastTrackArtist) ||
+        !sameString(hb.lastTrackTitle, base.lastTrackTitle) ||
+        hb.lastTrackPostedAt != base.lastTrackPostedAt) {
+        w.writeUint(HB_LAST_TRACK);
+        if (hb.lastTrackArtist) {
+            w.writeMapHeader(3);
+            w.writeUint(TRACK_ARTIST); writeClipped(w, hb.lastTrackArtist);
+            w.writeUint(TRACK_TITLE); writeClipped(w, hb.lastTrackTitle ? hb.lastTrackTitle : "");
+            w.writeUint(TRACK_POSTED_AT); w.writeUint(hb.lastTrackPostedAt);
+        } else {
+            w.writeNil();
+        }
+        count++;
+    }
+    if (keyframe || !sameString(hb.lastError, base.lastError)) {
+        w.writeUint(HB_LAST_ERROR);
+        if (hb.lastError) {
+            writeClipped(w, hb.lastError);
+        } else {
+            w.writeNil();
+        }
+        count++;
+    }
+    if (keyframe || !sameString(hb.firmwareVersion, base.firmwareVersion)) {
+        w.writeUint(HB_FIRMWARE); writeClipped(w, hb.firmwareVersion ? hb.firmwareVersion : ""); count++;
+    }
+    if (keyframe || !sameString(hb.configHash, base.configHash)) {
+        w.writeUint(HB_CONFIG_HASH); writeClipped(w, hb.configHash ? hb.configHash : ""); count++;
+    }
+    w.writeUint(HB_LOOP_MAX); w.writeUint(hb.loopMaxMs); count++;
+
+    // Counters: absolute in a keyframe, increments otherwise
+    const uint32_t values[] = { hb.uptimeS, hb.reconnectCount, hb.tracksDetected,
+                                hb.tracksPosted, hb.errorsSinceBoot };
+    const uint32_t previous[] = { base.uptimeS, base.reconnectCount, base.tracksDetected,
+                                  base.tracksPosted, base.errorsSinceBoot };
+    const uint32_t keys[] = { HB_UPTIME, HB_RECONNECTS, HB_DETECTED, HB_POSTED, HB_ERRORS };
+    for (int i = 0; i < 5; i++) {
+        uint32_t v = keyframe ? values[i] : values[i] - previous[i];
+        if (keyframe || v != 0) {
+            w.writeUint(keys[i]); w.writeUint(v); count++;
+        }
+    }
+
+    w.endMap(map, count);
+    return w.overflowed() ? 0 : w.length();
+}
+
+void HeartbeatEncoder::remember(const Heartbeat& hb) {
+    base = hb;
+    base.lastTrackArtist = keepString(hb.lastTrackArtist, baseArtist);
+    base.lastTrackTitle = keepString(hb.lastTrackTitle, baseTitle);
+    base.lastError = keepString(hb.lastError, baseError);
+    base.firmwareVersion = keepString(hb.firmwareVersion, baseFirmware);
+    base.configHash = keepString(hb.configHash, baseConfigHash);
+}
+
+// ========== Heartbeat decoder ==========
+
+HeartbeatDecoder::HeartbeatDecoder()
+    : haveBase(false)
+    , seq(0)
+    , current()
+{
+}
+
+MgmtDecodeResult HeartbeatDecoder::decode(const uint8_t* data, size_t len, Heartbeat* out) {
+    MsgPackReader r(data, len);
+    size_t fields;
+    if (!r.readMapHeader(&fields)) return MGMT_DECODE_INVALID;
+
+    // Decoded into a copy, so a bad message leaves the base intact
+    Heartbeat hb = current;
+    char s[5][MGMT_STRING_MAX];
+    char* const storage[5] = { artist, title, error, firmware, configHash };
+    const char** targets[5] = { &hb.lastTrackArtist, &hb.lastTrackTitle, &hb.lastError,
+                                &hb.firmwareVersion, &hb.configHash };
+    bool changed[5] = { false, false, false, false, false };
+
+    bool isHeartbeat = false, haveSeq = false, isDelta = false;
+    uint32_t msgSeq = 0, msgBase = 0;
+    uint32_t counters[5] = { 0, 0, 0, 0, 0 };
+    bool haveCounter[5] = { false, false, false, false, false };
+
+    for (size_t i = 0; i < fields; i++) {
+        uint32_t key, v;
+        int32_t iv;
+        if (!r.readUint(&key)) return MGMT_DECODE_INVALID;
+        switch (key) {
+            case KEY_TYPE:
+                if (!r.readUint(&v)) return MGMT_DECODE_INVALID;
+                isHeartbeat = v == TYPE_HEARTBEAT;
+                break;
+            case HB_SEQ:
+                if (!r.readUint(&msgSeq)) return MGMT_DECODE_INVALID;
+                haveSeq = true;
+                break;
+            case HB_BASE:
+                if (!r.readUint(&msgBase)) return MGMT_DECODE_INVALID;
+                isDelta = true;
+                break;
+            case HB_STATE:
+                if (!r.readUint(&v) || v > ERROR_STATE) return MGMT_DECODE_INVALID;
+                hb.state = (State)v;
+                break;
+            case HB_TRANSPORT:
+                if (!r.readUint(&v) || v > MGMT_TRANSPORT_WIFI) return MGMT_DECODE_INVALID;
+                hb.transport = (MgmtTransport)v;
+                break;
+            case HB_WIFI_RSSI:
+                hb.hasWifiRssi = !r.isNil();
+                if (hb.hasWifiRssi ? !r.readInt(&hb.wifiRssi) : !r.readNil()) {
+                    return MGMT_DECODE_INVALID;
+                }
+                break;
+            case HB_FREE_RAM:
+                if (!r.readUint(&hb.freeRam)) return MGMT_DECODE_INVALID;
+                break;
+            case HB_RADIO_SHOW_ID:
+                if (r.isNil()) {
+                    r.readNil();
+                    hb.radioShowID = -1;
+                } else if (r.readInt(&iv)) {
+                    hb.radioShowID = iv;
+                } else {
+                    return MGMT_DECODE_INVALID;
+                }
+                break;
+            case HB_LAST_TRACK: {
+                changed[0] = changed[1] = true;
+                if (r.isNil()) {
+                    r.readNil();
+                    s[0][0] = s[1][0] = '\0';
+                    hb.lastTrackArtist = hb.lastTrackTitle = nullptr;
+                    hb.lastTrackPostedAt = 0;
+                    break;
+                }
+                size_t n;
+                if (!r.readMapHeader(&n)) return MGMT_DECODE_INVALID;
+                hb.lastTrackArtist = hb.lastTrackTitle = "";
+                s[0][0] = s[1][0] = '\0';
+                for (size_t j = 0; j < n; j++) {
+                    uint32_t k;
+                    if (!r.readUint(&k)) return MGMT_DECODE_INVALID;
+                    bool ok = k == TRACK_ARTIST ? copyStr(r, s[0], MGMT_STRING_MAX)
+                            : k == TRACK_TITLE ? copyStr(r, s[1], MGMT_STRING_MAX)
+                            : k == TRACK_POSTED_AT ? r.readUint(&hb.lastTrackPostedAt)
+                            : r.skip();
+                    if (!ok) return MGMT_DECODE_INVALID;
+                }
+                break;
+            }
+            case HB_LAST_ERROR:
+                changed[2] = true;
+                if (r.isNil()) {
+                    r.readNil();
+                    hb.lastError = nullptr;
+                } else if (copyStr(r, s[2], MGMT_STRING_MAX)) {
+                    hb.lastError = "";
+                } else {
+                    return MGMT_DECODE_INVALID;
+                }
+                break;
+            case HB_FIRMWARE:
+                changed[3] = true;
+                if (!copyStr(r, s[3], MGMT_STRING_MAX)) return MGMT_DECODE_INVALID;
+                hb.firmwareVersion = "";
+                break;
+            case HB_CONFIG_HASH:
+                changed[4] = true;
+                if (!copyStr(r, s[4], MGMT_STRING_MAX)) return MGMT_DECODE_INVALID;
+                hb.configHash = "";
+                break;
+            case HB_LOOP_MAX:
+                if (!r.readUint(&hb.loopMaxMs)) return MGMT_DECODE_INVALID;
+                break;
+            case HB_UPTIME:
+            case HB_RECONNECTS:
+            case HB_DETECTED:
+            case HB_POSTED:
+            case HB_ERRORS: {
+                int c = key == HB_UPTIME ? 0 : (int)(key - HB_RECONNECTS) + 1;
+                if (!r.readUint(&counters[c])) return MGMT_DECODE_INVALID;
+                haveCounter[c] = true;
+                break;
+            }
+            default:
+                if (!r.skip()) return MGMT_DECODE_INVALID;
+                break;
+        }
+    }
+    if (!isHeartbeat || !haveSeq || !r.atEnd()) return MGMT_DECODE_INVALID;
+    if (isDelta && (!haveBase || msgBase != seq)) return MGMT_DECODE_NEED_KEYFRAME;
+
+    uint32_t* totals[5] = { &hb.uptimeS, &hb.reconnectCount, &hb.tracksDetected,
+                            &hb.tracksPosted, &hb.errorsSinceBoot };
+    for (int c = 0; c < 5; c++) {
+        if (isDelta) {
+            *totals[c] += counters[c];
+        } else if (haveCounter[c]) {
+            *totals[c] = counters[c];
+        } else {
+            return MGMT_DECODE_INVALID; // keyframes are complete
+        }
+    }
+
+    for (int i = 0; i < 5; i++) {
+        if (changed[i] && *targets[i]) {
+            memcpy(storage[i], s[i], MGMT_STRING_MAX);
+            *targets[i] = storage[i];
+        }
+    }
+    current = hb;
+    seq = msgSeq;
+    haveBase = true;
+    *out = current;
+    return MGMT_DECODE_OK;
+}
+
+// ========== Commands and acks ==========
+
+static MgmtAction actionNamed(const char* name) {
+    for (int i = 0; i < MGMT_ACTION_UNKNOWN; i++) {
+        if (name && strcmp(name, ACTION_NAMES[i]) == 0) return (MgmtAction)i;
+    }
+    return MGMT_ACTION_UNKNOWN;
+}
+
+MgmtDecodeResult decodeCommand(MgmtEncoding encoding, const uint8_t* data, size_t len,
+                               MgmtCommand* out) {
+    out->id[0] = out->key[0] = out->value[0] = '\0';
+    out->action = MGMT_ACTION_UNKNOWN;
+
+    if (encoding == MGMT_JSON) {
+        JsonDocument doc;
+        if (deserializeJson(doc, (const char*)data, len)) return MGMT_DECODE_INVALID;
+        const char* type = doc["type"] | "";
+        if (strcmp(type, "command") != 0 || !doc["id"].is<const char*>()) {
+            return MGMT_DECODE_INVALID;
+        }
+        if (!copyJsonStr(doc["id"], out->id, sizeof(out->id)) ||
+            !copyJsonStr(doc["key"], out->key, sizeof(out->key)) ||
+            !copyJsonStr(doc["value"], out->value, sizeof(out->value))) {
+            return MGMT_DECODE_INVALID;
+        }
+        out->action = actionNamed(doc["action"] | "");
+        return MGMT_DECODE_OK;
+    }
+
+    MsgPackReader r(data, len);
+    size_t fields;
+    if (!r.readMapHeader(&fields)) return MGMT_DECODE_INVALID;
+    bool isCommand = false, haveId = false;
+    for (size_t i = 0; i < fields; i++) {
+        uint32_t key, v = 0;
+        if (!r.readUint(&key)) return MGMT_DECODE_INVALID;
+        bool ok;
+        switch (key) {
+            case KEY_TYPE:
+                ok = r.readUint(&v);
+                isCommand = v == TYPE_COMMAND;
+                break;
+            case CMD_ID:
+                ok = haveId = copyStr(r, out->id, sizeof(out->id));
+                break;
+            case CMD_ACTION:
+                ok = r.readUint(&v);
+                out->action = v < MGMT_ACTION_UNKNOWN ? (MgmtAction)v : MGMT_ACTION_UNKNOWN;
+                break;
+            case CMD_KEY:
+                ok = copyStr(r, out->key, sizeof(out->key));
+                break;
+            case CMD_VALUE:
+                ok = copyStr(r, out->value, sizeof(out->value));
+                break;
+            default:
+                ok = r.skip();
+                break;
+        }
+        if (!ok) return MGMT_DECODE_INVALID;
+    }
+    if (!isCommand || !haveId || !r.atEnd()) return MGMT_DECODE_INVALID;
+    return MGMT_DECODE_OK;
+}
+
+size_t encodeCommand(MgmtEncoding encoding, const MgmtCommand& command,
+                     uint8_t* buf, size_t capacity) {
+    bool hasConfig = command.action == MGMT_ACTION_SET_CONFIG;
+    if (encoding == MGMT_JSON) {
+        JsonDocument doc;
+        doc["type"] = "command";
+        doc["id"] = command.id;
+        doc["action"] = command.action < MGMT_ACTION_UNKNOWN ? ACTION_NAMES[command.action] : "";
+        if (hasConfig) {
+            doc["key"] = command.key;
+            doc["value"] = command.value;
+        }
+        return finishJson(doc, buf, capacity);
+    }
+
+    MsgPackWriter w(buf, capacity);
+    w.writeMapHeader(hasConfig ? 5 : 3);
+    w.writeUint(KEY_TYPE); w.writeUint(TYPE_COMMAND);
+    w.writeUint(CMD_ID); w.writeStr(command.id);
+    w.writeUint(CMD_ACTION); w.writeUint((uint32_t)command.action);
+    if (hasConfig) {
+        w.writeUint(CMD_KEY); w.writeStr(command.key);
+        w.writeUint(CMD_VALUE); w.writeStr(command.value);
+    }
+    return w.overflowed() ? 0 : w.length();
+}
+
+size_t encodeAck(MgmtEncoding encoding, const char* id, MgmtAckStatus status,
+                 const char* error, uint8_t* buf, size_t capacity) {
+    if (encoding == MGMT_JSON) {
+        JsonDocument doc;
+        doc["type"] = "ack";
+        doc["id"] = id;
+        doc["status"] = ACK_STATUS_NAMES[status];
+        if (error) doc["error"] = error;
+        return finishJson(doc, buf, capacity);
+    }
+
+    MsgPackWriter w(buf, capacity);
+    w.writeMapHeader(error ? 4 : 3);
+    w.writeUint(KEY_TYPE); w.writeUint(TYPE_ACK);
+    w.writeUint(ACK_ID); w.writeStr(id);
+    w.writeUint(ACK_STATUS); w.writeUint((uint32_t)status);
+    if (error) {
+        w.writeUint(ACK_ERROR); w.writeStr(error);
+    }
+    return w.overflowed() ? 0 : w.length();
+}
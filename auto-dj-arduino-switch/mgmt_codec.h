@@ -0,0 +1,212 @@
+#ifndef MGMT_CODEC_H
+#define MGMT_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "state_machine.h"
+
+/**
+ * Encoding of the management channel messages (networking-spec §3.6.2):
+ * heartbeats and acks out, commands in.
+ *
+ * JSON is the spec's format. MessagePack is a negotiated alternative: the
+ * device offers both WebSocket subprotocols, preferring MessagePack, and
+ * uses whichever the server selects (JSON if it selects none). In
+ * MessagePack, field names and enum strings are replaced by the small
+ * integers below, and heartbeats after the first on a connection carry only
+ * what changed (see HeartbeatEncoder). Both encoders write into a caller's
+ * buffer; the MessagePack path never allocates.
+ *
+ * MessagePack keys (every message is a map; key 0 is the type):
+ *
+ *   type       0 heartbeat, 1 command, 2 ack
+ *   heartbeat  1 state (State value), 2 transport (0 ethernet, 1 wifi),
+ *              3 uptime_s, 4 wifi_rssi, 5 free_ram, 6 radio_show_id,
+ *              7 last_track {0 artist, 1 title, 2 posted_at}, 8 last_error,
+ *              9 firmware_version, 10 config_hash, 11 loop_max_ms,
+ *              12 reconnect_count, 13 tracks_detected, 14 tracks_posted,
+ *              15 errors_since_boot, 16 seq, 17 base
+ *   command    1 id, 2 action (0 set_config, 1 pause, 2 resume, 3 end_show,
+ *              4 restart, 5 ping), 3 key, 4 value
+ *   ack        1 id, 2 status (0 ok, 1 error, 2 unknown_command), 3 error
+ *
+ * Nullable fields are nil when null. Unknown keys are skipped. Heartbeat
+ * strings are clipped to MGMT_STRING_MAX - 1 bytes (at a UTF-8 character
+ * boundary), so that the delta encoder and decoders can keep fixed copies.
+ */
+
+#define MGMT_SUBPROTOCOL_MSGPACK "wxyc-auto-dj.msgpack"
+#define MGMT_SUBPROTOCOL_JSON "wxyc-auto-dj.json"
+#define MGMT_SUBPROTOCOLS_OFFERED MGMT_SUBPROTOCOL_MSGPACK ", " MGMT_SUBPROTOCOL_JSON
+
+#define MGMT_ID_MAX 40       // Command id, including the terminator
+#define MGMT_STRING_MAX 128  // Other strings, including the terminator
+
+enum MgmtEncoding {
+    MGMT_JSON,
+    MGMT_MSGPACK
+};
+
+/**
+ * Encoding for the subprotocol the server selected in its
+ * Sec-WebSocket-Protocol response header (nullptr if none).
+ */
+MgmtEncoding mgmtEncodingFor(const char* subprotocol);
+
+enum MgmtTransport {
+    MGMT_TRANSPORT_ETHERNET,
+    MGMT_TRANSPORT_WIFI
+};
+
+/**
+ * One heartbeat. Strings are borrowed; nullptr means null.
+ */
+struct Heartbeat {
+    State state;
+    MgmtTransport transport;
+    uint32_t uptimeS;
+    bool hasWifiRssi;
+    int32_t wifiRssi;
+    uint32_t freeRam;
+    int32_t radioShowID;          // -1 = null
+    const char* lastTrackArtist;  // nullptr = no last_track
+    const char* lastTrackTitle;
+    uint32_t lastTrackPostedAt;
+    const char* lastError;
+    const char* firmwareVersion;
+    const char* configHash;
+    uint32_t loopMaxMs;
+    uint32_t reconnectCount;
+    uint32_t tracksDetected;
+    uint32_t tracksPosted;
+    uint32_t errorsSinceBoot;
+};
+
+/**
+ * Encodes heartbeats for one connection.
+ *
+ * With MessagePack, the first heartbeat after reset() (a keyframe) carries
+ * every field, as does every keyframeInterval-th one after it. The ones in
+ * between are deltas against the previous heartbeat: counters (uptime_s and
+ * the *_count / tracks_* / errors_since_boot totals) are sent as increments
+ * and left out when zero, other fields are left out when unchanged, and
+ * loop_max_ms is always sent. Each heartbeat carries a sequence number, and
+ * a delta the number of the heartbeat it applies to; the channel is ordered,
+ * so a receiver only misses one across a reconnect, which starts over with
+ * a keyframe. A counter that went backwards also forces a keyframe.
+ *
+ * JSON heartbeats are always complete, as in the spec.
+ */
+class HeartbeatEncoder {
+public:
+    explicit HeartbeatEncoder(int keyframeInterval);
+
+    /** Starts a connection using `encoding`; the next heartbeat is a keyframe. */
+    void reset(MgmtEncoding encoding);
+
+    /** Makes the next heartbeat a keyframe (e.g. after a ping command). */
+    void forceKeyframe() { sinceKeyframe = -1; }
+
+    /**
+     * Writes the heartbeat into buf. Returns its length, or 0 if it did not
+     * fit (the delta base is left unchanged then).
+     */
+    size_t encode(const Heartbeat& hb, uint8_t* buf, size_t capacity);
+
+    MgmtEncoding encoding() const { return enc; }
+
+private:
+    MgmtEncoding enc;
+    int keyframeInterval;
+    int sinceKeyframe;  // -1 = next one is a keyframe
+    uint32_t seq;
+
+    // The previous heartbeat, with its strings copied as sent
+    Heartbeat base;
+    char baseArtist[MGMT_STRING_MAX];
+    char baseTitle[MGMT_STRING_MAX];
+    char baseError[MGMT_STRING_MAX];
+    char baseFirmware[MGMT_STRING_MAX];
+    char baseConfigHash[MGMT_STRING_MAX];
+
+    size_t encodeMsgPack(const Heartbeat& hb, bool keyframe, uint8_t* buf, size_t capacity);
+    void remember(const Heartbeat& hb);
+};
+
+enum MgmtDecodeResult {
+    MGMT_DECODE_OK,
+    MGMT_DECODE_INVALID,      // malformed, wrong type, or a string too long
+    MGMT_DECODE_NEED_KEYFRAME // a delta against a heartbeat this decoder has not seen
+};
+
+/**
+ * Server-side counterpart of HeartbeatEncoder for MessagePack heartbeats,
+ * applying deltas to the previous heartbeat. Used by the tests and as the
+ * reference for the management server. Strings in the decoded Heartbeat
+ * point into the decoder and stay valid until the next decode().
+ */
+class HeartbeatDecoder {
+public:
+    HeartbeatDecoder();
+
+    void reset() { haveBase = false; }
+    MgmtDecodeResult decode(const uint8_t* data, size_t len, Heartbeat* out);
+
+private:
+    bool haveBase;
+    uint32_t seq;
+    Heartbeat current;
+    char artist[MGMT_STRING_MAX];
+    char title[MGMT_STRING_MAX];
+    char error[MGMT_STRING_MAX];
+    char firmware[MGMT_STRING_MAX];
+    char configHash[MGMT_STRING_MAX];
+};
+
+// ========== Commands and acks ==========
+
+enum MgmtAction {
+    MGMT_ACTION_SET_CONFIG,
+    MGMT_ACTION_PAUSE,
+    MGMT_ACTION_RESUME,
+    MGMT_ACTION_END_SHOW,
+    MGMT_ACTION_RESTART,
+    MGMT_ACTION_PING,
+    MGMT_ACTION_UNKNOWN // acked with unknown_command
+};
+
+struct MgmtCommand {
+    char id[MGMT_ID_MAX];
+    MgmtAction action;
+    char key[MGMT_STRING_MAX];   // set_config only, else ""
+    char value[MGMT_STRING_MAX];
+};
+
+enum MgmtAckStatus {
+    MGMT_ACK_OK,
+    MGMT_ACK_ERROR,
+    MGMT_ACK_UNKNOWN_COMMAND
+};
+
+/**
+ * Decodes a command message. Fails if it is not a command, has no id, or a
+ * string does not fit in MgmtCommand.
+ */
+MgmtDecodeResult decodeCommand(MgmtEncoding encoding, const uint8_t* data, size_t len,
+                               MgmtCommand* out);
+
+/**
+ * Encodes a command (the server's side; for tests and stand-ins). Returns
+ * its length, or 0 if it did not fit.
+ */
+size_t encodeCommand(MgmtEncoding encoding, const MgmtCommand& command,
+                     uint8_t* buf, size_t capacity);
+
+/**
+ * Encodes an ack; `error` may be nullptr. Returns its length, or 0 if it did
+ * not fit.
+ */
+size_t encodeAck(MgmtEncoding encoding, const char* id, MgmtAckStatus status,
+                 const char* error, uint8_t* buf, size_t capacity);
+
+#endif
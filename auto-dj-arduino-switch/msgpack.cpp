@@ -0,0 +1,337 @@
+#include "msgpack.h"
+
+#include <string.h>
+
+// ========== Writer ==========
+
+MsgPackWriter::MsgPackWriter(uint8_t* buf, size_t capacity)
+    : buf(buf)
+    , cap(capacity)
+    , len(0)
+    , overflow(false)
+{
+}
+
+bool MsgPackWriter::reserve(size_t n) {
+    if (overflow || cap - len < n) {
+        overflow = true;
+        return false;
+    }
+    return true;
+}
+
+void MsgPackWriter::put(uint8_t b) {
+    buf[len++] = b;
+}
+
+void MsgPackWriter::putBE(uint32_t v, int bytes) {
+    for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) put((uint8_t)(v >> shift));
+}
+
+void MsgPackWriter::writeNil() {
+    if (reserve(1)) put(0xc0);
+}
+
+void MsgPackWriter::writeBool(bool value) {
+    if (reserve(1)) put(value ? 0xc3 : 0xc2);
+}
+
+void MsgPackWriter::writeUint(uint32_t value) {
+    if (value < 0x80) {
+        if (reserve(1)) put((uint8_t)value);
+    } else if (value <= 0xff) {
+        if (reserve(2)) { put(0xcc); putBE(value, 1); }
+    } else if (value <= 0xffff) {
+        if (reserve(3)) { put(0xcd); putBE(value, 2); }
+    } else {
+        if (reserve(5)) { put(0xce); putBE(value, 4); }
+    }
+}
+
+void MsgPackWriter::writeInt(int32_t value) {
+    if (value >= 0) {
+        writeUint((uint32_t)value);
+    } else if (value >= -32) {
+        if (reserve(1)) put((uint8_t)value); // negative fixint
+    } else if (value >= -128) {
+        if (reserve(2)) { put(0xd0); putBE((uint32_t)value, 1); }
+    } else if (value >= -32768) {
+        if (reserve(3)) { put(0xd1); putBE((uint32_t)value, 2); }
+    } else {
+        if (reserve(5)) { put(0xd2); putBE((uint32_t)value, 4); }
+    }
+}
+
+void MsgPackWriter::writeStr(const char* s) {
+    writeStr(s, strlen(s));
+}
+
+void MsgPackWriter::writeStr(const char* s, size_t n) {
+    size_t header = n < 32 ? 1 : n <= 0xff ? 2 : n <= 0xffff ? 3 : 5;
+    if (!reserve(header + n)) return;
+    if (n < 32) {
+        put((uint8_t)(0xa0 | n));
+    } else if (n <= 0xff) {
+        put(0xd9); putBE((uint32_t)n, 1);
+    } else if (n <= 0xffff) {
+        put(0xda); putBE((uint32_t)n, 2);
+    } else {
+        put(0xdb); putBE((uint32_t)n, 4);
+    }
+    memcpy(buf + len, s, n);
+    len += n;
+}
+
+void MsgPackWriter::writeMapHeader(size_t count) {
+    if (count < 16) {
+        if (reserve(1)) put((uint8_t)(0x80 | count));
+    } else if (count <= 0xffff) {
+        if (reserve(3)) { put(0xde); putBE((uint32_t)count, 2); }
+    } else {
+        if (reserve(5)) { put(0xdf); putBE((uint32_t)count, 4); }
+    }
+}
+
+void MsgPackWriter::writeArrayHeader(size_t count) {
+    if (count < 16) {
+        if (reserve(1)) put((uint8_t)(0x90 | count));
+    } else if (count <= 0xffff) {
+        if (reserve(3)) { put(0xdc); putBE((uint32_t)count, 2); }
+    } else {
+        if (reserve(5)) { put(0xdd); putBE((uint32_t)count, 4); }
+    }
+}
+
+size_t MsgPackWriter::beginMap() {
+    size_t position = len;
+    if (reserve(1)) put(0x80);
+    return position;
+}
+
+void MsgPackWriter::endMap(size_t position, size_t count) {
+    if (overflow) return;
+    if (count < 16) {
+        buf[position] = (uint8_t)(0x80 | count);
+        return;
+    }
+    if (!reserve(2)) return;
+    memmove(buf + position + 3, buf + position + 1, len - position - 1);
+    len += 2;
+    buf[position] = 0xde;
+    buf[position + 1] = (uint8_t)(count >> 8);
+    buf[position + 2] = (uint8_t)count;
+}
+
+// ========== Reader ==========
+
+MsgPackReader::MsgPackReader(const uint8_t* data, size_t len)
+    : data(data)
+    , len(len)
+    , pos(0)
+    , error(false)
+{
+}
+
+bool MsgPackReader::fail() {
+    error = true;
+    return false;
+}
+
+bool MsgPackReader::take(size_t n, const uint8_t** p) {
+    if (error || len - pos < n) return fail();
+    *p = data + pos;
+    pos += n;
+    return true;
+}
+
+bool MsgPackReader::readBE(int bytes, uint32_t* v) {
+    const uint8_t* p;
+    if (!take((size_t)bytes, &p)) return false;
+    *v = 0;
+    for (int i = 0; i < bytes; i++) *v = (*v << 8) | p[i];
+    return true;
+}
+
+bool MsgPackReader::isNil() {
+    return !error && pos < len && data[pos] == 0xc0;
+}
+
+bool MsgPackReader::readNil() {
+    const uint8_t* p;
+    if (!isNil()) return fail();
+    return take(1, &p);
+}
+
+bool MsgPackReader::readBool(bool* value) {
+    const uint8_t* p;
+    if (!take(1, &p)) return false;
+    if (*p != 0xc2 && *p != 0xc3) return fail();
+    *value = *p == 0xc3;
+    return true;
+}
+
+/**
+ * Any integer format (up to 32 bits of magnitude; 64-bit forms are
+ * accepted if the value fits).
+ */
+bool MsgPackReader::readInteger(int64_t* value) {
+    const uint8_t* p;
+    if (!take(1, &p)) return false;
+    uint8_t tag = *p;
+    uint32_t v;
+    if (tag < 0x80) {
+        *value = tag;
+        return true;
+    }
+    if (tag >= 0xe0) {
+        *value = (int8_t)tag;
+        return true;
+    }
+    switch (tag) {
+        case 0xcc: if (!readBE(1, &v)) return false; *value = v; return true;
+        case 0xcd: if (!readBE(2, &v)) return false; *value = v; return true;
+        case 0xce: if (!readBE(4, &v)) return false; *value = v; return true;
+        case 0xd0: if (!readBE(1, &v)) return false; *value = (int8_t)v; return true;
+        case 0xd1: if (!readBE(2, &v)) return false; *value = (int16_t)v; return true;
+        case 0xd2: if (!readBE(4, &v)) return false; *value = (int32_t)v; return true;
+        case 0xcf:
+        case 0xd3: {
+            uint32_t hi, lo;
+            if (!readBE(4, &hi) || !readBE(4, &lo)) return false;
+            uint64_t u = ((uint64_t)hi << 32) | lo;
+            if (tag == 0xcf && u > 0xffffffffULL) return fail();
+            int64_t s = (int64_t)u;
+            if (tag == 0xd3 && (s < INT32_MIN || s > (int64_t)0xffffffffLL)) return fail();
+            *value = tag == 0xcf ? (int64_t)u : s;
+            return true;
+        }
+        default:
+            return fail();
+    }
+}
+
+bool MsgPackReader::readUint(uint32_t* value) {
+    int64_t v;
+    if (!readInteger(&v)) return false;
+    if (v < 0 || v > 0xffffffffLL) return fail();
+    *value = (uint32_t)v;
+    return true;
+}
+
+bool MsgPackReader::readInt(int32_t* value) {
+    int64_t v;
+    if (!readInteger(&v)) return false;
+    if (v < INT32_MIN || v > INT32_MAX) return fail();
+    *value = (int32_t)v;
+    return true;
+}
+
+bool MsgPackReader::readStr(const char** s, size_t* n) {
+    const uint8_t* p;
+    if (!take(1, &p)) return false;
+    uint32_t size;
+    if ((*p & 0xe0) == 0xa0) {
+        size = *p & 0x1f;
+    } else if (*p == 0xd9) {
+        if (!readBE(1, &size)) return false;
+    } else if (*p == 0xda) {
+        if (!readBE(2, &size)) return false;
+    } else if (*p == 0xdb) {
+        if (!readBE(4, &size)) return false;
+    } else {
+        return fail();
+    }
+    if (!take(size, &p)) return false;
+    *s = (const char*)p;
+    *n = size;
+    return true;
+}
+
+bool MsgPackReader::readMapHeader(size_t* count) {
+    const uint8_t* p;
+    if (!take(1, &p)) return false;
+    uint32_t v;
+    if ((*p & 0xf0) == 0x80) {
+        v = *p & 0x0f;
+    } else if (*p == 0xde) {
+        if (!readBE(2, &v)) return false;
+    } else if (*p == 0xdf) {
+        if (!readBE(4, &v)) return false;
+    } else {
+        return fail();
+    }
+    *count = v;
+    return true;
+}
+
+bool MsgPackReader::readArrayHeader(size_t* count) {
+    const uint8_t* p;
+    if (!take(1, &p)) return false;
+    uint32_t v;
+    if ((*p & 0xf0) == 0x90) {
+        v = *p & 0x0f;
+    } else if (*p == 0xdc) {
+        if (!readBE(2, &v)) return false;
+    } else if (*p == 0xdd) {
+        if (!readBE(4, &v)) return false;
+    } else {
+        return fail();
+    }
+    *count = v;
+    return true;
+}
+
+bool MsgPackReader::skip() {
+    return skipValue(0);
+}
+
+bool MsgPackReader::skipValue(int depth) {
+    if (error || pos >= len) return fail();
+    uint8_t tag = data[pos];
+    const uint8_t* p;
+    uint32_t n;
+
+    // Containers: skip their elements
+    size_t elements = 0;
+    bool container = true;
+    if ((tag & 0xf0) == 0x80 || tag == 0xde || tag == 0xdf) {
+        if (!readMapHeader(&elements)) return false;
+        elements *= 2;
+    } else if ((tag & 0xf0) == 0x90 || tag == 0xdc || tag == 0xdd) {
+        if (!readArrayHeader(&elements)) return false;
+    } else {
+        container = false;
+    }
+    if (container) {
+        if (depth >= MSGPACK_MAX_DEPTH) return fail();
+        while (elements--) {
+            if (!skipValue(depth + 1)) return false;
+        }
+        return true;
+    }
+
+    if (tag < 0x80 || tag >= 0xe0 || tag == 0xc0 || tag == 0xc2 || tag == 0xc3) {
+        return take(1, &p);
+    }
+    if ((tag & 0xe0) == 0xa0) return take(1 + (tag & 0x1f), &p);
+
+    take(1, &p);
+    switch (tag) {
+        case 0xcc: case 0xd0: return take(1, &p);
+        case 0xcd: case 0xd1: return take(2, &p);
+        case 0xce: case 0xd2: case 0xca: return take(4, &p);
+        case 0xcf: case 0xd3: case 0xcb: return take(8, &p);
+        case 0xd9: case 0xc4: return readBE(1, &n) && take(n, &p);
+        case 0xda: case 0xc5: return readBE(2, &n) && take(n, &p);
+        case 0xdb: case 0xc6: return readBE(4, &n) && take(n, &p);
+        case 0xd4: return take(2, &p); // fixext: type byte + data
+        case 0xd5: return take(3, &p);
+        case 0xd6: return take(5, &p);
+        case 0xd7: return take(9, &p);
+        case 0xd8: return take(17, &p);
+        case 0xc7: return readBE(1, &n) && take(1 + (size_t)n, &p);
+        case 0xc8: return readBE(2, &n) && take(1 + (size_t)n, &p);
+        case 0xc9: return readBE(4, &n) && take(1 + (size_t)n, &p);
+        default:   return fail(); // 0xc1, never used
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef MSGPACK_H
+#define MSGPACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MSGPACK_MAX_DEPTH 4 // Nesting skip() will descend into
+
+/**
+ * MessagePack writer into a caller-supplied buffer. Never allocates; each
+ * value uses the smallest encoding for it. A write that does not fit marks
+ * the writer as overflowed and later writes are ignored, so a message can be
+ * written in full and checked once at the end.
+ *
+ * Maps are written with beginMap()/endMap(): the entry count is filled in
+ * when the map is closed, so fields can be left out as they are written.
+ *
+ *     MsgPackWriter w(buf, sizeof(buf));
+ *     size_t map = w.beginMap();
+ *     w.writeUint(1); w.writeStr("abc");
+ *     w.endMap(map, 1);
+ *     if (w.overflowed()) ...
+ */
+class MsgPackWriter {
+public:
+    MsgPackWriter(uint8_t* buf, size_t capacity);
+
+    void writeNil();
+    void writeBool(bool value);
+    void writeUint(uint32_t value);
+    void writeInt(int32_t value);
+    void writeStr(const char* s);
+    void writeStr(const char* s, size_t len);
+    void writeMapHeader(size_t count);
+    void writeArrayHeader(size_t count);
+
+    /** Reserves a one-byte map header; returns its position for endMap(). */
+    size_t beginMap();
+
+    /**
+     * Fills in the header reserved by beginMap(). Maps of more than 15
+     * entries need a three-byte header, so the entries are moved up.
+     */
+    void endMap(size_t position, size_t count);
+
+    size_t length() const { return len; }
+    bool overflowed() const { return overflow; }
+
+private:
+    uint8_t* buf;
+    size_t cap;
+    size_t len;
+    bool overflow;
+
+    bool reserve(size_t n);
+    void put(uint8_t b);
+    void putBE(uint32_t v, int bytes);
+};
+
+/**
+ * MessagePack reader over a buffer. Strings are returned as pointers into
+ * the buffer (not NUL-terminated). A read of the wrong type, or past the
+ * end, returns false and marks the reader as failed; later reads fail too.
+ */
+class MsgPackReader {
+public:
+    MsgPackReader(const uint8_t* data, size_t len);
+
+    bool isNil();                // peek, does not consume
+    bool readNil();
+    bool readBool(bool* value);
+    bool readUint(uint32_t* value);
+    bool readInt(int32_t* value);
+    bool readStr(const char** s, size_t* len);
+    bool readMapHeader(size_t* count);
+    bool readArrayHeader(size_t* count);
+
+    /** Skips one value of any type, including nested maps and arrays. */
+    bool skip();
+
+    bool atEnd() const { return pos == len; }
+    bool failed() const { return error; }
+
+private:
+    const uint8_t* data;
+    size_t len;
+    size_t pos;
+    bool error;
+
+    bool fail();
+    bool take(size_t n, const uint8_t** p);
+    bool readBE(int bytes, uint32_t* v);
+    bool readInteger(int64_t* value);
+    bool skipValue(int depth);
+};
+
+#endif
@@ -0,0 +1,274 @@
+#include "network_manager.h"
+#include "log_buffer.h"
+#include "mem_stats.h"
+#include "stall_detector.h"
+
+#include <new>
+
+#if ENABLE_ETHERNET
+#include "trust_anchors.h" // generated; see README "Ethernet"
+#endif
+
+// ========== WiFi Transport ==========
+
+WifiTransport::WifiTransport(WifiManager& wifi)
+    : wifi(wifi)
+    , client(nullptr)
+{
+}
+
+const char* WifiTransport::name() const { return "WiFi"; }
+
+void WifiTransport::setUp() { wifi.setUp(); }
+
+void WifiTransport::update() { wifi.update(); }
+
+bool WifiTransport::isUp() { return wifi.isConnected(); }
+
+Client* WifiTransport::openClient() {
+    // Constructed per request (never a long-lived global) to avoid the Giga R1
+    // global WiFiClient crash bug; storage is reused to stay off the heap.
+    client = new (storage) WiFiSSLClient();
+    return client;
+}
+
+void WifiTransport::closeClient() {
+    if (!client) return;
+    client->stop(); // prevent socket leak
+    client->~WiFiSSLClient();
+    client = nullptr;
+}
+
+unsigned long WifiTransport::getEpochTime() { return wifi.getEpochTime(); }
+
+int WifiTransport::signalDbm() { return wifi.isConnected() ? (int)WiFi.RSSI() : 0; }
+
+// ========== Ethernet Transport ==========
+
+#if ENABLE_ETHERNET
+
+EthernetTransport::EthernetTransport(int csPin, const uint8_t* mac, int entropyPin)
+    : csPin(csPin)
+    , mac(mac)
+    , entropyPin(entropyPin)
+    , began(false)
+    , ntp(udp, NTP_SERVER)
+    , client(nullptr)
+{
+}
+
+const char* EthernetTransport::name() const { return "Ethernet"; }
+
+void EthernetTransport::setUp() {
+    StallScope stallScope(STALL_RECONNECT);
+    Ethernet.init(csPin);
+    serialLog.print("[Ethernet] DHCP...");
+    // Bounded DHCP wait so a dead jack does not hold up WiFi fallback
+    if (Ethernet.begin(const_cast<uint8_t*>(mac), ETHERNET_DHCP_TIMEOUT_MS) == 0) {
+        serialLog.println(Ethernet.hardwareStatus() == EthernetNoHardware
+            ? " no shield detected." : " failed.");
+        return;
+    }
+    began = true;
+    serialLog.print(" IP: ");
+    serialLog.println(Ethernet.localIP().toString());
+    ntp.begin();
+}
+
+void EthernetTransport::update() {
+    if (!began) return;
+    Ethernet.maintain(); // DHCP lease renewal
+    if (isUp()) ntp.update(); // rate-limited internally
+}
+
+bool EthernetTransport::isUp() {
+    return began && Ethernet.linkStatus() == LinkON;
+}
+
+Client* EthernetTransport::openClient() {
+    client = new (storage) SSLClient(tcp, TAs, (size_t)TAs_NUM, entropyPin);
+    return client;
+}
+
+void EthernetTransport::closeClient() {
+    if (!client) return;
+    client->stop();
+    client->~SSLClient();
+    client = nullptr;
+}
+
+unsigned long EthernetTransport::getEpochTime() {
+    return ntp.isTimeSet() ? ntp.getEpochTime() : 0;
+}
+
+#endif
+
+// ========== Network Manager ==========
+
+NetworkManager::NetworkManager(int failureThreshold, unsigned long cooldownMs,
+                               unsigned long preferenceMs)
+    : count(0)
+    , selector(failureThreshold, cooldownMs, preferenceMs)
+    , current(-1)
+    , lastUsed(-1)
+    , attempts(0)
+    , openedAt(0)
+    , client(nullptr)
+    , kept(-1)
+    , keptAt(0)
+    , lastSignalSample(0)
+{
+}
+
+void NetworkManager::addTransport(Transport& transport) {
+    int link = selector.addLink();
+    if (link < 0) return;
+    transports[link] = &transport;
+    count = link + 1;
+}
+
+void NetworkManager::setUp() {
+    MemScope memScope(MEM_NETWORK);
+    for (int i = 0; i < count; i++) {
+        transports[i]->setUp();
+        selector.setLinkUp(i, transports[i]->isUp());
+    }
+}
+
+void NetworkManager::update() {
+    MemScope memScope(MEM_NETWORK);
+    for (int i = 0; i < count; i++) {
+        transports[i]->update();
+        bool up = transports[i]->isUp();
+        if (up != selector.isUp(i)) {
+            serialLog.print("[Net] ");
+            serialLog.print(transports[i]->name());
+            serialLog.println(up ? " up." : " down.");
+        }
+        selector.setLinkUp(i, up);
+    }
+    sampleSignals();
+}
+
+void NetworkManager::sampleSignals() {
+    unsigned long now = millis();
+    if (lastSignalSample != 0 && now - lastSignalSample < LINK_SIGNAL_SAMPLE_MS) return;
+    lastSignalSample = now;
+    for (int i = 0; i < count; i++) {
+        if (selector.isUp(i)) selector.recordSignal(i, transports[i]->signalDbm());
+    }
+}
+
+bool NetworkManager::isConnected() {
+    for (int i = 0; i < count; i++) {
+        if (transports[i]->isUp()) return true;
+    }
+    return false;
+}
+
+Client* NetworkManager::open() {
+    dropKept();
+    int link = selector.select(millis());
+    if (link < 0) return nullptr;
+    attempts = 1;
+    return openOn(link);
+}
+
+Client* NetworkManager::failover() {
+    int failed = current;
+    close(false);
+
+    // Each link gets at most one attempt per request
+    if (failed < 0 || attempts >= count) return nullptr;
+    int link = selector.selectExcluding(failed, millis());
+    if (link < 0) return nullptr;
+
+    serialLog.print("[Net] Failing over from ");
+    serialLog.print(transports[failed]->name());
+    serialLog.print(" to ");
+    serialLog.println(transports[link]->name());
+
+    attempts++;
+    return openOn(link);
+}
+
+Client* NetworkManager::openOn(int link) {
+    current = link;
+    lastUsed = link;
+    openedAt = millis();
+    client = transports[link]->openClient();
+    return client;
+}
+
+void NetworkManager::record(int link, bool ok) {
+    if (ok) {
+        selector.recordSuccess(link, millis() - openedAt);
+    } else {
+        selector.recordFailure(link, millis());
+    }
+}
+
+void NetworkManager::close(bool ok) {
+    if (current < 0) return;
+    transports[current]->closeClient();
+    record(current, ok);
+    current = -1;
+    client = nullptr;
+}
+
+void NetworkManager::keep(bool ok) {
+    if (current < 0) return;
+    record(current, ok);
+    kept = current;
+    keptAt = millis();
+    current = -1;
+}
+
+Client* NetworkManager::resume(unsigned long maxIdleMs) {
+    if (kept < 0) return nullptr;
+    unsigned long now = millis();
+    if (now - keptAt > maxIdleMs || !client->connected() || selector.select(now) != kept) {
+        dropKept();
+        return nullptr;
+    }
+    current = kept;
+    lastUsed = kept;
+    attempts = 1;
+    openedAt = now;
+    kept = -1;
+    return client;
+}
+
+void NetworkManager::dropKept() {
+    if (kept < 0) return;
+    transports[kept]->closeClient();
+    kept = -1;
+    client = nullptr;
+}
+
+const char* NetworkManager::activeTransportName() const {
+    return lastUsed >= 0 ? transports[lastUsed]->name() : "none";
+}
+
+const char* NetworkManager::linkName(int link) const {
+    return link >= 0 && link < count ? transports[link]->name() : "none";
+}
+
+unsigned long NetworkManager::responseTimeoutMs(unsigned long estimatedMs) const {
+    int link = current >= 0 ? current : lastUsed;
+    int dbm = selector.signalDbm(link);
+    if (dbm == 0 || dbm >= LINK_WEAK_SIGNAL_DBM) return estimatedMs;
+    unsigned long stretched = estimatedMs * 2;
+    return stretched < HTTP_TIMEOUT_MAX_MS ? stretched : HTTP_TIMEOUT_MAX_MS;
+}
+
+unsigned long NetworkManager::getEpochTime() {
+    for (int i = 0; i < count; i++) {
+        if (!transports[i]->isUp()) continue;
+        unsigned long epoch = transports[i]->getEpochTime();
+        if (epoch > 0) return epoch;
+    }
+    return 0;
+}
+
+const LinkSelector& NetworkManager::links() const { return selector; }
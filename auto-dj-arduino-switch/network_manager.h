@@ -0,0 +1,210 @@
+#ifndef NETWORK_MANAGER_H
+#define NETWORK_MANAGER_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include <WiFiSSLClient.h>
+#include "config.h"
+#include "link_selector.h"
+#include "wifi_manager.h"
+
+#define NETWORK_MAX_TRANSPORTS LINK_SELECTOR_MAX_LINKS
+
+/**
+ * One physical link that can produce TLS clients.
+ *
+ * openClient() constructs a fresh client for a single request and
+ * closeClient() destroys it, preserving the per-call lifecycle that works
+ * around the Giga R1 global WiFiClient crash bug. A transport hands out at
+ * most one client at a time.
+ */
+class Transport {
+public:
+    virtual ~Transport() {}
+    virtual const char* name() const = 0;
+    virtual void setUp() = 0;
+    virtual void update() = 0;
+    virtual bool isUp() = 0;
+    virtual Client* openClient() = 0;
+    virtual void closeClient() = 0;
+
+    /**
+     * Returns NTP epoch seconds obtained over this link, or 0 if unavailable.
+     */
+    virtual unsigned long getEpochTime() = 0;
+
+    /**
+     * Signal strength in dBm, or 0 if the link has none to report (wired).
+     */
+    virtual int signalDbm() { return 0; }
+};
+
+/**
+ * WiFi link: WifiManager handles association; clients are WiFiSSLClient.
+ */
+class WifiTransport : public Transport {
+public:
+    explicit WifiTransport(WifiManager& wifi);
+    const char* name() const;
+    void setUp();
+    void update();
+    bool isUp();
+    Client* openClient();
+    void closeClient();
+    unsigned long getEpochTime();
+    int signalDbm();
+
+private:
+    WifiManager& wifi;
+    WiFiSSLClient* client;
+    alignas(WiFiSSLClient) unsigned char storage[sizeof(WiFiSSLClient)];
+};
+
+#if ENABLE_ETHERNET
+#include <Ethernet.h>
+#include <EthernetUdp.h>
+#include <NTPClient.h>
+#include <SSLClient.h>
+
+/**
+ * Ethernet Shield 2 (W5500) link. The W5500 does TCP only, so TLS runs in
+ * software via SSLClient (BearSSL) over an EthernetClient.
+ */
+class EthernetTransport : public Transport {
+public:
+    EthernetTransport(int csPin, const uint8_t* mac, int entropyPin);
+    const char* name() const;
+    void setUp();
+    void update();
+    bool isUp();
+    Client* openClient();
+    void closeClient();
+    unsigned long getEpochTime();
+
+private:
+    int csPin;
+    const uint8_t* mac;
+    int entropyPin;
+    bool began;
+
+    EthernetClient tcp;
+    EthernetUDP udp;
+    NTPClient ntp;
+    SSLClient* client;
+    alignas(SSLClient) unsigned char storage[sizeof(SSLClient)];
+};
+#endif
+
+/**
+ * Routes each HTTP request over the best available transport.
+ *
+ * Transports are registered in preference order (Ethernet first, then
+ * WiFi; see docs/networking-spec.md section 2.2). A LinkSelector tracks
+ * per-link health and smoothed request RTT. Callers bracket every request
+ * with open()/close():
+ *
+ *   for (Client* c = net.open(); c; c = net.failover()) {
+ *       ...request over *c...
+ *       if (connection failed) continue;
+ *       net.close(true);
+ *       return result;
+ *   }
+ *
+ * failover() closes the current client as failed and reopens on the next
+ * best link, so a request that dies on one link is retried on the other
+ * within the same call instead of being dropped.
+ *
+ * update() also samples each link's signal strength every
+ * LINK_SIGNAL_SAMPLE_MS into the selector.
+ */
+class NetworkManager {
+public:
+    NetworkManager(int failureThreshold, unsigned long cooldownMs,
+                   unsigned long preferenceMs);
+
+    /**
+     * Registers a transport. Call in preference order, before setUp().
+     */
+    void addTransport(Transport& transport);
+
+    void setUp();
+    void update();
+
+    /**
+     * True if at least one transport is up.
+     */
+    bool isConnected();
+
+    /**
+     * Opens a client on the best link, or returns nullptr if none is up.
+     */
+    Client* open();
+
+    /**
+     * Closes the current client as failed and opens one on the next best
+     * link. Returns nullptr when no other link is available.
+     */
+    Client* failover();
+
+    /**
+     * Closes the current client and records the outcome. A request counts as
+     * successful if it reached the server, whatever the HTTP status.
+     */
+    void close(bool ok);
+
+    /**
+     * Records the outcome like close(ok), but leaves the client connected
+     * for resume(). Whatever calls open() next closes it first, since a
+     * transport hands out one client at a time.
+     */
+    void keep(bool ok);
+
+    /**
+     * Returns the client left by keep(), still connected to the same
+     * server, as the current request's client. Returns nullptr (and closes
+     * it) if it has been idle longer than maxIdleMs, the server has closed
+     * it, or its link is no longer the one open() would choose.
+     */
+    Client* resume(unsigned long maxIdleMs);
+
+    /**
+     * Name of the transport that carried (or is carrying) the latest request.
+     */
+    const char* activeTransportName() const;
+
+    /**
+     * Name of the transport registered as `link` (see links()).
+     */
+    const char* linkName(int link) const;
+
+    /**
+     * Stretches an endpoint's estimated response timeout (RttEstimator) for
+     * the link carrying the current request: doubled, up to
+     * HTTP_TIMEOUT_MAX_MS, while its signal is below LINK_WEAK_SIGNAL_DBM.
+     * A weak link loses frames, and TCP resends them at its own pace, so
+     * responses arrive late before the RTT samples show it.
+     */
+    unsigned long responseTimeoutMs(unsigned long estimatedMs) const;
+    unsigned long getEpochTime();
+    const LinkSelector& links() const;
+
+private:
+    Transport* transports[NETWORK_MAX_TRANSPORTS];
+    int count;
+    LinkSelector selector;
+    int current;
+    int lastUsed;
+    int attempts;
+    unsigned long openedAt;
+    Client* client;
+    int kept;
+    unsigned long keptAt;
+    unsigned long lastSignalSample;
+
+    Client* openOn(int link);
+    void record(int link, bool ok);
+    void dropKept();
+    void sampleSignals();
+};
+
+#endif
@@ -0,0 +1,367 @@
+#include "play_history.h"
+#include "checkpoint.h"
+#include "msgpack.h"
+
+#include <string.h>
+
+// ========== Record format ==========
+//
+//   0  magic         "PLY1"
+//   4  epoch         uint32
+//   8  shId          int32
+//  12  radioShowID   int32
+//  16  status        uint8
+//  17  (reserved)    3 bytes, 0
+//  20  metadata      MessagePack [artist, title, album], rest 0
+// 124  crc           CRC-32 of bytes 0-123
+//
+// Index entries: hour (epoch / 3600) and first record number, uint32 each.
+// All little-endian.
+
+static const uint8_t RECORD_MAGIC[4] = {'P', 'L', 'Y', '1'};
+#define RECORD_EPOCH_OFFSET 4
+#define RECORD_META_OFFSET 20
+#define RECORD_CRC_OFFSET (PLAY_RECORD_SIZE - 4)
+#define SECONDS_PER_HOUR 3600
+
+static_assert(RECORD_META_OFFSET + 1 + 3 * (2 + PLAY_FIELD_MAX) <= RECORD_CRC_OFFSET,
+              "the three fields must fit a record at their longest");
+
+static void putU32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t getU32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+/**
+ * Length of s cut to at most max bytes without splitting a UTF-8
+ * character.
+ */
+static size_t fieldLength(const char* s, size_t max) {
+    size_t len = strlen(s);
+    if (len <= max) return len;
+    len = max;
+    while (len > 0 && ((uint8_t)s[len] & 0xC0) == 0x80) len--;
+    return len;
+}
+
+static bool readField(MsgPackReader& reader, char* field) {
+    const char* s;
+    size_t len;
+    if (!reader.readStr(&s, &len) || len > PLAY_FIELD_MAX) return false;
+    memcpy(field, s, len);
+    field[len] = '\0';
+    return true;
+}
+
+static bool decodeRecord(const uint8_t* r, PlayRecord* out) {
+    if (memcmp(r, RECORD_MAGIC, sizeof(RECORD_MAGIC)) != 0) return false;
+    if (getU32(r + RECORD_CRC_OFFSET) != crc32Ieee(r, RECORD_CRC_OFFSET)) return false;
+    if (r[16] >= PLAY_STATUS_COUNT) return false;
+    out->epoch = getU32(r + RECORD_EPOCH_OFFSET);
+    out->shId = (int32_t)getU32(r + 8);
+    out->radioShowID = (int32_t)getU32(r + 12);
+    out->status = (PlayStatus)r[16];
+
+    MsgPackReader reader(r + RECORD_META_OFFSET, RECORD_CRC_OFFSET - RECORD_META_OFFSET);
+    size_t fields;
+    return reader.readArrayHeader(&fields) && fields == 3 &&
+           readField(reader, out->artist) && readField(reader, out->title) &&
+           readField(reader, out->album);
+}
+
+const char* playStatusName(PlayStatus status) {
+    switch (status) {
+        case PLAY_POSTED:     return "posted";
+        case PLAY_REJECTED:   return "rejected";
+        case PLAY_UNANSWERED: return "unanswered";
+        case PLAY_DROPPED:    return "dropped";
+        default:              return "?";
+    }
+}
+
+// ========== MemoryHistoryFile ==========
+
+MemoryHistoryFile::MemoryHistoryFile(uint8_t* storage, size_t capacity)
+    : storage(storage), capacity(capacity), length(0), reads(0), writes(0) {}
+
+bool MemoryHistoryFile::read(uint32_t offset, void* buf, size_t len) {
+    reads++;
+    if (offset > length || len > length - offset) return false;
+    memcpy(buf, storage + offset, len);
+    return true;
+}
+
+bool MemoryHistoryFile::write(uint32_t offset, const void* data, size_t len) {
+    writes++;
+    if (offset > length || offset > capacity || len > capacity - offset) return false;
+    memcpy(storage + offset, data, len);
+    if (offset + len > length) length = offset + len;
+    return true;
+}
+
+void MemoryHistoryFile::truncate(uint32_t size) {
+    if (size < length) length = size;
+}
+
+// ========== PlayHistory ==========
+
+PlayHistory::PlayHistory()
+    : records(nullptr)
+    , index(nullptr)
+    , written(0)
+    , indexEntries(0)
+    , lastHour(0)
+    , haveHour(false)
+    , indexStale(false)
+    , lastEpoch(0)
+    , pendingCount(0)
+    , pendingTimed(false)
+    , pendingSince(0)
+    , batches(0)
+{
+}
+
+bool PlayHistory::epochAt(uint32_t n, uint32_t* epoch) {
+    uint8_t bytes[4];
+    if (!records->read(n * PLAY_RECORD_SIZE + RECORD_EPOCH_OFFSET, bytes, sizeof(bytes))) {
+        return false;
+    }
+    *epoch = getU32(bytes);
+    return true;
+}
+
+bool PlayHistory::indexEntry(uint32_t i, uint32_t* hour, uint32_t* first) {
+    uint8_t bytes[PLAY_INDEX_ENTRY_SIZE];
+    if (!index->read(i * PLAY_INDEX_ENTRY_SIZE, bytes, sizeof(bytes))) return false;
+    *hour = getU32(bytes);
+    *first = getU32(bytes + 4);
+    return true;
+}
+
+bool PlayHistory::addIndexEntry(uint32_t hour, uint32_t first) {
+    uint8_t bytes[PLAY_INDEX_ENTRY_SIZE];
+    putU32(bytes, hour);
+    putU32(bytes + 4, first);
+    if (!index->write(indexEntries * PLAY_INDEX_ENTRY_SIZE, bytes, sizeof(bytes))) return false;
+    indexEntries++;
+    lastHour = hour;
+    haveHour = true;
+    return true;
+}
+
+/**
+ * Adds the index entries missing for records in the file, scanning from
+ * the newest indexed hour's first record.
+ */
+bool PlayHistory::repairIndex() {
+    uint32_t from = 0;
+    if (haveHour) {
+        uint32_t hour;
+        if (!indexEntry(indexEntries - 1, &hour, &from)) return false;
+        from++;
+    }
+    for (uint32_t n = from; n < written; n++) {
+        uint32_t epoch;
+        if (!epochAt(n, &epoch)) return false;
+        uint32_t hour = epoch / SECONDS_PER_HOUR;
+        if ((!haveHour || hour > lastHour) && !addIndexEntry(hour, n)) return false;
+    }
+    indexStale = false;
+    return true;
+}
+
+bool PlayHistory::begin(HistoryFile& recordFile, HistoryFile& indexFile) {
+    records = &recordFile;
+    index = &indexFile;
+    pendingCount = 0;
+    pendingTimed = false;
+    indexStale = false;
+
+    // A record torn by a reset fails its check; the next batch overwrites it
+    written = records->size() / PLAY_RECORD_SIZE;
+    while (written > 0) {
+        uint8_t r[PLAY_RECORD_SIZE];
+        PlayRecord record;
+        if (records->read((written - 1) * PLAY_RECORD_SIZE, r, sizeof(r)) &&
+            decodeRecord(r, &record)) {
+            lastEpoch = record.epoch;
+            break;
+        }
+        written--;
+    }
+    if (written == 0) lastEpoch = 0;
+
+    indexEntries = index->size() / PLAY_INDEX_ENTRY_SIZE;
+    haveHour = false;
+    while (indexEntries > 0) {
+        uint32_t hour, first;
+        if (!indexEntry(indexEntries - 1, &hour, &first)) {
+            records = nullptr;
+            return false;
+        }
+        if (first < written) {
+            lastHour = hour;
+            haveHour = true;
+            break;
+        }
+        indexEntries--;
+    }
+    if (!repairIndex()) {
+        records = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void PlayHistory::record(uint32_t epoch, int shId, int radioShowID, PlayStatus status,
+                         const char* artist, const char* title, const char* album) {
+    if (!records) return;
+    if (pendingCount == PLAY_HISTORY_PENDING && !flush()) return;
+
+    if (epoch < lastEpoch) epoch = lastEpoch; // also covers 0, time unknown
+    lastEpoch = epoch;
+
+    uint8_t* r = batch + pendingCount * PLAY_RECORD_SIZE;
+    memset(r, 0, PLAY_RECORD_SIZE);
+    memcpy(r, RECORD_MAGIC, sizeof(RECORD_MAGIC));
+    putU32(r + RECORD_EPOCH_OFFSET, epoch);
+    putU32(r + 8, (uint32_t)shId);
+    putU32(r + 12, (uint32_t)radioShowID);
+    r[16] = (uint8_t)status;
+
+    MsgPackWriter writer(r + RECORD_META_OFFSET, RECORD_CRC_OFFSET - RECORD_META_OFFSET);
+    writer.writeArrayHeader(3);
+    writer.writeStr(artist, fieldLength(artist, PLAY_FIELD_MAX));
+    writer.writeStr(title, fieldLength(title, PLAY_FIELD_MAX));
+    writer.writeStr(album, fieldLength(album, PLAY_FIELD_MAX));
+    putU32(r + RECORD_CRC_OFFSET, crc32Ieee(r, RECORD_CRC_OFFSET));
+    pendingCount++;
+}
+
+bool PlayHistory::update(unsigned long nowMs) {
+    if (pendingCount == 0) return true;
+    if (!pendingTimed) {
+        pendingTimed = true;
+        pendingSince = nowMs;
+    }
+    if (pendingCount < PLAY_HISTORY_BATCH && nowMs - pendingSince < PLAY_HISTORY_FLUSH_MS) {
+        return true;
+    }
+    return flush();
+}
+
+bool PlayHistory::flush() {
+    if (!records) return false;
+    if (pendingCount == 0) return true;
+    if (!records->write(written * PLAY_RECORD_SIZE, batch, pendingCount * PLAY_RECORD_SIZE)) {
+        return false;
+    }
+    uint32_t first = written;
+    written += pendingCount;
+    pendingCount = 0;
+    pendingTimed = false;
+    batches++;
+
+    if (indexStale) return repairIndex();
+
+    // The batch's new hours, in one index write
+    uint8_t entries[PLAY_HISTORY_PENDING * PLAY_INDEX_ENTRY_SIZE];
+    size_t count = 0;
+    uint32_t hour = lastHour;
+    bool have = haveHour;
+    for (uint32_t n = first; n < written; n++) {
+        uint32_t h = getU32(batch + (n - first) * PLAY_RECORD_SIZE + RECORD_EPOCH_OFFSET) /
+                     SECONDS_PER_HOUR;
+        if (have && h <= hour) continue;
+        putU32(entries + count * PLAY_INDEX_ENTRY_SIZE, h);
+        putU32(entries + count * PLAY_INDEX_ENTRY_SIZE + 4, n);
+        count++;
+        hour = h;
+        have = true;
+    }
+    if (count == 0) return true;
+    if (!index->write(indexEntries * PLAY_INDEX_ENTRY_SIZE, entries,
+                      count * PLAY_INDEX_ENTRY_SIZE)) {
+        indexStale = true; // the records are in; their index entries follow later
+        return false;
+    }
+    indexEntries += count;
+    lastHour = hour;
+    haveHour = true;
+    return true;
+}
+
+/**
+ * The number of the first record stamped at or after epoch (written if
+ * none is): the index narrows it to one hour's records, searched in turn.
+ */
+bool PlayHistory::lowerBound(uint32_t epoch, uint32_t* n) {
+    uint32_t hour = epoch / SECONDS_PER_HOUR;
+
+    // First index entry for a later hour
+    uint32_t lo = 0, hi = indexEntries;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        uint32_t h, first;
+        if (!indexEntry(mid, &h, &first)) return false;
+        if (h <= hour) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) {
+        *n = 0;
+        return true;
+    }
+    uint32_t entryHour, start, end = written;
+    if (!indexEntry(lo - 1, &entryHour, &start)) return false;
+    if (lo < indexEntries) {
+        uint32_t h;
+        if (!indexEntry(lo, &h, &end)) return false;
+    }
+    if (entryHour < hour) { // nothing was played in epoch's hour
+        *n = end;
+        return true;
+    }
+
+    while (start < end) {
+        uint32_t mid = start + (end - start) / 2;
+        uint32_t e;
+        if (!epochAt(mid, &e)) return false;
+        if (e < epoch) {
+            start = mid + 1;
+        } else {
+            end = mid;
+        }
+    }
+    *n = start;
+    return true;
+}
+
+bool PlayHistory::find(uint32_t fromEpoch, uint32_t toEpoch, uint32_t* first, uint32_t* end) {
+    if (!records || !flush()) return false;
+    if (!lowerBound(fromEpoch, first)) return false;
+    if (toEpoch <= fromEpoch) {
+        *end = *first;
+        return true;
+    }
+    return lowerBound(toEpoch, end);
+}
+
+bool PlayHistory::read(uint32_t n, PlayRecord* out) {
+    if (!records) return false;
+    if (n >= written) {
+        if (n - written >= pendingCount) return false;
+        return decodeRecord(batch + (n - written) * PLAY_RECORD_SIZE, out);
+    }
+    uint8_t r[PLAY_RECORD_SIZE];
+    return records->read(n * PLAY_RECORD_SIZE, r, sizeof(r)) && decodeRecord(r, out);
+}
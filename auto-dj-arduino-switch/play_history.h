@@ -0,0 +1,176 @@
+#ifndef PLAY_HISTORY_H
+#define PLAY_HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+
+#define PLAY_RECORD_SIZE 128
+#define PLAY_FIELD_MAX 32                         // Bytes kept of artist, title and album
+#define PLAY_HISTORY_PENDING (2 * PLAY_HISTORY_BATCH) // Records held in RAM before a forced write
+#define PLAY_INDEX_ENTRY_SIZE 8
+
+/**
+ * What became of a flowsheet entry.
+ */
+enum PlayStatus {
+    PLAY_POSTED,     // the flowsheet accepted it
+    PLAY_REJECTED,   // the flowsheet answered with an error
+    PLAY_UNANSWERED, // sent, but no answer came; not resent
+    PLAY_DROPPED,    // never sent: queue full, too large, or its show abandoned
+    PLAY_STATUS_COUNT
+};
+
+const char* playStatusName(PlayStatus status);
+
+/**
+ * One play as read back from the history. Text fields are NUL-terminated
+ * and cut to PLAY_FIELD_MAX bytes on a UTF-8 character boundary.
+ */
+struct PlayRecord {
+    uint32_t epoch;      // seconds; never earlier than the record before
+    int32_t shId;        // AzuraCast sh_id, -1 if unknown
+    int32_t radioShowID;
+    PlayStatus status;
+    char artist[PLAY_FIELD_MAX + 1];
+    char title[PLAY_FIELD_MAX + 1];
+    char album[PLAY_FIELD_MAX + 1];
+};
+
+/**
+ * A file that can be read and written at any offset, and grows when written
+ * past its end: a file on the SD card, or RAM for tests.
+ */
+class HistoryFile {
+public:
+    virtual ~HistoryFile() {}
+    virtual uint32_t size() = 0;
+    virtual bool read(uint32_t offset, void* buf, size_t len) = 0;
+    virtual bool write(uint32_t offset, const void* data, size_t len) = 0;
+};
+
+/**
+ * HistoryFile over a fixed RAM buffer. Counts reads and writes, so tests
+ * can see what a lookup or a batch costs.
+ */
+class MemoryHistoryFile : public HistoryFile {
+public:
+    MemoryHistoryFile(uint8_t* storage, size_t capacity);
+
+    uint32_t size() { return length; }
+    bool read(uint32_t offset, void* buf, size_t len);
+    bool write(uint32_t offset, const void* data, size_t len);
+
+    /** Cuts the file to `size` bytes, like a write interrupted there. */
+    void truncate(uint32_t size);
+
+    unsigned long readCount() const { return reads; }
+    unsigned long writeCount() const { return writes; }
+
+private:
+    uint8_t* storage;
+    size_t capacity;
+    uint32_t length;
+    unsigned long reads;
+    unsigned long writes;
+};
+
+/**
+ * Append-only history of flowsheet entries: when each was settled, its
+ * sh_id and show, what became of it, and its artist, title and album.
+ *
+ * Records are PLAY_RECORD_SIZE bytes, CRC-32 checked, in time order in one
+ * file. record() only encodes into a RAM batch; the batch reaches the file
+ * in one write from update(), once PLAY_HISTORY_BATCH records are waiting
+ * (a whole 512-byte SD block) or the oldest has waited
+ * PLAY_HISTORY_FLUSH_MS, so the card is touched only from the idle part of
+ * loop() and a few times an hour. Only if PLAY_HISTORY_PENDING records pile
+ * up without an update() does record() write them itself. A reset loses
+ * what was still in RAM.
+ *
+ * A second file is a sparse index: one 8-byte entry (hour, first record)
+ * for each hour that has any records. find() binary-searches the index for
+ * the hours bounding a time, then the records within that hour, so a
+ * lookup costs O(log n) small reads however long the history gets.
+ *
+ * begin() drops a torn record at the end of the file (one whose write a
+ * reset interrupted) and index entries past the last record, and re-adds
+ * index entries whose write was lost; the next batch overwrites the torn
+ * bytes.
+ *
+ * Pure logic; the caller supplies the files and the time.
+ */
+class PlayHistory {
+public:
+    PlayHistory();
+
+    /**
+     * Opens the history in `records` and its `index`. Returns false if
+     * either cannot be read.
+     */
+    bool begin(HistoryFile& records, HistoryFile& index);
+
+    /**
+     * Adds a play. epoch 0 (time unknown), or a time before the last
+     * record's, is recorded as the last record's time, so the file stays
+     * in time order.
+     */
+    void record(uint32_t epoch, int shId, int radioShowID, PlayStatus status,
+                const char* artist, const char* title, const char* album);
+
+    /**
+     * Writes the waiting batch if it is due. Call from loop()'s idle time.
+     * Returns false if a write failed (the batch is kept for the next try).
+     */
+    bool update(unsigned long nowMs);
+
+    /** Writes whatever is waiting now. */
+    bool flush();
+
+    /**
+     * Finds the records stamped in [fromEpoch, toEpoch): *first is the
+     * number of the first one and *end one past the last. Writes anything
+     * waiting first, so it is included.
+     */
+    bool find(uint32_t fromEpoch, uint32_t toEpoch, uint32_t* first, uint32_t* end);
+
+    /**
+     * Reads record n (0 is the oldest). Returns false past the end or if
+     * the record fails its check.
+     */
+    bool read(uint32_t n, PlayRecord* out);
+
+    bool isReady() const { return records != nullptr; }
+    uint32_t count() const { return written + pendingCount; }
+    uint32_t pending() const { return pendingCount; }
+    unsigned long batchCount() const { return batches; }
+
+private:
+    HistoryFile* records;
+    HistoryFile* index;
+    uint32_t written;       // records in the file
+    uint32_t indexEntries;  // entries in the index file
+    uint32_t lastHour;      // hour of the newest index entry, if haveHour
+    bool haveHour;
+    bool indexStale;        // an index write failed; repairIndex() catches up
+    uint32_t lastEpoch;
+    uint8_t batch[PLAY_HISTORY_PENDING * PLAY_RECORD_SIZE]; // records not yet written
+    uint32_t pendingCount;
+    bool pendingTimed;      // update() has seen the oldest waiting record
+    unsigned long pendingSince;
+    unsigned long batches;
+
+    bool epochAt(uint32_t n, uint32_t* epoch);
+    bool indexEntry(uint32_t i, uint32_t* hour, uint32_t* first);
+    bool addIndexEntry(uint32_t hour, uint32_t first);
+    bool repairIndex();
+    bool lowerBound(uint32_t epoch, uint32_t* n);
+};
+
+/**
+ * Platform: the history's record and index files, or false if there is
+ * no card (history_platform.cpp on the Giga).
+ */
+bool playHistoryFiles(HistoryFile** records, HistoryFile** index);
+
+#endif
@@ -1,49 +1,43 @@
 #include "relay_monitor.h"
 
-RelayMonitor::RelayMonitor(int relayPin, int ledPin, unsigned long debounceMs)
+RelayMonitor::RelayMonitor(int relayPin, int ledPin, unsigned long debounceMs,
+                           unsigned long minDebounceMs, unsigned long maxDebounceMs)
     : relayPin(relayPin)
     , ledPin(ledPin)
-    , debounceMs(debounceMs)
-    , debouncedState(HIGH)
-    , lastReading(HIGH)
-    , lastChangeTime(0)
+    , filter(debounceMs, minDebounceMs, maxDebounceMs)
     , changed(false)
 {
+    filter.reset(HIGH);
 }
 
 void RelayMonitor::setUp() {
     pinMode(relayPin, INPUT_PULLUP);
     pinMode(ledPin, OUTPUT);
-    debouncedState = digitalRead(relayPin);
-    lastReading = debouncedState;
-    digitalWrite(ledPin, debouncedState == LOW ? HIGH : LOW);
+    filter.reset(digitalRead(relayPin));
+    digitalWrite(ledPin, filter.level() == LOW ? HIGH : LOW);
 }
 
 void RelayMonitor::update() {
-    changed = false;
-    int reading = digitalRead(relayPin);
-
-    if (reading != lastReading) {
-        lastChangeTime = millis();
-    }
-
-    if ((millis() - lastChangeTime) > debounceMs) {
-        if (reading != debouncedState) {
-            debouncedState = reading;
-            changed = true;
-            // LED on when auto DJ is active (relay closed = LOW)
-            digitalWrite(ledPin, debouncedState == LOW ? HIGH : LOW);
-        }
+    changed = filter.update(digitalRead(relayPin), millis());
+    if (changed) {
+        // LED on when auto DJ is active (relay closed = LOW)
+        digitalWrite(ledPin, filter.level() == LOW ? HIGH : LOW);
     }
-
-    lastReading = reading;
 }
 
 bool RelayMonitor::isAutoDJActive() const {
     // Relay closed (pin LOW via pullup) = AUX off = auto DJ active
-    return debouncedState == LOW;
+    return filter.level() == LOW;
 }
 
 bool RelayMonitor::stateChanged() const {
     return changed;
 }
+
+bool RelayMonitor::activationPending() const {
+    return !isAutoDJActive() && filter.settling();
+}
+
+const DebounceFilter& RelayMonitor::debounce() const {
+    return filter;
+}
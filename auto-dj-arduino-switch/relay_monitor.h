@@ -2,9 +2,12 @@
 #define RELAY_MONITOR_H
 
 #include <Arduino.h>
+#include "debounce_filter.h"
 
 /**
- * Monitors the mixing board AUX relay contact with software debouncing.
+ * Monitors the mixing board AUX relay contact with software debouncing
+ * (DebounceFilter: the settle window starts at debounceMs and adapts to
+ * the contact's observed bounce within [minDebounceMs, maxDebounceMs]).
  *
  * The relay contact is wired between RELAY_PIN and GND. When the relay
  * closes (AUX off = auto DJ active), the pin reads LOW via INPUT_PULLUP.
@@ -15,20 +18,29 @@
  */
 class RelayMonitor {
 public:
-    RelayMonitor(int relayPin, int ledPin, unsigned long debounceMs);
+    RelayMonitor(int relayPin, int ledPin, unsigned long debounceMs,
+                 unsigned long minDebounceMs, unsigned long maxDebounceMs);
     void setUp();
     void update();
     bool isAutoDJActive() const;
     bool stateChanged() const;
 
+    /**
+     * True while the contact has closed but is still inside the settle
+     * window: auto DJ is probably about to become active, early enough to
+     * warm up for the show.
+     */
+    bool activationPending() const;
+
+    /**
+     * The contact's bounce statistics and current settle window.
+     */
+    const DebounceFilter& debounce() const;
+
 private:
     int relayPin;
     int ledPin;
-    unsigned long debounceMs;
-
-    int debouncedState;
-    int lastReading;
-    unsigned long lastChangeTime;
+    DebounceFilter filter;
     bool changed;
 };
 
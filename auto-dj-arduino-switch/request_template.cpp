@@ -0,0 +1,144 @@
+#include "request_template.h"
+
+#include <stdio.h>
+#include <string.h>
+
+FormRequest::FormRequest(char* storage, size_t size, size_t headerRoom)
+    : storage(storage)
+    , size(size)
+    , bodyStart(headerRoom < size ? headerRoom : size)
+    , bodyEnd(bodyStart)
+    , overflow(headerRoom >= size)
+{
+}
+
+FormRequest& FormRequest::append(const char* s) {
+    return append(s, strlen(s));
+}
+
+FormRequest& FormRequest::append(const char* s, size_t len) {
+    if (overflow || len > size - bodyEnd) {
+        overflow = true;
+        return *this;
+    }
+    memcpy(storage + bodyEnd, s, len);
+    bodyEnd += len;
+    return *this;
+}
+
+FormRequest& FormRequest::appendNumber(unsigned long value) {
+    char buf[21]; // fits a 64-bit long
+    int n = snprintf(buf, sizeof(buf), "%lu", value);
+    return append(buf, (size_t)n);
+}
+
+FormRequest& FormRequest::appendNumber(long value) {
+    char buf[21];
+    int n = snprintf(buf, sizeof(buf), "%ld", value);
+    return append(buf, (size_t)n);
+}
+
+// Bytes in the UTF-8 character starting at s, stopping short at a NUL. A
+// stray continuation or invalid byte counts as a character of its own.
+static size_t utf8CharLength(const char* s) {
+    unsigned char lead = (unsigned char)*s;
+    size_t n = lead >= 0xF0 && lead < 0xF8 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+    for (size_t i = 1; i < n; i++) {
+        if (((unsigned char)s[i] & 0xC0) != 0x80) return i;
+    }
+    return n;
+}
+
+static size_t urlEncodedLength(unsigned char c) {
+    return isUnreservedChar((char)c) || c == ' ' ? 1 : 3;
+}
+
+static size_t jsonEscapedLength(unsigned char c) {
+    if (c == '"' || c == '\\' || c == '\n' || c == '\r' || c == '\t') return 2;
+    return c < 0x20 ? 6 : 1;
+}
+
+void FormRequest::appendUrlEncodedByte(unsigned char c) {
+    if (isUnreservedChar((char)c)) {
+        append((const char*)&c, 1);
+    } else if (c == ' ') {
+        append("+", 1);
+    } else {
+        char esc[3] = { '%', lowerHexDigit(c >> 4), lowerHexDigit(c & 0x0F) };
+        append(esc, 3);
+    }
+}
+
+void FormRequest::appendJsonEscapedByte(unsigned char c) {
+    if (c == '"' || c == '\\') {
+        char esc[2] = { '\\', (char)c };
+        append(esc, 2);
+    } else if (c == '\n') {
+        append("\\n", 2);
+    } else if (c == '\r') {
+        append("\\r", 2);
+    } else if (c == '\t') {
+        append("\\t", 2);
+    } else if (c < 0x20) {
+        char esc[6] = { '\\', 'u', '0', '0', lowerHexDigit(c >> 4), lowerHexDigit(c & 0x0F) };
+        append(esc, 6);
+    } else {
+        append((const char*)&c, 1);
+    }
+}
+
+FormRequest& FormRequest::appendEncoded(const char* s, size_t maxLen) {
+    size_t used = 0;
+    while (*s && !overflow) {
+        size_t n = utf8CharLength(s);
+        size_t length = 0;
+        for (size_t i = 0; i < n; i++) length += urlEncodedLength((unsigned char)s[i]);
+        if (length > maxLen - used) break;
+        used += length;
+        for (; n > 0; n--, s++) appendUrlEncodedByte((unsigned char)*s);
+    }
+    return *this;
+}
+
+/**
+ * Appends s as a JSON string literal. Quotes, backslashes and control
+ * characters are escaped; everything else, including UTF-8 sequences,
+ * is copied as is.
+ */
+FormRequest& FormRequest::appendJsonString(const char* s, size_t maxLen) {
+    append("\"", 1);
+    size_t used = 0;
+    while (*s && !overflow) {
+        size_t n = utf8CharLength(s);
+        size_t length = 0;
+        for (size_t i = 0; i < n; i++) length += jsonEscapedLength((unsigned char)s[i]);
+        if (length > maxLen - used) break;
+        used += length;
+        for (; n > 0; n--, s++) appendJsonEscapedByte((unsigned char)*s);
+    }
+    return append("\"", 1);
+}
+
+bool FormRequest::finish(const char* requestLine, const char* headers,
+                         const char** data, size_t* length) {
+    if (overflow) return false;
+
+    char tail[26]; // Content-Length digits + blank line
+    int tailLen = snprintf(tail, sizeof(tail), "%lu\r\n\r\n", (unsigned long)bodyLength());
+    size_t lineLen = strlen(requestLine);
+    size_t headersLen = strlen(headers);
+    size_t prefixLen = lineLen + headersLen + (size_t)tailLen;
+    if (prefixLen > bodyStart) {
+        overflow = true;
+        return false;
+    }
+
+    char* start = storage + bodyStart - prefixLen;
+    memcpy(start, requestLine, lineLen);
+    memcpy(start + lineLen, headers, headersLen);
+    memcpy(start + lineLen + headersLen, tail, (size_t)tailLen);
+
+    *data = start;
+    *length = prefixLen + bodyLength();
+    return true;
+}
@@ -0,0 +1,104 @@
+#ifndef REQUEST_TEMPLATE_H
+#define REQUEST_TEMPLATE_H
+
+#include <stddef.h>
+
+// ========== Compile-time URL encoding ==========
+
+constexpr bool isUnreservedChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+           c == '-' || c == '_' || c == '.' || c == '~';
+}
+
+constexpr char lowerHexDigit(unsigned v) {
+    return (char)(v < 10 ? '0' + v : 'a' + (v - 10));
+}
+
+/**
+ * A string literal form-encoded at compile time, with the same rules as
+ * urlEncode(): unreserved characters pass through, space becomes '+', and
+ * everything else becomes %xx (lowercase hex). Sized for the worst case.
+ */
+template <size_t N>
+struct EncodedLiteral {
+    char str[N * 3 - 2];
+    size_t len;
+
+    constexpr explicit EncodedLiteral(const char (&s)[N]) : str(), len(0) {
+        for (size_t i = 0; i + 1 < N; i++) {
+            char c = s[i];
+            if (isUnreservedChar(c)) {
+                str[len++] = c;
+            } else if (c == ' ') {
+                str[len++] = '+';
+            } else {
+                str[len++] = '%';
+                str[len++] = lowerHexDigit((unsigned char)c >> 4);
+                str[len++] = lowerHexDigit((unsigned char)c & 0x0F);
+            }
+        }
+        str[len] = '\0';
+    }
+};
+
+template <size_t N>
+constexpr EncodedLiteral<N> urlEncodeLiteral(const char (&s)[N]) {
+    return EncodedLiteral<N>(s);
+}
+
+// ========== Request composition ==========
+
+/**
+ * Builds a complete POST (request line, headers, form or JSON body) in one
+ * contiguous buffer so it can go to the socket in a single write.
+ *
+ * The body is appended first, into the storage after room reserved for
+ * headers; finish() then places the constant request line and header block,
+ * plus the Content-Length value, immediately in front of it. Only the
+ * variable body fields are formatted at run time.
+ *
+ *     FormRequest form(storage, sizeof(storage), HEADER_ROOM);
+ *     form.append("radioShowID=").appendNumber(id).append("&mode=signoffConfirm");
+ *     form.finish(requestLine, headers, &data, &len);
+ *
+ * `headers` must end with "Content-Length: ". An append that does not fit
+ * marks the request as overflowed and finish() fails.
+ */
+class FormRequest {
+public:
+    FormRequest(char* storage, size_t size, size_t headerRoom);
+
+    FormRequest& append(const char* s);
+    FormRequest& append(const char* s, size_t len);
+    FormRequest& appendNumber(unsigned long value);
+    FormRequest& appendNumber(long value);
+    FormRequest& appendNumber(int value) { return appendNumber((long)value); }
+    // Each writes at most maxLen encoded bytes of s (not counting quotes),
+    // clipping it before the first UTF-8 character that would not fit
+    FormRequest& appendEncoded(const char* s, size_t maxLen = (size_t)-1); // urlEncode() at run time
+    FormRequest& appendJsonString(const char* s, size_t maxLen = (size_t)-1); // quoted and escaped
+
+    template <size_t N>
+    FormRequest& append(const EncodedLiteral<N>& encoded) {
+        return append(encoded.str, encoded.len);
+    }
+
+    const char* body() const { return storage + bodyStart; }
+    size_t bodyLength() const { return bodyEnd - bodyStart; }
+    bool overflowed() const { return overflow; }
+
+    bool finish(const char* requestLine, const char* headers,
+                const char** data, size_t* length);
+
+private:
+    void appendUrlEncodedByte(unsigned char c);
+    void appendJsonEscapedByte(unsigned char c);
+
+    char* storage;
+    size_t size;
+    size_t bodyStart;
+    size_t bodyEnd;
+    bool overflow;
+};
+
+#endif
@@ -0,0 +1,113 @@
+#include "retry_policy.h"
+
+unsigned long backoffDelayMs(unsigned long baseMs, unsigned long maxMs, int attempt,
+                             unsigned long random) {
+    unsigned long ceiling = baseMs;
+    for (int i = 1; i < attempt && ceiling < maxMs; i++) {
+        ceiling *= 2;
+    }
+    if (ceiling > maxMs) ceiling = maxMs;
+
+    unsigned long half = ceiling / 2;
+    return half + random % (ceiling - half + 1);
+}
+
+// ========== CircuitBreaker ==========
+
+CircuitBreaker::CircuitBreaker(int failureThreshold, unsigned long openMs)
+    : failureThreshold(failureThreshold)
+    , openMs(openMs)
+    , current(CLOSED)
+    , failures(0)
+    , since(0)
+    , refused(0)
+{
+}
+
+bool CircuitBreaker::allow(unsigned long nowMs) {
+    if (current == CLOSED) return true;
+
+    if (nowMs - since >= openMs) {
+        // Open long enough, or the last probe never reported back
+        current = HALF_OPEN;
+        since = nowMs;
+        return true;
+    }
+    refused++;
+    return false;
+}
+
+bool CircuitBreaker::record(bool ok, unsigned long nowMs) {
+    State previous = current;
+    if (ok) {
+        current = CLOSED;
+        failures = 0;
+    } else {
+        failures++;
+        if (current == HALF_OPEN || failures >= failureThreshold) {
+            current = OPEN;
+            since = nowMs;
+        }
+    }
+    return current != previous;
+}
+
+unsigned long CircuitBreaker::refusingForMs(unsigned long nowMs) const {
+    if (current == CLOSED) return 0;
+    unsigned long elapsed = nowMs - since;
+    return elapsed >= openMs ? 0 : openMs - elapsed;
+}
+
+const char* CircuitBreaker::stateName(State s) {
+    switch (s) {
+        case CLOSED:    return "closed";
+        case OPEN:      return "open";
+        case HALF_OPEN: return "half-open";
+        default:        return "unknown";
+    }
+}
+
+// ========== RttEstimator ==========
+
+RttEstimator::RttEstimator(unsigned long initialMs, unsigned long minMs, unsigned long maxMs)
+    : initialMs(initialMs)
+    , minMs(minMs)
+    , maxMs(maxMs)
+    , srtt8(0)
+    , rttvar4(0)
+    , samples(0)
+    , timeouts(0)
+    , backoff(0)
+{
+}
+
+void RttEstimator::sample(unsigned long rttMs) {
+    if (samples == 0) {
+        srtt8 = rttMs << 3;
+        rttvar4 = rttMs << 1; // RTTVAR = R/2
+    } else {
+        long delta = (long)rttMs - (long)(srtt8 >> 3);
+        srtt8 = (unsigned long)((long)srtt8 + delta);
+        unsigned long magnitude = delta < 0 ? (unsigned long)-delta : (unsigned long)delta;
+        rttvar4 = rttvar4 + magnitude - (rttvar4 >> 2);
+    }
+    samples++;
+    backoff = 0;
+}
+
+void RttEstimator::timedOut() {
+    timeouts++;
+    if (timeoutMs() < maxMs) backoff++;
+}
+
+unsigned long RttEstimator::timeoutMs() const {
+    unsigned long timeout = initialMs;
+    if (samples > 0) {
+        // SRTT + max(G, 4 * RTTVAR), with a 1 ms clock
+        timeout = smoothedMs() + (rttvar4 > 0 ? rttvar4 : 1);
+    }
+    if (timeout < minMs) timeout = minMs;
+    for (int i = 0; i < backoff && timeout < maxMs; i++) timeout *= 2;
+    if (timeout > maxMs) timeout = maxMs;
+    return timeout;
+}
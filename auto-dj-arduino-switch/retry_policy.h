@@ -0,0 +1,110 @@
+#ifndef RETRY_POLICY_H
+#define RETRY_POLICY_H
+
+/**
+ * How long to wait before retry number `attempt` (1 for the first retry):
+ * an exponential ceiling, baseMs doubled per attempt and capped at maxMs,
+ * with "equal jitter" -- half the ceiling, plus a random share of the other
+ * half taken from `random`. The jitter keeps devices and endpoints that
+ * failed together from retrying in lockstep; the fixed half keeps a retry
+ * from following its failure immediately.
+ *
+ * Pure; the caller supplies the random value (e.g. Arduino random()).
+ */
+unsigned long backoffDelayMs(unsigned long baseMs, unsigned long maxMs, int attempt,
+                             unsigned long random);
+
+/**
+ * Stops requests to an endpoint that keeps failing, then probes it for
+ * recovery.
+ *
+ * CLOSED: requests go through; failureThreshold failures in a row open
+ * the breaker. OPEN: requests are refused until openMs has passed, then
+ * the breaker is HALF_OPEN and lets one probe through. The probe's success
+ * closes it, its failure opens it for another openMs. A probe whose
+ * outcome is never recorded is replaced after openMs.
+ *
+ * Pure logic with no I/O; time is passed in by the caller.
+ */
+class CircuitBreaker {
+public:
+    enum State { CLOSED, OPEN, HALF_OPEN };
+
+    CircuitBreaker(int failureThreshold, unsigned long openMs);
+
+    /**
+     * Returns true if a request may be sent now. In HALF_OPEN this is the
+     * probe, and further requests are refused until its outcome is
+     * recorded.
+     */
+    bool allow(unsigned long nowMs);
+
+    /**
+     * Records the outcome of a request allow() let through. Returns true if
+     * the breaker changed state.
+     */
+    bool record(bool ok, unsigned long nowMs);
+
+    /**
+     * How much longer allow() will refuse: until the next probe is let
+     * through, or 0 if a request would go out now.
+     */
+    unsigned long refusingForMs(unsigned long nowMs) const;
+
+    State state() const { return current; }
+    int consecutiveFailures() const { return failures; }
+    unsigned long refusedCount() const { return refused; }
+
+    static const char* stateName(State s);
+
+private:
+    int failureThreshold;
+    unsigned long openMs;
+
+    State current;
+    int failures;
+    unsigned long since; // when the breaker opened, or the probe began
+    unsigned long refused;
+};
+
+/**
+ * Derives an endpoint's response timeout from the round-trip times of its
+ * responses, as TCP derives its retransmission timeout (RFC 6298).
+ *
+ * Each sample updates a smoothed RTT (gain 1/8) and a mean deviation
+ * (gain 1/4); the timeout is the smoothed RTT plus four deviations, within
+ * [minMs, maxMs]. A quick, steady server gets a timeout a little over its
+ * usual answer time, so a dead one is noticed in seconds; a slow or erratic
+ * one gets room. Until the first sample the timeout is initialMs. A
+ * timeout doubles it (up to maxMs) until the next sample, so a server
+ * that has slowed past the estimate is given longer on the next attempt.
+ *
+ * Only responses that arrived are sampled, never a wait that timed out
+ * (Karn's rule). Pure logic with no I/O; the caller times the wait.
+ */
+class RttEstimator {
+public:
+    RttEstimator(unsigned long initialMs, unsigned long minMs, unsigned long maxMs);
+
+    void sample(unsigned long rttMs);
+    void timedOut();
+
+    unsigned long timeoutMs() const;
+    unsigned long smoothedMs() const { return srtt8 >> 3; }
+    unsigned long deviationMs() const { return rttvar4 >> 2; }
+    unsigned long sampleCount() const { return samples; }
+    unsigned long timeoutCount() const { return timeouts; }
+
+private:
+    unsigned long initialMs;
+    unsigned long minMs;
+    unsigned long maxMs;
+
+    unsigned long srtt8;   // smoothed RTT, scaled by 8
+    unsigned long rttvar4; // mean deviation, scaled by 4
+    unsigned long samples;
+    unsigned long timeouts;
+    int backoff;           // doublings since the last sample
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA256_DIGEST_SIZE 32
+#define SHA256_BLOCK_SIZE 64
+
+/**
+ * Incremental SHA-256 (FIPS 180-4): feed the message in pieces of any size
+ * with update(), then finish(). Keeps one 64-byte block and the chaining
+ * state; nothing is allocated.
+ */
+class Sha256 {
+public:
+    Sha256();
+
+    void reset();
+    void update(const void* data, size_t len);
+
+    /**
+     * Writes the digest of everything fed since reset(). The hash must be
+     * reset() before it is used again.
+     */
+    void finish(uint8_t digest[SHA256_DIGEST_SIZE]);
+
+private:
+    uint32_t state[8];
+    uint64_t length; // bytes fed
+    uint8_t block[SHA256_BLOCK_SIZE];
+    size_t blockLen;
+
+    void compress(const uint8_t* data);
+};
+
+/**
+ * Parses a 64-character hex digest (either case). Returns false if hex is
+ * not exactly that.
+ */
+bool sha256FromHex(const char* hex, uint8_t digest[SHA256_DIGEST_SIZE]);
+
+#endif
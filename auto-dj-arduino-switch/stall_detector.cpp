@@ -0,0 +1,99 @@
+#include "stall_detector.h"
+
+#define STALL_RECORD_MAGIC 0x57444F47UL // "WDOG"
+
+const char* stallOpName(StallOp op) {
+    switch (op) {
+        case STALL_NONE:       return "none";
+        case STALL_POLL:       return "poll";
+        case STALL_START_SHOW: return "startShow";
+        case STALL_ADD_ENTRY:  return "addEntry";
+        case STALL_END_SHOW:   return "endShow";
+        case STALL_RECONNECT:  return "reconnect";
+        case STALL_FIRMWARE:   return "firmware";
+        case STALL_HISTORY:    return "history";
+        default:               return "unknown";
+    }
+}
+
+StallDetector::StallDetector(unsigned long watchdogTimeoutMs)
+    : timeoutMs(watchdogTimeoutMs)
+    , record(&local)
+{
+    local.magic = STALL_RECORD_MAGIC;
+    local.op = STALL_NONE;
+    local.startedMs = 0;
+    local.kickedMs = 0;
+    seal();
+    for (int i = 0; i < STALL_OP_COUNT; i++) longest[i] = 0;
+}
+
+void StallDetector::seal() {
+    record->check = ~(record->magic ^ record->op ^ record->startedMs ^ record->kickedMs);
+}
+
+bool StallDetector::valid() const {
+    return record->magic == STALL_RECORD_MAGIC &&
+           record->check == ~(record->magic ^ record->op ^ record->startedMs ^ record->kickedMs) &&
+           record->op < STALL_OP_COUNT;
+}
+
+bool StallDetector::attach(StallRecord* persistent, bool resetByWatchdog, StallReport* report) {
+    // Anything begun before attach() carries over; a record attached before
+    // (a restart without losing RAM) is the previous run's, not this one's
+    StallRecord current = *record;
+    if (record == persistent) {
+        current.magic = STALL_RECORD_MAGIC;
+        current.op = STALL_NONE;
+        current.startedMs = 0;
+        current.kickedMs = 0;
+    }
+    record = persistent;
+
+    bool inFlight = valid() && record->op != STALL_NONE;
+    bool found = inFlight || resetByWatchdog;
+    if (found) {
+        report->op = inFlight ? (StallOp)record->op : STALL_NONE;
+        report->watchdog = resetByWatchdog;
+        report->inFlightMs = 0;
+        if (inFlight) {
+            report->inFlightMs = (uint32_t)(record->kickedMs - record->startedMs);
+            if (resetByWatchdog) report->inFlightMs += timeoutMs;
+        }
+    }
+
+    *record = current;
+    seal();
+    return found;
+}
+
+StallOp StallDetector::begin(StallOp op, unsigned long nowMs) {
+    StallOp outer = (StallOp)record->op;
+    record->op = op;
+    record->startedMs = nowMs;
+    record->kickedMs = nowMs;
+    seal();
+    return outer;
+}
+
+void StallDetector::end(StallOp outer, unsigned long outerStartedMs, unsigned long nowMs) {
+    unsigned long ran = (uint32_t)(nowMs - record->startedMs);
+    if (record->op < STALL_OP_COUNT && ran > longest[record->op]) longest[record->op] = ran;
+    record->op = outer;
+    record->startedMs = outerStartedMs;
+    seal();
+}
+
+void StallDetector::kicked(unsigned long nowMs) {
+    record->kickedMs = nowMs;
+    seal();
+}
+
+unsigned long StallDetector::inFlightMs(unsigned long nowMs) const {
+    if (record->op == STALL_NONE) return 0;
+    return (uint32_t)(nowMs - record->startedMs);
+}
+
+unsigned long StallDetector::longestMs(StallOp op) const {
+    return op < STALL_OP_COUNT ? longest[op] : 0;
+}
@@ -0,0 +1,145 @@
+#ifndef STALL_DETECTOR_H
+#define STALL_DETECTOR_H
+
+#include <Arduino.h>
+#include <stdint.h>
+
+/**
+ * Blocking operations a hang is attributed to. Time outside any StallScope
+ * counts as STALL_NONE.
+ */
+enum StallOp {
+    STALL_NONE,
+    STALL_POLL,
+    STALL_START_SHOW,
+    STALL_ADD_ENTRY,
+    STALL_END_SHOW,
+    STALL_RECONNECT,
+    STALL_FIRMWARE,
+    STALL_HISTORY,
+    STALL_OP_COUNT
+};
+
+const char* stallOpName(StallOp op);
+
+/**
+ * The operation in flight, kept where it survives a reset (RAM the startup
+ * code does not clear, see stall_platform.cpp). `check` covers the other
+ * fields, so a record that was never written, or was cleared or corrupted
+ * by a power loss, is recognised and ignored.
+ */
+struct StallRecord {
+    uint32_t magic;
+    uint32_t op;
+    uint32_t startedMs; // when op began
+    uint32_t kickedMs;  // last watchdog kick
+    uint32_t check;
+};
+
+/** What the last run was doing when it was reset. */
+struct StallReport {
+    StallOp op;
+    bool watchdog;            // the hardware watchdog caused the reset
+    unsigned long inFlightMs; // op start to the reset (to the last kick if not watchdog)
+};
+
+/**
+ * Software side of the hardware watchdog: tracks which operation is in
+ * flight, in a record that survives the reset the watchdog causes, so the
+ * next boot can report what hung and for how long.
+ *
+ * The loop kicks the watchdog every iteration and every StallScope kicks it
+ * on entry, so each operation gets a full watchdog timeout to itself. An
+ * operation that outlives it is, by definition, what the reset interrupted,
+ * and it ran for (last kick + timeout - its start).
+ *
+ * Bookkeeping is a handful of stores per scope and kick. The longest run of
+ * each operation is kept too, for spotting near misses before they become
+ * resets.
+ *
+ * Pure logic; the watchdog, the reset cause and the surviving record come
+ * from the platform functions below, which the sketch links for the Giga
+ * (stall_platform.cpp) and the test shim for the host.
+ */
+class StallDetector {
+public:
+    explicit StallDetector(unsigned long watchdogTimeoutMs);
+
+    /**
+     * Moves the record to `persistent` (which outlives a reset). If it holds
+     * a valid record with an operation in flight, or the watchdog reset the
+     * device, fills report and returns true. The record then starts afresh.
+     */
+    bool attach(StallRecord* persistent, bool resetByWatchdog, StallReport* report);
+
+    /**
+     * Marks op as in flight; the watchdog has just been kicked. Returns the
+     * operation it nests inside, for end().
+     */
+    StallOp begin(StallOp op, unsigned long nowMs);
+
+    /**
+     * Ends the innermost operation, returning to `outer` (begun at
+     * outerStartedMs).
+     */
+    void end(StallOp outer, unsigned long outerStartedMs, unsigned long nowMs);
+
+    void kicked(unsigned long nowMs);
+
+    StallOp current() const { return (StallOp)record->op; }
+    unsigned long startedMs() const { return record->startedMs; }
+    unsigned long inFlightMs(unsigned long nowMs) const;
+    unsigned long longestMs(StallOp op) const;
+
+private:
+    unsigned long timeoutMs;
+    StallRecord local; // until attach()
+    StallRecord* record;
+    unsigned long longest[STALL_OP_COUNT];
+
+    void seal();
+    bool valid() const;
+};
+
+// ========== Platform ==========
+
+/** Starts the hardware watchdog; a no-op where there is none. */
+void watchdogStart(unsigned long timeoutMs);
+void watchdogKick();
+bool resetByWatchdog();
+StallRecord* persistentStallRecord();
+
+extern StallDetector stallDetector;
+
+/**
+ * Attributes a blocking operation to a StallOp for the watchdog, and kicks
+ * it on entry:
+ *
+ *     bool AzuraCastClient::poll() {
+ *         StallScope stallScope(STALL_POLL);
+ *         ...
+ */
+class StallScope {
+public:
+    explicit StallScope(StallOp op) {
+        watchdogKick();
+        outerStartedMs = stallDetector.startedMs();
+        outer = stallDetector.begin(op, millis());
+    }
+    ~StallScope() { stallDetector.end(outer, outerStartedMs, millis()); }
+
+    StallScope(const StallScope&) = delete;
+    StallScope& operator=(const StallScope&) = delete;
+
+private:
+    StallOp outer;
+    unsigned long outerStartedMs;
+};
+
+/** Kicks the watchdog from the loop or between steps of a long operation. */
+inline void feedWatchdog() {
+    watchdogKick();
+    stallDetector.kicked(millis());
+}
+
+#endif
@@ -0,0 +1,37 @@
+/**
+ * Watchdog and reset-surviving RAM for the Giga R1 (mbed OS).
+ *
+ * The hardware watchdog is the STM32H7's independent watchdog through
+ * mbed::Watchdog; it cannot be stopped once started, and its longest
+ * timeout is about 32 s. The stall record sits in a .noinit section, which
+ * the startup code neither loads nor zeroes, so it keeps its contents
+ * across a watchdog or software reset (not across a power loss; the
+ * record's check word catches that).
+ */
+#if defined(ARDUINO_ARCH_MBED)
+
+#include "stall_detector.h"
+
+#include "drivers/Watchdog.h"
+#include "drivers/ResetReason.h"
+
+static StallRecord noinitRecord __attribute__((section(".noinit")));
+
+void watchdogStart(unsigned long timeoutMs) {
+    mbed::Watchdog::get_instance().start((uint32_t)timeoutMs);
+}
+
+void watchdogKick() {
+    mbed::Watchdog& watchdog = mbed::Watchdog::get_instance();
+    if (watchdog.is_running()) watchdog.kick();
+}
+
+bool resetByWatchdog() {
+    return mbed::ResetReason::get() == RESET_REASON_WATCHDOG;
+}
+
+StallRecord* persistentStallRecord() {
+    return &noinitRecord;
+}
+
+#endif
@@ -1,12 +1,40 @@
 #include "state_machine.h"
+#include "retry_policy.h"
 #include "utils.h"
 
+// Sets the deadline for the next attempt after `attempt` failures
+static void scheduleRetry(Context& ctx, const Inputs& inputs, int attempt) {
+    ctx.backingOff = true;
+    ctx.retryAt = inputs.currentMillis + backoffDelayMs(inputs.retryBackoffMs,
+        inputs.retryBackoffMaxMs, attempt, inputs.jitter);
+}
+
+// While the flowsheet's circuit breaker is open no attempt is made, so none
+// is counted against maxRetries; the next one waits for the breaker's probe.
+// Returns true if that is the case.
+static bool waitForBreaker(Context& ctx, const Inputs& inputs) {
+    if (inputs.breakerWaitMs == 0) return false;
+    ctx.backingOff = true;
+    ctx.retryAt = inputs.currentMillis + inputs.breakerWaitMs;
+    return true;
+}
+
+// Logs the polled track unless a live DJ is on or the hour is unknown
+static void logPolledTrack(TickResult& result, const Inputs& inputs) {
+    if (!inputs.pollNewTrack || inputs.pollLiveDJ) return;
+    unsigned long hourMs = currentHourMs(inputs.epochTime);
+    if (hourMs == 0) return;
+    result.addEntry = true;
+    result.addEntryHourMs = hourMs;
+    result.addEntryShId = inputs.pollShId;
+}
+
 TickResult tick(const Context& ctx, const Inputs& inputs) {
     TickResult result;
     result.context = ctx;
     result.addEntry = false;
     result.addEntryHourMs = 0;
-    result.delayMs = 0;
+    result.addEntryShId = 0;
 
     // WiFi loss: any state except BOOTING/CONNECTING_WIFI -> CONNECTING_WIFI.
     // Preserves radioShowID for resumption after reconnect.
@@ -14,6 +42,7 @@ TickResult tick(const Context& ctx, const Inputs& inputs) {
         result.context.state != CONNECTING_WIFI &&
         !inputs.wifiConnected) {
         result.context.state = CONNECTING_WIFI;
+        result.context.backingOff = false;
         return result;
     }
 
@@ -23,11 +52,8 @@ TickResult tick(const Context& ctx, const Inputs& inputs) {
 
         case CONNECTING_WIFI:
             if (inputs.wifiConnected) {
-                if (result.context.radioShowID > 0) {
-                    result.context.state = AUTO_DJ_ACTIVE;
-                } else {
-                    result.context.state = IDLE;
-                }
+                result.context.state = reconnectState(result.context.radioShowID,
+                                                      inputs.autoDJActive);
                 result.context.retryCount = 0;
             }
             break;
@@ -40,23 +66,31 @@ TickResult tick(const Context& ctx, const Inputs& inputs) {
             break;
 
         case STARTING_SHOW:
+            if (!retryDue(result.context, inputs.currentMillis)) break;
+            result.context.backingOff = false;
             if (inputs.epochTime == 0) {
                 result.context.state = ERROR_STATE;
                 result.context.retryCount = 0;
                 break;
             }
+            if (waitForBreaker(result.context, inputs)) break;
             if (inputs.startShowResult > 0) {
                 result.context.radioShowID = inputs.startShowResult;
                 result.context.lastPollTime = 0;
                 result.context.state = AUTO_DJ_ACTIVE;
                 result.context.retryCount = 0;
+                // A warm track counts as the show's first poll
+                if (inputs.pollNewTrack) {
+                    result.context.lastPollTime = inputs.currentMillis;
+                    logPolledTrack(result, inputs);
+                }
             } else {
                 result.context.retryCount++;
                 if (result.context.retryCount >= inputs.maxRetries) {
                     result.context.state = ERROR_STATE;
                     result.context.retryCount = 0;
                 } else {
-                    result.delayMs = inputs.retryBackoffMs * result.context.retryCount;
+                    scheduleRetry(result.context, inputs, result.context.retryCount);
                 }
             }
             break;
@@ -69,20 +103,14 @@ TickResult tick(const Context& ctx, const Inputs& inputs) {
             }
             if (inputs.currentMillis - result.context.lastPollTime >= inputs.pollIntervalMs) {
                 result.context.lastPollTime = inputs.currentMillis;
-                if (inputs.pollNewTrack && !inputs.pollLiveDJ) {
-                    unsigned long hourMs = currentHourMs(inputs.epochTime);
-                    if (hourMs > 0) {
-                        result.addEntry = true;
-                        result.addEntryHourMs = hourMs;
-                        result.addEntryArtist = inputs.artist;
-                        result.addEntryTitle = inputs.title;
-                        result.addEntryAlbum = inputs.album;
-                    }
-                }
+                logPolledTrack(result, inputs);
             }
             break;
 
         case ENDING_SHOW:
+            if (!retryDue(result.context, inputs.currentMillis)) break;
+            result.context.backingOff = false;
+            if (waitForBreaker(result.context, inputs)) break;
             if (inputs.endShowResult) {
                 result.context.radioShowID = -1;
                 result.context.state = IDLE;
@@ -94,12 +122,14 @@ TickResult tick(const Context& ctx, const Inputs& inputs) {
                     result.context.state = IDLE;
                     result.context.retryCount = 0;
                 } else {
-                    result.delayMs = inputs.retryBackoffMs * result.context.retryCount;
+                    scheduleRetry(result.context, inputs, result.context.retryCount);
                 }
             }
             break;
 
         case ERROR_STATE:
+            if (!retryDue(result.context, inputs.currentMillis)) break;
+            result.context.backingOff = false;
             if (!inputs.wifiConnected) {
                 result.context.state = CONNECTING_WIFI;
                 result.context.retryCount = 0;
@@ -109,14 +139,31 @@ TickResult tick(const Context& ctx, const Inputs& inputs) {
             } else if (!inputs.autoDJActive) {
                 result.context.state = IDLE;
                 result.context.retryCount = 0;
+            } else {
+                scheduleRetry(result.context, inputs, 1); // check again later
             }
-            result.delayMs = inputs.retryBackoffMs;
             break;
     }
 
+    // ERROR_STATE is entered backing off, so it is not left straight away
+    if (result.context.state == ERROR_STATE && ctx.state != ERROR_STATE) {
+        scheduleRetry(result.context, inputs, 1);
+    }
+
     return result;
 }
 
+bool retryDue(const Context& ctx, unsigned long nowMs) {
+    return !ctx.backingOff || (long)(nowMs - ctx.retryAt) >= 0;
+}
+
+State reconnectState(int radioShowID, bool autoDJActive) {
+    if (radioShowID > 0) {
+        return autoDJActive ? AUTO_DJ_ACTIVE : ENDING_SHOW;
+    }
+    return autoDJActive ? STARTING_SHOW : IDLE;
+}
+
 const char* stateName(State s) {
     switch (s) {
         case BOOTING:         return "BOOTING";
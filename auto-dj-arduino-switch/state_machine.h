@@ -23,6 +23,8 @@ struct Context {
     int radioShowID;
     int retryCount;
     unsigned long lastPollTime;
+    bool backingOff;           // waiting for retryAt before the next attempt
+    unsigned long retryAt;     // millis() deadline while backingOff
 };
 
 /**
@@ -40,16 +42,19 @@ struct Inputs {
     // I/O results (filled by orchestrator for the current state)
     int startShowResult;    // radioShowID or -1 on failure
     bool endShowResult;     // success?
-    bool pollNewTrack;      // new track detected?
+    // > 0 while the flowsheet's circuit breaker refuses requests: startShow or
+    // endShow was not attempted, and a probe goes through this many ms later
+    unsigned long breakerWaitMs;
+    bool pollNewTrack;      // new track detected? (STARTING_SHOW: a warm track to log at once)
     bool pollLiveDJ;        // live DJ streaming?
-    String artist;
-    String title;
-    String album;
+    int pollShId;           // the new track's sh_id; its metadata stays in the source's slot
 
     // Config constants (avoids #define dependency in pure code)
     unsigned long pollIntervalMs;
     int maxRetries;
-    unsigned long retryBackoffMs;
+    unsigned long retryBackoffMs;    // first retry's backoff ceiling
+    unsigned long retryBackoffMaxMs; // cap on the doubled ceiling
+    unsigned long jitter;            // random value for backoffDelayMs()
 };
 
 /**
@@ -61,11 +66,7 @@ struct TickResult {
     // Post-transition actions for the orchestrator
     bool addEntry;
     unsigned long addEntryHourMs;
-    String addEntryArtist;
-    String addEntryTitle;
-    String addEntryAlbum;
-
-    unsigned long delayMs;
+    int addEntryShId;       // the track to post, read from the source at post time
 };
 
 /**
@@ -75,6 +76,23 @@ struct TickResult {
  */
 TickResult tick(const Context& ctx, const Inputs& inputs);
 
+/**
+ * Whether a backoff started by tick() has run out, so the orchestrator may
+ * make the state's next attempt (startShow, endShow). tick() ignores the
+ * I/O results of a state that is still backing off, and the loop keeps
+ * running -- relay monitoring, polling, logging -- while it waits.
+ */
+bool retryDue(const Context& ctx, unsigned long nowMs);
+
+/**
+ * Where CONNECTING_WIFI goes once a link is up, decided by the relay level
+ * rather than by a change event, since the relay may have moved while the
+ * device was offline or powered down: an open show is resumed if auto DJ is
+ * still active and signed off if not; with no open show, one is started if
+ * auto DJ is active.
+ */
+State reconnectState(int radioShowID, bool autoDJActive);
+
 /**
  * Returns a human-readable name for the given state.
  */
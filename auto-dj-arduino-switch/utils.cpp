@@ -1,5 +1,9 @@
 #include "utils.h"
 
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
 String urlEncode(const String& str) {
     String encoded;
     encoded.reserve(str.length() * 2);
@@ -19,23 +23,22 @@ String urlEncode(const String& str) {
 }
 
 int parseRadioShowID(const String& location) {
-    int idx = location.indexOf("radioShowID=");
-    if (idx < 0) {
-        return -1;
-    }
+    return parseRadioShowID(location.c_str());
+}
 
-    String idStr = location.substring(idx + 12); // length of "radioShowID="
-    int ampIdx = idStr.indexOf('&');
-    if (ampIdx >= 0) {
-        idStr = idStr.substring(0, ampIdx);
+int parseRadioShowID(const char* location) {
+    const char* param = strstr(location, "radioShowID=");
+    if (!param) {
+        return -1;
     }
 
-    int radioShowID = idStr.toInt();
-    if (radioShowID <= 0) {
+    // Same as String::toInt() on the value up to the next '&'
+    long radioShowID = atol(param + 12); // length of "radioShowID="
+    if (radioShowID <= 0 || radioShowID > INT_MAX) {
         return -1;
     }
 
-    return radioShowID;
+    return (int)radioShowID;
 }
 
 unsigned long currentHourMs(unsigned long epochSeconds) {
@@ -16,6 +16,7 @@ String urlEncode(const String& str);
  * Returns the ID, or -1 if not found or not a valid positive integer.
  */
 int parseRadioShowID(const String& location);
+int parseRadioShowID(const char* location);
 
 /**
  * Truncates an epoch-seconds value to the hour boundary and converts to milliseconds.
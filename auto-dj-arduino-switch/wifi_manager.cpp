@@ -1,4 +1,7 @@
 #include "wifi_manager.h"
+#include "config.h"
+#include "log_buffer.h"
+#include "stall_detector.h"
 
 WifiManager::WifiManager(const char* ssid, const char* password, unsigned long retryIntervalMs)
     : ssid(ssid)
@@ -10,28 +13,32 @@ WifiManager::WifiManager(const char* ssid, const char* password, unsigned long r
 }
 
 void WifiManager::setUp() {
-    Serial.print("[WiFi] MAC address: ");
-    Serial.println(WiFi.macAddress());
-    Serial.print("[WiFi] Connecting to ");
-    Serial.print(ssid);
-    Serial.print("...");
+    StallScope stallScope(STALL_RECONNECT);
+    serialLog.print("[WiFi] MAC address: ");
+    serialLog.println(WiFi.macAddress());
+    serialLog.print("[WiFi] Connecting to ");
+    serialLog.print(ssid);
+    serialLog.print("...");
 
+    WiFi.setTimeout(WIFI_CONNECT_TIMEOUT_MS);
     WiFi.begin(ssid, password);
+    feedWatchdog();
 
     // Block until connected on initial setup
     unsigned long start = millis();
     while (WiFi.status() != WL_CONNECTED) {
         delay(500);
-        Serial.print(".");
+        feedWatchdog();
+        serialLog.print(".");
         if (millis() - start > 30000) {
-            Serial.println(" timeout.");
+            serialLog.println(" timeout.");
             return;
         }
     }
 
-    Serial.println(" connected.");
-    Serial.print("[WiFi] IP: ");
-    Serial.println(WiFi.localIP());
+    serialLog.println(" connected.");
+    serialLog.print("[WiFi] IP: ");
+    serialLog.println(WiFi.localIP().toString());
     wasConnected = true;
 }
 
@@ -39,13 +46,14 @@ void WifiManager::update() {
     bool connected = (WiFi.status() == WL_CONNECTED);
 
     if (wasConnected && !connected) {
-        Serial.println("[WiFi] Connection lost.");
+        serialLog.println("[WiFi] Connection lost.");
         wasConnected = false;
     }
 
     if (!connected && (millis() - lastRetryTime > retryIntervalMs)) {
         lastRetryTime = millis();
-        Serial.print("[WiFi] Reconnecting...");
+        StallScope stallScope(STALL_RECONNECT);
+        serialLog.print("[WiFi] Reconnecting...");
         WiFi.disconnect();
         delay(100);
         WiFi.begin(ssid, password);
@@ -57,12 +65,12 @@ void WifiManager::update() {
         }
 
         if (WiFi.status() == WL_CONNECTED) {
-            Serial.println(" reconnected.");
-            Serial.print("[WiFi] IP: ");
-            Serial.println(WiFi.localIP());
+            serialLog.println(" reconnected.");
+            serialLog.print("[WiFi] IP: ");
+            serialLog.println(WiFi.localIP().toString());
             wasConnected = true;
         } else {
-            Serial.println(" still disconnected.");
+            serialLog.println(" still disconnected.");
         }
     }
 }
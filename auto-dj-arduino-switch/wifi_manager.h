@@ -7,8 +7,9 @@
 /**
  * Manages WiFi connection with automatic reconnection.
  *
- * Note: WiFi.begin() blocks for ~36 seconds on reconnection (known Giga R1
- * limitation). The state machine in the main sketch should account for this.
+ * Note: WiFi.begin() blocks for ~36 seconds on reconnection by default
+ * (known Giga R1 limitation), longer than the watchdog allows; setUp()
+ * bounds it to WIFI_CONNECT_TIMEOUT_MS.
  */
 class WifiManager {
 public:
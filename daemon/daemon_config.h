@@ -0,0 +1,15 @@
+#ifndef DAEMON_CONFIG_H
+#define DAEMON_CONFIG_H
+
+// ========== Daemon Configuration ==========
+// Timing and protocol settings shared with the sketch come from config.h.
+
+#define DAEMON_STEP_MS 100                // Station loop() period; > DEBOUNCE_MAX_MS, so a change is settled by the next step
+#define DAEMON_TASK_STACK_BYTES 262144    // Reserved per station; a few KB are touched
+#define DAEMON_READ_WAIT_MS 100           // Longest a client read parks before rechecking timeouts
+#define DAEMON_DNS_TTL_MS 300000UL        // Resolved addresses are reused this long
+#define DAEMON_SHUTDOWN_MS 15000          // Grace period for in-flight requests on SIGTERM
+#define DAEMON_RX_BUFFER 4096             // Per-connection receive buffer
+#define DAEMON_PIN_BASE 100               // Virtual pins: station i uses BASE + 2i (relay), +1 (LED)
+
+#endif
@@ -0,0 +1,247 @@
+#include "event_loop.h"
+
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#define EVENT_LOOP_MAX_EVENTS 64
+
+static thread_local Task* runningTask = nullptr;
+
+// ========== Task ==========
+
+Task::Task(size_t stackSize)
+    : loop(nullptr)
+    , stack(nullptr)
+    , stackBytes(0)
+    , started(false)
+    , done(false)
+    , stopping(false)
+    , queued(false)
+    , interruptible(false)
+    , wokeOnIo(false)
+    , waitSeq(0)
+{
+    // Reserved, not committed: a station touches a few KB of it. The lowest
+    // page is a guard, so an overflow faults instead of corrupting a neighbour.
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    stackBytes = (stackSize + page - 1) / page * page + page;
+    void* p = mmap(nullptr, stackBytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if (p == MAP_FAILED) {
+        stackBytes = 0;
+        return;
+    }
+    mprotect(p, page, PROT_NONE);
+    stack = p;
+}
+
+Task::~Task() {
+    if (stack) munmap(stack, stackBytes);
+}
+
+Task* Task::current() {
+    return runningTask;
+}
+
+void Task::trampoline(unsigned int hi, unsigned int lo) {
+    Task* task = reinterpret_cast<Task*>(((uintptr_t)hi << 32) | (uintptr_t)lo);
+    task->run();
+    task->done = true;
+    // Returning resumes uc_link, the loop
+}
+
+void Task::ready(uint32_t) {
+    wokeOnIo = true;
+    loop->schedule(*this);
+}
+
+void Task::suspend() {
+    swapcontext(&context, &loop->loopContext);
+}
+
+bool Task::wait(int fd, uint32_t events, unsigned long timeoutMs) {
+    epoll_event ev = {};
+    ev.events = events;
+    ev.data.ptr = static_cast<Watcher*>(this);
+    if (epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) return false;
+
+    wokeOnIo = false;
+    interruptible = false;
+    loop->timers.push(EventLoop::Timer{EventLoop::now() + timeoutMs, ++waitSeq, this});
+    suspend();
+    waitSeq++;
+
+    epoll_ctl(loop->epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    return wokeOnIo;
+}
+
+void Task::sleep(unsigned long ms, bool canWake) {
+    interruptible = canWake;
+    loop->timers.push(EventLoop::Timer{EventLoop::now() + ms, ++waitSeq, this});
+    suspend();
+    waitSeq++;
+    interruptible = false;
+}
+
+// ========== Event Loop ==========
+
+EventLoop::EventLoop()
+    : epollFd(epoll_create1(EPOLL_CLOEXEC))
+    , stopFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    , running(false)
+    , counters{0, 0}
+{
+    if (epollFd >= 0 && stopFd >= 0) {
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr; // marks the stop eventfd
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, stopFd, &ev);
+    }
+}
+
+EventLoop::~EventLoop() {
+    if (stopFd >= 0) close(stopFd);
+    if (epollFd >= 0) close(epollFd);
+}
+
+unsigned long EventLoop::now() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)ts.tv_sec * 1000UL + (unsigned long)(ts.tv_nsec / 1000000);
+}
+
+void EventLoop::start(Task& task) {
+    if (task.started || !task.stack) return;
+    task.loop = this;
+    task.started = true;
+    getcontext(&task.context);
+    task.context.uc_stack.ss_sp = task.stack;
+    task.context.uc_stack.ss_size = task.stackBytes;
+    task.context.uc_link = &loopContext;
+    uintptr_t p = reinterpret_cast<uintptr_t>(&task);
+    makecontext(&task.context, (void (*)())Task::trampoline, 2,
+                (unsigned int)(p >> 32), (unsigned int)p);
+    tasks.push_back(&task);
+    schedule(task);
+}
+
+bool EventLoop::watch(int fd, uint32_t events, Watcher& watcher) {
+    epoll_event ev = {};
+    ev.events = events;
+    ev.data.ptr = &watcher;
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+void EventLoop::unwatch(int fd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+void EventLoop::wake(Task& task) {
+    if (task.interruptible) schedule(task);
+}
+
+void EventLoop::schedule(Task& task) {
+    if (task.queued || task.done) return;
+    task.queued = true;
+    runnable.push_back(&task);
+}
+
+void EventLoop::resume(Task& task) {
+    task.queued = false;
+    if (task.done) return;
+    runningTask = &task;
+    task.enter();
+    swapcontext(&loopContext, &task.context);
+    task.leave();
+    runningTask = nullptr;
+    counters.switches++;
+    if (task.done) forget(task);
+}
+
+/**
+ * Drops a finished task's leftover timers, so it can be destroyed.
+ */
+void EventLoop::forget(Task& task) {
+    for (size_t i = 0; i < tasks.size(); i++) {
+        if (tasks[i] == &task) {
+            tasks.erase(tasks.begin() + i);
+            break;
+        }
+    }
+    std::priority_queue<Timer> kept;
+    while (!timers.empty()) {
+        if (timers.top().task != &task) kept.push(timers.top());
+        timers.pop();
+    }
+    timers.swap(kept);
+}
+
+int EventLoop::nextTimeoutMs() {
+    if (!runnable.empty()) return 0;
+    if (timers.empty()) return -1;
+    long remaining = (long)(timers.top().deadline - now());
+    return remaining > 0 ? (int)remaining : 0;
+}
+
+void EventLoop::pass(int timeoutMs) {
+    epoll_event events[EVENT_LOOP_MAX_EVENTS];
+    int n = epoll_wait(epollFd, events, EVENT_LOOP_MAX_EVENTS, timeoutMs);
+    counters.passes++;
+    for (int i = 0; i < n; i++) {
+        Watcher* watcher = static_cast<Watcher*>(events[i].data.ptr);
+        if (!watcher) {
+            uint64_t count;
+            ssize_t r = read(stopFd, &count, sizeof(count));
+            (void)r;
+            running = false;
+            continue;
+        }
+        watcher->ready(events[i].events);
+    }
+
+    unsigned long t = now();
+    while (!timers.empty() && (long)(t - timers.top().deadline) >= 0) {
+        Timer timer = timers.top();
+        timers.pop();
+        if (timer.task->waitSeq == timer.seq) schedule(*timer.task);
+    }
+
+    // Only the tasks runnable now; ones they make runnable wait a pass
+    size_t count = runnable.size();
+    while (count-- > 0) {
+        Task* task = runnable.front();
+        runnable.pop_front();
+        resume(*task);
+    }
+}
+
+void EventLoop::run() {
+    running = true;
+    while (running) pass(nextTimeoutMs());
+}
+
+bool EventLoop::shutdown(unsigned long timeoutMs) {
+    for (Task* task : tasks) {
+        task->requestStop();
+        wake(*task);
+    }
+    unsigned long start = now();
+    for (;;) {
+        if (tasks.empty()) return true;
+        if (now() - start >= timeoutMs) return false;
+        int timeout = nextTimeoutMs();
+        long left = (long)(timeoutMs - (now() - start));
+        if (timeout < 0 || timeout > left) timeout = (int)left;
+        pass(timeout);
+    }
+}
+
+void EventLoop::stop() {
+    uint64_t one = 1;
+    ssize_t r = write(stopFd, &one, sizeof(one));
+    (void)r;
+}
@@ -0,0 +1,171 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <ucontext.h>
+
+#include <deque>
+#include <queue>
+#include <vector>
+
+class EventLoop;
+
+/**
+ * Receives readiness events for a file descriptor registered with
+ * EventLoop::watch().
+ */
+class Watcher {
+public:
+    virtual ~Watcher() {}
+    virtual void ready(uint32_t events) = 0;
+};
+
+/**
+ * A cooperatively scheduled thread of control with its own stack.
+ *
+ * Code running in a task blocks through wait() and sleep(), which switch
+ * back to the loop until the descriptor is ready or the time is up. To the
+ * sketch code a station runs (its clients block in delay() and in
+ * PosixClient reads), these look like ordinary blocking calls, so it runs
+ * unchanged while hundreds of stations share one thread.
+ */
+class Task : public Watcher {
+public:
+    explicit Task(size_t stackSize);
+    virtual ~Task();
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    /** The task running now, or nullptr when on the loop itself. */
+    static Task* current();
+
+    /**
+     * Waits until fd reports any of `events` (EPOLLIN, EPOLLOUT) or timeoutMs
+     * passes. Returns true if the descriptor became ready. Must be called
+     * from this task.
+     */
+    bool wait(int fd, uint32_t events, unsigned long timeoutMs);
+
+    /**
+     * Sleeps for ms. An interruptible sleep ends early on EventLoop::wake().
+     * Must be called from this task.
+     */
+    void sleep(unsigned long ms, bool interruptible = false);
+
+    /** Asks run() to return; it is expected to check stopRequested(). */
+    void requestStop() { stopping = true; }
+    bool stopRequested() const { return stopping; }
+    bool finished() const { return done; }
+
+protected:
+    virtual void run() = 0;
+
+    /** Hooks around every switch into and out of the task (on the loop side). */
+    virtual void enter() {}
+    virtual void leave() {}
+
+private:
+    friend class EventLoop;
+
+    EventLoop* loop;
+    ucontext_t context;
+    void* stack;
+    size_t stackBytes;
+    bool started;
+    bool done;
+    bool stopping;
+    bool queued;
+    bool interruptible;
+    bool wokeOnIo;
+    unsigned long waitSeq; // bumped per wait, so a stale timer is ignored
+
+    void ready(uint32_t events) override;
+    void suspend();
+    static void trampoline(unsigned int hi, unsigned int lo);
+};
+
+/**
+ * A single-threaded epoll loop that runs Tasks and Watchers.
+ *
+ * Each pass collects epoll events and expired timers, then resumes every
+ * task that became runnable once, in the order they did. Timers live in a
+ * heap whose nearest deadline is the epoll_wait timeout. stop() may be
+ * called from any thread (it writes an eventfd); everything else belongs to
+ * the loop's thread.
+ */
+class EventLoop {
+public:
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    /** False if the epoll or eventfd descriptor could not be created. */
+    bool isValid() const { return epollFd >= 0 && stopFd >= 0; }
+
+    /**
+     * Schedules a task's first run. The loop lets go of a task once run()
+     * returns; it must not be destroyed before then.
+     */
+    void start(Task& task);
+
+    /** Registers a long-lived descriptor (a live source, a signalfd). */
+    bool watch(int fd, uint32_t events, Watcher& watcher);
+    void unwatch(int fd);
+
+    /** Ends an interruptible sleep() early; does nothing otherwise. */
+    void wake(Task& task);
+
+    /** Runs until stop(). */
+    void run();
+
+    /**
+     * Asks every started task to stop and runs until they have all returned,
+     * or timeoutMs passes. Returns true if they all did.
+     */
+    bool shutdown(unsigned long timeoutMs);
+
+    /** Makes run() return after the current pass. Safe from any thread. */
+    void stop();
+
+    /** Monotonic milliseconds; the daemon's millis() reads the same clock. */
+    static unsigned long now();
+
+    struct Stats {
+        unsigned long passes;   // epoll_wait returns
+        unsigned long switches; // task resumptions
+    };
+    Stats stats() const { return counters; }
+
+private:
+    friend class Task;
+
+    struct Timer {
+        unsigned long deadline;
+        unsigned long seq;
+        Task* task;
+        bool operator<(const Timer& other) const {
+            return (long)(deadline - other.deadline) > 0; // min-heap
+        }
+    };
+
+    int epollFd;
+    int stopFd;
+    bool running;
+    ucontext_t loopContext;
+    std::deque<Task*> runnable;
+    std::priority_queue<Timer> timers;
+    std::vector<Task*> tasks; // started and not finished
+    Stats counters;
+
+    void schedule(Task& task);
+    void resume(Task& task);
+    void forget(Task& task);
+    void pass(int timeoutMs);
+    int nextTimeoutMs();
+};
+
+#endif
@@ -0,0 +1,53 @@
+#include "file_flash_region.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <vector>
+
+FileFlashRegion::FileFlashRegion(size_t sectorSize, int sectorCount)
+    : fd(-1)
+    , sectorBytes(sectorSize)
+    , sectors(sectorCount)
+{
+}
+
+FileFlashRegion::~FileFlashRegion() {
+    if (fd >= 0) close(fd);
+}
+
+bool FileFlashRegion::open(const std::string& path) {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) return false;
+    if ((size_t)st.st_size < sectorBytes * sectors) {
+        // Extend with erased bytes; any existing prefix is kept
+        std::vector<uint8_t> erased(sectorBytes * sectors - st.st_size, 0xFF);
+        if (pwrite(fd, erased.data(), erased.size(), st.st_size) != (ssize_t)erased.size()) return false;
+    }
+    return true;
+}
+
+bool FileFlashRegion::inRange(size_t offset, size_t len) const {
+    return fd >= 0 && offset <= sectorBytes * sectors && len <= sectorBytes * sectors - offset;
+}
+
+bool FileFlashRegion::read(size_t offset, void* buf, size_t len) {
+    return inRange(offset, len) && pread(fd, buf, len, offset) == (ssize_t)len;
+}
+
+bool FileFlashRegion::program(size_t offset, const void* data, size_t len) {
+    std::vector<uint8_t> bytes(len);
+    if (!read(offset, bytes.data(), len)) return false;
+    const uint8_t* in = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; i++) bytes[i] &= in[i];
+    return pwrite(fd, bytes.data(), len, offset) == (ssize_t)len;
+}
+
+bool FileFlashRegion::erase(int sector) {
+    if (sector < 0 || sector >= sectors || fd < 0) return false;
+    std::vector<uint8_t> erased(sectorBytes, 0xFF);
+    return pwrite(fd, erased.data(), sectorBytes, (off_t)sector * sectorBytes) == (ssize_t)sectorBytes;
+}
@@ -0,0 +1,36 @@
+#ifndef FILE_FLASH_REGION_H
+#define FILE_FLASH_REGION_H
+
+#include "checkpoint.h"
+
+#include <string>
+
+/**
+ * FlashRegion backed by a file, so a station's CheckpointStore survives a
+ * daemon restart the way the Giga's survives a reset. Keeps NOR semantics
+ * (programming ANDs into the existing bytes) so the store behaves exactly
+ * as on the board; a new file starts erased.
+ */
+class FileFlashRegion : public FlashRegion {
+public:
+    FileFlashRegion(size_t sectorSize, int sectorCount);
+    ~FileFlashRegion();
+
+    /** Opens or creates the file. Returns false if it cannot. */
+    bool open(const std::string& path);
+
+    size_t sectorSize() const { return sectorBytes; }
+    int sectorCount() const { return sectors; }
+    bool read(size_t offset, void* buf, size_t len);
+    bool program(size_t offset, const void* data, size_t len);
+    bool erase(int sector);
+
+private:
+    int fd;
+    size_t sectorBytes;
+    int sectors;
+
+    bool inRange(size_t offset, size_t len) const;
+};
+
+#endif
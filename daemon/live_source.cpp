@@ -0,0 +1,293 @@
+#include "live_source.h"
+#include "posix_runtime.h"
+
+#include <Arduino.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define LIVE_VALUE_MAX 64 // Bytes of a live file read
+
+// ========== LiveSource ==========
+
+LiveSource::LiveSource(int pin)
+    : loop(nullptr)
+    , pin(pin)
+    , listener(nullptr)
+{
+}
+
+void LiveSource::setLevel(int level) {
+    if (runtime::pinLevel(pin) == level) return;
+    runtime::setPinLevel(pin, level);
+    if (loop && listener) loop->wake(*listener);
+}
+
+void LiveSource::setAutoDJActive(bool active) {
+    setLevel(active ? LOW : HIGH);
+}
+
+bool parseLiveValue(const char* text, size_t len, bool* active) {
+    while (len > 0 && isspace((unsigned char)*text)) {
+        text++;
+        len--;
+    }
+    while (len > 0 && isspace((unsigned char)text[len - 1])) len--;
+
+    if ((len == 1 && *text == '1') || (len == 2 && strncasecmp(text, "on", 2) == 0)) {
+        *active = true;
+        return true;
+    }
+    if ((len == 1 && *text == '0') || (len == 3 && strncasecmp(text, "off", 3) == 0)) {
+        *active = false;
+        return true;
+    }
+    return false;
+}
+
+// ========== Files ==========
+
+FileWatcher::FileWatcher()
+    : fd(-1)
+{
+}
+
+FileWatcher::~FileWatcher() {
+    if (fd >= 0) close(fd);
+}
+
+bool FileWatcher::add(EventLoop& loop, const std::string& path, FileLiveSource& source) {
+    if (fd < 0) {
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0 || !loop.watch(fd, EPOLLIN, *this)) return false;
+    }
+    size_t slash = path.rfind('/');
+    std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO);
+    if (wd < 0) return false;
+    directories[wd] = directory;
+    sources.insert(std::make_pair(path, &source));
+    return true;
+}
+
+void FileWatcher::remove(FileLiveSource& source) {
+    for (auto it = sources.begin(); it != sources.end();) {
+        it = it->second == &source ? sources.erase(it) : std::next(it);
+    }
+}
+
+void FileWatcher::ready(uint32_t) {
+    alignas(inotify_event) char buf[4096];
+    for (;;) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0) return;
+        for (char* p = buf; p < buf + n;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+            p += sizeof(inotify_event) + event->len;
+            auto dir = directories.find(event->wd);
+            if (dir == directories.end() || event->len == 0) continue;
+            std::string path = dir->second == "/" ? "/" : dir->second + "/";
+            path += event->name;
+            auto range = sources.equal_range(path);
+            for (auto it = range.first; it != range.second; ++it) it->second->reload();
+        }
+    }
+}
+
+FileLiveSource::FileLiveSource(int pin, const std::string& path, FileWatcher& files)
+    : LiveSource(pin)
+    , path(path)
+    , files(files)
+{
+}
+
+FileLiveSource::~FileLiveSource() {
+    files.remove(*this);
+}
+
+bool FileLiveSource::open(EventLoop& eventLoop, std::string* error) {
+    loop = &eventLoop;
+    if (!files.add(eventLoop, path, *this)) {
+        *error = "cannot watch " + path + ": " + strerror(errno);
+        return false;
+    }
+    reload();
+    return true;
+}
+
+void FileLiveSource::reload() {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    char text[LIVE_VALUE_MAX];
+    ssize_t n = read(fd, text, sizeof(text));
+    close(fd);
+    bool active;
+    if (n > 0 && parseLiveValue(text, (size_t)n, &active)) setAutoDJActive(active);
+}
+
+// ========== Sockets ==========
+
+SocketLiveSource::SocketLiveSource(int pin, const std::string& path)
+    : LiveSource(pin)
+    , path(path)
+    , listenFd(-1)
+{
+}
+
+SocketLiveSource::~SocketLiveSource() {
+    peers.clear();
+    if (listenFd >= 0) {
+        close(listenFd);
+        unlink(path.c_str());
+    }
+}
+
+bool SocketLiveSource::open(EventLoop& eventLoop, std::string* error) {
+    loop = &eventLoop;
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        *error = path + ": socket path too long";
+        return false;
+    }
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    unlink(path.c_str()); // left over from an earlier run
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0 || bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+        || listen(listenFd, 8) != 0 || !eventLoop.watch(listenFd, EPOLLIN, *this)) {
+        *error = "cannot listen on " + path + ": " + strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+void SocketLiveSource::ready(uint32_t) {
+    for (;;) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+        peers.emplace_back(new Peer(*this, fd));
+        if (!loop->watch(fd, EPOLLIN, *peers.back())) peers.pop_back();
+    }
+}
+
+void SocketLiveSource::drop(Peer* peer) {
+    for (size_t i = 0; i < peers.size(); i++) {
+        if (peers[i].get() == peer) {
+            peers.erase(peers.begin() + i);
+            return;
+        }
+    }
+}
+
+SocketLiveSource::Peer::~Peer() {
+    owner.loop->unwatch(fd);
+    close(fd);
+}
+
+void SocketLiveSource::Peer::ready(uint32_t) {
+    char buf[64];
+    for (;;) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n > 0) {
+            for (ssize_t i = 0; i < n; i++) {
+                if (buf[i] == '1' || buf[i] == '0') owner.setAutoDJActive(buf[i] == '1');
+            }
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        owner.drop(this); // closed or failed; deletes this
+        return;
+    }
+}
+
+// ========== GPIO ==========
+
+GpioLiveSource::GpioLiveSource(int pin, const std::string& chip, unsigned line)
+    : LiveSource(pin)
+    , chip(chip)
+    , line(line)
+    , lineFd(-1)
+{
+}
+
+GpioLiveSource::~GpioLiveSource() {
+    if (lineFd >= 0) close(lineFd);
+}
+
+bool GpioLiveSource::open(EventLoop& eventLoop, std::string* error) {
+    loop = &eventLoop;
+    int chipFd = ::open(chip.c_str(), O_RDONLY | O_CLOEXEC);
+    if (chipFd < 0) {
+        *error = "cannot open " + chip + ": " + strerror(errno);
+        return false;
+    }
+
+    gpio_v2_line_request request = {};
+    request.offsets[0] = line;
+    request.num_lines = 1;
+    strncpy(request.consumer, "auto-dj", sizeof(request.consumer) - 1);
+    request.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING
+                         | GPIO_V2_LINE_FLAG_EDGE_FALLING | GPIO_V2_LINE_FLAG_BIAS_PULL_UP;
+    int r = ioctl(chipFd, GPIO_V2_GET_LINE_IOCTL, &request);
+    if (r != 0 && errno == EINVAL) {
+        // No bias support: rely on an external pull-up
+        request.config.flags &= ~(uint64_t)GPIO_V2_LINE_FLAG_BIAS_PULL_UP;
+        r = ioctl(chipFd, GPIO_V2_GET_LINE_IOCTL, &request);
+    }
+    int requestErrno = errno;
+    close(chipFd);
+    if (r != 0) {
+        *error = "cannot request " + chip + " line " + std::to_string(line) + ": " + strerror(requestErrno);
+        return false;
+    }
+
+    lineFd = request.fd;
+    fcntl(lineFd, F_SETFL, fcntl(lineFd, F_GETFL) | O_NONBLOCK);
+    if (!eventLoop.watch(lineFd, EPOLLIN, *this)) {
+        *error = "cannot watch " + chip + ": " + strerror(errno);
+        return false;
+    }
+    readLevel();
+    return true;
+}
+
+void GpioLiveSource::ready(uint32_t) {
+    // The events only say that something changed; the current value is
+    // what matters, so drain them and read it
+    gpio_v2_line_event events[16];
+    while (read(lineFd, events, sizeof(events)) > 0) {}
+    readLevel();
+}
+
+void GpioLiveSource::readLevel() {
+    gpio_v2_line_values values = {};
+    values.mask = 1;
+    if (ioctl(lineFd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) == 0) {
+        setLevel((values.bits & 1) ? HIGH : LOW);
+    }
+}
+
+// ========== Factory ==========
+
+std::unique_ptr<LiveSource> makeLiveSource(const StationConfig& config, int pin,
+                                           FileWatcher& files) {
+    switch (config.liveKind) {
+        case LIVE_FILE:
+            return std::unique_ptr<LiveSource>(new FileLiveSource(pin, config.livePath, files));
+        case LIVE_SOCKET:
+            return std::unique_ptr<LiveSource>(new SocketLiveSource(pin, config.livePath));
+        case LIVE_GPIO:
+            return std::unique_ptr<LiveSource>(new GpioLiveSource(pin, config.livePath, config.gpioLine));
+    }
+    return nullptr;
+}
@@ -0,0 +1,148 @@
+#ifndef LIVE_SOURCE_H
+#define LIVE_SOURCE_H
+
+#include "event_loop.h"
+#include "station_config.h"
+
+#include <stddef.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * A station's live signal. The source drives the station's virtual relay
+ * pin (runtime::setPinLevel()) with the level the Giga would read -- LOW
+ * while auto DJ is active -- so the station's RelayMonitor debounces it
+ * exactly as on the board. A change also wakes the station from its idle
+ * sleep, so it is seen within a step rather than at the next one.
+ */
+class LiveSource {
+public:
+    explicit LiveSource(int pin);
+    virtual ~LiveSource() {}
+
+    /**
+     * Starts watching the source. Returns false, with the reason in `error`,
+     * if it cannot be opened.
+     */
+    virtual bool open(EventLoop& loop, std::string* error) = 0;
+
+    /** The task to wake on a change (the station). */
+    void setListener(Task& task) { listener = &task; }
+
+protected:
+    EventLoop* loop;
+
+    void setLevel(int level);
+    void setAutoDJActive(bool active);
+
+private:
+    int pin;
+    Task* listener;
+};
+
+/**
+ * Parses a file's or message's text as a live value: "1" or "on" for auto
+ * DJ active, "0" or "off" for not, ignoring surrounding whitespace and
+ * case. Returns false for anything else.
+ */
+bool parseLiveValue(const char* text, size_t len, bool* active);
+
+class FileLiveSource;
+
+/**
+ * One inotify instance for every file source (the per-user instance limit
+ * is far below the number of stations). Watches each file's directory, so
+ * a file replaced by rename is seen as well as one rewritten in place.
+ */
+class FileWatcher : public Watcher {
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    bool add(EventLoop& loop, const std::string& path, FileLiveSource& source);
+    void remove(FileLiveSource& source);
+    void ready(uint32_t events) override;
+
+private:
+    int fd;
+    std::map<int, std::string> directories; // watch descriptor -> directory
+    std::multimap<std::string, FileLiveSource*> sources; // by path
+};
+
+/** A file holding the live value (see parseLiveValue()). */
+class FileLiveSource : public LiveSource {
+public:
+    FileLiveSource(int pin, const std::string& path, FileWatcher& files);
+    ~FileLiveSource();
+
+    bool open(EventLoop& loop, std::string* error) override;
+
+    /** Re-reads the file; an unreadable or unparseable one keeps the level. */
+    void reload();
+
+private:
+    std::string path;
+    FileWatcher& files;
+};
+
+/**
+ * A Unix stream socket the daemon listens on. Any number of peers may
+ * connect; each '1' or '0' byte one writes sets the level (other bytes are
+ * ignored), so `echo 1 | socat - UNIX-CONNECT:PATH` works as well as a
+ * long-lived connection from a controller.
+ */
+class SocketLiveSource : public LiveSource, public Watcher {
+public:
+    SocketLiveSource(int pin, const std::string& path);
+    ~SocketLiveSource();
+
+    bool open(EventLoop& loop, std::string* error) override;
+    void ready(uint32_t events) override; // accept
+
+private:
+    class Peer : public Watcher {
+    public:
+        Peer(SocketLiveSource& owner, int fd) : owner(owner), fd(fd) {}
+        ~Peer();
+        void ready(uint32_t events) override;
+
+    private:
+        SocketLiveSource& owner;
+        int fd;
+    };
+
+    std::string path;
+    int listenFd;
+    std::vector<std::unique_ptr<Peer>> peers;
+
+    void drop(Peer* peer);
+};
+
+/**
+ * A GPIO line through the character device (uAPI v2), requested as an
+ * input with both edges reported and the pull-up enabled where the chip
+ * supports bias. The raw line level is the relay pin level.
+ */
+class GpioLiveSource : public LiveSource, public Watcher {
+public:
+    GpioLiveSource(int pin, const std::string& chip, unsigned line);
+    ~GpioLiveSource();
+
+    bool open(EventLoop& loop, std::string* error) override;
+    void ready(uint32_t events) override;
+
+private:
+    std::string chip;
+    unsigned line;
+    int lineFd;
+
+    void readLevel();
+};
+
+/** The source a station's configuration names, driving `pin`. */
+std::unique_ptr<LiveSource> makeLiveSource(const StationConfig& config, int pin,
+                                           FileWatcher& files);
+
+#endif
@@ -0,0 +1,138 @@
+/**
+ * auto-dj-daemon: the switch logic as a Linux service, for streams whose
+ * live signal is a file, a socket or a GPIO line rather than the mixing
+ * board relay. Runs one Station per line of the station list over a single
+ * epoll loop. See the README, "Linux daemon".
+ *
+ *   auto-dj-daemon [-s STATE_DIR] STATIONS_FILE
+ *
+ * STATE_DIR holds each station's checkpoint, so open shows are resumed
+ * across restarts. SIGINT and SIGTERM stop the daemon after in-flight
+ * requests finish (up to DAEMON_SHUTDOWN_MS).
+ */
+#include "daemon_config.h"
+#include "event_loop.h"
+#include "live_source.h"
+#include "nowplaying_feed.h"
+#include "station.h"
+#include "station_config.h"
+
+#include <Arduino.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+class SignalWatcher : public Watcher {
+public:
+    SignalWatcher(EventLoop& loop, int fd) : loop(loop), fd(fd) {}
+    void ready(uint32_t) override {
+        signalfd_siginfo info;
+        while (read(fd, &info, sizeof(info)) == (ssize_t)sizeof(info)) {}
+        loop.stop();
+    }
+
+private:
+    EventLoop& loop;
+    int fd;
+};
+
+int usage() {
+    fprintf(stderr, "usage: auto-dj-daemon [-s STATE_DIR] STATIONS_FILE\n");
+    return 2;
+}
+
+// Each station holds a socket and possibly a live source open; lift the
+// soft descriptor limit to the hard one rather than fail at a few hundred
+void raiseFileLimit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* stateDir = nullptr;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:")) != -1) {
+        if (opt != 's') return usage();
+        stateDir = optarg;
+    }
+    if (optind != argc - 1) return usage();
+
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    signal(SIGPIPE, SIG_IGN);
+    raiseFileLimit();
+
+    std::vector<StationConfig> configs;
+    std::string error;
+    if (!loadStations(argv[optind], &configs, &error)) {
+        fprintf(stderr, "auto-dj-daemon: %s\n", error.c_str());
+        return 1;
+    }
+
+    EventLoop loop;
+    if (!loop.isValid()) {
+        fprintf(stderr, "auto-dj-daemon: cannot create event loop: %s\n", strerror(errno));
+        return 1;
+    }
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, nullptr);
+    int signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    SignalWatcher signalWatcher(loop, signalFd);
+    if (signalFd < 0 || !loop.watch(signalFd, EPOLLIN, signalWatcher)) {
+        fprintf(stderr, "auto-dj-daemon: cannot watch signals: %s\n", strerror(errno));
+        return 1;
+    }
+
+    FileWatcher files;
+    std::vector<std::unique_ptr<NowPlayingFeed>> feeds;
+    std::vector<std::unique_ptr<Station>> stations;
+    for (size_t i = 0; i < configs.size(); i++) {
+        stations.emplace_back(new Station(configs[i], (int)i, files, Serial));
+        if (!stations.back()->open(loop, stateDir, &error)) {
+            fprintf(stderr, "auto-dj-daemon: %s: %s\n", configs[i].name.c_str(), error.c_str());
+            return 1;
+        }
+        const Url& nowPlaying = configs[i].nowPlaying;
+        if (!nowPlaying.shortcode.empty()
+            && !stations.back()->follow(feedFor(feeds, nowPlaying, Serial))) {
+            fprintf(stderr, "auto-dj-daemon: %s: more than %d stations on one now playing feed\n",
+                    configs[i].name.c_str(), NOWPLAYING_FANOUT_MAX);
+            return 1;
+        }
+    }
+
+    Serial.print("[Daemon] Running ");
+    Serial.print((unsigned long)stations.size());
+    Serial.print(" stations, ");
+    Serial.print((unsigned long)feeds.size());
+    Serial.println(" shared now playing feeds.");
+    for (auto& feed : feeds) loop.start(*feed);
+    for (auto& station : stations) loop.start(*station);
+    loop.run();
+
+    Serial.println("[Daemon] Stopping...");
+    if (!loop.shutdown(DAEMON_SHUTDOWN_MS)) {
+        Serial.println("[Daemon] Some stations did not stop in time.");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,45 @@
+#include "nowplaying_feed.h"
+#include "config.h"
+#include "daemon_config.h"
+
+NowPlayingFeed::NowPlayingFeed(const Url& feedUrl, Print& logOutput)
+    : Task(DAEMON_TASK_STACK_BYTES)
+    , url(feedUrl)
+    , log(feedUrl.host + feedUrl.path, logOutput)
+    , network(LINK_FAILURE_THRESHOLD, LINK_COOLDOWN_MS, LINK_PREFERENCE_MS)
+    , feed(network, url.host.c_str(), url.port, url.path.c_str())
+{
+    transport.addEndpoint(url.host.c_str(), url.port, url.tls);
+}
+
+bool NowPlayingFeed::serves(const Url& other) const {
+    return other.tls == url.tls && other.host == url.host && other.port == url.port
+        && other.path == url.path;
+}
+
+void NowPlayingFeed::run() {
+    network.addTransport(transport);
+    network.setUp();
+    while (!stopRequested()) {
+        network.update();
+        feed.poll();
+        sleep(POLL_INTERVAL_MS, true);
+    }
+}
+
+void NowPlayingFeed::enter() {
+    log.enter();
+}
+
+void NowPlayingFeed::leave() {
+    log.leave();
+}
+
+NowPlayingFeed& feedFor(std::vector<std::unique_ptr<NowPlayingFeed>>& feeds, const Url& url,
+                        Print& logOutput) {
+    for (auto& feed : feeds) {
+        if (feed->serves(url)) return *feed;
+    }
+    feeds.emplace_back(new NowPlayingFeed(url, logOutput));
+    return *feeds.back();
+}
@@ -0,0 +1,51 @@
+#ifndef NOWPLAYING_FEED_H
+#define NOWPLAYING_FEED_H
+
+#include "azuracast_client.h"
+#include "event_loop.h"
+#include "network_manager.h"
+#include "posix_transport.h"
+#include "station_config.h"
+#include "task_log.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * One AzuraCast all-stations document, polled every POLL_INTERVAL_MS for
+ * all the stations that name it, as a Task of its own. Each following
+ * station's AzuraCastClient gets its track changes from the feed's
+ * NowPlayingFanout and no longer fetches anything, so adding a station to
+ * a feed adds no requests.
+ */
+class NowPlayingFeed : public Task {
+public:
+    NowPlayingFeed(const Url& url, Print& logOutput);
+
+    /** True if url names this feed's document (shortcode aside). */
+    bool serves(const Url& url) const;
+
+    NowPlayingFanout& fanout() { return feed; }
+
+protected:
+    void run() override;
+    void enter() override;
+    void leave() override;
+
+private:
+    Url url;
+    TaskLog log;
+    PosixTransport transport;
+    NetworkManager network;
+    NowPlayingFanout feed;
+};
+
+/**
+ * The feed in `feeds` serving url, created (with its log lines going to
+ * logOutput) if there is none yet.
+ */
+NowPlayingFeed& feedFor(std::vector<std::unique_ptr<NowPlayingFeed>>& feeds, const Url& url,
+                        Print& logOutput);
+
+#endif
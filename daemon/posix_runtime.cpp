@@ -0,0 +1,166 @@
+#include "posix_runtime.h"
+#include "config.h"
+#include "event_loop.h"
+#include "log_buffer.h"
+#include "mem_stats.h"
+#include "stall_detector.h"
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <vector>
+
+// ========== Clock ==========
+
+// The monotonic clock itself, not time since start: tick() takes a
+// lastPollTime of 0 to mean "poll now", which on a clock starting at zero
+// would hold off the first poll of a show started in the first interval.
+unsigned long millis() { return EventLoop::now(); }
+
+unsigned long micros() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)ts.tv_sec * 1000000UL + (unsigned long)(ts.tv_nsec / 1000);
+}
+
+void delay(unsigned long ms) {
+    Task* task = Task::current();
+    if (task) {
+        task->sleep(ms);
+        return;
+    }
+    timespec ts = {(time_t)(ms / 1000), (long)(ms % 1000) * 1000000L};
+    nanosleep(&ts, nullptr);
+}
+
+void delayMicroseconds(unsigned int us) {
+    timespec ts = {0, (long)us * 1000L};
+    nanosleep(&ts, nullptr);
+}
+
+void yield() {
+    Task* task = Task::current();
+    if (task) task->sleep(0);
+}
+
+// ========== Random ==========
+
+// One generator for every station, seeded per process, so stations that
+// fail together do not back off in step
+static bool randomSeeded = false;
+
+void randomSeed(unsigned long seed) {
+    srandom((unsigned)seed);
+    randomSeeded = true;
+}
+
+long random(long howbig) {
+    if (howbig <= 0) return 0;
+    if (!randomSeeded) randomSeed((unsigned long)micros() ^ (unsigned long)getpid());
+    return ::random() % howbig;
+}
+
+long random(long howsmall, long howbig) {
+    if (howsmall >= howbig) return howsmall;
+    return howsmall + random(howbig - howsmall);
+}
+
+// ========== GPIO ==========
+
+static std::vector<int> pinLevels;
+
+void runtime::setPinLevel(int pin, int level) {
+    if (pin < 0) return;
+    if ((size_t)pin >= pinLevels.size()) pinLevels.resize(pin + 1, HIGH);
+    pinLevels[pin] = level;
+}
+
+int runtime::pinLevel(int pin) {
+    return pin >= 0 && (size_t)pin < pinLevels.size() ? pinLevels[pin] : HIGH;
+}
+
+void pinMode(int, int) {}
+
+int digitalRead(int pin) { return runtime::pinLevel(pin); }
+
+void digitalWrite(int pin, int value) { runtime::setPinLevel(pin, value); }
+
+int analogRead(int) { return 0; }
+
+// ========== Stream ==========
+
+int Stream::timedRead() {
+    // PosixClient::read() already parks for data, so this only loops to
+    // enforce the stream timeout
+    unsigned long start = millis();
+    do {
+        int c = read();
+        if (c >= 0) return c;
+        if (exhausted()) return -1;
+        if (!Task::current()) delay(1);
+    } while (millis() - start < getTimeout());
+    return -1;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+    size_t n = 0;
+    while (n < length) {
+        int c = timedRead();
+        if (c < 0) break;
+        buffer[n++] = (char)c;
+    }
+    return n;
+}
+
+// ========== Serial ==========
+
+HardwareSerial Serial;
+
+void HardwareSerial::begin(unsigned long) {}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return fputc(c, stdout) == EOF ? 0 : 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t size) {
+    return fwrite(buf, 1, size, stdout);
+}
+
+int HardwareSerial::availableForWrite() { return LOG_BUFFER_SIZE; }
+
+// ========== Sketch globals ==========
+
+// Used only outside a station; each station swaps in its own (see Station)
+static char logStorage[LOG_BUFFER_SIZE];
+LogBuffer serialLog(logStorage, sizeof(logStorage));
+
+// Per-module heap attribution is a single-board figure: across hundreds of
+// stations it would mix them all. The daemon reports memory through the OS
+// instead (RSS), so the platform readings are zero and MemScope is inert.
+MemStats memStats;
+
+HeapCounters readHeapCounters() { return HeapCounters{0, 0, 0, 0}; }
+
+void setHeapPeak(unsigned long) {}
+
+unsigned long largestFreeBlock() { return 0; }
+
+unsigned long stackFreeBytes() { return 0; }
+
+// One process hosts every station and has no hardware watchdog; a hung
+// station shows up in its own logs instead. The detector still tracks
+// what is in flight, but nothing survives a restart.
+StallDetector stallDetector(WATCHDOG_TIMEOUT_MS);
+
+static StallRecord stallRecord;
+
+void watchdogStart(unsigned long) {}
+
+void watchdogKick() {}
+
+bool resetByWatchdog() { return false; }
+
+StallRecord* persistentStallRecord() { return &stallRecord; }
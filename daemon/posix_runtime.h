@@ -0,0 +1,26 @@
+#ifndef POSIX_RUNTIME_H
+#define POSIX_RUNTIME_H
+
+/**
+ * The daemon's implementation of the Arduino API the sketch code uses
+ * (declared by the host Arduino.h in test/shim/), on a real clock:
+ *
+ *   millis()/micros()  the monotonic clock
+ *   delay()            parks the calling station's Task (see event_loop.h),
+ *                      or sleeps when called outside one
+ *   digitalRead()      virtual pins, driven by the live sources
+ *   Serial             standard output
+ *
+ * serialLog is swapped for the running station's own LogBuffer on every
+ * switch into it (see Station), so the global is never shared mid-line.
+ */
+namespace runtime {
+
+/** Sets a virtual input pin; pins never set read HIGH (pulled up). */
+void setPinLevel(int pin, int level);
+
+int pinLevel(int pin);
+
+}
+
+#endif
@@ -0,0 +1,363 @@
+#include "posix_transport.h"
+#include "config.h"
+#include "event_loop.h"
+#include "log_buffer.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <map>
+
+#if DAEMON_TLS
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#endif
+
+#define EPOCH_VALID_AFTER 1577836800UL // 2020-01-01; earlier means the clock is unset
+
+// ========== Resolver ==========
+
+namespace {
+
+struct CachedAddress {
+    sockaddr_storage addr;
+    unsigned len;
+    unsigned long resolvedAt;
+};
+
+std::map<std::string, CachedAddress> addressCache;
+
+} // namespace
+
+bool resolveHost(const char* host, uint16_t port, sockaddr_storage* addr, unsigned* addrLen) {
+    std::string key = std::string(host) + ":" + std::to_string(port);
+    auto it = addressCache.find(key);
+    if (it != addressCache.end() && EventLoop::now() - it->second.resolvedAt < DAEMON_DNS_TTL_MS) {
+        *addr = it->second.addr;
+        *addrLen = it->second.len;
+        return true;
+    }
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICSERV | AI_ADDRCONFIG;
+    addrinfo* result = nullptr;
+    char service[8];
+    snprintf(service, sizeof(service), "%u", (unsigned)port);
+    if (getaddrinfo(host, service, &hints, &result) != 0 || !result) {
+        // Keep using a stale address rather than failing outright
+        if (it == addressCache.end()) return false;
+        *addr = it->second.addr;
+        *addrLen = it->second.len;
+        return true;
+    }
+
+    CachedAddress cached;
+    memcpy(&cached.addr, result->ai_addr, result->ai_addrlen);
+    cached.len = (unsigned)result->ai_addrlen;
+    cached.resolvedAt = EventLoop::now();
+    freeaddrinfo(result);
+    addressCache[key] = cached;
+    *addr = cached.addr;
+    *addrLen = cached.len;
+    return true;
+}
+
+// ========== TLS ==========
+
+#if DAEMON_TLS
+
+static SSL_CTX* tlsContext() {
+    static SSL_CTX* context = nullptr;
+    if (!context) {
+        context = SSL_CTX_new(TLS_client_method());
+        if (!context) return nullptr;
+        SSL_CTX_set_min_proto_version(context, TLS1_2_VERSION);
+        SSL_CTX_set_default_verify_paths(context); // honours SSL_CERT_FILE / SSL_CERT_DIR
+        SSL_CTX_set_verify(context, SSL_VERIFY_PEER, nullptr);
+        SSL_CTX_set_mode(context, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    }
+    return context;
+}
+
+bool tlsSupported() { return tlsContext() != nullptr; }
+
+#else
+
+bool tlsSupported() { return false; }
+
+#endif
+
+// ========== PosixClient ==========
+
+PosixClient::PosixClient()
+    : fd(-1)
+    , ssl(nullptr)
+    , peerClosed(false)
+    , rxLen(0)
+    , rxPos(0)
+{
+}
+
+PosixClient::~PosixClient() {
+    stop();
+}
+
+bool PosixClient::waitFor(uint32_t events, unsigned long timeoutMs) {
+    Task* task = Task::current();
+    if (task) return task->wait(fd, events, timeoutMs);
+    pollfd p = {fd, (short)((events & EPOLLIN ? POLLIN : 0) | (events & EPOLLOUT ? POLLOUT : 0)), 0};
+    return ::poll(&p, 1, (int)timeoutMs) > 0;
+}
+
+int PosixClient::connect(IPAddress, uint16_t) {
+    return 0; // stations connect by hostname
+}
+
+int PosixClient::connect(const char* host, uint16_t port) {
+    return connect(host, port, false);
+}
+
+int PosixClient::connect(const char* host, uint16_t port, bool tls) {
+    stop();
+    sockaddr_storage addr;
+    unsigned addrLen;
+    if (!resolveHost(host, port, &addr, &addrLen)) return 0;
+
+    fd = ::socket(addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return 0;
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), addrLen) != 0) {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (errno != EINPROGRESS || !waitFor(EPOLLOUT, HTTP_RESPONSE_TIMEOUT_MS)
+            || ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) != 0 || error != 0) {
+            stop();
+            return 0;
+        }
+    }
+    if (tls && !handshake(host)) {
+        stop();
+        return 0;
+    }
+    return 1;
+}
+
+bool PosixClient::handshake(const char* host) {
+#if DAEMON_TLS
+    SSL_CTX* context = tlsContext();
+    if (!context) return false;
+    ssl = SSL_new(context);
+    if (!ssl) return false;
+    SSL_set_fd(ssl, fd);
+    SSL_set_tlsext_host_name(ssl, host);
+    SSL_set1_host(ssl, host);
+
+    unsigned long start = EventLoop::now();
+    for (;;) {
+        int r = SSL_connect(ssl);
+        if (r == 1) return true;
+        int error = SSL_get_error(ssl, r);
+        uint32_t events = 0;
+        if (error == SSL_ERROR_WANT_READ) events = EPOLLIN;
+        if (error == SSL_ERROR_WANT_WRITE) events = EPOLLOUT;
+        unsigned long elapsed = EventLoop::now() - start;
+        if (!events || elapsed >= HTTP_RESPONSE_TIMEOUT_MS) {
+            ERR_clear_error();
+            return false;
+        }
+        waitFor(events, HTTP_RESPONSE_TIMEOUT_MS - elapsed);
+    }
+#else
+    (void)host;
+    return false;
+#endif
+}
+
+size_t PosixClient::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t PosixClient::write(const uint8_t* buf, size_t size) {
+    if (fd < 0) return 0;
+    size_t sent = 0;
+    unsigned long start = EventLoop::now();
+    while (sent < size) {
+        uint32_t events = EPOLLOUT;
+#if DAEMON_TLS
+        if (ssl) {
+            int r = SSL_write(ssl, buf + sent, (int)(size - sent));
+            if (r > 0) {
+                sent += (size_t)r;
+                continue;
+            }
+            int error = SSL_get_error(ssl, r);
+            if (error == SSL_ERROR_WANT_READ) events = EPOLLIN;
+            else if (error != SSL_ERROR_WANT_WRITE) break;
+        } else
+#endif
+        {
+            ssize_t n = ::send(fd, buf + sent, size - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n > 0) {
+                sent += (size_t)n;
+                continue;
+            }
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) break;
+        }
+        unsigned long elapsed = EventLoop::now() - start;
+        if (elapsed >= HTTP_RESPONSE_TIMEOUT_MS) break;
+        waitFor(events, HTTP_RESPONSE_TIMEOUT_MS - elapsed);
+    }
+    return sent;
+}
+
+bool PosixClient::fill(bool wait) {
+    if (rxPos < rxLen) return true;
+    if (fd < 0 || peerClosed) return false;
+    for (bool waited = false;; waited = true) {
+        uint32_t events = EPOLLIN;
+#if DAEMON_TLS
+        if (ssl) {
+            int r = SSL_read(ssl, rxBuf, sizeof(rxBuf));
+            if (r > 0) {
+                rxLen = (size_t)r;
+                rxPos = 0;
+                return true;
+            }
+            int error = SSL_get_error(ssl, r);
+            if (error == SSL_ERROR_WANT_WRITE) {
+                events = EPOLLOUT;
+            } else if (error != SSL_ERROR_WANT_READ) {
+                peerClosed = true; // close_notify, reset or protocol error
+                ERR_clear_error();
+                return false;
+            }
+        } else
+#endif
+        {
+            ssize_t n = ::recv(fd, rxBuf, sizeof(rxBuf), MSG_DONTWAIT);
+            if (n > 0) {
+                rxLen = (size_t)n;
+                rxPos = 0;
+                return true;
+            }
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                peerClosed = true;
+                return false;
+            }
+        }
+        if (!wait || waited) return false;
+        if (!waitFor(events, DAEMON_READ_WAIT_MS)) return false;
+    }
+}
+
+int PosixClient::available() {
+    fill(true);
+    return (int)(rxLen - rxPos);
+}
+
+int PosixClient::read() {
+    if (!fill(true)) return -1;
+    return rxBuf[rxPos++];
+}
+
+int PosixClient::read(uint8_t* buf, size_t size) {
+    if (!fill(true)) return -1;
+    size_t n = rxLen - rxPos;
+    if (n > size) n = size;
+    memcpy(buf, rxBuf + rxPos, n);
+    rxPos += n;
+    return (int)n;
+}
+
+int PosixClient::peek() {
+    if (!fill(true)) return -1;
+    return rxBuf[rxPos];
+}
+
+void PosixClient::flush() {}
+
+void PosixClient::stop() {
+#if DAEMON_TLS
+    if (ssl) {
+        SSL_shutdown(ssl); // best effort; never waits
+        SSL_free(ssl);
+        ssl = nullptr;
+        ERR_clear_error();
+    }
+#endif
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    peerClosed = false;
+    rxLen = rxPos = 0;
+}
+
+uint8_t PosixClient::connected() {
+    if (fd < 0) return 0;
+    fill(false);
+    return (!peerClosed || rxPos < rxLen) ? 1 : 0;
+}
+
+PosixClient::operator bool() { return fd >= 0; }
+
+// ========== PosixTransport ==========
+
+PosixTransport::PosixTransport()
+    : client(*this)
+    , open(false)
+{
+}
+
+void PosixTransport::addEndpoint(const char* host, uint16_t port, bool tls) {
+    endpoints.push_back(Endpoint{host, port, tls});
+}
+
+const char* PosixTransport::name() const { return "Host"; }
+
+void PosixTransport::setUp() {}
+
+void PosixTransport::update() {}
+
+bool PosixTransport::isUp() { return true; }
+
+Client* PosixTransport::openClient() {
+    open = true;
+    return &client;
+}
+
+void PosixTransport::closeClient() {
+    if (!open) return;
+    client.stop();
+    open = false;
+}
+
+unsigned long PosixTransport::getEpochTime() {
+    unsigned long epoch = (unsigned long)time(nullptr);
+    return epoch > EPOCH_VALID_AFTER ? epoch : 0;
+}
+
+int PosixTransport::EndpointClient::connect(const char* host, uint16_t port) {
+    for (const Endpoint& endpoint : transport.endpoints) {
+        if (endpoint.port == port && endpoint.host == host) {
+            return PosixClient::connect(host, port, endpoint.tls);
+        }
+    }
+    serialLog.print("[Net] No endpoint configured for ");
+    serialLog.print(host);
+    serialLog.print(":");
+    serialLog.println((unsigned int)port);
+    return 0;
+}
@@ -0,0 +1,116 @@
+#ifndef POSIX_TRANSPORT_H
+#define POSIX_TRANSPORT_H
+
+#include <Client.h>
+#include "daemon_config.h"
+#include "network_manager.h"
+
+#include <stdint.h>
+#include <sys/socket.h>
+#include <string>
+#include <vector>
+
+typedef struct ssl_st SSL;
+
+/**
+ * Client over a non-blocking POSIX socket, optionally TLS (OpenSSL, when
+ * the daemon is built with DAEMON_TLS).
+ *
+ * Blocking is done by parking the calling Task on the descriptor (see
+ * Task::wait()), so a station waiting on a slow server holds up no other
+ * station. When nothing is buffered, available(), read() and peek() wait up
+ * to DAEMON_READ_WAIT_MS for data before reporting none; callers poll them
+ * in loops with their own timeouts, which keeps those honest. Outside a
+ * task the same calls poll() instead.
+ */
+class PosixClient : public Client {
+public:
+    PosixClient();
+    ~PosixClient();
+
+    /** Connects to an address resolved by PosixTransport. */
+    int connect(const char* host, uint16_t port, bool tls);
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    void flush() override;
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override;
+
+private:
+    int fd;
+    SSL* ssl;
+    bool peerClosed;
+    uint8_t rxBuf[DAEMON_RX_BUFFER];
+    size_t rxLen;
+    size_t rxPos;
+
+    bool waitFor(uint32_t events, unsigned long timeoutMs);
+    bool fill(bool wait);
+    bool handshake(const char* host);
+};
+
+/**
+ * Transport for the daemon: the host's own network, always up, with the
+ * system clock (kept by NTP on the host) as the epoch source.
+ *
+ * Only the endpoints a station is configured with are reachable; each is
+ * registered with addEndpoint(), which also says whether it is TLS. Host
+ * names are resolved with getaddrinfo() on first use and cached for
+ * DAEMON_DNS_TTL_MS across all stations, so a lookup (which blocks the
+ * loop) happens once per host rather than once per request.
+ */
+class PosixTransport : public Transport {
+public:
+    PosixTransport();
+
+    void addEndpoint(const char* host, uint16_t port, bool tls);
+
+    const char* name() const override;
+    void setUp() override;
+    void update() override;
+    bool isUp() override;
+    Client* openClient() override;
+    void closeClient() override;
+    unsigned long getEpochTime() override;
+
+    /** The opened client, connecting through the endpoint table. */
+    class EndpointClient : public PosixClient {
+    public:
+        explicit EndpointClient(PosixTransport& transport) : transport(transport) {}
+        int connect(const char* host, uint16_t port) override;
+        using PosixClient::connect;
+    private:
+        PosixTransport& transport;
+    };
+
+private:
+    struct Endpoint {
+        std::string host;
+        uint16_t port;
+        bool tls;
+    };
+    std::vector<Endpoint> endpoints;
+    EndpointClient client;
+    bool open;
+};
+
+/**
+ * Resolves host:port through the shared cache. Returns false if the name
+ * does not resolve. Exposed for the startup check of every configured host.
+ */
+bool resolveHost(const char* host, uint16_t port, sockaddr_storage* addr,
+                 unsigned* addrLen);
+
+/** True if this build can open TLS endpoints. */
+bool tlsSupported();
+
+#endif
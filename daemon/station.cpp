@@ -0,0 +1,247 @@
+#include "station.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define FLASH_FILE_SECTOR_SIZE 4096
+
+Station::Station(const StationConfig& stationConfig, int index, FileWatcher& files,
+                 Print& logOutput)
+    : Task(DAEMON_TASK_STACK_BYTES)
+    , config(stationConfig)
+    , relayPin(DAEMON_PIN_BASE + 2 * index)
+    , log(stationConfig.name, logOutput)
+    , relayMonitor(relayPin, relayPin + 1, DEBOUNCE_MS, DEBOUNCE_MIN_MS, DEBOUNCE_MAX_MS)
+    , network(LINK_FAILURE_THRESHOLD, LINK_COOLDOWN_MS, LINK_PREFERENCE_MS)
+    , azuracast(network, config.nowPlaying.host.c_str(), config.nowPlaying.port,
+                config.nowPlaying.path.c_str())
+    , flowsheet(network, config.flowsheet.host.c_str(), config.flowsheet.port,
+                config.apiKey.c_str())
+    , live(makeLiveSource(config, relayPin, files))
+    , flash(FLASH_FILE_SECTOR_SIZE, CHECKPOINT_SECTORS)
+    , hasFlash(false)
+    , ctx{BOOTING, -1, 0, 0, false, 0}
+    , lastWarmPoll(0)
+{
+    transport.addEndpoint(config.nowPlaying.host.c_str(), config.nowPlaying.port,
+                          config.nowPlaying.tls);
+    transport.addEndpoint(config.flowsheet.host.c_str(), config.flowsheet.port,
+                          config.flowsheet.tls);
+}
+
+bool Station::open(EventLoop& loop, const char* stateDir, std::string* error) {
+    if ((config.nowPlaying.tls || config.flowsheet.tls) && !tlsSupported()) {
+        *error = "https needs a daemon built with OpenSSL";
+        return false;
+    }
+    if (!live || !live->open(loop, error)) return false;
+    live->setListener(*this);
+
+    if (stateDir) {
+        std::string path = std::string(stateDir) + "/" + config.name + ".checkpoint";
+        if (!flash.open(path)) {
+            *error = "cannot open " + path + ": " + strerror(errno);
+            return false;
+        }
+        hasFlash = true;
+    }
+    return true;
+}
+
+bool Station::follow(NowPlayingFeed& feed) {
+    return azuracast.follow(feed.fanout(), config.nowPlaying.shortcode.c_str());
+}
+
+// ========== Task ==========
+
+void Station::run() {
+    setUp();
+    while (!stopRequested()) {
+        step();
+        sleep(DAEMON_STEP_MS, true);
+    }
+}
+
+void Station::enter() {
+    log.enter();
+}
+
+void Station::leave() {
+    log.leave();
+}
+
+void Station::logTransition(State prev, State next) {
+    if (prev != next) {
+        serialLog.print("[State] ");
+        serialLog.print(stateName(prev));
+        serialLog.print(" -> ");
+        serialLog.println(stateName(next));
+    }
+}
+
+// ========== Checkpoint ==========
+
+/**
+ * As restoreCheckpoint() in the .ino, from the station's checkpoint file.
+ */
+void Station::restoreCheckpoint() {
+    Checkpoint saved;
+    bool restored = hasFlash && checkpoints.begin(flash, &saved);
+
+    unsigned long pollDueInMs = 0;
+    unsigned long epoch = network.getEpochTime();
+    if (restored && epoch > 0 && saved.pollDueEpoch > epoch) {
+        pollDueInMs = (saved.pollDueEpoch - epoch) * 1000UL;
+    }
+    ctx = resumeContext(restored ? &saved : nullptr, millis(), pollDueInMs, POLL_INTERVAL_MS);
+    azuracast.restoreShId(restored ? saved.lastShId : 0);
+
+    if (ctx.radioShowID > 0) {
+        serialLog.print("[Checkpoint] Open show radioShowID=");
+        serialLog.print(ctx.radioShowID);
+        serialLog.print(", last sh_id=");
+        serialLog.println(saved.lastShId);
+    }
+}
+
+/**
+ * As saveCheckpoint() in the .ino.
+ */
+void Station::saveCheckpoint(unsigned long epoch) {
+    int shId = azuracast.getShId();
+    if (flowsheet.queuedEntries() > 0 && checkpoints.hasRecord()) {
+        shId = checkpoints.last().lastShId;
+    }
+
+    uint32_t pollDueEpoch = 0;
+    if (epoch > 0 && ctx.state == AUTO_DJ_ACTIVE) {
+        unsigned long sincePoll = millis() - ctx.lastPollTime;
+        unsigned long dueInMs = sincePoll >= POLL_INTERVAL_MS ? 0 : POLL_INTERVAL_MS - sincePoll;
+        pollDueEpoch = epoch + dueInMs / 1000;
+    }
+
+    if (checkpoints.isReady() && !checkpoints.save(makeCheckpoint(ctx, shId, pollDueEpoch))) {
+        serialLog.println("[Checkpoint] Write failed.");
+    }
+}
+
+// ========== Setup / Loop ==========
+
+void Station::setUp() {
+    relayMonitor.setUp();
+    ctx.state = CONNECTING_WIFI;
+    ctx.retryCount = 0;
+    serialLog.println("[State] BOOTING -> CONNECTING_WIFI");
+
+    network.addTransport(transport);
+    network.setUp();
+
+    restoreCheckpoint();
+
+    if (network.isConnected()) {
+        // Relay level, not a change event: it may have moved while stopped
+        ctx.state = reconnectState(ctx.radioShowID, relayMonitor.isAutoDJActive());
+        ctx.retryCount = 0;
+        logTransition(CONNECTING_WIFI, ctx.state);
+    }
+}
+
+/**
+ * As warmUp() in the .ino, without the first-entry latency report.
+ */
+void Station::warmUp(const Inputs& inputs) {
+    if (relayMonitor.activationPending() || (inputs.relayStateChanged && inputs.autoDJActive)) {
+        if (!azuracast.isWarm(WARM_TRACK_MAX_AGE_MS)) azuracast.warm();
+        flowsheet.preconnect();
+        return;
+    }
+    if (inputs.currentMillis - lastWarmPoll >= IDLE_WARM_INTERVAL_MS) {
+        lastWarmPoll = inputs.currentMillis;
+        azuracast.warm();
+    }
+}
+
+void Station::step() {
+    relayMonitor.update();
+    network.update();
+
+    // ---- GATHER INPUTS ----
+    Inputs inputs;
+    inputs.relayStateChanged = relayMonitor.stateChanged();
+    inputs.autoDJActive = relayMonitor.isAutoDJActive();
+    inputs.wifiConnected = network.isConnected();
+    inputs.epochTime = network.getEpochTime();
+    inputs.currentMillis = millis();
+    inputs.pollIntervalMs = POLL_INTERVAL_MS;
+    inputs.maxRetries = MAX_RETRIES;
+    unsigned long responseTimeout = flowsheet.responseTimeoutMs();
+    inputs.retryBackoffMs = responseTimeout > RETRY_BACKOFF_MS ? responseTimeout : RETRY_BACKOFF_MS;
+    inputs.retryBackoffMaxMs = RETRY_BACKOFF_MAX_MS;
+    inputs.jitter = random(RETRY_BACKOFF_MAX_MS);
+
+    inputs.startShowResult = -1;
+    inputs.endShowResult = false;
+    inputs.breakerWaitMs = 0;
+    inputs.pollNewTrack = false;
+    inputs.pollLiveDJ = false;
+    inputs.pollShId = 0;
+
+    // ---- PRE-TICK I/O ----
+    bool attemptDue = retryDue(ctx, inputs.currentMillis);
+    switch (ctx.state) {
+        case IDLE:
+            if (inputs.wifiConnected) warmUp(inputs);
+            break;
+        case STARTING_SHOW: {
+            if (!attemptDue) break;
+            inputs.breakerWaitMs = flowsheet.circuitBreaker().refusingForMs(inputs.currentMillis);
+            if (inputs.breakerWaitMs > 0) break;
+            unsigned long hourMs = currentHourMs(inputs.epochTime);
+            if (hourMs > 0) {
+                inputs.startShowResult = flowsheet.startShow(hourMs);
+            }
+            if (inputs.startShowResult > 0 && azuracast.takeWarm(WARM_TRACK_MAX_AGE_MS)) {
+                inputs.pollNewTrack = true;
+                inputs.pollLiveDJ = azuracast.isLiveDJ();
+                inputs.pollShId = azuracast.getShId();
+            }
+            break;
+        }
+        case AUTO_DJ_ACTIVE:
+            if (inputs.currentMillis - ctx.lastPollTime >= POLL_INTERVAL_MS) {
+                inputs.pollNewTrack = azuracast.poll();
+                inputs.pollLiveDJ = azuracast.isLiveDJ();
+                inputs.pollShId = azuracast.getShId();
+            }
+            break;
+        case ENDING_SHOW:
+            if (!attemptDue) break;
+            inputs.breakerWaitMs = flowsheet.circuitBreaker().refusingForMs(inputs.currentMillis);
+            if (inputs.breakerWaitMs == 0) inputs.endShowResult = flowsheet.endShow(ctx.radioShowID);
+            break;
+        default:
+            break;
+    }
+
+    // ---- TICK ----
+    State prevState = ctx.state;
+    TickResult result = tick(ctx, inputs);
+    ctx = result.context;
+    logTransition(prevState, ctx.state);
+
+    // ---- POST-TICK I/O ----
+    if (ctx.state == AUTO_DJ_ACTIVE) {
+        flowsheet.update();
+    } else if (prevState == ENDING_SHOW && ctx.radioShowID < 0) {
+        flowsheet.discardEntries();
+    }
+    if (result.addEntry) {
+        const NowPlayingTrack* track = azuracast.track(result.addEntryShId);
+        if (track) {
+            flowsheet.queueEntry(ctx.radioShowID, result.addEntryHourMs,
+                track->artist, track->title, track->album, track->shId);
+        }
+        if (prevState == STARTING_SHOW) flowsheet.flush();
+    }
+    saveCheckpoint(inputs.epochTime);
+}
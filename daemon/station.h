@@ -0,0 +1,96 @@
+#ifndef STATION_H
+#define STATION_H
+
+#include "config.h"
+#include "daemon_config.h"
+#include "event_loop.h"
+#include "file_flash_region.h"
+#include "live_source.h"
+#include "nowplaying_feed.h"
+#include "posix_transport.h"
+#include "station_config.h"
+#include "task_log.h"
+
+#include "azuracast_client.h"
+#include "checkpoint.h"
+#include "flowsheet_client.h"
+#include "network_manager.h"
+#include "relay_monitor.h"
+#include "state_machine.h"
+#include "utils.h"
+
+#include <memory>
+#include <string>
+
+/**
+ * One station: the sketch's modules and orchestration, run as a Task.
+ *
+ * step() is the .ino's loop() -- relay and network updates, the I/O for the
+ * current state, tick(), the post-tick I/O and the checkpoint -- and run()
+ * calls it every DAEMON_STEP_MS (sooner when the live source changes). The
+ * station's relay and LED are virtual pins driven by its LiveSource, its
+ * only link is a PosixTransport, and its checkpoints go to a file in the
+ * state directory. Its log lines are prefixed with its name (see TaskLog).
+ * A station whose now-playing URL names a shortcode takes its tracks from
+ * a shared NowPlayingFeed instead of polling on its own.
+ *
+ * Stopping leaves an open show open, as a power cut would; it is resumed
+ * from the checkpoint on the next start.
+ */
+class Station : public Task {
+public:
+    /**
+     * `index` picks the station's virtual pins. Log lines are written to
+     * logOutput.
+     */
+    Station(const StationConfig& config, int index, FileWatcher& files, Print& logOutput);
+
+    /**
+     * Opens the live source and, if stateDir is non-null, the checkpoint
+     * file. Call before EventLoop::start().
+     */
+    bool open(EventLoop& loop, const char* stateDir, std::string* error);
+
+    /**
+     * Subscribes the station to the feed serving its shortcode. Call before
+     * EventLoop::start(); returns false if the feed is full.
+     */
+    bool follow(NowPlayingFeed& feed);
+
+    const std::string& name() const { return config.name; }
+    const Context& context() const { return ctx; }
+
+protected:
+    void run() override;
+    void enter() override;
+    void leave() override;
+
+private:
+    StationConfig config;
+    int relayPin;
+
+    TaskLog log;
+
+    RelayMonitor relayMonitor;
+    PosixTransport transport;
+    NetworkManager network;
+    AzuraCastClient azuracast;
+    FlowsheetClient flowsheet;
+    std::unique_ptr<LiveSource> live;
+
+    FileFlashRegion flash;
+    bool hasFlash;
+    CheckpointStore checkpoints;
+
+    Context ctx;
+    unsigned long lastWarmPoll;
+
+    void setUp();
+    void step();
+    void warmUp(const Inputs& inputs);
+    void restoreCheckpoint();
+    void saveCheckpoint(unsigned long epoch);
+    void logTransition(State prev, State next);
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "station_config.h"
+
+#include <stdlib.h>
+
+#include <fstream>
+#include <set>
+#include <sstream>
+
+bool parseUrl(const std::string& fullText, Url* url) {
+    size_t hash = fullText.find('#');
+    std::string text = fullText.substr(0, hash);
+    url->shortcode = hash == std::string::npos ? "" : fullText.substr(hash + 1);
+    if (hash != std::string::npos && url->shortcode.empty()) return false;
+
+    size_t rest;
+    if (text.compare(0, 7, "http://") == 0) {
+        url->tls = false;
+        rest = 7;
+    } else if (text.compare(0, 8, "https://") == 0) {
+        url->tls = true;
+        rest = 8;
+    } else {
+        return false;
+    }
+
+    size_t slash = text.find('/', rest);
+    std::string authority = text.substr(rest, slash == std::string::npos ? std::string::npos : slash - rest);
+    url->path = slash == std::string::npos ? "/" : text.substr(slash);
+
+    size_t colon = authority.rfind(':');
+    unsigned long port = url->tls ? 443 : 80;
+    if (colon != std::string::npos) {
+        std::string digits = authority.substr(colon + 1);
+        if (digits.empty() || digits.find_first_not_of("0123456789") != std::string::npos) return false;
+        port = strtoul(digits.c_str(), nullptr, 10);
+        if (port == 0 || port > 65535) return false;
+        authority.resize(colon);
+    }
+    if (authority.empty() || authority.find('@') != std::string::npos) return false;
+    url->host = authority;
+    url->port = (uint16_t)port;
+    return true;
+}
+
+bool parseLiveSpec(const std::string& text, StationConfig* station) {
+    if (text.compare(0, 5, "file:") == 0 && text.size() > 5) {
+        station->liveKind = LIVE_FILE;
+        station->livePath = text.substr(5);
+        return true;
+    }
+    if (text.compare(0, 7, "socket:") == 0 && text.size() > 7) {
+        station->liveKind = LIVE_SOCKET;
+        station->livePath = text.substr(7);
+        return true;
+    }
+    if (text.compare(0, 5, "gpio:") == 0) {
+        size_t colon = text.rfind(':');
+        std::string line = text.substr(colon + 1);
+        if (colon <= 5 || line.empty() || line.find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+        station->liveKind = LIVE_GPIO;
+        station->livePath = text.substr(5, colon - 5);
+        station->gpioLine = (unsigned)strtoul(line.c_str(), nullptr, 10);
+        return true;
+    }
+    return false;
+}
+
+bool parseStationLine(const std::string& line, StationConfig* station, std::string* error) {
+    std::istringstream in(line);
+    std::string live, nowPlaying, flowsheet, extra;
+    if (!(in >> station->name >> live >> nowPlaying >> flowsheet >> station->apiKey)) {
+        *error = "expected: name live now-playing-url flowsheet-url api-key";
+        return false;
+    }
+    if (in >> extra) {
+        *error = "unexpected field \"" + extra + "\"";
+        return false;
+    }
+    if (!parseLiveSpec(live, station)) {
+        *error = "bad live signal \"" + live + "\" (file:PATH, socket:PATH or gpio:CHIP:LINE)";
+        return false;
+    }
+    if (!parseUrl(nowPlaying, &station->nowPlaying)) {
+        *error = "bad now playing URL \"" + nowPlaying + "\"";
+        return false;
+    }
+    if (!parseUrl(flowsheet, &station->flowsheet) || !station->flowsheet.shortcode.empty()) {
+        *error = "bad flowsheet URL \"" + flowsheet + "\"";
+        return false;
+    }
+    return true;
+}
+
+bool loadStations(const char* path, std::vector<StationConfig>* stations, std::string* error) {
+    std::ifstream file(path);
+    if (!file) {
+        *error = std::string(path) + ": cannot open";
+        return false;
+    }
+    std::set<std::string> names;
+    std::string line;
+    for (int number = 1; std::getline(file, line); number++) {
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#') continue;
+
+        StationConfig station;
+        std::string problem;
+        if (!parseStationLine(line, &station, &problem)) {
+            *error = std::string(path) + ":" + std::to_string(number) + ": " + problem;
+            return false;
+        }
+        if (!names.insert(station.name).second) {
+            *error = std::string(path) + ":" + std::to_string(number)
+                   + ": duplicate station \"" + station.name + "\"";
+            return false;
+        }
+        stations->push_back(station);
+    }
+    return true;
+}
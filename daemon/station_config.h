@@ -0,0 +1,76 @@
+#ifndef STATION_CONFIG_H
+#define STATION_CONFIG_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * Station list for the daemon, one station per line:
+ *
+ *   # name   live                      now playing URL                                  flowsheet URL           API key
+ *   wxyc-hd2 file:/run/auto-dj/hd2     https://remote.wxyc.org/api/nowplaying_static/hd2.json https://www.wxyc.info KEY
+ *
+ * Fields are separated by spaces or tabs; blank lines and lines starting
+ * with '#' are skipped. The live signal is one of
+ *
+ *   file:PATH            a file holding 1 (auto DJ active) or 0, rewritten
+ *                        in place or replaced by rename
+ *   socket:PATH          a Unix stream socket the daemon listens on; peers
+ *                        write '1' and '0' characters
+ *   gpio:CHIP:LINE       a GPIO character device line, wired like the
+ *                        Giga's relay input (closed to ground = active)
+ *
+ * URLs are http or https, with an optional port. The flowsheet URL names
+ * only the server; the paths are the sketch's. A now-playing URL ending in
+ * #SHORTCODE names AzuraCast's all-stations document and the station in it,
+ * e.g. https://remote.wxyc.org/api/nowplaying#hd2: stations naming the same
+ * document share one poll of it (see NowPlayingFeed).
+ */
+
+enum LiveKind {
+    LIVE_FILE,
+    LIVE_SOCKET,
+    LIVE_GPIO
+};
+
+struct Url {
+    bool tls;
+    std::string host;
+    uint16_t port;
+    std::string path; // "/" if none
+    std::string shortcode; // after '#', "" if none
+};
+
+struct StationConfig {
+    std::string name;
+    LiveKind liveKind;
+    std::string livePath; // file, socket or chip path
+    unsigned gpioLine;
+    Url nowPlaying;
+    Url flowsheet;
+    std::string apiKey;
+};
+
+/**
+ * Parses an http:// or https:// URL. Returns false if it is not one, has
+ * no host, or the port is out of range.
+ */
+bool parseUrl(const std::string& text, Url* url);
+
+/** Parses a live signal field (see above). */
+bool parseLiveSpec(const std::string& text, StationConfig* station);
+
+/**
+ * Parses one station line. Returns false with a message in `error` if it
+ * is malformed; blank and comment lines are the caller's to skip.
+ */
+bool parseStationLine(const std::string& line, StationConfig* station, std::string* error);
+
+/**
+ * Reads a station list. On failure `error` names the line and the problem.
+ * Station names must be unique.
+ */
+bool loadStations(const char* path, std::vector<StationConfig>* stations, std::string* error);
+
+#endif
@@ -0,0 +1,42 @@
+#include "task_log.h"
+
+#include <utility>
+
+TaskLog::TaskLog(const std::string& name, Print& output)
+    : name(name)
+    , buffer(storage, sizeof(storage))
+    , output(output)
+    , atLineStart(true)
+{
+}
+
+void TaskLog::enter() {
+    std::swap(serialLog, buffer);
+}
+
+void TaskLog::leave() {
+    std::swap(serialLog, buffer);
+    drain();
+}
+
+/**
+ * Writes the complete and partial lines out, each prefixed with the name.
+ */
+void TaskLog::drain() {
+    const char* chunk;
+    size_t n;
+    while ((n = buffer.peek(&chunk, buffer.pending())) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            if (atLineStart) {
+                output.print("[");
+                output.print(name.c_str());
+                output.print("] ");
+                atLineStart = false;
+            }
+            if (chunk[i] == '\r') continue;
+            output.write((uint8_t)chunk[i]);
+            if (chunk[i] == '\n') atLineStart = true;
+        }
+        buffer.consume(n);
+    }
+}
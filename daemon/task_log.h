@@ -0,0 +1,35 @@
+#ifndef TASK_LOG_H
+#define TASK_LOG_H
+
+#include "config.h"
+#include "log_buffer.h"
+
+#include <string>
+
+/**
+ * A task's own log: a LogBuffer swapped in for the sketch's serialLog while
+ * the task runs (enter()), and written out with each line prefixed by the
+ * task's name when it yields (leave()). Lines from tasks that interleave on
+ * the loop therefore never mix.
+ */
+class TaskLog {
+public:
+    TaskLog(const std::string& name, Print& output);
+
+    TaskLog(const TaskLog&) = delete;
+    TaskLog& operator=(const TaskLog&) = delete;
+
+    void enter();
+    void leave();
+
+private:
+    std::string name;
+    char storage[LOG_BUFFER_SIZE];
+    LogBuffer buffer;
+    Print& output;
+    bool atLineStart;
+
+    void drain();
+};
+
+#endif
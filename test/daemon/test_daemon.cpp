@@ -0,0 +1,603 @@
+/**
+ * Tests of the Linux daemon build (daemon/): the station list parser, the
+ * event loop, and whole stations -- the sketch's modules and tick() run as
+ * Tasks -- against the stand-in AzuraCast and tubafrenzy servers.
+ *
+ * Unlike the emulation, the daemon runs on the real clock, so these tests
+ * take real time: a show's first entry is held FLOWSHEET_ENTRY_HOLD_MS
+ * before it is sent. ManyStations is the scaling benchmark.
+ */
+#include <gtest/gtest.h>
+
+#include "config.h"
+#include "event_loop.h"
+#include "live_source.h"
+#include "nowplaying_feed.h"
+#include "posix_transport.h"
+#include "station.h"
+#include "station_config.h"
+#include "standin_server.h"
+
+#include <ArduinoHttpClient.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+#define TEST_API_KEY "daemon-api-key"
+
+// ========== Helpers ==========
+
+namespace {
+
+// Discards station log lines (hundreds of stations are too chatty for ctest)
+class NullPrint : public Print {
+public:
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t*, size_t size) override { return size; }
+};
+
+// Collects station log lines
+class CapturePrint : public Print {
+public:
+    std::string text;
+    size_t write(uint8_t c) override { text += (char)c; return 1; }
+};
+
+std::string makeTempDir() {
+    char pattern[] = "/tmp/auto-dj-daemon-XXXXXX";
+    const char* dir = mkdtemp(pattern);
+    return dir ? dir : "";
+}
+
+void removeTree(const std::string& dir) {
+    std::string command = "rm -rf '" + dir + "'";
+    ASSERT_EQ(system(command.c_str()), 0);
+}
+
+void writeFile(const std::string& path, const std::string& text) {
+    std::ofstream(path) << text;
+}
+
+bool waitFor(std::function<bool()> pred, unsigned long limitMs) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(limitMs);
+    while (!pred()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+std::vector<StandinRequest> requestsTo(StandinServer& server, const char* path) {
+    std::vector<StandinRequest> matching;
+    for (const auto& r : server.requests()) {
+        if (r.path == path) matching.push_back(r);
+    }
+    return matching;
+}
+
+size_t countRequests(StandinServer& server, const char* path) {
+    return requestsTo(server, path).size();
+}
+
+long residentKb() {
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+double threadCpuMs(std::thread& thread) {
+    clockid_t clock;
+    timespec ts;
+    if (pthread_getcpuclockid(thread.native_handle(), &clock) != 0) return 0;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+} // namespace
+
+// ========== Station list ==========
+
+TEST(StationConfig, ParsesLine) {
+    StationConfig s;
+    std::string error;
+    ASSERT_TRUE(parseStationLine(
+        "hd2\tfile:/run/auto-dj/hd2  https://remote.wxyc.org/api/nowplaying_static/hd2.json "
+        "https://www.wxyc.info KEY", &s, &error)) << error;
+    EXPECT_EQ(s.name, "hd2");
+    EXPECT_EQ(s.liveKind, LIVE_FILE);
+    EXPECT_EQ(s.livePath, "/run/auto-dj/hd2");
+    EXPECT_TRUE(s.nowPlaying.tls);
+    EXPECT_EQ(s.nowPlaying.host, "remote.wxyc.org");
+    EXPECT_EQ(s.nowPlaying.port, 443);
+    EXPECT_EQ(s.nowPlaying.path, "/api/nowplaying_static/hd2.json");
+    EXPECT_EQ(s.flowsheet.host, "www.wxyc.info");
+    EXPECT_EQ(s.flowsheet.path, "/");
+    EXPECT_EQ(s.apiKey, "KEY");
+}
+
+TEST(StationConfig, UrlPorts) {
+    Url url;
+    ASSERT_TRUE(parseUrl("http://127.0.0.1:8080/x", &url));
+    EXPECT_FALSE(url.tls);
+    EXPECT_EQ(url.host, "127.0.0.1");
+    EXPECT_EQ(url.port, 8080);
+    ASSERT_TRUE(parseUrl("http://localhost", &url));
+    EXPECT_EQ(url.port, 80);
+    EXPECT_FALSE(parseUrl("ftp://host/", &url));
+    EXPECT_FALSE(parseUrl("http://:80/", &url));
+    EXPECT_FALSE(parseUrl("http://host:0/", &url));
+    EXPECT_FALSE(parseUrl("http://host:70000/", &url));
+    EXPECT_FALSE(parseUrl("http://host:8x/", &url));
+}
+
+TEST(StationConfig, ShortcodeNamesTheStationInAFeed) {
+    Url url;
+    ASSERT_TRUE(parseUrl("https://remote.wxyc.org/api/nowplaying#hd2", &url));
+    EXPECT_EQ(url.path, "/api/nowplaying");
+    EXPECT_EQ(url.shortcode, "hd2");
+    ASSERT_TRUE(parseUrl("https://remote.wxyc.org/api/nowplaying", &url));
+    EXPECT_EQ(url.shortcode, "");
+    EXPECT_FALSE(parseUrl("https://remote.wxyc.org/api/nowplaying#", &url));
+
+    StationConfig s;
+    std::string error;
+    EXPECT_FALSE(parseStationLine("hd2 file:/x https://a/api/nowplaying#hd2 https://b#hd2 KEY",
+                                  &s, &error));
+}
+
+TEST(StationConfig, LiveSpecs) {
+    StationConfig s;
+    ASSERT_TRUE(parseLiveSpec("socket:/run/hd3.sock", &s));
+    EXPECT_EQ(s.liveKind, LIVE_SOCKET);
+    EXPECT_EQ(s.livePath, "/run/hd3.sock");
+    ASSERT_TRUE(parseLiveSpec("gpio:/dev/gpiochip0:17", &s));
+    EXPECT_EQ(s.liveKind, LIVE_GPIO);
+    EXPECT_EQ(s.livePath, "/dev/gpiochip0");
+    EXPECT_EQ(s.gpioLine, 17u);
+    EXPECT_FALSE(parseLiveSpec("gpio:/dev/gpiochip0", &s));
+    EXPECT_FALSE(parseLiveSpec("gpio:17", &s));
+    EXPECT_FALSE(parseLiveSpec("file:", &s));
+    EXPECT_FALSE(parseLiveSpec("pipe:/tmp/x", &s));
+}
+
+TEST(StationConfig, BadLinesNameTheProblem) {
+    StationConfig s;
+    std::string error;
+    EXPECT_FALSE(parseStationLine("hd2 file:/x http://a/ http://b/", &s, &error));
+    EXPECT_FALSE(parseStationLine("hd2 file:/x http://a/ http://b/ KEY extra", &s, &error));
+    EXPECT_NE(error.find("extra"), std::string::npos);
+    EXPECT_FALSE(parseStationLine("hd2 file:/x gopher://a/ http://b/ KEY", &s, &error));
+    EXPECT_NE(error.find("now playing"), std::string::npos);
+}
+
+TEST(StationConfig, LoadSkipsCommentsAndRejectsDuplicates) {
+    std::string dir = makeTempDir();
+    std::string path = dir + "/stations.conf";
+    writeFile(path, "# stations\n\n"
+                    "a file:/x http://h/ http://f/ K\n"
+                    "  # indented comment\n"
+                    "b socket:/y http://h/ http://f/ K\n");
+    std::vector<StationConfig> stations;
+    std::string error;
+    ASSERT_TRUE(loadStations(path.c_str(), &stations, &error)) << error;
+    ASSERT_EQ(stations.size(), 2u);
+    EXPECT_EQ(stations[1].name, "b");
+
+    writeFile(path, "a file:/x http://h/ http://f/ K\na file:/z http://h/ http://f/ K\n");
+    stations.clear();
+    EXPECT_FALSE(loadStations(path.c_str(), &stations, &error));
+    EXPECT_NE(error.find(":2:"), std::string::npos) << error;
+    removeTree(dir);
+}
+
+TEST(LiveValue, Parses) {
+    bool active;
+    ASSERT_TRUE(parseLiveValue("1\n", 2, &active));
+    EXPECT_TRUE(active);
+    ASSERT_TRUE(parseLiveValue(" off ", 5, &active));
+    EXPECT_FALSE(active);
+    ASSERT_TRUE(parseLiveValue("ON", 2, &active));
+    EXPECT_TRUE(active);
+    EXPECT_FALSE(parseLiveValue("", 0, &active));
+    EXPECT_FALSE(parseLiveValue("10", 2, &active));
+}
+
+// ========== Event loop ==========
+
+namespace {
+
+class FnTask : public Task {
+public:
+    explicit FnTask(std::function<void(Task&)> body) : Task(65536), body(body) {}
+protected:
+    void run() override { body(*this); }
+private:
+    std::function<void(Task&)> body;
+};
+
+} // namespace
+
+TEST(EventLoop, SleepingTasksInterleave) {
+    EventLoop loop;
+    std::vector<std::string> order;
+    FnTask a([&](Task& t) {
+        order.push_back("a0");
+        t.sleep(20);
+        order.push_back("a1");
+    });
+    FnTask b([&](Task& t) {
+        order.push_back("b0");
+        t.sleep(5);
+        order.push_back("b1");
+    });
+    loop.start(a);
+    loop.start(b);
+    ASSERT_TRUE(loop.shutdown(1000));
+    EXPECT_EQ(order, (std::vector<std::string>{"a0", "b0", "b1", "a1"}));
+}
+
+TEST(EventLoop, WaitWakesOnReadableAndTimesOut) {
+    EventLoop loop;
+    int fds[2];
+    ASSERT_EQ(pipe2(fds, O_NONBLOCK), 0);
+    bool first = false, second = true;
+    unsigned long waitedMs = 0;
+    FnTask reader([&](Task& t) {
+        first = t.wait(fds[0], EPOLLIN, 5000);
+        char c;
+        ASSERT_EQ(read(fds[0], &c, 1), 1);
+        unsigned long start = EventLoop::now();
+        second = t.wait(fds[0], EPOLLIN, 30);
+        waitedMs = EventLoop::now() - start;
+    });
+    FnTask writer([&](Task& t) {
+        t.sleep(10);
+        ASSERT_EQ(write(fds[1], "x", 1), 1);
+    });
+    loop.start(reader);
+    loop.start(writer);
+    ASSERT_TRUE(loop.shutdown(2000));
+    EXPECT_TRUE(first);
+    EXPECT_FALSE(second);
+    EXPECT_GE(waitedMs, 30u);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(EventLoop, StopFromAnotherThread) {
+    EventLoop loop;
+    FnTask idle([](Task& t) {
+        while (!t.stopRequested()) t.sleep(1000, true);
+    });
+    loop.start(idle);
+    std::thread stopper([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        loop.stop();
+    });
+    loop.run();
+    stopper.join();
+    // The interruptible sleep ends at once rather than after a second
+    unsigned long start = EventLoop::now();
+    ASSERT_TRUE(loop.shutdown(500));
+    EXPECT_LT(EventLoop::now() - start, 500u);
+}
+
+// ========== POSIX transport ==========
+
+TEST(PosixTransport, GetFromTask) {
+    AzuraCastStandin azuracast;
+    azuracast.setTrack(7, "Broadcast", "Tears", "Work and Non Work");
+    EventLoop loop;
+    PosixTransport transport;
+    transport.addEndpoint("127.0.0.1", azuracast.server().port(), false);
+    int status = 0;
+    String body;
+    FnTask task([&](Task&) {
+        Client* client = transport.openClient();
+        HttpClient http(*client, "127.0.0.1", azuracast.server().port());
+        ASSERT_EQ(http.get(AZURACAST_PATH), 0);
+        status = http.responseStatusCode();
+        body = http.responseBody();
+        transport.closeClient();
+    });
+    loop.start(task);
+    ASSERT_TRUE(loop.shutdown(5000));
+    EXPECT_EQ(status, 200);
+    EXPECT_EQ((size_t)body.length(), azuracast.payloadSize());
+}
+
+TEST(PosixTransport, UnknownEndpointIsRefused) {
+    PosixTransport transport;
+    transport.addEndpoint("127.0.0.1", 1, false);
+    Client* client = transport.openClient();
+    EXPECT_EQ(client->connect("127.0.0.1", 2), 0);
+    transport.closeClient();
+}
+
+// ========== Stations ==========
+
+class DaemonTest : public ::testing::Test {
+protected:
+    AzuraCastStandin azuracast;
+    TubafrenzyStandin tubafrenzy{TEST_API_KEY};
+    std::string dir;
+    EventLoop loop;
+    FileWatcher files;
+    std::vector<std::unique_ptr<NowPlayingFeed>> feeds;
+    std::vector<std::unique_ptr<Station>> stations;
+    std::thread runner;
+    NullPrint discard;
+
+    void SetUp() override {
+        dir = makeTempDir();
+        ASSERT_FALSE(dir.empty());
+        ASSERT_TRUE(loop.isValid());
+        azuracast.setTrack(1001, "Yo La Tengo", "Autumn Sweater", "I Can Hear the Heart");
+    }
+
+    void TearDown() override {
+        stopLoop();
+        stations.clear();
+        feeds.clear();
+        removeTree(dir);
+    }
+
+    StationConfig config(const std::string& name, const std::string& live) {
+        StationConfig s;
+        std::string error;
+        std::string line = name + " " + live
+            + " http://127.0.0.1:" + std::to_string(azuracast.server().port()) + AZURACAST_PATH
+            + " http://127.0.0.1:" + std::to_string(tubafrenzy.server().port())
+            + " " TEST_API_KEY;
+        EXPECT_TRUE(parseStationLine(line, &s, &error)) << error;
+        return s;
+    }
+
+    Station& addStation(const StationConfig& c, Print& out, const char* stateDir = nullptr) {
+        stations.emplace_back(new Station(c, (int)stations.size(), files, out));
+        std::string error;
+        EXPECT_TRUE(stations.back()->open(loop, stateDir, &error)) << error;
+        return *stations.back();
+    }
+
+    Station& addFileStation(const std::string& name, bool live, Print& out,
+                            const char* stateDir = nullptr) {
+        writeFile(livePath(name), live ? "1\n" : "0\n");
+        return addStation(config(name, "file:" + livePath(name)), out, stateDir);
+    }
+
+    std::string livePath(const std::string& name) { return dir + "/" + name + ".live"; }
+
+    // A station on the stand-in's all-stations document
+    Station& addFeedStation(const std::string& name, const std::string& shortcode) {
+        writeFile(livePath(name), "0\n");
+        StationConfig c = config(name, "file:" + livePath(name));
+        EXPECT_TRUE(parseUrl("http://127.0.0.1:" + std::to_string(azuracast.server().port())
+                             + AZURACAST_ALL_PATH "#" + shortcode, &c.nowPlaying));
+        Station& station = addStation(c, discard);
+        EXPECT_TRUE(station.follow(feedFor(feeds, c.nowPlaying, discard)));
+        return station;
+    }
+
+    void startLoop() {
+        for (auto& f : feeds) loop.start(*f);
+        for (auto& s : stations) loop.start(*s);
+        runner = std::thread([this] {
+            loop.run();
+            loop.shutdown(DAEMON_SHUTDOWN_MS);
+        });
+    }
+
+    void stopLoop() {
+        if (!runner.joinable()) return;
+        loop.stop();
+        runner.join();
+    }
+
+    size_t count(const char* path) { return countRequests(tubafrenzy.server(), path); }
+};
+
+TEST_F(DaemonTest, FileStationRunsAShow) {
+    CapturePrint out;
+    Station& station = addFileStation("hd2", false, out);
+    startLoop();
+    ASSERT_TRUE(waitFor([&] { return station.context().state == IDLE; }, 5000));
+
+    writeFile(livePath("hd2"), "1\n");
+    ASSERT_TRUE(waitFor([&] { return count(TUBAFRENZY_PATH_START_SHOW) == 1; }, 5000));
+    ASSERT_TRUE(waitFor([&] { return count(TUBAFRENZY_PATH_ADD_ENTRY) == 1; },
+                        FLOWSHEET_ENTRY_HOLD_MS + 5000)) << out.text;
+    auto entry = requestsTo(tubafrenzy.server(), TUBAFRENZY_PATH_ADD_ENTRY)[0];
+    EXPECT_EQ(entry.formField("artistName"), "Yo La Tengo");
+
+    writeFile(livePath("hd2"), "0\n");
+    ASSERT_TRUE(waitFor([&] { return count(TUBAFRENZY_PATH_END_SHOW) == 1; }, 5000));
+    stopLoop();
+
+    EXPECT_NE(out.text.find("[hd2] [State] IDLE -> STARTING_SHOW\n"), std::string::npos) << out.text;
+    EXPECT_NE(out.text.find("[hd2] [Flowsheet] Show ended"), std::string::npos) << out.text;
+}
+
+TEST_F(DaemonTest, SocketStation) {
+    std::string path = dir + "/hd3.sock";
+    addStation(config("hd3", "socket:" + path), discard);
+    startLoop();
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    ASSERT_EQ(write(fd, "1\n", 2), 2);
+    ASSERT_TRUE(waitFor([&] { return count(TUBAFRENZY_PATH_START_SHOW) == 1; }, 5000));
+    ASSERT_EQ(write(fd, "0\n", 2), 2);
+    close(fd);
+    ASSERT_TRUE(waitFor([&] { return count(TUBAFRENZY_PATH_END_SHOW) == 1; }, 5000));
+}
+
+// Stations are independent: one whose flowsheet server hangs does not hold
+// up another's show.
+TEST_F(DaemonTest, SlowServerBlocksOnlyItsStation) {
+    TubafrenzyStandin slow{TEST_API_KEY};
+    slow.server().setResponseDelayMs(3000);
+    StationConfig stuck = config("stuck", "file:" + livePath("stuck"));
+    stuck.flowsheet.port = slow.server().port();
+    writeFile(livePath("stuck"), "1\n");
+    addStation(stuck, discard);
+    addFileStation("fine", false, discard);
+    startLoop();
+
+    ASSERT_TRUE(waitFor([&] { return slow.server().requestCount() == 1; }, 5000));
+    writeFile(livePath("fine"), "1\n");
+    auto t0 = std::chrono::steady_clock::now();
+    ASSERT_TRUE(waitFor([&] { return count(TUBAFRENZY_PATH_START_SHOW) == 1; }, 5000));
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    EXPECT_LT(ms, 1000);
+}
+
+// The checkpoint file carries an open show across a daemon restart.
+TEST_F(DaemonTest, RestartResumesOpenShow) {
+    std::string state = dir + "/state";
+    ASSERT_EQ(mkdir(state.c_str(), 0700), 0);
+    addFileStation("hd2", true, discard, state.c_str());
+    startLoop();
+    ASSERT_TRUE(waitFor([&] { return count(TUBAFRENZY_PATH_ADD_ENTRY) == 1; },
+                        FLOWSHEET_ENTRY_HOLD_MS + 5000));
+    stopLoop();
+    stations.clear();
+
+    EventLoop second;
+    FileWatcher secondFiles;
+    Station again(config("hd2", "file:" + livePath("hd2")), 0, secondFiles, discard);
+    std::string error;
+    ASSERT_TRUE(again.open(second, state.c_str(), &error)) << error;
+    second.start(again);
+    std::thread t([&] {
+        second.run();
+        second.shutdown(DAEMON_SHUTDOWN_MS);
+    });
+    ASSERT_TRUE(waitFor([&] { return again.context().state == AUTO_DJ_ACTIVE; }, 5000));
+    writeFile(livePath("hd2"), "0\n");
+    ASSERT_TRUE(waitFor([&] { return count(TUBAFRENZY_PATH_END_SHOW) == 1; }, 5000));
+    second.stop();
+    t.join();
+
+    EXPECT_EQ(count(TUBAFRENZY_PATH_START_SHOW), 1u); // resumed, not restarted
+    EXPECT_EQ(count(TUBAFRENZY_PATH_ADD_ENTRY), 1u);  // same track not logged again
+    auto end = requestsTo(tubafrenzy.server(), TUBAFRENZY_PATH_END_SHOW)[0];
+    EXPECT_EQ(end.formField("radioShowID"), std::to_string(tubafrenzy.lastRadioShowID()));
+}
+
+// Stations on one all-stations document share a single poll of it, and
+// each gets its own station's track.
+TEST_F(DaemonTest, SharedFeedServesStationsWithOneRequest) {
+    azuracast.setStationTrack("hd2", 2001, "Stereolab", "French Disko", "Transient Random-Noise Bursts");
+    azuracast.setStationTrack("hd3", 3001, "Broadcast", "Pendulum", "Work and Non Work");
+    addFeedStation("hd2", "hd2");
+    addFeedStation("hd3", "hd3");
+    addFeedStation("hd2-backup", "hd2");
+    ASSERT_EQ(feeds.size(), 1u);
+    startLoop();
+    ASSERT_TRUE(waitFor([&] { return feeds[0]->fanout().stationCount() == 3; }, 5000));
+
+    for (auto& station : stations) writeFile(livePath(station->name()), "1\n");
+    ASSERT_TRUE(waitFor([&] { return count(TUBAFRENZY_PATH_ADD_ENTRY) == 3; },
+                        FLOWSHEET_ENTRY_HOLD_MS + 5000));
+    std::multiset<std::string> artists;
+    for (const auto& r : requestsTo(tubafrenzy.server(), TUBAFRENZY_PATH_ADD_ENTRY)) {
+        artists.insert(r.formField("artistName"));
+    }
+    EXPECT_EQ(artists, (std::multiset<std::string>{"Broadcast", "Stereolab", "Stereolab"}));
+
+    auto polls = azuracast.server().requests();
+    ASSERT_EQ(polls.size(), 1u);
+    EXPECT_EQ(polls[0].path, AZURACAST_ALL_PATH);
+}
+
+// ========== Scaling ==========
+
+// N stations go live at once, log their first track and sign off, all on
+// one loop thread. Prints how long until every show had started, every
+// first entry was in and every show had ended (each includes the entry
+// hold), the spread of show start times, the loop thread's CPU time, and
+// the idle cost per station.
+TEST_F(DaemonTest, ManyStations) {
+    // The stand-in servers spend a thread per connection, which is what
+    // limits ctest; AUTO_DJ_DAEMON_STATIONS adds a bigger round by hand.
+    std::vector<int> counts = {50, 200};
+    if (const char* extra = getenv("AUTO_DJ_DAEMON_STATIONS")) counts.push_back(atoi(extra));
+    const unsigned long IDLE_MS = 2000;
+    size_t started = 0, entries = 0, ended = 0;
+
+    for (int n : counts) {
+        if (n <= 0) continue;
+        unsigned long limitMs = 30000 + 200UL * n;
+        long rssBefore = residentKb();
+        for (int i = 0; i < n; i++) addFileStation("s" + std::to_string(stations.size()), false, discard);
+        long rssPerStation = (residentKb() - rssBefore) * 1024 / n;
+        startLoop();
+        ASSERT_TRUE(waitFor([&] { return loop.stats().switches >= 2 * stations.size(); }, 5000));
+        double cpu0 = threadCpuMs(runner);
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t i = stations.size() - n; i < stations.size(); i++) {
+            writeFile(livePath(stations[i]->name()), "1\n");
+        }
+        ASSERT_TRUE(waitFor([&] { return count(TUBAFRENZY_PATH_START_SHOW) == started + n; }, limitMs));
+        auto t1 = std::chrono::steady_clock::now();
+        ASSERT_TRUE(waitFor([&] { return count(TUBAFRENZY_PATH_ADD_ENTRY) == entries + n; },
+                            FLOWSHEET_ENTRY_HOLD_MS + limitMs));
+        auto t2 = std::chrono::steady_clock::now();
+
+        auto t3 = std::chrono::steady_clock::now();
+        for (size_t i = stations.size() - n; i < stations.size(); i++) {
+            writeFile(livePath(stations[i]->name()), "0\n");
+        }
+        ASSERT_TRUE(waitFor([&] { return count(TUBAFRENZY_PATH_END_SHOW) == ended + n; }, limitMs));
+        auto t4 = std::chrono::steady_clock::now();
+        double cpu1 = threadCpuMs(runner);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(IDLE_MS));
+        double idleCpu = threadCpuMs(runner) - cpu1;
+
+        std::vector<double> startMs;
+        for (const auto& r : requestsTo(tubafrenzy.server(), TUBAFRENZY_PATH_START_SHOW)) {
+            if (r.receivedAt >= t0) {
+                startMs.push_back(std::chrono::duration<double, std::milli>(r.receivedAt - t0).count());
+            }
+        }
+        std::sort(startMs.begin(), startMs.end());
+        auto ms = [](std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+            return std::chrono::duration<double, std::milli>(b - a).count();
+        };
+        printf("[Daemon] %3d stations: all started %5.0fms (p50 %4.0fms, p99 %4.0fms), "
+               "all entries %5.0fms, all ended %5.0fms\n",
+               n, ms(t0, t1), startMs[startMs.size() / 2], startMs[startMs.size() * 99 / 100],
+               ms(t0, t2), ms(t3, t4));
+        printf("[Daemon] %3d stations: loop CPU %.0fms for the show cycle, idle %.2f%% of a core "
+               "(%.1fus/station/s), ~%ld bytes RSS per station\n",
+               n, cpu1 - cpu0, idleCpu / IDLE_MS * 100, idleCpu * 1000 / IDLE_MS / n, rssPerStation);
+
+        started += n;
+        entries += n;
+        ended += n;
+        stopLoop();
+        stations.clear();
+    }
+    RecordProperty("max_stations", *std::max_element(counts.begin(), counts.end()));
+}
@@ -0,0 +1,93 @@
+/**
+ * Single-link Transports for driving the sketch's clients on the host, and
+ * the log drain every test runs between requests.
+ *
+ * LoopbackTransport hands out an emulated WiFiSSLClient, so requests reach
+ * whatever stand-in emu::routeHost() points the hostname at. MemoryTransport
+ * hands out a MemoryClient, which discards what is written and replays a
+ * canned server response, then reports the connection closed: no sockets,
+ * no waiting, for the fuzz targets and parser tests.
+ */
+#ifndef LOOPBACK_TRANSPORT_H
+#define LOOPBACK_TRANSPORT_H
+
+#include "log_buffer.h"
+#include "network_manager.h"
+#include <WiFiSSLClient.h>
+
+#include <cstring>
+#include <string>
+
+#define LOOPBACK_EPOCH 1705345200UL // 2024-01-15 19:00 UTC
+
+class MemoryClient : public Client {
+public:
+    void load(const std::string& response) {
+        data = response;
+        pos = 0;
+        open = false;
+    }
+
+    int connect(IPAddress, uint16_t) override { return open = true; }
+    int connect(const char*, uint16_t) override { return open = true; }
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t*, size_t size) override { return size; }
+    using Print::write;
+    int available() override { return (int)(data.size() - pos); }
+    int read() override { return pos < data.size() ? (uint8_t)data[pos++] : -1; }
+    int read(uint8_t* buf, size_t size) override {
+        if (pos >= data.size()) return -1;
+        size_t n = data.size() - pos < size ? data.size() - pos : size;
+        std::memcpy(buf, data.data() + pos, n);
+        pos += n;
+        return (int)n;
+    }
+    int peek() override { return pos < data.size() ? (uint8_t)data[pos] : -1; }
+    void flush() override {}
+    void stop() override { open = false; }
+    uint8_t connected() override { return open && pos < data.size(); }
+    operator bool() override { return open; }
+
+private:
+    std::string data;
+    size_t pos = 0;
+    bool open = false;
+};
+
+/** One always-up link whose one client is a ClientType. */
+template <class ClientType>
+class SingleClientTransport : public Transport {
+public:
+    ClientType client;
+
+    explicit SingleClientTransport(const char* label) : label(label) {}
+
+    const char* name() const override { return label; }
+    void setUp() override {}
+    void update() override {}
+    bool isUp() override { return true; }
+    Client* openClient() override { return &client; }
+    void closeClient() override { client.stop(); }
+    unsigned long getEpochTime() override { return LOOPBACK_EPOCH; }
+
+private:
+    const char* label;
+};
+
+class LoopbackTransport : public SingleClientTransport<WiFiSSLClient> {
+public:
+    LoopbackTransport() : SingleClientTransport("Loopback") {}
+};
+
+class MemoryTransport : public SingleClientTransport<MemoryClient> {
+public:
+    MemoryTransport() : SingleClientTransport("Memory") {}
+};
+
+/** Throws away the buffered log, as loop() would have sent it to Serial. */
+inline void drainSerialLog() {
+    const char* chunk;
+    while (size_t n = serialLog.peek(&chunk, serialLog.pending())) serialLog.consume(n);
+}
+
+#endif // LOOPBACK_TRANSPORT_H
@@ -0,0 +1,16 @@
+// Placeholder credentials for the host-emulation build. The emulated WiFi
+// accepts any SSID, and the stand-in flowsheet servers check for this key and
+// token.
+
+#ifndef SECRETS_H
+#define SECRETS_H
+
+#define WIFI_SSID "emulated-ssid"
+#define WIFI_PASS "emulated-pass"
+
+#define AUTO_DJ_API_KEY "emulated-api-key"
+
+#define BACKEND_SERVICE_TOKEN "emulated-token"
+#define BACKEND_SERVICE_DJ_ID 42
+
+#endif
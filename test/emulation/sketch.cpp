@@ -0,0 +1,4 @@
+// Compiles the sketch's .ino as C++ for the host-emulation build. The
+// Arduino IDE does the same, minus the automatic prototypes the sketch does
+// not rely on.
+#include "auto-dj-arduino-switch.ino"
@@ -0,0 +1,716 @@
+#include "standin_server.h"
+
+#include <ArduinoJson.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+#if EMULATION_TLS
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <signal.h>
+#else
+typedef struct ssl_st SSL;
+#endif
+
+// ========== StandinRequest ==========
+
+static std::string lower(std::string s) {
+    for (auto& c : s) c = (char)std::tolower((unsigned char)c);
+    return s;
+}
+
+static std::string formDecode(const std::string& s) {
+    std::string out;
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] == '+') {
+            out += ' ';
+        } else if (s[i] == '%' && i + 2 < s.size()) {
+            out += (char)std::strtol(s.substr(i + 1, 2).c_str(), nullptr, 16);
+            i += 2;
+        } else {
+            out += s[i];
+        }
+    }
+    return out;
+}
+
+std::string StandinRequest::header(const std::string& name) const {
+    auto it = headers.find(lower(name));
+    return it == headers.end() ? std::string() : it->second;
+}
+
+std::string StandinRequest::formField(const std::string& name) const {
+    size_t pos = 0;
+    while (pos <= body.size()) {
+        size_t end = body.find('&', pos);
+        if (end == std::string::npos) end = body.size();
+        std::string pair = body.substr(pos, end - pos);
+        size_t eq = pair.find('=');
+        if (eq != std::string::npos && pair.compare(0, eq, name) == 0 && eq == name.size()) {
+            return formDecode(pair.substr(eq + 1));
+        }
+        pos = end + 1;
+    }
+    return std::string();
+}
+
+// ========== TLS ==========
+
+#if EMULATION_TLS
+
+namespace {
+
+// One key and certificate for all stand-ins; ECDSA P-256, as the real
+// hosts' certificates are
+struct StandinIdentity {
+    SSL_CTX* context = nullptr;
+    std::string certificatePem;
+
+    StandinIdentity() {
+        EVP_PKEY* key = nullptr;
+        EVP_PKEY_CTX* keygen = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+        if (!keygen || EVP_PKEY_keygen_init(keygen) <= 0 ||
+            EVP_PKEY_CTX_set_ec_paramgen_curve_nid(keygen, NID_X9_62_prime256v1) <= 0 ||
+            EVP_PKEY_keygen(keygen, &key) <= 0) {
+            EVP_PKEY_CTX_free(keygen);
+            return;
+        }
+        EVP_PKEY_CTX_free(keygen);
+
+        X509* cert = X509_new();
+        X509_set_version(cert, 2);
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), -3600);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 30L * 24 * 3600);
+        X509_set_pubkey(cert, key);
+        X509_NAME* name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                   reinterpret_cast<const unsigned char*>("standin"), -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        X509_sign(cert, key, EVP_sha256());
+
+        BIO* bio = BIO_new(BIO_s_mem());
+        PEM_write_bio_X509(bio, cert);
+        char* pem;
+        long len = BIO_get_mem_data(bio, &pem);
+        certificatePem.assign(pem, (size_t)len);
+        BIO_free(bio);
+
+        context = SSL_CTX_new(TLS_server_method());
+        if (!context || SSL_CTX_use_certificate(context, cert) != 1 ||
+            SSL_CTX_use_PrivateKey(context, key) != 1) {
+            SSL_CTX_free(context);
+            context = nullptr;
+            certificatePem.clear();
+        }
+        X509_free(cert);
+        EVP_PKEY_free(key);
+        ::signal(SIGPIPE, SIG_IGN); // OpenSSL writes with write(), not send(MSG_NOSIGNAL)
+    }
+};
+
+StandinIdentity& identity() {
+    static StandinIdentity id;
+    return id;
+}
+
+} // namespace
+
+std::string standinCertificate() { return identity().certificatePem; }
+
+#else
+
+std::string standinCertificate() { return std::string(); }
+
+#endif
+
+// Reads what is there of one connection's stream, TLS or not
+static ssize_t receive(int fd, SSL* ssl, char* buf, size_t size) {
+#if EMULATION_TLS
+    if (ssl) return SSL_read(ssl, buf, (int)size);
+#else
+    (void)ssl;
+#endif
+    return ::recv(fd, buf, size, 0);
+}
+
+static bool sendAll(int fd, SSL* ssl, const std::string& out) {
+    size_t sent = 0;
+    while (sent < out.size()) {
+#if EMULATION_TLS
+        ssize_t n = ssl ? SSL_write(ssl, out.data() + sent, (int)(out.size() - sent))
+                        : ::send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+#else
+        (void)ssl;
+        ssize_t n = ::send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+#endif
+        if (n <= 0) return false;
+        sent += (size_t)n;
+    }
+    return true;
+}
+
+// ========== StandinServer ==========
+
+StandinServer::StandinServer(Handler handler)
+    : handler_(std::move(handler))
+    , listenFd_(-1)
+    , port_(0)
+    , running_(true)
+    , delayMs_(0)
+    , requestsPerConnection_(0)
+    , minBodyBytes_(0)
+    , tls_(false)
+    , connectionCount_(0)
+    , hangUpAt_(0)
+{
+    listenFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd_ < 0) throw std::runtime_error("socket() failed");
+    int one = 1;
+    ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if (::bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(listenFd_, 16) != 0) {
+        ::close(listenFd_);
+        throw std::runtime_error("bind/listen on 127.0.0.1 failed");
+    }
+    socklen_t len = sizeof(addr);
+    ::getsockname(listenFd_, reinterpret_cast<sockaddr*>(&addr), &len);
+    port_ = ntohs(addr.sin_port);
+
+    acceptThread_ = std::thread(&StandinServer::acceptLoop, this);
+}
+
+StandinServer::~StandinServer() {
+    running_ = false;
+    ::shutdown(listenFd_, SHUT_RDWR);
+    ::close(listenFd_);
+    acceptThread_.join();
+
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int fd : connectionFds_) ::shutdown(fd, SHUT_RDWR);
+        threads.swap(connectionThreads_);
+    }
+    for (auto& t : threads) t.join();
+}
+
+std::vector<StandinRequest> StandinServer::requests() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return requests_;
+}
+
+size_t StandinServer::requestCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return requests_.size();
+}
+
+void StandinServer::clearRequests() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    requests_.clear();
+}
+
+bool StandinServer::enableTls() {
+#if EMULATION_TLS
+    if (!identity().context) return false;
+    tls_ = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void StandinServer::hangUpAfter(size_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    hangUpAt_ = count;
+}
+
+void StandinServer::acceptLoop() {
+    while (running_) {
+        int fd = ::accept(listenFd_, nullptr, nullptr);
+        if (fd < 0) {
+            if (!running_) return;
+            continue;
+        }
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        connectionFds_.push_back(fd);
+        connectionThreads_.emplace_back(&StandinServer::serve, this, fd, ++connectionCount_);
+    }
+}
+
+/**
+ * Reads requests off one connection until the client closes it or asks for
+ * "Connection: close". Bytes past the end of one request are kept for the
+ * next, so pipelined requests are answered in order.
+ */
+void StandinServer::serve(int fd, unsigned long connection) {
+    std::string buffer;
+    char chunk[4096];
+    unsigned served = 0;
+    SSL* ssl = nullptr;
+#if EMULATION_TLS
+    if (tls_) {
+        ssl = SSL_new(identity().context);
+        SSL_set_fd(ssl, fd);
+        if (SSL_accept(ssl) != 1) goto done;
+    }
+#endif
+
+    for (;;) {
+        size_t headerEnd;
+        while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+            ssize_t n = receive(fd, ssl, chunk, sizeof(chunk));
+            if (n <= 0) goto done;
+            buffer.append(chunk, (size_t)n);
+        }
+
+        StandinRequest request;
+        request.connection = connection;
+        {
+            std::string head = buffer.substr(0, headerEnd);
+            size_t lineEnd = head.find("\r\n");
+            std::string requestLine = head.substr(0, lineEnd);
+            size_t sp1 = requestLine.find(' ');
+            size_t sp2 = requestLine.find(' ', sp1 + 1);
+            request.method = requestLine.substr(0, sp1);
+            request.path = requestLine.substr(sp1 + 1, sp2 - sp1 - 1);
+
+            size_t pos = lineEnd == std::string::npos ? head.size() : lineEnd + 2;
+            while (pos < head.size()) {
+                size_t end = head.find("\r\n", pos);
+                if (end == std::string::npos) end = head.size();
+                std::string line = head.substr(pos, end - pos);
+                size_t colon = line.find(':');
+                if (colon != std::string::npos) {
+                    size_t v = line.find_first_not_of(' ', colon + 1);
+                    request.headers[lower(line.substr(0, colon))] =
+                        v == std::string::npos ? std::string() : line.substr(v);
+                }
+                pos = end + 2;
+            }
+        }
+        buffer.erase(0, headerEnd + 4);
+
+        size_t contentLength = (size_t)std::strtoul(request.header("Content-Length").c_str(),
+                                                    nullptr, 10);
+        while (buffer.size() < contentLength) {
+            ssize_t n = receive(fd, ssl, chunk, sizeof(chunk));
+            if (n <= 0) goto done;
+            buffer.append(chunk, (size_t)n);
+        }
+        request.body = buffer.substr(0, contentLength);
+        buffer.erase(0, contentLength);
+        request.receivedAt = std::chrono::steady_clock::now();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            requests_.push_back(request);
+            if (hangUpAt_ != 0 && requests_.size() == hangUpAt_) {
+                hangUpAt_ = 0;
+                goto done;
+            }
+        }
+
+        if (delayMs_ > 0) std::this_thread::sleep_for(std::chrono::milliseconds(delayMs_));
+        StandinResponse response = handler_(request);
+        if (response.body.size() < minBodyBytes_) response.body.resize(minBodyBytes_, ' ');
+        served++;
+        bool close = lower(request.header("Connection")) == "close" ||
+                     (requestsPerConnection_ != 0 && served >= requestsPerConnection_);
+
+        char statusLine[64];
+        std::snprintf(statusLine, sizeof(statusLine), "HTTP/1.1 %d %s\r\n", response.status,
+                      response.status == 200 ? "OK"
+                      : response.status == 206 ? "Partial Content"
+                      : response.status == 302 ? "Found"
+                      : response.status == 403 ? "Forbidden"
+                      : response.status == 404 ? "Not Found" : "Error");
+        std::string out = statusLine;
+        out += "Server: standin\r\n";
+        for (const auto& h : response.headers) out += h.first + ": " + h.second + "\r\n";
+        out += "Content-Length: " + std::to_string(response.body.size()) + "\r\n";
+        if (close) out += "Connection: close\r\n";
+        out += "\r\n";
+        bool cut = response.cutAfter >= 0 && (size_t)response.cutAfter < response.body.size();
+        out += cut ? response.body.substr(0, (size_t)response.cutAfter) : response.body;
+
+        if (!sendAll(fd, ssl, out)) goto done;
+        if (close || cut) break;
+    }
+
+done:
+#if EMULATION_TLS
+    if (ssl) {
+        SSL_shutdown(ssl);
+        SSL_free(ssl);
+        ERR_clear_error();
+    }
+#endif
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find(connectionFds_.begin(), connectionFds_.end(), fd);
+    if (it != connectionFds_.end()) connectionFds_.erase(it);
+    ::close(fd);
+}
+
+// ========== AzuraCastStandin ==========
+
+static std::string jsonString(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+AzuraCastStandin::AzuraCastStandin()
+    : shId_(0)
+    , live_(false)
+    , status_(200)
+    , server_([this](const StandinRequest& r) { return handle(r); })
+{
+}
+
+void AzuraCastStandin::setTrack(int shId, const std::string& artist, const std::string& title,
+                                const std::string& album) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shId_ = shId;
+    artist_ = artist;
+    title_ = title;
+    album_ = album;
+}
+
+void AzuraCastStandin::setLive(bool live) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    live_ = live;
+}
+
+void AzuraCastStandin::setStatus(int status) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    status_ = status;
+}
+
+size_t AzuraCastStandin::payloadSize() const { return payload().size(); }
+
+static std::string songJson(int id, const std::string& artist, const std::string& title,
+                            const std::string& album) {
+    std::string s = "{\"id\":\"" + std::to_string(id) + "a1b2c3d4e5f6\"";
+    s += ",\"text\":" + jsonString(artist + " - " + title);
+    s += ",\"artist\":" + jsonString(artist);
+    s += ",\"title\":" + jsonString(title);
+    s += ",\"album\":" + jsonString(album);
+    s += ",\"genre\":\"\",\"isrc\":\"\",\"lyrics\":\"\"";
+    s += ",\"art\":\"https://remote.wxyc.org/api/station/main/art/" + std::to_string(id) +
+         "-1700000000.jpg\",\"custom_fields\":[]}";
+    return s;
+}
+
+void AzuraCastStandin::setStationTrack(const std::string& shortcode, int shId,
+                                       const std::string& artist, const std::string& title,
+                                       const std::string& album) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& station : stations_) {
+        if (station.shortcode == shortcode) {
+            station = Station{shortcode, shId, artist, title, album};
+            return;
+        }
+    }
+    stations_.push_back(Station{shortcode, shId, artist, title, album});
+}
+
+std::string AzuraCastStandin::payload() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stationPayload("main", shId_, artist_, title_, album_);
+}
+
+std::string AzuraCastStandin::allStationsPayload() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string p = "[" + stationPayload("main", shId_, artist_, title_, album_);
+    for (const auto& station : stations_) {
+        p += ",\n" + stationPayload(station.shortcode, station.shId, station.artist,
+                                    station.title, station.album);
+    }
+    return p + "]";
+}
+
+// Caller holds mutex_
+std::string AzuraCastStandin::stationPayload(const std::string& shortcode, int shId,
+                                             const std::string& artist, const std::string& title,
+                                             const std::string& album) const {
+    std::string p = "{\"station\":{\"id\":1,\"name\":\"WXYC Auto DJ\",\"shortcode\":" +
+        jsonString(shortcode) + ","
+        "\"description\":\"\",\"frontend\":\"icecast\",\"backend\":\"liquidsoap\","
+        "\"listen_url\":\"https://remote.wxyc.org/listen/main/radio.mp3\","
+        "\"url\":\"https://wxyc.org\",\"public_player_url\":\"https://remote.wxyc.org/public/main\","
+        "\"playlist_pls_url\":\"https://remote.wxyc.org/public/main/playlist.pls\","
+        "\"playlist_m3u_url\":\"https://remote.wxyc.org/public/main/playlist.m3u\","
+        "\"is_public\":true,\"mounts\":[{\"id\":1,\"name\":\"/radio.mp3 (128kbps MP3)\","
+        "\"url\":\"https://remote.wxyc.org/listen/main/radio.mp3\",\"bitrate\":128,"
+        "\"format\":\"mp3\",\"listeners\":{\"total\":3,\"unique\":3,\"current\":3},"
+        "\"path\":\"/radio.mp3\",\"is_default\":true}],\"remotes\":[],"
+        "\"hls_enabled\":false,\"hls_url\":null,\"hls_listeners\":0},";
+    p += "\"listeners\":{\"total\":3,\"unique\":3,\"current\":3},";
+    p += "\"live\":{\"is_live\":" + std::string(live_ ? "true" : "false") +
+         ",\"streamer_name\":\"\",\"broadcast_start\":null,\"art\":null},";
+    p += "\"now_playing\":{\"sh_id\":" + std::to_string(shId) +
+         ",\"played_at\":1705345200,\"duration\":245,\"playlist\":\"General Rotation\","
+         "\"streamer\":\"\",\"is_request\":false,\"song\":" +
+         songJson(shId, artist, title, album) + ",\"elapsed\":12,\"remaining\":233},";
+    p += "\"playing_next\":{\"cued_at\":1705345433,\"played_at\":1705345445,\"duration\":198,"
+         "\"playlist\":\"General Rotation\",\"is_request\":false,\"song\":" +
+         songJson(shId + 1, "Next Artist", "Next Title", "Next Album") + "},";
+    p += "\"song_history\":[";
+    for (int i = 1; i <= 15; i++) {
+        if (i > 1) p += ",";
+        p += "{\"sh_id\":" + std::to_string(shId - i) +
+             ",\"played_at\":" + std::to_string(1705345200 - i * 220) +
+             ",\"duration\":220,\"playlist\":\"General Rotation\",\"streamer\":\"\","
+             "\"is_request\":false,\"song\":" +
+             songJson(shId - i, "History Artist " + std::to_string(i),
+                      "History Title " + std::to_string(i), "History Album") + "}";
+    }
+    p += "],\"is_online\":true,\"cache\":\"hit\"}";
+    return p;
+}
+
+StandinResponse AzuraCastStandin::handle(const StandinRequest& request) {
+    StandinResponse response;
+    bool all = request.path == "/api/nowplaying";
+    if (!all && request.path != "/api/nowplaying_static/main.json") {
+        response.status = 404;
+        return response;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        response.status = status_;
+    }
+    if (response.status == 200) {
+        response.headers.emplace_back("Content-Type", "application/json");
+        response.body = all ? allStationsPayload() : payload();
+    }
+    return response;
+}
+
+// ========== TubafrenzyStandin ==========
+
+TubafrenzyStandin::TubafrenzyStandin(const std::string& apiKey)
+    : apiKey_(apiKey)
+    , nextShowID_(5001)
+    , server_([this](const StandinRequest& r) { return handle(r); })
+{
+}
+
+StandinResponse TubafrenzyStandin::handle(const StandinRequest& request) {
+    StandinResponse response;
+    if (request.method != "POST") {
+        response.status = 404;
+        return response;
+    }
+    if (request.header("X-Auto-DJ-Key") != apiKey_) {
+        response.status = 403;
+        return response;
+    }
+
+    if (request.path == "/playlists/startRadioShow") {
+        int id = nextShowID_++;
+        response.status = 302;
+        response.headers.emplace_back("Location",
+            "/playlists/flowsheet?mode=modifyFlowsheet&radioShowID=" + std::to_string(id));
+    } else if (request.path == "/playlists/flowsheetEntryAdd") {
+        response.status = 302;
+        response.headers.emplace_back("Location",
+            "/playlists/flowsheet?mode=modifyFlowsheet&radioShowID=" +
+            request.formField("radioShowID"));
+    } else if (request.path == "/playlists/finishRadioShow") {
+        response.status = 302;
+        response.headers.emplace_back("Location", "/playlists/flowsheet");
+    } else {
+        response.status = 404;
+    }
+    return response;
+}
+
+// ========== BackendServiceStandin ==========
+
+BackendServiceStandin::BackendServiceStandin(const std::string& token)
+    : token_(token)
+    , nextShowID_(789)
+    , openShowID_(0)
+    , djID_(0)
+    , server_([this](const StandinRequest& r) { return handle(r); })
+{
+}
+
+bool BackendServiceStandin::showOpen() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return openShowID_ != 0;
+}
+
+std::vector<BackendServiceStandin::Entry> BackendServiceStandin::entries() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_;
+}
+
+static StandinResponse jsonResponse(int status, const std::string& body) {
+    StandinResponse response;
+    response.status = status;
+    response.headers.emplace_back("Content-Type", "application/json");
+    response.body = body;
+    return response;
+}
+
+static std::string showRecord(int id, int djID, const std::string& showName, bool ended) {
+    return "{\"id\":" + std::to_string(id) + ",\"primary_dj_id\":" + std::to_string(djID) +
+           ",\"show_name\":\"" + showName + "\",\"start_time\":\"2024-01-15T19:00:00.000Z\","
+           "\"end_time\":" + (ended ? "\"2024-01-15T21:00:00.000Z\"" : "null") + "}";
+}
+
+StandinResponse BackendServiceStandin::handle(const StandinRequest& request) {
+    if (request.method != "POST") return jsonResponse(404, "{\"message\":\"Not found\"}");
+    if (request.header("Authorization") != "Bearer " + token_) {
+        return jsonResponse(401, "{\"message\":\"Unauthorized\"}");
+    }
+    JsonDocument doc;
+    if (request.header("Content-Type") != "application/json" ||
+        deserializeJson(doc, request.body.c_str(), request.body.size())) {
+        return jsonResponse(400, "{\"message\":\"Malformed JSON\"}");
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (request.path == "/flowsheet/join") {
+        if (!doc["dj_id"].is<int>()) return jsonResponse(400, "{\"message\":\"dj_id required\"}");
+        openShowID_ = nextShowID_++;
+        djID_ = doc["dj_id"].as<int>();
+        const char* name = doc["show_name"].as<const char*>();
+        return jsonResponse(200, showRecord(openShowID_, djID_, name ? name : "", false));
+    }
+    if (request.path == "/flowsheet") {
+        if (openShowID_ == 0) return jsonResponse(400, "{\"message\":\"No active show\"}");
+        Entry entry;
+        entry.showID = openShowID_;
+        entry.message = doc["message"].is<const char*>();
+        if (entry.message) {
+            entry.text = doc["message"].as<const char*>();
+        } else {
+            const char* artist = doc["artist_name"].as<const char*>();
+            const char* album = doc["album_title"].as<const char*>();
+            const char* title = doc["track_title"].as<const char*>();
+            if (!artist || !album || !title || !doc["request_flag"].is<bool>()) {
+                return jsonResponse(400, "{\"message\":\"Missing fields\"}");
+            }
+            entry.artist = artist;
+            entry.album = album;
+            entry.title = title;
+        }
+        entries_.push_back(entry);
+        return jsonResponse(200, "{\"id\":" + std::to_string(entries_.size()) +
+                                 ",\"show_id\":" + std::to_string(openShowID_) + "}");
+    }
+    if (request.path == "/flowsheet/end") {
+        if (openShowID_ == 0 || !doc["dj_id"].is<int>() || doc["dj_id"].as<int>() != djID_) {
+            return jsonResponse(400, "{\"message\":\"No active show\"}");
+        }
+        int id = openShowID_;
+        openShowID_ = 0;
+        return jsonResponse(200, showRecord(id, djID_, "", true));
+    }
+    return jsonResponse(404, "{\"message\":\"Not found\"}");
+}
+
+// ========== FirmwareStandin ==========
+
+FirmwareStandin::FirmwareStandin()
+    : cuts_(0)
+    , cutAfter_(0)
+    , ignoreRange_(false)
+    , server_([this](const StandinRequest& r) { return handle(r); })
+{
+}
+
+void FirmwareStandin::setRelease(const std::string& version, const std::string& image,
+                                 const std::string& sha256) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    version_ = version;
+    image_ = image;
+    sha256_ = sha256;
+}
+
+void FirmwareStandin::cutNext(int count, size_t afterBytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cuts_ = count;
+    cutAfter_ = afterBytes;
+}
+
+void FirmwareStandin::setIgnoreRange(bool ignore) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ignoreRange_ = ignore;
+}
+
+std::string FirmwareStandin::imagePath() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return "/auto-dj/firmware/" + version_ + ".bin";
+}
+
+StandinResponse FirmwareStandin::handle(const StandinRequest& request) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    StandinResponse response;
+    if (request.method != "GET") {
+        response.status = 404;
+        return response;
+    }
+    if (request.path == "/auto-dj/firmware/manifest.json") {
+        response.headers.push_back({"Content-Type", "application/json"});
+        response.body = "{\"version\":" + jsonString(version_) +
+                        ",\"url\":\"/auto-dj/firmware/" + version_ + ".bin\"" +
+                        ",\"size\":" + std::to_string(image_.size()) +
+                        ",\"sha256\":" + jsonString(sha256_) + "}";
+        return response;
+    }
+    if (request.path != "/auto-dj/firmware/" + version_ + ".bin") {
+        response.status = 404;
+        return response;
+    }
+
+    response.headers.push_back({"Content-Type", "application/octet-stream"});
+    size_t from = 0, to = image_.size() - 1;
+    std::string range = request.header("Range");
+    if (!ignoreRange_ && range.compare(0, 6, "bytes=") == 0) {
+        char* end;
+        from = std::strtoul(range.c_str() + 6, &end, 10);
+        if (*end == '-' && end[1]) to = std::min(to, (size_t)std::strtoul(end + 1, nullptr, 10));
+        if (from > to) {
+            response.status = 416;
+            return response;
+        }
+        response.status = 206;
+        response.headers.push_back({"Content-Range", "bytes " + std::to_string(from) + "-" +
+                                    std::to_string(to) + "/" + std::to_string(image_.size())});
+    }
+    response.body = image_.substr(from, to - from + 1);
+    if (cuts_ > 0) {
+        cuts_--;
+        response.cutAfter = (long)cutAfter_;
+    }
+    return response;
+}
@@ -0,0 +1,264 @@
+/**
+ * Stand-in HTTP servers for the host-emulation tests.
+ *
+ * StandinServer is a small threaded HTTP/1.1 server on 127.0.0.1 (ephemeral
+ * port) that hands each parsed request to a handler and records it with its
+ * arrival time. Connections are kept alive unless the client sends
+ * "Connection: close", and pipelined requests are answered in order.
+ * Requests must carry Content-Length bodies; chunked uploads are not
+ * supported. enableTls() makes it an HTTPS server (with emu::setTls() on
+ * the client side).
+ *
+ * AzuraCastStandin, TubafrenzyStandin, BackendServiceStandin and
+ * FirmwareStandin serve the endpoints the sketch talks to, closely enough
+ * that the real client code runs unmodified.
+ */
+#ifndef STANDIN_SERVER_H
+#define STANDIN_SERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct StandinRequest {
+    std::string method;
+    std::string path;                          // including any query string
+    std::map<std::string, std::string> headers; // names lower-cased
+    std::string body;
+    std::chrono::steady_clock::time_point receivedAt;
+    unsigned long connection;                  // 1-based accept counter
+
+    std::string header(const std::string& name) const;
+    /** Decoded value of one application/x-www-form-urlencoded body field. */
+    std::string formField(const std::string& name) const;
+};
+
+struct StandinResponse {
+    int status = 200;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+    /** If >= 0, send only this much of the body, then drop the connection. */
+    long cutAfter = -1;
+};
+
+class StandinServer {
+public:
+    typedef std::function<StandinResponse(const StandinRequest&)> Handler;
+
+    explicit StandinServer(Handler handler);
+    ~StandinServer();
+
+    StandinServer(const StandinServer&) = delete;
+    StandinServer& operator=(const StandinServer&) = delete;
+
+    uint16_t port() const { return port_; }
+
+    std::vector<StandinRequest> requests() const;
+    size_t requestCount() const;
+    void clearRequests();
+
+    /** Milliseconds of real time to wait before answering each request. */
+    void setResponseDelayMs(unsigned ms) { delayMs_ = ms; }
+
+    /**
+     * Pads every response body with trailing spaces to at least `bytes`,
+     * which leaves JSON valid, for sizing responses. 0 (the default) sends
+     * bodies as the handler made them.
+     */
+    void setMinBodyBytes(size_t bytes) { minBodyBytes_ = bytes; }
+
+    /**
+     * Serves HTTPS on connections accepted from now on, with the
+     * certificate from standinCertificate(). Returns false if this build
+     * has no TLS (EMULATION_TLS).
+     */
+    bool enableTls();
+
+    /**
+     * Answers the nth request on each connection with "Connection: close"
+     * and closes it, like a server with a keep-alive request limit. 0 (the
+     * default) means no limit.
+     */
+    void setRequestsPerConnection(unsigned n) { requestsPerConnection_ = n; }
+
+    /**
+     * Once the server has recorded `count` requests in total, drops that
+     * request's connection without answering (a crash or network cut after
+     * the request was acted on). Fires once; 0 disables.
+     */
+    void hangUpAfter(size_t count);
+
+private:
+    Handler handler_;
+    int listenFd_;
+    uint16_t port_;
+    std::atomic<bool> running_;
+    std::atomic<unsigned> delayMs_;
+    std::atomic<unsigned> requestsPerConnection_;
+    std::atomic<size_t> minBodyBytes_;
+    std::atomic<bool> tls_;
+    std::thread acceptThread_;
+
+    mutable std::mutex mutex_;
+    std::vector<StandinRequest> requests_;
+    std::vector<std::thread> connectionThreads_;
+    std::vector<int> connectionFds_;
+    unsigned long connectionCount_;
+    size_t hangUpAt_;
+
+    void acceptLoop();
+    void serve(int fd, unsigned long connection);
+};
+
+/**
+ * The self-signed certificate (PEM) of every stand-in under enableTls(),
+ * generated once per process, for emu::setTls(). Empty if this build has
+ * no TLS.
+ */
+std::string standinCertificate();
+
+/**
+ * Serves /api/nowplaying_static/main.json with a settable current track.
+ * The payload is padded with station, listener and history blocks so its
+ * size (~10 KB) matches the real endpoint the filter was written for.
+ *
+ * /api/nowplaying serves the all-stations array: "main" first, then every
+ * station added with setStationTrack(), in the order they were added.
+ */
+class AzuraCastStandin {
+public:
+    AzuraCastStandin();
+
+    void setTrack(int shId, const std::string& artist, const std::string& title,
+                  const std::string& album);
+    void setLive(bool live);
+    void setStatus(int status); // non-200 makes every poll fail
+
+    /** Adds (or updates) another station in the all-stations document. */
+    void setStationTrack(const std::string& shortcode, int shId, const std::string& artist,
+                         const std::string& title, const std::string& album);
+
+    StandinServer& server() { return server_; }
+    size_t payloadSize() const;
+
+private:
+    struct Station {
+        std::string shortcode;
+        int shId;
+        std::string artist, title, album;
+    };
+
+    mutable std::mutex mutex_;
+    int shId_;
+    std::string artist_, title_, album_;
+    bool live_;
+    int status_;
+    std::vector<Station> stations_;
+    StandinServer server_;
+
+    std::string payload() const;
+    std::string allStationsPayload() const;
+    std::string stationPayload(const std::string& shortcode, int shId, const std::string& artist,
+                               const std::string& title, const std::string& album) const;
+    StandinResponse handle(const StandinRequest& request);
+};
+
+/**
+ * Serves the three tubafrenzy form endpoints. Requests without the expected
+ * X-Auto-DJ-Key get 403; startRadioShow answers 302 with a Location carrying
+ * a fresh radioShowID, and flowsheetEntryAdd / finishRadioShow answer 302.
+ */
+class TubafrenzyStandin {
+public:
+    explicit TubafrenzyStandin(const std::string& apiKey);
+
+    StandinServer& server() { return server_; }
+    int lastRadioShowID() const { return nextShowID_ - 1; }
+
+private:
+    std::string apiKey_;
+    std::atomic<int> nextShowID_;
+    StandinServer server_;
+
+    StandinResponse handle(const StandinRequest& request);
+};
+
+/**
+ * Serves the three Backend-Service flowsheet endpoints (JSON, Bearer
+ * token). Requests without the expected token get 401 and bodies that are
+ * not valid JSON 400. /flowsheet/join opens a show and answers with its
+ * Show record; /flowsheet adds an entry (a song, or a {"message"} such as
+ * a breakpoint) to the open show, 400 if there is none; /flowsheet/end
+ * closes it. Every success is 200 with a JSON body.
+ */
+class BackendServiceStandin {
+public:
+    struct Entry {
+        int showID;
+        bool message;        // {"message": ...} rather than a song
+        std::string text;    // the message, for a message entry
+        std::string artist, album, title;
+    };
+
+    explicit BackendServiceStandin(const std::string& token);
+
+    StandinServer& server() { return server_; }
+    int lastShowID() const { return nextShowID_ - 1; }
+    bool showOpen() const;
+    std::vector<Entry> entries() const;
+
+private:
+    std::string token_;
+    std::atomic<int> nextShowID_;
+    mutable std::mutex mutex_;
+    int openShowID_;
+    int djID_;
+    std::vector<Entry> entries_;
+    StandinServer server_;
+
+    StandinResponse handle(const StandinRequest& request);
+};
+
+/**
+ * Serves a firmware manifest at /auto-dj/firmware/manifest.json and the
+ * image it names at /auto-dj/firmware/<version>.bin, honouring single
+ * "Range: bytes=a-b" (or "a-") requests with 206 and Content-Range.
+ */
+class FirmwareStandin {
+public:
+    FirmwareStandin();
+
+    /** Publishes a release; sha256 is the hex digest the manifest claims. */
+    void setRelease(const std::string& version, const std::string& image,
+                    const std::string& sha256);
+
+    /**
+     * Cuts the next `count` image responses off after `afterBytes` bytes
+     * of body, dropping the connection.
+     */
+    void cutNext(int count, size_t afterBytes);
+
+    /** Answers image requests with the whole image (200), ignoring Range. */
+    void setIgnoreRange(bool ignore);
+
+    StandinServer& server() { return server_; }
+    std::string imagePath() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::string version_, image_, sha256_;
+    int cuts_;
+    size_t cutAfter_;
+    bool ignoreRange_;
+    StandinServer server_;
+
+    StandinResponse handle(const StandinRequest& request);
+};
+
+#endif // STANDIN_SERVER_H
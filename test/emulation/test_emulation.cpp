@@ -0,0 +1,724 @@
+/**
+ * End-to-end tests of the whole sketch (setup()/loop(), the clients,
+ * RelayMonitor, WifiManager, NetworkManager) running on the host against
+ * stand-in AzuraCast and tubafrenzy servers on localhost.
+ *
+ * The virtual clock only moves when the test advances it (or the sketch
+ * calls delay()), so state-machine timing is deterministic; socket I/O is
+ * real, which is what the throughput and latency numbers measure.
+ */
+#include <gtest/gtest.h>
+
+#include "config.h"
+#include "secrets.h"
+#include "state_machine.h"
+#include "mem_stats.h"
+#include "stall_detector.h"
+#include "flowsheet_client.h"
+#include "azuracast_client.h"
+#include "network_manager.h"
+#include "emulation.h"
+#include "standin_server.h"
+#include <WiFi.h>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+// Defined by the sketch (sketch.cpp)
+extern Context ctx;
+extern FlowsheetClient flowsheet;
+extern AzuraCastClient azuracast; // tests reach it as ::azuracast
+extern NetworkManager network;
+void setup();
+void loop();
+
+class EmulationTest : public ::testing::Test {
+protected:
+    AzuraCastStandin azuracast;
+    TubafrenzyStandin tubafrenzy{AUTO_DJ_API_KEY};
+
+    void SetUp() override {
+        emu::reset();
+        boot();
+    }
+
+    // Power-on after `downMs` without power, with the relay at `relayLevel`;
+    // flash keeps whatever the last run checkpointed, wall time moves on
+    void reboot(int relayLevel, unsigned long downMs = 5000) {
+        unsigned long epoch = WiFi.getTime();
+        emu::powerCycle();
+        emu::setEpochTime(epoch + downMs / 1000);
+        emu::setPinLevel(RELAY_PIN, relayLevel);
+        boot();
+    }
+
+    void boot() {
+        emu::routeHost(AZURACAST_HOST, AZURACAST_PORT, azuracast.server().port());
+        emu::routeHost(TUBAFRENZY_HOST, TUBAFRENZY_PORT, tubafrenzy.server().port());
+
+        // The sketch's globals outlive a test; restart it from power-on
+        ctx = { BOOTING, -1, 0, 0, false, 0 };
+        flowsheet.discardEntries();
+        setup();
+    }
+
+    size_t entryCount() {
+        size_t n = 0;
+        for (const auto& r : tubafrenzy.server().requests()) {
+            if (r.path == TUBAFRENZY_PATH_ADD_ENTRY) n++;
+        }
+        return n;
+    }
+
+    // Runs loop() in 100ms virtual steps until pred() holds or limitMs passes
+    bool runUntil(std::function<bool()> pred, unsigned long limitMs = 120000) {
+        unsigned long start = millis();
+        while (!pred()) {
+            if (millis() - start > limitMs) return false;
+            loop();
+            emu::advanceMillis(100);
+        }
+        return true;
+    }
+
+    void runFor(unsigned long ms) {
+        unsigned long start = millis();
+        while (millis() - start < ms) {
+            loop();
+            emu::advanceMillis(100);
+        }
+    }
+
+    void relayClosed() { emu::setPinLevel(RELAY_PIN, LOW); }
+    void relayOpen() { emu::setPinLevel(RELAY_PIN, HIGH); }
+
+    // Unique sh_ids per test: the sketch's AzuraCastClient remembers the last one
+    static int nextShId() {
+        static int shId = 90000;
+        return shId += 10;
+    }
+};
+
+// ========== Lifecycle ==========
+
+TEST_F(EmulationTest, SetupReachesIdle) {
+    EXPECT_EQ(ctx.state, IDLE);
+    EXPECT_NE(emu::serialOutput().find("=== WXYC Auto DJ Arduino Switch ==="),
+              std::string::npos);
+}
+
+TEST_F(EmulationTest, FullShowLifecycle) {
+    int shId = nextShId();
+    azuracast.setTrack(shId, "Stereolab", "French Disko", "Jenny Ondioline");
+
+    relayClosed();
+    ASSERT_TRUE(runUntil([] { return ctx.state == AUTO_DJ_ACTIVE; }));
+    EXPECT_EQ(ctx.radioShowID, tubafrenzy.lastRadioShowID());
+
+    // First poll is due immediately and finds a new track
+    ASSERT_TRUE(runUntil([&] { return tubafrenzy.server().requestCount() >= 2; }));
+
+    azuracast.setTrack(shId + 1, "Broadcast", "Pendulum", "Haha Sound & Co.");
+    ASSERT_TRUE(runUntil([&] { return tubafrenzy.server().requestCount() >= 3; }));
+
+    relayOpen();
+    ASSERT_TRUE(runUntil([] { return ctx.state == IDLE; }));
+
+    auto reqs = tubafrenzy.server().requests();
+    ASSERT_EQ(reqs.size(), 4u);
+
+    EXPECT_EQ(reqs[0].path, TUBAFRENZY_PATH_START_SHOW);
+    EXPECT_EQ(reqs[0].formField("djName"), AUTO_DJ_NAME);
+    EXPECT_EQ(reqs[0].formField("showName"), AUTO_DJ_SHOW_NAME);
+    EXPECT_FALSE(reqs[0].formField("startingHour").empty());
+
+    EXPECT_EQ(reqs[1].path, TUBAFRENZY_PATH_ADD_ENTRY);
+    EXPECT_EQ(reqs[1].formField("radioShowID"), std::to_string(tubafrenzy.lastRadioShowID()));
+    EXPECT_EQ(reqs[1].formField("artistName"), "Stereolab");
+    EXPECT_EQ(reqs[1].formField("songTitle"), "French Disko");
+    EXPECT_EQ(reqs[1].formField("releaseTitle"), "Jenny Ondioline");
+
+    EXPECT_EQ(reqs[2].path, TUBAFRENZY_PATH_ADD_ENTRY);
+    EXPECT_EQ(reqs[2].formField("artistName"), "Broadcast");
+    EXPECT_EQ(reqs[2].formField("releaseTitle"), "Haha Sound & Co.");
+
+    EXPECT_EQ(reqs[3].path, TUBAFRENZY_PATH_END_SHOW);
+    EXPECT_EQ(reqs[3].formField("mode"), "signoffConfirm");
+
+    for (const auto& r : reqs) {
+        EXPECT_EQ(r.header("X-Auto-DJ-Key"), AUTO_DJ_API_KEY);
+        EXPECT_EQ(r.header("Content-Type"), "application/x-www-form-urlencoded");
+    }
+}
+
+TEST_F(EmulationTest, SameTrackIsNotRepeated) {
+    azuracast.setTrack(nextShId(), "Yo La Tengo", "Autumn Sweater", "I Can Hear the Heart");
+
+    relayClosed();
+    ASSERT_TRUE(runUntil([&] { return tubafrenzy.server().requestCount() >= 2; }));
+
+    size_t polls = azuracast.server().requestCount();
+    runFor(3 * POLL_INTERVAL_MS);
+    EXPECT_GE(azuracast.server().requestCount(), polls + 2);
+    EXPECT_EQ(tubafrenzy.server().requestCount(), 2u); // start + one entry
+}
+
+TEST_F(EmulationTest, LiveDJTrackIsNotLogged) {
+    azuracast.setTrack(nextShId(), "Live", "Set", "");
+    azuracast.setLive(true);
+
+    relayClosed();
+    ASSERT_TRUE(runUntil([&] { return azuracast.server().requestCount() >= 2; }));
+    EXPECT_EQ(tubafrenzy.server().requestCount(), 1u); // start only
+}
+
+TEST_F(EmulationTest, UnreachableFlowsheetEndsInErrorState) {
+    emu::clearRoutes();
+    emu::routeHost(AZURACAST_HOST, AZURACAST_PORT, azuracast.server().port());
+
+    // Once the circuit breaker opens, each retry waits for its probe
+    relayClosed();
+    ASSERT_TRUE(runUntil([] { return ctx.state == ERROR_STATE; },
+                         MAX_RETRIES * BREAKER_OPEN_MS + 30000));
+    EXPECT_EQ(tubafrenzy.server().requestCount(), 0u);
+}
+
+// A failed startShow() backs off by deadline, not delay(): loop() keeps
+// returning promptly while the retry waits
+TEST_F(EmulationTest, RetryBackoffDoesNotBlockLoop) {
+    emu::clearRoutes();
+    emu::routeHost(AZURACAST_HOST, AZURACAST_PORT, azuracast.server().port());
+
+    relayClosed();
+    ASSERT_TRUE(runUntil([] { return ctx.backingOff; }));
+    EXPECT_EQ(ctx.state, STARTING_SHOW);
+    unsigned long before = millis();
+    loop();
+    EXPECT_LT(millis() - before, 10UL);
+    EXPECT_TRUE(ctx.backingOff);
+}
+
+static size_t occurrences(const std::string& haystack, const char* needle) {
+    size_t n = 0;
+    for (size_t at = haystack.find(needle); at != std::string::npos;
+         at = haystack.find(needle, at + 1)) {
+        n++;
+    }
+    return n;
+}
+
+TEST_F(EmulationTest, FlowsheetOutageOpensCircuitBreaker) {
+    emu::clearRoutes();
+    emu::routeHost(AZURACAST_HOST, AZURACAST_PORT, azuracast.server().port());
+
+    relayClosed();
+    ASSERT_TRUE(runUntil([] {
+        return ctx.state == STARTING_SHOW &&
+               flowsheet.circuitBreaker().state() == CircuitBreaker::OPEN;
+    }));
+
+    // For the rest of the open spell the show start waits for the probe:
+    // nothing is attempted and no retry is used up
+    unsigned long openFor = flowsheet.circuitBreaker().refusingForMs(millis());
+    ASSERT_GT(openFor, 1000UL);
+    int retries = ctx.retryCount;
+    emu::clearSerialOutput();
+    runFor(openFor - 1000);
+    EXPECT_EQ(occurrences(emu::serialOutput(), "[Flowsheet] Starting show..."), 0u);
+    EXPECT_EQ(ctx.state, STARTING_SHOW);
+    EXPECT_EQ(ctx.retryCount, retries);
+
+    // Once the host is back, a probe gets through and the show starts
+    emu::routeHost(TUBAFRENZY_HOST, TUBAFRENZY_PORT, tubafrenzy.server().port());
+    ASSERT_TRUE(runUntil([] { return ctx.state == AUTO_DJ_ACTIVE; }, BREAKER_OPEN_MS + 30000));
+    EXPECT_EQ(flowsheet.circuitBreaker().state(), CircuitBreaker::CLOSED);
+}
+
+// Response timeouts follow each host's round trips, and stretch while the
+// WiFi signal is weak
+TEST_F(EmulationTest, ResponseTimeoutsTrackLinkConditions) {
+    azuracast.setTrack(nextShId(), "Low", "Words", "I Could Live in Hope");
+    relayClosed();
+    ASSERT_TRUE(runUntil([&] { return entryCount() >= 1; }));
+
+    // Loopback answers within milliseconds: both hosts are down at the floor
+    EXPECT_GT(::azuracast.roundTrips().sampleCount(), 0UL);
+    EXPECT_EQ(::azuracast.roundTrips().timeoutMs(), (unsigned long)HTTP_TIMEOUT_MIN_MS);
+    EXPECT_EQ(flowsheet.responseTimeoutMs(), (unsigned long)HTTP_TIMEOUT_MIN_MS);
+
+    emu::setRssi(-85);
+    runFor(6 * LINK_SIGNAL_SAMPLE_MS);
+    EXPECT_LT(network.links().signalDbm(0), LINK_WEAK_SIGNAL_DBM);
+    EXPECT_EQ(flowsheet.responseTimeoutMs(), 2UL * HTTP_TIMEOUT_MIN_MS);
+
+    emu::setRssi(-58);
+    runFor(6 * LINK_SIGNAL_SAMPLE_MS);
+    EXPECT_EQ(flowsheet.responseTimeoutMs(), (unsigned long)HTTP_TIMEOUT_MIN_MS);
+    EXPECT_EQ(network.links().weakestSignalDbm(0), -85);
+}
+
+TEST_F(EmulationTest, LoopKeepsWatchdogFed) {
+    EXPECT_TRUE(emu::watchdogRunning());
+    azuracast.setTrack(nextShId(), "Low", "Words", "I Could Live in Hope");
+    relayClosed();
+    ASSERT_TRUE(runUntil([] { return ctx.state == AUTO_DJ_ACTIVE; }));
+    runFor(WATCHDOG_TIMEOUT_MS * 2);
+    EXPECT_FALSE(emu::watchdogExpired());
+    EXPECT_GT(emu::watchdogKicks(), 0UL);
+}
+
+TEST_F(EmulationTest, WatchdogResetIsAttributedAfterReboot) {
+    // startShow hangs: nothing kicks the watchdog until it fires
+    StallScope hung(STALL_START_SHOW);
+    emu::advanceMillis(WATCHDOG_TIMEOUT_MS);
+    ASSERT_TRUE(emu::watchdogExpired());
+
+    emu::watchdogReset();
+    boot();
+    const std::string& out = emu::serialOutput();
+    EXPECT_NE(out.find("[Watchdog] Watchdog reset during startShow, in flight 30000 ms."),
+              std::string::npos) << out;
+    EXPECT_EQ(stallDetector.current(), STALL_NONE);
+}
+
+TEST_F(EmulationTest, StartShowResponseAllocatesNothing) {
+    flowsheet.startShow(0); // warm up (log lines, first-use growth)
+
+    unsigned long before = memStats.module(MEM_FLOWSHEET).allocs;
+    int radioShowID = flowsheet.startShow(0);
+    EXPECT_GT(radioShowID, 0);
+    // Connecting is counted under MEM_NETWORK; composing the request,
+    // reading the 302 and parsing its Location take nothing from the heap
+    EXPECT_EQ(memStats.module(MEM_FLOWSHEET).allocs, before);
+}
+
+TEST_F(EmulationTest, WifiLossAndRecoveryResumesShow) {
+    azuracast.setTrack(nextShId(), "Low", "Words", "I Could Live in Hope");
+    relayClosed();
+    ASSERT_TRUE(runUntil([] { return ctx.state == AUTO_DJ_ACTIVE; }));
+    int showID = ctx.radioShowID;
+
+    emu::setWifiConnected(false);
+    ASSERT_TRUE(runUntil([] { return ctx.state == CONNECTING_WIFI; }));
+
+    emu::setWifiConnected(true);
+    ASSERT_TRUE(runUntil([] { return ctx.state == AUTO_DJ_ACTIVE; }));
+    EXPECT_EQ(ctx.radioShowID, showID);
+}
+
+// ========== Warm restart ==========
+
+TEST_F(EmulationTest, WarmRestartResumesOpenShow) {
+    int shId = nextShId();
+    azuracast.setTrack(shId, "Cocteau Twins", "Lorelei", "Head over Heels");
+    relayClosed();
+    ASSERT_TRUE(runUntil([&] { return entryCount() >= 1; }));
+    int showID = ctx.radioShowID;
+
+    reboot(LOW);
+    EXPECT_EQ(ctx.state, AUTO_DJ_ACTIVE);
+    EXPECT_EQ(ctx.radioShowID, showID);
+    EXPECT_NE(emu::serialOutput().find("[Checkpoint] Open show radioShowID="),
+              std::string::npos);
+
+    // Same track still playing: polled, not logged again, no new show
+    size_t polls = azuracast.server().requestCount();
+    runFor(2 * POLL_INTERVAL_MS);
+    EXPECT_GT(azuracast.server().requestCount(), polls);
+    EXPECT_EQ(tubafrenzy.server().requestCount(), 2u);
+
+    azuracast.setTrack(shId + 1, "Slowdive", "Alison", "Souvlaki");
+    ASSERT_TRUE(runUntil([&] { return entryCount() >= 2; }));
+    auto reqs = tubafrenzy.server().requests();
+    EXPECT_EQ(reqs.back().formField("radioShowID"), std::to_string(showID));
+    EXPECT_EQ(reqs.back().formField("artistName"), "Slowdive");
+}
+
+TEST_F(EmulationTest, RelayOpenedWhilePoweredDownSignsOff) {
+    azuracast.setTrack(nextShId(), "Galaxie 500", "Tugboat", "Today");
+    relayClosed();
+    ASSERT_TRUE(runUntil([&] { return entryCount() >= 1; }));
+    int showID = ctx.radioShowID;
+
+    reboot(HIGH);
+    EXPECT_EQ(ctx.state, ENDING_SHOW);
+    ASSERT_TRUE(runUntil([] { return ctx.state == IDLE; }));
+
+    auto reqs = tubafrenzy.server().requests();
+    EXPECT_EQ(reqs.back().path, TUBAFRENZY_PATH_END_SHOW);
+    EXPECT_EQ(reqs.back().formField("radioShowID"), std::to_string(showID));
+
+    // Nothing left to resume after that
+    reboot(HIGH);
+    EXPECT_EQ(ctx.state, IDLE);
+    EXPECT_EQ(ctx.radioShowID, -1);
+}
+
+TEST_F(EmulationTest, ClosedShowIsNotResumed) {
+    azuracast.setTrack(nextShId(), "Mazzy Star", "Fade into You", "So Tonight That I Might See");
+    relayClosed();
+    ASSERT_TRUE(runUntil([&] { return entryCount() >= 1; }));
+    relayOpen();
+    ASSERT_TRUE(runUntil([] { return ctx.state == IDLE; }));
+
+    reboot(LOW);
+    EXPECT_EQ(ctx.state, STARTING_SHOW);
+    ASSERT_TRUE(runUntil([] { return ctx.state == AUTO_DJ_ACTIVE; }));
+    EXPECT_EQ(tubafrenzy.server().requests()[3].path, TUBAFRENZY_PATH_START_SHOW);
+}
+
+TEST_F(EmulationTest, CheckpointsDoNotWriteEveryPoll) {
+    int shId = nextShId();
+    azuracast.setTrack(shId, "Artist", "Title", "Album");
+    relayClosed();
+    ASSERT_TRUE(runUntil([&] { return entryCount() >= 1; }));
+
+    unsigned long erases = emu::flashEraseCount();
+    for (int i = 1; i <= 10; i++) {
+        azuracast.setTrack(shId + i, "Artist", "Title", "Album");
+        runFor(POLL_INTERVAL_MS);
+    }
+    runFor(10 * POLL_INTERVAL_MS); // no track changes
+    // At most one record per track: 4 x 4 KB sectors hold 512 of them
+    EXPECT_LE(emu::flashEraseCount() - erases, 1u);
+}
+
+// Virtual time from power-on to the first flowsheet entry for a track that
+// started during 30 s without power: a cold boot starts a new show first, a
+// warm restart resumes the checkpointed one and, its poll being overdue,
+// polls at once.
+TEST_F(EmulationTest, PowerOnToFirstEntry) {
+    int shId = nextShId();
+    auto measure = [&](bool warm) {
+        if (!warm) emu::eraseFlash();
+        azuracast.setTrack(++shId, "Artist", "Title", "Album");
+        size_t before = entryCount();
+        reboot(LOW, 30000);
+        EXPECT_TRUE(runUntil([&] { return entryCount() > before; }));
+        return millis();
+    };
+
+    unsigned long coldMs = measure(false);
+    unsigned long warmMs = measure(true);
+    printf("[Emulation] power-on to first entry: cold %lu ms, warm %lu ms\n", coldMs, warmMs);
+    EXPECT_LT(warmMs, coldMs);
+    EXPECT_LE(warmMs, FLOWSHEET_ENTRY_HOLD_MS + 1000);
+    RecordProperty("cold_ms", (int)coldMs);
+    RecordProperty("warm_ms", (int)warmMs);
+}
+
+// Virtual time from the relay contact closing to the first flowsheet entry.
+// The now-playing track is fetched and the flowsheet connection opened
+// while the contact settles, so startShow and the first entry go out
+// together instead of a poll and an entry hold later.
+TEST_F(EmulationTest, RelayEdgeToFirstEntry) {
+    const unsigned CONNECT_MS = 20;
+    emu::setConnectLatencyMs(CONNECT_MS);
+    int shId = nextShId();
+    azuracast.setTrack(shId, "Artist", "Title", "Album");
+    runFor(IDLE_WARM_INTERVAL_MS + 1000);
+    EXPECT_GE(azuracast.server().requestCount(), 1u);
+    EXPECT_EQ(tubafrenzy.server().requestCount(), 0u);
+
+    size_t before = tubafrenzy.server().requestCount();
+    relayClosed();
+    unsigned long edge = millis();
+    while (entryCount() == 0 && millis() - edge < 30000) {
+        loop();
+        emu::advanceMillis(1);
+    }
+    unsigned long latencyMs = millis() - edge;
+    printf("[Emulation] relay edge to first entry: %lu ms\n", latencyMs);
+    ASSERT_EQ(entryCount(), 1u);
+    EXPECT_LT(latencyMs, (unsigned long)FLOWSHEET_ENTRY_HOLD_MS);
+
+    auto reqs = tubafrenzy.server().requests();
+    ASSERT_EQ(reqs.size(), before + 2);
+    EXPECT_EQ(reqs[before].path, TUBAFRENZY_PATH_START_SHOW);
+    EXPECT_EQ(reqs[before + 1].formField("artistName"), "Artist");
+    runFor(1000); // drain the serial log
+    EXPECT_NE(emu::serialOutput().find("Connection opened ahead of the show"), std::string::npos);
+    EXPECT_NE(emu::serialOutput().find("after the relay closed"), std::string::npos);
+    RecordProperty("edge_to_entry_ms", (int)latencyMs);
+}
+
+// A contact glitch warms up but never starts a show
+TEST_F(EmulationTest, RelayGlitchStartsNoShow) {
+    azuracast.setTrack(nextShId(), "Artist", "Title", "Album");
+    relayClosed();
+    loop();
+    emu::advanceMillis(1);
+    loop();
+    relayOpen();
+    runFor(5000);
+    EXPECT_EQ(ctx.state, IDLE);
+    EXPECT_EQ(tubafrenzy.server().requestCount(), 0u);
+}
+
+// ========== Memory ==========
+
+// Steady-state polling must not grow the heap: every module's retained
+// bytes are the same after 20 more poll+entry cycles as after warm-up.
+TEST_F(EmulationTest, PollCyclesDoNotLeak) {
+    int shId = nextShId();
+    azuracast.setTrack(shId, "Artist", "Title", "Album");
+    relayClosed();
+    ASSERT_TRUE(runUntil([&] { return tubafrenzy.server().requestCount() >= 2; }));
+
+    auto cycle = [&](int i) {
+        azuracast.setTrack(++shId, "Artist " + std::to_string(i), "Title", "Album");
+        emu::advanceMillis(POLL_INTERVAL_MS);
+        loop();
+    };
+    for (int i = 0; i < 5; i++) cycle(i); // warm up (log lines, first-use growth)
+
+    long before[MEM_MODULE_COUNT];
+    for (int m = 0; m < MEM_MODULE_COUNT; m++) before[m] = memStats.module((MemModule)m).retained;
+    unsigned long allocsBefore = memStats.module(MEM_AZURACAST).allocs;
+
+    for (int i = 5; i < 25; i++) cycle(i);
+
+    EXPECT_GT(memStats.module(MEM_AZURACAST).allocs, allocsBefore);
+    for (int m = MEM_OTHER + 1; m < MEM_MODULE_COUNT; m++) {
+        EXPECT_EQ(memStats.module((MemModule)m).retained, before[m])
+            << memModuleName((MemModule)m) << " leaked";
+    }
+    EXPECT_GT(memStats.module(MEM_AZURACAST).peak, 0u);
+}
+
+TEST_F(EmulationTest, MemStatsAreLoggedPeriodically) {
+    runFor(MEM_STATS_INTERVAL_MS + 1000);
+    const std::string& out = emu::serialOutput();
+    EXPECT_NE(out.find("[Mem] heap "), std::string::npos);
+    EXPECT_NE(out.find("[Mem]   azuracast: "), std::string::npos);
+    EXPECT_GT(memStats.minStackFree(), 0u);
+}
+
+// ========== Pipelining ==========
+
+TEST_F(EmulationTest, FinalEntryIsPipelinedWithSignOff) {
+    int shId = nextShId();
+    azuracast.setTrack(shId, "Stereolab", "French Disko", "Jenny Ondioline");
+    relayClosed();
+    ASSERT_TRUE(runUntil([&] { return tubafrenzy.server().requestCount() >= 2; }));
+
+    // New track, then the relay opens before the entry's hold runs out
+    azuracast.setTrack(shId + 1, "Broadcast", "Pendulum", "Haha Sound & Co.");
+    size_t polls = azuracast.server().requestCount();
+    ASSERT_TRUE(runUntil([&] { return azuracast.server().requestCount() > polls; }));
+    EXPECT_EQ(flowsheet.queuedEntries(), 1);
+    relayOpen();
+    ASSERT_TRUE(runUntil([] { return ctx.state == IDLE; }));
+
+    auto reqs = tubafrenzy.server().requests();
+    ASSERT_EQ(reqs.size(), 4u);
+    EXPECT_EQ(reqs[2].path, TUBAFRENZY_PATH_ADD_ENTRY);
+    EXPECT_EQ(reqs[2].formField("artistName"), "Broadcast");
+    EXPECT_EQ(reqs[3].path, TUBAFRENZY_PATH_END_SHOW);
+    EXPECT_EQ(reqs[3].connection, reqs[2].connection);
+    EXPECT_NE(reqs[1].connection, reqs[2].connection);
+}
+
+TEST_F(EmulationTest, EntriesQueuedDuringOutageArePipelined) {
+    emu::clearRoutes(); // flowsheet unreachable
+    flowsheet.queueEntry(5001, 1705345200000UL, "Low", "Words", "I Could Live in Hope");
+    flowsheet.queueEntry(5001, 1705345200000UL, "Low", "Shame", "I Could Live in Hope");
+    EXPECT_FALSE(flowsheet.flush());
+    EXPECT_EQ(flowsheet.queuedEntries(), 2);
+
+    emu::routeHost(TUBAFRENZY_HOST, TUBAFRENZY_PORT, tubafrenzy.server().port());
+    flowsheet.queueEntry(5001, 1705345200000UL, "Low", "Lazy", "I Could Live in Hope");
+    EXPECT_TRUE(flowsheet.flush());
+    EXPECT_EQ(flowsheet.queuedEntries(), 0);
+
+    auto reqs = tubafrenzy.server().requests();
+    ASSERT_EQ(reqs.size(), 3u);
+    EXPECT_EQ(reqs[0].formField("songTitle"), "Words");
+    EXPECT_EQ(reqs[1].formField("songTitle"), "Shame");
+    EXPECT_EQ(reqs[2].formField("songTitle"), "Lazy");
+    EXPECT_EQ(reqs[0].connection, reqs[2].connection);
+}
+
+// A long non-ASCII title no longer fits the request whole: it is posted
+// clipped to whole characters rather than dropped
+TEST_F(EmulationTest, LongTitleIsClippedNotDropped) {
+    std::string title;
+    for (int i = 0; i < 400; i++) title += "\xC3\xA9"; // six bytes URL-encoded
+    EXPECT_TRUE(flowsheet.addEntry(5001, 1705345200000UL, "Arvo P\xC3\xA4rt", String(title.c_str()),
+                                   "Tabula Rasa"));
+
+    auto reqs = tubafrenzy.server().requests();
+    ASSERT_EQ(reqs.size(), 1u);
+    EXPECT_EQ(reqs[0].formField("songTitle"), title.substr(0, 2 * (FLOWSHEET_FIELD_MAX / 6)));
+    EXPECT_EQ(reqs[0].formField("artistName"), "Arvo P\xC3\xA4rt");
+}
+
+// A server that closes after each response has not processed the requests
+// behind it, so those are resent, each exactly once.
+TEST_F(EmulationTest, ServerClosingMidPipelineResendsTheRest) {
+    tubafrenzy.server().setRequestsPerConnection(1);
+    flowsheet.queueEntry(5001, 1705345200000UL, "Can", "Vitamin C", "Ege Bamyasi");
+    flowsheet.queueEntry(5001, 1705345200000UL, "Can", "Spoon", "Ege Bamyasi");
+    EXPECT_TRUE(flowsheet.endShow(5001));
+
+    auto reqs = tubafrenzy.server().requests();
+    ASSERT_EQ(reqs.size(), 3u);
+    EXPECT_EQ(reqs[0].formField("songTitle"), "Vitamin C");
+    EXPECT_EQ(reqs[1].formField("songTitle"), "Spoon");
+    EXPECT_EQ(reqs[2].path, TUBAFRENZY_PATH_END_SHOW);
+    EXPECT_NE(reqs[0].connection, reqs[1].connection);
+    EXPECT_NE(reqs[1].connection, reqs[2].connection);
+}
+
+// A connection that dies mid-pipeline may have been acted on: the
+// unanswered entries are dropped rather than risk duplicates, and only the
+// sign-off (which the state machine retries anyway) is sent again.
+TEST_F(EmulationTest, DroppedConnectionMidPipelineIsNotResent) {
+    tubafrenzy.server().hangUpAfter(2);
+    flowsheet.queueEntry(5001, 1705345200000UL, "Can", "Vitamin C", "Ege Bamyasi");
+    flowsheet.queueEntry(5001, 1705345200000UL, "Can", "Spoon", "Ege Bamyasi");
+    flowsheet.queueEntry(5001, 1705345200000UL, "Can", "Sing Swan Song", "Ege Bamyasi");
+    EXPECT_FALSE(flowsheet.endShow(5001));
+    EXPECT_EQ(flowsheet.queuedEntries(), 0);
+    runFor(1000); // drain the log
+    EXPECT_NE(emu::serialOutput().find("unanswered, not resent: Can - Sing Swan Song"),
+              std::string::npos);
+
+    EXPECT_TRUE(flowsheet.endShow(5001));
+    auto reqs = tubafrenzy.server().requests();
+    ASSERT_EQ(reqs.size(), 3u);
+    EXPECT_EQ(reqs[0].formField("songTitle"), "Vitamin C");
+    EXPECT_EQ(reqs[1].formField("songTitle"), "Spoon");
+    EXPECT_EQ(reqs[2].path, TUBAFRENZY_PATH_END_SHOW);
+}
+
+TEST_F(EmulationTest, AbandonedSignOffDiscardsHeldEntries) {
+    int shId = nextShId();
+    azuracast.setTrack(shId, "Stereolab", "French Disko", "Jenny Ondioline");
+    relayClosed();
+    ASSERT_TRUE(runUntil([&] { return tubafrenzy.server().requestCount() >= 2; }));
+
+    azuracast.setTrack(shId + 1, "Broadcast", "Pendulum", "Haha Sound & Co.");
+    size_t polls = azuracast.server().requestCount();
+    ASSERT_TRUE(runUntil([&] { return azuracast.server().requestCount() > polls; }));
+    emu::clearRoutes(); // flowsheet goes away before the sign-off
+    relayOpen();
+    ASSERT_TRUE(runUntil([] { return ctx.state == IDLE; }));
+    EXPECT_EQ(flowsheet.queuedEntries(), 0);
+    EXPECT_EQ(tubafrenzy.server().requestCount(), 2u);
+}
+
+// ========== Throughput and latency ==========
+
+// Socket cost of each flowsheet request: the whole request should leave in
+// one write.
+TEST_F(EmulationTest, FlowsheetRequestWriteCost) {
+    struct Case { const char* name; std::function<bool()> call; };
+    Case cases[] = {
+        {"startShow", [] { return flowsheet.startShow(1705345200000UL) > 0; }},
+        {"addEntry", [] { return flowsheet.addEntry(5001, 1705345200000UL, "Stereolab",
+                                                    "French Disko", "Jenny Ondioline"); }},
+        {"endShow", [] { return flowsheet.endShow(5001); }},
+    };
+    for (auto& c : cases) {
+        emu::resetSocketStats();
+        ASSERT_TRUE(c.call()) << c.name;
+        emu::SocketStats stats = emu::socketStats();
+        printf("[Emulation] %-9s %lu write calls, %lu bytes out\n",
+               c.name, stats.writeCalls, stats.bytesWritten);
+        EXPECT_EQ(stats.writeCalls, 1u) << c.name;
+    }
+}
+
+// Times each loop() iteration that performs network I/O, in real time.
+TEST_F(EmulationTest, PollAndEntryThroughput) {
+    const int CYCLES = 100;
+    int shId = nextShId();
+    azuracast.setTrack(shId, "Artist", "Title", "Album");
+
+    relayClosed();
+    ASSERT_TRUE(runUntil([] { return ctx.state == AUTO_DJ_ACTIVE; }));
+
+    std::vector<double> cycleUs;
+    emu::resetSocketStats();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < CYCLES; i++) {
+        azuracast.setTrack(++shId, "Artist " + std::to_string(i), "Title", "Album");
+        emu::advanceMillis(POLL_INTERVAL_MS);
+        auto t0 = std::chrono::steady_clock::now();
+        loop(); // poll + the previous cycle's held entry
+        auto t1 = std::chrono::steady_clock::now();
+        cycleUs.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+    }
+    double totalSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    emu::SocketStats stats = emu::socketStats();
+
+    emu::advanceMillis(FLOWSHEET_ENTRY_HOLD_MS);
+    loop(); // last entry
+    // startShow, the track playing when the show started, one entry per cycle
+    ASSERT_EQ(tubafrenzy.server().requestCount(), (size_t)CYCLES + 2);
+
+    std::sort(cycleUs.begin(), cycleUs.end());
+    double p50 = cycleUs[CYCLES / 2];
+    double p99 = cycleUs[CYCLES * 99 / 100];
+    printf("[Emulation] %d poll+entry cycles in %.3fs (%.0f cycles/s), "
+           "p50 %.0fus, p99 %.0fus\n",
+           CYCLES, totalSec, CYCLES / totalSec, p50, p99);
+    printf("[Emulation] per cycle: %.1f connects, %.1f socket writes, "
+           "%.0f bytes out, %.0f bytes in (payload %zu bytes)\n",
+           (double)stats.connects / CYCLES, (double)stats.writeCalls / CYCLES,
+           (double)stats.bytesWritten / CYCLES, (double)stats.bytesRead / CYCLES,
+           azuracast.payloadSize());
+
+    RecordProperty("cycles_per_sec", (int)(CYCLES / totalSec));
+    RecordProperty("p99_us", (int)p99);
+    RecordProperty("writes_per_cycle", (int)(stats.writeCalls / CYCLES));
+}
+
+// Wall time for the final entry (or a backlog of three) plus the sign-off,
+// sent one request per connection versus pipelined on one connection. Each
+// connect costs CONNECT_MS, standing in for the TCP and TLS handshakes.
+TEST_F(EmulationTest, PipelinedSignOffLatency) {
+    const unsigned CONNECT_MS = 20;
+    const int RUNS = 5;
+    emu::setConnectLatencyMs(CONNECT_MS);
+
+    auto measure = [&](int entries, bool pipelined) {
+        double totalMs = 0;
+        for (int run = 0; run < RUNS; run++) {
+            auto t0 = std::chrono::steady_clock::now();
+            for (int i = 0; i < entries; i++) {
+                String title = String("Track ") + String(i);
+                if (pipelined) {
+                    flowsheet.queueEntry(5001, 1705345200000UL, "Artist", title, "Album");
+                } else {
+                    EXPECT_TRUE(flowsheet.addEntry(5001, 1705345200000UL, "Artist", title,
+                                                   "Album"));
+                }
+            }
+            EXPECT_TRUE(flowsheet.endShow(5001));
+            totalMs += std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - t0).count();
+        }
+        return totalMs / RUNS;
+    };
+
+    for (int entries : {1, 3}) {
+        emu::resetSocketStats();
+        double sequentialMs = measure(entries, false);
+        unsigned long sequentialConnects = emu::socketStats().connects / RUNS;
+        emu::resetSocketStats();
+        double pipelinedMs = measure(entries, true);
+        unsigned long pipelinedConnects = emu::socketStats().connects / RUNS;
+
+        printf("[Emulation] %d entr%s + sign-off: sequential %.1f ms (%lu connects), "
+               "pipelined %.1f ms (%lu connect)\n",
+               entries, entries == 1 ? "y" : "ies", sequentialMs, sequentialConnects,
+               pipelinedMs, pipelinedConnects);
+        EXPECT_EQ(sequentialConnects, (unsigned long)entries + 1);
+        EXPECT_EQ(pipelinedConnects, 1u);
+        EXPECT_LT(pipelinedMs, sequentialMs);
+    }
+    EXPECT_EQ(tubafrenzy.server().requestCount(), (size_t)RUNS * 2 * (2 + 4));
+}
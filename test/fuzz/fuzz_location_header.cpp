@@ -0,0 +1,32 @@
+/**
+ * Fuzz target for the startRadioShow response path: the input is the raw
+ * HTTP response (status line, headers, body) that FlowsheetClient reads the
+ * Location header from before parsing the radioShowID out of it.
+ */
+#include "flowsheet_client.h"
+#include "loopback_transport.h"
+#include "log_buffer.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+static MemoryTransport transport;
+static NetworkManager network(LINK_FAILURE_THRESHOLD, LINK_COOLDOWN_MS, LINK_PREFERENCE_MS);
+static FlowsheetClient flowsheet(network, TUBAFRENZY_HOST, TUBAFRENZY_PORT, "fuzz-key");
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    static bool initialized = false;
+    if (!initialized) {
+        network.addTransport(transport);
+        network.setUp();
+        initialized = true;
+    }
+
+    transport.client.load(std::string(reinterpret_cast<const char*>(data), size));
+
+    int id = flowsheet.startShow(1705345200000UL);
+    if (id == 0 || id < -1) abort();
+
+    drainSerialLog();
+    return 0;
+}
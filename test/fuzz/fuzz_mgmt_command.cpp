@@ -0,0 +1,45 @@
+/**
+ * Fuzz target for the management channel decoders. The first byte picks
+ * the encoding; the rest is one message, decoded as a command (what the
+ * device receives) and, for MessagePack, as a heartbeat. A decoded command
+ * must have a terminated id within MgmtCommand and must re-encode to a
+ * command that decodes to the same fields.
+ */
+#include "mgmt_codec.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size < 1) return 0;
+    MgmtEncoding encoding = data[0] & 1 ? MGMT_MSGPACK : MGMT_JSON;
+    data++;
+    size--;
+
+    MgmtCommand cmd;
+    if (decodeCommand(encoding, data, size, &cmd) == MGMT_DECODE_OK) {
+        if (strnlen(cmd.id, sizeof(cmd.id)) >= sizeof(cmd.id)) abort();
+        if (strnlen(cmd.key, sizeof(cmd.key)) >= sizeof(cmd.key)) abort();
+        if (strnlen(cmd.value, sizeof(cmd.value)) >= sizeof(cmd.value)) abort();
+
+        if (cmd.action != MGMT_ACTION_UNKNOWN && strlen(cmd.id) > 0 &&
+            strspn(cmd.id, "abcdefghijklmnopqrstuvwxyz0123456789-") == strlen(cmd.id)) {
+            uint8_t buf[512];
+            size_t n = encodeCommand(encoding, cmd, buf, sizeof(buf));
+            MgmtCommand again;
+            if (n == 0 || decodeCommand(encoding, buf, n, &again) != MGMT_DECODE_OK) abort();
+            if (strcmp(again.id, cmd.id) != 0 || again.action != cmd.action) abort();
+        }
+    }
+
+    if (encoding == MGMT_MSGPACK) {
+        HeartbeatDecoder decoder;
+        Heartbeat hb;
+        if (decoder.decode(data, size, &hb) == MGMT_DECODE_OK) {
+            if (hb.state > ERROR_STATE) abort();
+            if (hb.firmwareVersion && strlen(hb.firmwareVersion) >= MGMT_STRING_MAX) abort();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,36 @@
+/**
+ * Fuzz target for the now-playing path: the input is served as the body of
+ * a 200 response to AzuraCastClient::poll(), which runs the filtered JSON
+ * parse and field extraction exactly as on the device.
+ */
+#include "azuracast_client.h"
+#include "loopback_transport.h"
+#include "log_buffer.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+static MemoryTransport transport;
+static NetworkManager network(LINK_FAILURE_THRESHOLD, LINK_COOLDOWN_MS, LINK_PREFERENCE_MS);
+static AzuraCastClient azuracast(network, AZURACAST_HOST, AZURACAST_PORT, AZURACAST_PATH);
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    static bool initialized = false;
+    if (!initialized) {
+        network.addTransport(transport);
+        network.setUp();
+        initialized = true;
+    }
+
+    std::string response = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                           "Content-Length: " + std::to_string(size) + "\r\n\r\n";
+    response.append(reinterpret_cast<const char*>(data), size);
+    transport.client.load(response);
+
+    if (azuracast.poll()) {
+        if (azuracast.getShId() == 0) abort(); // a new track always has an sh_id
+    }
+
+    drainSerialLog();
+    return 0;
+}
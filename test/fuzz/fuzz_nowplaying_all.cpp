@@ -0,0 +1,45 @@
+/**
+ * Fuzz target for the all-stations now-playing path: the input is served as
+ * the body of a 200 response to NowPlayingFanout::poll(), which walks the
+ * array element by element and dispatches to two subscribed stations.
+ */
+#include "azuracast_client.h"
+#include "loopback_transport.h"
+#include "log_buffer.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+class CheckingConsumer : public NowPlayingConsumer {
+public:
+    void onTrackChange(const char*, const NowPlayingTrack& track) override {
+        if (track.shId == 0) abort(); // only real tracks are delivered
+    }
+};
+
+static MemoryTransport transport;
+static NetworkManager network(LINK_FAILURE_THRESHOLD, LINK_COOLDOWN_MS, LINK_PREFERENCE_MS);
+static NowPlayingFanout fanout(network, AZURACAST_HOST, AZURACAST_PORT, AZURACAST_ALL_PATH);
+static CheckingConsumer mainStation, hd2Station;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    static bool initialized = false;
+    if (!initialized) {
+        network.addTransport(transport);
+        network.setUp();
+        fanout.subscribe("main", mainStation);
+        fanout.subscribe("hd2", hd2Station);
+        initialized = true;
+    }
+
+    std::string response = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                           "Content-Length: " + std::to_string(size) + "\r\n\r\n";
+    response.append(reinterpret_cast<const char*>(data), size);
+    transport.client.load(response);
+
+    int changes = fanout.poll();
+    if (changes > 2 * fanout.stationCount()) abort();
+
+    drainSerialLog();
+    return 0;
+}
@@ -0,0 +1,19 @@
+/**
+ * Fuzz target for parseRadioShowID(): any Location value must yield either
+ * -1 or a positive ID, and a positive ID only when the key is present.
+ */
+#include "utils.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    size_t len = 0;
+    while (len < size && data[len] != 0) len++;
+    String location(reinterpret_cast<const char*>(data), (unsigned int)len);
+
+    int id = parseRadioShowID(location);
+    if (id == 0 || id < -1) abort();
+    if (id > 0 && location.indexOf("radioShowID=") < 0) abort();
+    return 0;
+}
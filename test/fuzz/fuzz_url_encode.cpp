@@ -0,0 +1,48 @@
+/**
+ * Fuzz target for urlEncode(): the output must use only unreserved
+ * characters, '+' and well-formed %XX escapes, and must decode back to the
+ * input byte for byte.
+ */
+#include "utils.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    // Arduino Strings are NUL-terminated; the sketch never sees embedded NULs
+    size_t len = 0;
+    while (len < size && data[len] != 0) len++;
+    String input(reinterpret_cast<const char*>(data), (unsigned int)len);
+
+    String encoded = urlEncode(input);
+
+    std::string decoded;
+    const std::string& e = encoded.str();
+    for (size_t i = 0; i < e.size(); i++) {
+        char c = e[i];
+        if (c == '+') {
+            decoded += ' ';
+        } else if (c == '%') {
+            if (i + 2 >= e.size()) abort(); // truncated escape
+            int hi = hexValue(e[i + 1]);
+            int lo = hexValue(e[i + 2]);
+            if (hi < 0 || lo < 0) abort();
+            decoded += (char)(hi * 16 + lo);
+            i += 2;
+        } else if (isAlphaNumeric(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            decoded += c;
+        } else {
+            abort(); // reserved character leaked through
+        }
+    }
+    if (decoded != input.str()) abort();
+    return 0;
+}
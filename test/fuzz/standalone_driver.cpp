@@ -0,0 +1,218 @@
+/**
+ * Standalone driver for the fuzz targets, for toolchains without libFuzzer
+ * (the project's CI compiler is GCC). It accepts the libFuzzer flags the
+ * ctest entries use, so each target runs unchanged under either:
+ *
+ *   fuzz_target [-runs=N] [-seed=N] [-max_len=N] [-max_total_time=S] CORPUS...
+ *
+ * Every corpus file is executed once, then -runs mutated inputs derived from
+ * the corpus (bit flips, byte edits, block insert/erase/duplicate, splices,
+ * and dictionary tokens typical of HTTP and JSON). Mutations are
+ * deterministic for a given -seed. A file given on its own is simply
+ * replayed, to reproduce a crash.
+ *
+ * On a crash (abort, signal, or sanitizer report) the current input is
+ * written to crash-<target>. Throughput is printed as execs/sec so parser
+ * speed regressions show up in the test log next to crashes.
+ */
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+// Provided by the sanitizer runtime when linked; null otherwise
+extern "C" void __sanitizer_set_death_callback(void (*callback)(void)) __attribute__((weak));
+
+static const char* const DICTIONARY[] = {
+    "HTTP/1.1 ", "200 OK", "302 Found", "\r\n", "\r\n\r\n", "Location: ",
+    "Content-Length: ", "radioShowID=", "&", "%", "%00", "+",
+    "{", "}", "[", "]", ":", ",", "\"", "\\u00e9", "\\\"", "null", "true", "false",
+    "\"now_playing\"", "\"sh_id\"", "\"song\"", "\"artist\"", "\"title\"", "\"album\"",
+    "\"live\"", "\"is_live\"", "2147483647", "-1", "0", "1e308",
+};
+
+static std::string targetName;
+static const std::string* currentInput = nullptr;
+
+static void saveCurrentInput() {
+    if (!currentInput) return;
+    // Only async-signal-safe calls from here on
+    char path[256] = "crash-";
+    std::strncat(path, targetName.c_str(), sizeof(path) - 8);
+    int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        ssize_t ignored = ::write(fd, currentInput->data(), currentInput->size());
+        (void)ignored;
+        ::close(fd);
+        const char msg[] = "\n[fuzz] crashing input written to ";
+        ignored = ::write(2, msg, sizeof(msg) - 1);
+        ignored = ::write(2, path, std::strlen(path));
+        ignored = ::write(2, "\n", 1);
+    }
+    currentInput = nullptr;
+}
+
+static void onSignal(int sig) {
+    saveCurrentInput();
+    ::signal(sig, SIG_DFL);
+    ::raise(sig);
+}
+
+static bool readFile(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    out = ss.str();
+    return true;
+}
+
+static void loadCorpus(const std::string& path, std::vector<std::string>& corpus) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) return;
+    if (!S_ISDIR(st.st_mode)) {
+        std::string data;
+        if (readFile(path, data)) corpus.push_back(data);
+        return;
+    }
+    DIR* dir = ::opendir(path.c_str());
+    if (!dir) return;
+    std::vector<std::string> names;
+    while (dirent* entry = ::readdir(dir)) {
+        if (entry->d_name[0] != '.') names.push_back(entry->d_name);
+    }
+    ::closedir(dir);
+    std::sort(names.begin(), names.end()); // stable order for reproducible runs
+    for (const auto& name : names) loadCorpus(path + "/" + name, corpus);
+}
+
+static void mutate(std::string& data, const std::vector<std::string>& corpus,
+                   std::mt19937& rng, size_t maxLen) {
+    auto pick = [&](size_t n) { return n == 0 ? 0 : (size_t)(rng() % n); };
+    int rounds = 1 + (int)pick(4);
+    for (int r = 0; r < rounds; r++) {
+        switch (pick(8)) {
+            case 0: // flip a bit
+                if (!data.empty()) data[pick(data.size())] ^= (char)(1 << pick(8));
+                break;
+            case 1: // random byte
+                if (!data.empty()) data[pick(data.size())] = (char)pick(256);
+                break;
+            case 2: // insert random bytes
+                data.insert(pick(data.size() + 1), std::string(1 + pick(4), (char)pick(256)));
+                break;
+            case 3: { // erase a block
+                if (data.empty()) break;
+                size_t at = pick(data.size());
+                data.erase(at, 1 + pick(data.size() - at));
+                break;
+            }
+            case 4: { // duplicate a block
+                if (data.empty()) break;
+                size_t at = pick(data.size());
+                std::string block = data.substr(at, 1 + pick(16));
+                data.insert(pick(data.size() + 1), block);
+                break;
+            }
+            case 5: { // splice with another corpus entry
+                const std::string& other = corpus[pick(corpus.size())];
+                size_t cut = pick(data.size() + 1);
+                data = data.substr(0, cut) + other.substr(pick(other.size() + 1));
+                break;
+            }
+            case 6: { // dictionary token
+                const char* token = DICTIONARY[pick(sizeof(DICTIONARY) / sizeof(DICTIONARY[0]))];
+                data.insert(pick(data.size() + 1), token);
+                break;
+            }
+            default: { // replace a digit run with an extreme number
+                size_t at = data.find_first_of("0123456789", pick(data.size() + 1));
+                if (at == std::string::npos) break;
+                size_t end = data.find_first_not_of("0123456789", at);
+                if (end == std::string::npos) end = data.size();
+                static const char* const NUMBERS[] = {
+                    "0", "-1", "2147483648", "99999999999999999999", "4294967296", "1e400"
+                };
+                data.replace(at, end - at, NUMBERS[pick(6)]);
+                break;
+            }
+        }
+    }
+    if (data.size() > maxLen) data.resize(maxLen);
+}
+
+static void run(const std::string& input) {
+    currentInput = &input;
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+    currentInput = nullptr;
+}
+
+int main(int argc, char** argv) {
+    const char* slash = std::strrchr(argv[0], '/');
+    targetName = slash ? slash + 1 : argv[0];
+
+    unsigned long runs = 0;
+    unsigned long seed = 1;
+    size_t maxLen = 16384;
+    double maxTotalTime = 0;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        if (std::strncmp(argv[i], "-runs=", 6) == 0) runs = std::strtoul(argv[i] + 6, nullptr, 10);
+        else if (std::strncmp(argv[i], "-seed=", 6) == 0) seed = std::strtoul(argv[i] + 6, nullptr, 10);
+        else if (std::strncmp(argv[i], "-max_len=", 9) == 0) maxLen = std::strtoul(argv[i] + 9, nullptr, 10);
+        else if (std::strncmp(argv[i], "-max_total_time=", 16) == 0) maxTotalTime = std::atof(argv[i] + 16);
+        else if (argv[i][0] == '-') std::fprintf(stderr, "[fuzz] ignoring flag %s\n", argv[i]);
+        else paths.push_back(argv[i]);
+    }
+
+    ::signal(SIGABRT, onSignal);
+    ::signal(SIGSEGV, onSignal);
+    ::signal(SIGBUS, onSignal);
+    ::signal(SIGFPE, onSignal);
+    ::signal(SIGILL, onSignal);
+    if (__sanitizer_set_death_callback) __sanitizer_set_death_callback(saveCurrentInput);
+
+    std::vector<std::string> corpus;
+    for (const auto& p : paths) loadCorpus(p, corpus);
+    if (corpus.empty()) corpus.push_back(std::string());
+
+    auto start = std::chrono::steady_clock::now();
+    unsigned long execs = 0;
+    for (const auto& input : corpus) {
+        run(input);
+        execs++;
+    }
+
+    std::mt19937 rng((std::mt19937::result_type)seed);
+    for (unsigned long i = 0; i < runs; i++) {
+        std::string input = corpus[rng() % corpus.size()];
+        mutate(input, corpus, rng, maxLen);
+        run(input);
+        execs++;
+        if (maxTotalTime > 0 && (i & 63) == 0 &&
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > maxTotalTime) {
+            break;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("[fuzz] %s: %zu seeds, %lu execs in %.3fs, %.0f exec/s (seed %lu)\n",
+                targetName.c_str(), corpus.size(), execs, seconds,
+                seconds > 0 ? execs / seconds : 0.0, seed);
+    return 0;
+}
@@ -0,0 +1,187 @@
+/**
+ * HTTPS load and latency harness for the client request paths. Stand-ins
+ * for tubafrenzy (startRadioShow, flowsheetEntryAdd, finishRadioShow) and
+ * AzuraCast (nowplaying_static) serve real TLS on localhost with a
+ * self-signed certificate, and the sketch's own FlowsheetClient and
+ * AzuraCastClient talk to them through the emulated WiFiSSLClient, so every
+ * request pays a real handshake, encryption and parse on the host.
+ *
+ * For each endpoint it prints the requests per second, the share of the
+ * wall time spent in TLS handshakes, and the latency percentiles of single
+ * requests. Built when OpenSSL is found; ctest runs a short pass.
+ *
+ *   https_load [--requests=N] [--connect-ms=N] [--delay-ms=N]
+ *              [--body-bytes=N] [--nowplaying-bytes=N] [--plain]
+ *
+ * --connect-ms adds that much to every connect, standing in for the round
+ * trips of a real network; --delay-ms holds every response that long.
+ * --body-bytes pads the flowsheet responses and --nowplaying-bytes the
+ * now-playing document (~10 KB as served) to at least that size. --plain
+ * runs the same load without TLS, for comparison.
+ */
+#include "azuracast_client.h"
+#include "config.h"
+#include "emulation.h"
+#include "flowsheet_client.h"
+#include "log_buffer.h"
+#include "loopback_transport.h"
+#include "standin_server.h"
+#include <WiFiSSLClient.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define API_KEY "load-key"
+#define SHOW_HOUR_MS 1705345200000UL
+
+// ========== Helpers ==========
+
+struct Options {
+    int requests = 200;
+    unsigned connectMs = 0;
+    unsigned delayMs = 0;
+    size_t bodyBytes = 0;
+    size_t nowPlayingBytes = 0;
+    bool tls = true;
+};
+
+static bool parseOption(const char* arg, const char* name, unsigned long* value) {
+    size_t len = strlen(name);
+    if (strncmp(arg, name, len) != 0 || arg[len] != '=') return false;
+    *value = strtoul(arg + len + 1, nullptr, 10);
+    return true;
+}
+
+static bool parseOptions(int argc, char** argv, Options* options) {
+    for (int i = 1; i < argc; i++) {
+        unsigned long value;
+        if (parseOption(argv[i], "--requests", &value)) options->requests = (int)value;
+        else if (parseOption(argv[i], "--connect-ms", &value)) options->connectMs = (unsigned)value;
+        else if (parseOption(argv[i], "--delay-ms", &value)) options->delayMs = (unsigned)value;
+        else if (parseOption(argv[i], "--body-bytes", &value)) options->bodyBytes = value;
+        else if (parseOption(argv[i], "--nowplaying-bytes", &value)) options->nowPlayingBytes = value;
+        else if (strcmp(argv[i], "--plain") == 0) options->tls = false;
+        else return false;
+    }
+    return options->requests > 0;
+}
+
+/** Times single requests and reports them with the socket counters. */
+class Run {
+public:
+    explicit Run(const char* name) : name(name), failures(0) {
+        emu::resetSocketStats();
+        start = std::chrono::steady_clock::now();
+    }
+
+    template <class Request>
+    void request(Request request) {
+        auto before = std::chrono::steady_clock::now();
+        if (!request()) failures++;
+        latenciesUs.push_back(std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - before).count());
+        drainSerialLog();
+    }
+
+    int report() {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        emu::SocketStats stats = emu::socketStats();
+        std::sort(latenciesUs.begin(), latenciesUs.end());
+        printf("%-10s %5zu requests %7.3f s %8.1f req/s  %5lu connects %5lu handshakes "
+               "%5.1f%% in handshakes  %7lu B out %9lu B in\n",
+               name, latenciesUs.size(), seconds, latenciesUs.size() / seconds, stats.connects,
+               stats.handshakes, stats.handshakeUs / (seconds * 1e4), stats.bytesWritten,
+               stats.bytesRead);
+        printf("%-10s latency ms: p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n", name,
+               percentile(50) / 1000, percentile(90) / 1000, percentile(99) / 1000,
+               latenciesUs.back() / 1000);
+        if (failures > 0) printf("%-10s %d requests failed\n", name, failures);
+        return failures;
+    }
+
+private:
+    const char* name;
+    int failures;
+    std::chrono::steady_clock::time_point start;
+    std::vector<double> latenciesUs;
+
+    // Nearest rank
+    double percentile(int p) const {
+        size_t rank = (latenciesUs.size() * p + 99) / 100;
+        return latenciesUs[rank > 0 ? rank - 1 : 0];
+    }
+};
+
+// ========== Scenarios ==========
+
+// A show of `requests` entries, one addEntry() per track as the sketch
+// posts them, between its startRadioShow and finishRadioShow
+static int runFlowsheet(NetworkManager& network, const Options& options) {
+    TubafrenzyStandin standin{API_KEY};
+    standin.server().setResponseDelayMs(options.delayMs);
+    standin.server().setMinBodyBytes(options.bodyBytes);
+    if (options.tls) standin.server().enableTls();
+    emu::routeHost(TUBAFRENZY_HOST, TUBAFRENZY_PORT, standin.server().port());
+    FlowsheetClient client(network, TUBAFRENZY_HOST, TUBAFRENZY_PORT, API_KEY);
+
+    Run run("flowsheet");
+    int showID = -1;
+    run.request([&] { return (showID = client.startShow(SHOW_HOUR_MS)) > 0; });
+    if (showID <= 0) return run.report();
+    for (int i = 0; i < options.requests; i++) {
+        run.request([&] {
+            return client.addEntry(showID, SHOW_HOUR_MS, "Artist", String("Track ") + String(i),
+                                   "Album", i);
+        });
+    }
+    run.request([&] { return client.endShow(showID); });
+    return run.report();
+}
+
+// `requests` polls, each finding a new track so the whole document is parsed
+static int runNowPlaying(NetworkManager& network, const Options& options) {
+    AzuraCastStandin standin;
+    standin.server().setResponseDelayMs(options.delayMs);
+    standin.server().setMinBodyBytes(options.nowPlayingBytes);
+    if (options.tls) standin.server().enableTls();
+    emu::routeHost(AZURACAST_HOST, AZURACAST_PORT, standin.server().port());
+    AzuraCastClient client(network, AZURACAST_HOST, AZURACAST_PORT, AZURACAST_PATH);
+
+    Run run("nowplaying");
+    for (int i = 0; i < options.requests; i++) {
+        standin.setTrack(1000 + i, "Artist", "Track " + std::to_string(i), "Album");
+        run.request([&] { return client.poll(); });
+    }
+    return run.report();
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, &options)) {
+        fprintf(stderr, "usage: %s [--requests=N] [--connect-ms=N] [--delay-ms=N] "
+                "[--body-bytes=N] [--nowplaying-bytes=N] [--plain]\n", argv[0]);
+        return 2;
+    }
+
+    emu::reset();
+    emu::setConnectLatencyMs(options.connectMs);
+    if (options.tls && !emu::setTls(standinCertificate())) {
+        fprintf(stderr, "TLS setup failed\n");
+        return 1;
+    }
+    LoopbackTransport transport;
+    NetworkManager network(LINK_FAILURE_THRESHOLD, LINK_COOLDOWN_MS, LINK_PREFERENCE_MS);
+    network.addTransport(transport);
+    network.setUp();
+
+    printf("%s, connect +%u ms, response delay %u ms\n", options.tls ? "HTTPS" : "HTTP",
+           options.connectMs, options.delayMs);
+    int failures = runFlowsheet(network, options);
+    failures += runNowPlaying(network, options);
+    return failures == 0 ? 0 : 1;
+}
@@ -1,9 +1,12 @@
 /**
- * Minimal Arduino String shim for desktop testing.
+ * Arduino core shim for desktop testing and emulation.
  *
- * Implements just enough of the Arduino String class to compile and test
- * the pure functions extracted into utils.h/utils.cpp. This is NOT a
- * complete Arduino compatibility layer -- only the subset used by utils.cpp.
+ * Provides the subset of the Arduino core API the sketch uses: the String
+ * class, Print/Stream, Serial, and time and GPIO functions. Time is a
+ * virtual clock that only moves when the sketch calls delay() or a test
+ * calls emu::advanceMillis(), and GPIO levels are plain variables that
+ * tests set through test/shim/emulation.h. This is NOT a complete Arduino
+ * compatibility layer -- only what the sketch and its tests exercise.
  */
 #ifndef ARDUINO_H_SHIM
 #define ARDUINO_H_SHIM
@@ -12,24 +15,62 @@
 #include <cstring>
 #include <cctype>
 #include <cstdio>
+#include <cstdint>
+#include <cstdlib>
 #include <sstream>
 
 #define HEX 16
+#define DEC 10
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define LED_BUILTIN 13
+#define A0 54
+
+typedef uint8_t byte;
 
 inline bool isAlphaNumeric(char c) {
     return std::isalnum(static_cast<unsigned char>(c));
 }
 
+// ========== Time and GPIO (virtual, see emulation.h) ==========
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(int pin, int mode);
+int digitalRead(int pin);
+void digitalWrite(int pin, int value);
+int analogRead(int pin);
+void yield();
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+// ========== String ==========
+
 class String {
 public:
     String() : data_() {}
     String(const char* s) : data_(s ? s : "") {}
     String(const String& other) : data_(other.data_) {}
+    String(const char* s, unsigned int len) : data_(s, len) {}
 
     // Numeric constructors
+    String(char c) : data_(1, c) {}
     String(int val) {
         data_ = std::to_string(val);
     }
+    String(unsigned int val) {
+        data_ = std::to_string(val);
+    }
+    String(long val) {
+        data_ = std::to_string(val);
+    }
     String(unsigned long val) {
         data_ = std::to_string(val);
     }
@@ -43,8 +84,18 @@ public:
         }
     }
 
+    String& operator=(const String& other) {
+        data_ = other.data_;
+        return *this;
+    }
+    String& operator=(const char* s) {
+        data_ = s ? s : "";
+        return *this;
+    }
+
     unsigned int length() const { return static_cast<unsigned int>(data_.size()); }
     char charAt(unsigned int index) const { return data_[index]; }
+    char operator[](unsigned int index) const { return data_[index]; }
 
     int indexOf(const char* str) const {
         auto pos = data_.find(str);
@@ -76,6 +127,12 @@ public:
         data_.reserve(size);
     }
 
+    void trim() {
+        size_t start = data_.find_first_not_of(" \t\r\n");
+        size_t end = data_.find_last_not_of(" \t\r\n");
+        data_ = (start == std::string::npos) ? "" : data_.substr(start, end - start + 1);
+    }
+
     bool equalsIgnoreCase(const String& other) const {
         if (data_.size() != other.data_.size()) return false;
         for (size_t i = 0; i < data_.size(); i++) {
@@ -87,6 +144,10 @@ public:
         return true;
     }
 
+    bool startsWith(const char* prefix) const {
+        return data_.compare(0, std::strlen(prefix), prefix) == 0;
+    }
+
     String& operator+=(char c) {
         data_ += c;
         return *this;
@@ -99,6 +160,10 @@ public:
         data_ += s.data_;
         return *this;
     }
+    bool concat(const char* s, unsigned int len) {
+        data_.append(s, len);
+        return true;
+    }
 
     String operator+(const char* s) const {
         String result(*this);
@@ -120,6 +185,7 @@ public:
     bool operator==(const char* s) const { return data_ == s; }
     bool operator==(const String& s) const { return data_ == s.data_; }
     bool operator!=(const char* s) const { return data_ != s; }
+    bool operator!=(const String& s) const { return data_ != s.data_; }
 
     const char* c_str() const { return data_.c_str(); }
 
@@ -135,4 +201,96 @@ inline std::ostream& operator<<(std::ostream& os, const String& s) {
     return os << s.c_str();
 }
 
+// ========== Print / Stream ==========
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t size) {
+        size_t n = 0;
+        while (size--) n += write(*buf++);
+        return n;
+    }
+    size_t write(const char* s) {
+        return s ? write(reinterpret_cast<const uint8_t*>(s), std::strlen(s)) : 0;
+    }
+    size_t write(const char* buf, size_t size) {
+        return write(reinterpret_cast<const uint8_t*>(buf), size);
+    }
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write(s.c_str(), s.length()); }
+    size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+    size_t print(int n) { return printNumber("%d", n); }
+    size_t print(unsigned int n) { return printNumber("%u", n); }
+    size_t print(long n) { return printNumber("%ld", n); }
+    size_t print(unsigned long n) { return printNumber("%lu", n); }
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T& value) {
+        size_t n = print(value);
+        return n + println();
+    }
+
+private:
+    template <typename T>
+    size_t printNumber(const char* format, T n) {
+        char buf[24];
+        int len = std::snprintf(buf, sizeof(buf), format, n);
+        return write(buf, static_cast<size_t>(len));
+    }
+};
+
+class Stream : public Print {
+public:
+    Stream() : timeoutMs_(1000) {}
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeoutMs) { timeoutMs_ = timeoutMs; }
+    unsigned long getTimeout() const { return timeoutMs_; }
+
+    /**
+     * Reads up to length bytes, waiting up to the stream timeout for each.
+     * The wait is measured in real time, not on the virtual clock.
+     */
+    size_t readBytes(char* buffer, size_t length);
+
+protected:
+    int timedRead();
+
+    /**
+     * True when no more data can ever arrive (e.g. a Content-Length body has
+     * been read in full), so timedRead() can return at once instead of
+     * sitting out a wait that could only time out.
+     */
+    virtual bool exhausted() { return false; }
+
+private:
+    unsigned long timeoutMs_;
+};
+
+/**
+ * Serial shim: captures output in memory (see emu::serialOutput()).
+ */
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud);
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    using Print::write;
+    int availableForWrite() override;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
 #endif // ARDUINO_H_SHIM
@@ -0,0 +1,105 @@
+/**
+ * ArduinoHttpClient shim for emulation.
+ *
+ * Implements the HttpClient subset the sketch uses, with the same wire
+ * behaviour as the real library where it matters for measurement: the
+ * request line and each header go to the underlying Client as separate
+ * writes, "Connection: close" is sent unless connectionKeepAlive() is
+ * called, and response bodies are delimited by Content-Length (or by the
+ * server closing the connection). Chunked responses are not supported.
+ */
+#ifndef ARDUINO_HTTP_CLIENT_H_SHIM
+#define ARDUINO_HTTP_CLIENT_H_SHIM
+
+#include "Client.h"
+
+#define HTTP_SUCCESS 0
+#define HTTP_ERROR_CONNECTION_FAILED -1
+#define HTTP_ERROR_API -2
+#define HTTP_ERROR_TIMED_OUT -3
+#define HTTP_ERROR_INVALID_RESPONSE -4
+
+class HttpClient : public Client {
+public:
+    HttpClient(Client& client, const char* serverName, uint16_t port = 80);
+    HttpClient(Client& client, const String& serverName, uint16_t port = 80);
+
+    void beginRequest();
+    void endRequest();
+    void beginBody();
+
+    int get(const char* path);
+    int post(const char* path);
+    int post(const char* path, const char* contentType, const char* body);
+    int startRequest(const char* path, const char* method,
+                     const char* contentType = nullptr, int contentLength = -1,
+                     const uint8_t* body = nullptr);
+
+    void sendHeader(const char* header);
+    void sendHeader(const char* name, const char* value);
+    void sendHeader(const String& name, const String& value);
+    void sendHeader(const char* name, const int value);
+
+    void connectionKeepAlive();
+    void noDefaultRequestHeaders();
+    void setHttpResponseTimeout(uint32_t timeoutMs);
+
+    int responseStatusCode();
+    bool headerAvailable();
+    String readHeaderName();
+    String readHeaderValue();
+    int skipResponseHeaders();
+    int contentLength();
+    bool isResponseChunked() const { return false; }
+    bool endOfBodyReached();
+    String responseBody();
+    Stream& responseStream();
+
+    // Client
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    void flush() override;
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override;
+
+protected:
+    bool exhausted() override;
+
+private:
+    enum State {
+        eIdle,
+        eRequestStarted,
+        eRequestSent,
+        eReadingHeaders,
+        eReadingBody
+    };
+
+    Client* client;
+    String serverName;
+    uint16_t serverPort;
+    State state;
+    bool keepAlive;
+    bool defaultHeaders;
+    uint32_t responseTimeoutMs;
+
+    int statusCode;
+    long bodyLength;
+    long bodyRead;
+    String headerName;
+    String headerValue;
+
+    void finishHeaders();
+    bool readLine(String& line);
+    int waitRead();
+    void resetResponse();
+};
+
+#endif // ARDUINO_HTTP_CLIENT_H_SHIM
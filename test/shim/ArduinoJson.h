@@ -0,0 +1,148 @@
+/**
+ * ArduinoJson shim for emulation.
+ *
+ * A small DOM-based stand-in for the ArduinoJson v7 API subset the sketch
+ * uses: JsonDocument with chained operator[] (creating members on write),
+ * the `value | default` idiom, as<T>(), deserializeJson() from a Stream or
+ * buffer with DeserializationOption::Filter, and serializeJson(). It follows
+ * ArduinoJson's observable behaviour (one value per call, the default
+ * nesting limit of 10, filters applied to the parsed tree, null as<String>()
+ * is "null") but not its memory layout.
+ */
+#ifndef ARDUINO_JSON_H_SHIM
+#define ARDUINO_JSON_H_SHIM
+
+#include "Arduino.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace ArduinoJsonShim {
+
+struct Node {
+    enum Type { Null, Bool, Integer, Float, Str, Object, Array };
+    Type type = Null;
+    bool boolean = false;
+    long long integer = 0;
+    double real = 0;
+    std::string str;
+    std::vector<std::pair<std::string, std::shared_ptr<Node>>> members;
+    std::vector<std::shared_ptr<Node>> elements;
+
+    Node* member(const char* key) const;
+};
+
+} // namespace ArduinoJsonShim
+
+class JsonVariant {
+public:
+    explicit JsonVariant(ArduinoJsonShim::Node* node) : node(node) {}
+
+    JsonVariant operator[](const char* key) const;
+    JsonVariant operator[](const String& key) const { return (*this)[key.c_str()]; }
+    JsonVariant operator[](int index) const;
+
+    JsonVariant operator=(bool value) const;
+    JsonVariant operator=(int value) const { return setInteger(value); }
+    JsonVariant operator=(long value) const { return setInteger(value); }
+    JsonVariant operator=(unsigned int value) const { return setInteger(value); }
+    JsonVariant operator=(unsigned long value) const { return setInteger((long long)value); }
+    JsonVariant operator=(double value) const;
+    JsonVariant operator=(const char* value) const;
+    JsonVariant operator=(const String& value) const { return (*this) = value.c_str(); }
+    JsonVariant operator=(std::nullptr_t) const { return (*this) = (const char*)nullptr; }
+
+    bool isNull() const;
+    size_t size() const;
+
+    template <typename T> bool is() const;
+    template <typename T> T as() const;
+
+    template <typename T>
+    T operator|(const T& fallback) const { return is<T>() ? as<T>() : fallback; }
+    const char* operator|(const char* fallback) const;
+
+    ArduinoJsonShim::Node* raw() const { return node; }
+
+private:
+    ArduinoJsonShim::Node* node;
+    JsonVariant setInteger(long long value) const;
+};
+
+// Supported conversions (defined in json_shim.cpp)
+template <> bool JsonVariant::is<bool>() const;
+template <> bool JsonVariant::is<int>() const;
+template <> bool JsonVariant::is<long>() const;
+template <> bool JsonVariant::is<unsigned long>() const;
+template <> bool JsonVariant::is<double>() const;
+template <> bool JsonVariant::is<const char*>() const;
+template <> bool JsonVariant::is<String>() const;
+template <> bool JsonVariant::as<bool>() const;
+template <> int JsonVariant::as<int>() const;
+template <> long JsonVariant::as<long>() const;
+template <> unsigned long JsonVariant::as<unsigned long>() const;
+template <> double JsonVariant::as<double>() const;
+template <> const char* JsonVariant::as<const char*>() const;
+template <> String JsonVariant::as<String>() const;
+
+class JsonDocument {
+public:
+    JsonDocument();
+    JsonDocument(const JsonDocument& other);
+    JsonDocument& operator=(const JsonDocument& other);
+
+    JsonVariant operator[](const char* key) { return as()[key]; }
+    JsonVariant operator[](const String& key) { return as()[key.c_str()]; }
+    JsonVariant operator[](int index) { return as()[index]; }
+    JsonVariant as() { return JsonVariant(root.get()); }
+    JsonVariant as() const { return JsonVariant(root.get()); }
+
+    void clear();
+    bool isNull() const { return root->type == ArduinoJsonShim::Node::Null; }
+
+private:
+    std::shared_ptr<ArduinoJsonShim::Node> root;
+};
+
+class DeserializationError {
+public:
+    enum Code { Ok, EmptyInput, IncompleteInput, InvalidInput, NoMemory, TooDeep };
+
+    DeserializationError(Code code = Ok) : code_(code) {}
+    explicit operator bool() const { return code_ != Ok; }
+    bool operator==(Code c) const { return code_ == c; }
+    bool operator!=(Code c) const { return code_ != c; }
+    Code code() const { return code_; }
+    const char* c_str() const;
+
+private:
+    Code code_;
+};
+
+namespace DeserializationOption {
+class Filter {
+public:
+    explicit Filter(const JsonDocument& filter) : filter_(filter.as()) {}
+    JsonVariant variant() const { return filter_; }
+
+private:
+    JsonVariant filter_;
+};
+} // namespace DeserializationOption
+
+DeserializationError deserializeJson(JsonDocument& doc, Stream& input);
+DeserializationError deserializeJson(JsonDocument& doc, Stream& input,
+                                     DeserializationOption::Filter filter);
+DeserializationError deserializeJson(JsonDocument& doc, const char* input, size_t length);
+DeserializationError deserializeJson(JsonDocument& doc, const char* input, size_t length,
+                                     DeserializationOption::Filter filter);
+DeserializationError deserializeJson(JsonDocument& doc, const char* input);
+DeserializationError deserializeJson(JsonDocument& doc, const String& input);
+
+size_t serializeJson(const JsonDocument& doc, char* output, size_t size);
+size_t serializeJson(const JsonDocument& doc, String& output);
+size_t serializeJson(const JsonDocument& doc, Print& output);
+size_t measureJson(const JsonDocument& doc);
+
+#endif // ARDUINO_JSON_H_SHIM
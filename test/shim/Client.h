@@ -0,0 +1,43 @@
+/**
+ * Arduino Client / IPAddress shim for emulation.
+ */
+#ifndef CLIENT_H_SHIM
+#define CLIENT_H_SHIM
+
+#include "Arduino.h"
+
+class IPAddress {
+public:
+    IPAddress() : octets_{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : octets_{a, b, c, d} {}
+
+    String toString() const {
+        char buf[16];
+        std::snprintf(buf, sizeof(buf), "%u.%u.%u.%u",
+                      octets_[0], octets_[1], octets_[2], octets_[3]);
+        return String(buf);
+    }
+    uint8_t operator[](int i) const { return octets_[i]; }
+
+private:
+    uint8_t octets_[4];
+};
+
+class Client : public Stream {
+public:
+    virtual int connect(IPAddress ip, uint16_t port) = 0;
+    virtual int connect(const char* host, uint16_t port) = 0;
+    size_t write(uint8_t c) override = 0;
+    size_t write(const uint8_t* buf, size_t size) override = 0;
+    using Print::write;
+    int available() override = 0;
+    int read() override = 0;
+    virtual int read(uint8_t* buf, size_t size) = 0;
+    int peek() override = 0;
+    void flush() override = 0;
+    virtual void stop() = 0;
+    virtual uint8_t connected() = 0;
+    virtual operator bool() = 0;
+};
+
+#endif // CLIENT_H_SHIM
@@ -0,0 +1,34 @@
+/**
+ * WiFi shim for emulation. Connection state, RSSI and NTP time are set by
+ * tests through emulation.h.
+ */
+#ifndef WIFI_H_SHIM
+#define WIFI_H_SHIM
+
+#include "Arduino.h"
+#include "Client.h"
+
+enum wl_status_t {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+};
+
+class WiFiClass {
+public:
+    int begin(const char* ssid, const char* passphrase);
+    void disconnect();
+    void setTimeout(unsigned long timeoutMs) { (void)timeoutMs; }
+    uint8_t status();
+    String macAddress();
+    IPAddress localIP();
+    unsigned long getTime();
+    int32_t RSSI();
+};
+
+extern WiFiClass WiFi;
+
+#endif // WIFI_H_SHIM
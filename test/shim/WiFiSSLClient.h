@@ -0,0 +1,45 @@
+/**
+ * WiFiSSLClient shim for emulation: a TCP client over local sockets, plain
+ * unless emu::setTls() turns on real TLS. Hostnames are resolved through
+ * emu::routeHost() to stand-in servers on 127.0.0.1, so the sketch's HTTPS
+ * code paths run unchanged against them.
+ */
+#ifndef WIFI_SSL_CLIENT_H_SHIM
+#define WIFI_SSL_CLIENT_H_SHIM
+
+#include "Client.h"
+
+typedef struct ssl_st SSL;
+
+class WiFiSSLClient : public Client {
+public:
+    WiFiSSLClient();
+    ~WiFiSSLClient();
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    void flush() override;
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override;
+
+private:
+    int fd;
+    SSL* ssl;
+    bool peerClosed;
+    uint8_t rxBuf[1024];
+    size_t rxLen;
+    size_t rxPos;
+
+    bool fill(bool wait);
+    bool handshake(const char* host);
+};
+
+#endif // WIFI_SSL_CLIENT_H_SHIM
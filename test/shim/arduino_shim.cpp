@@ -0,0 +1,198 @@
+#include "Arduino.h"
+#include "emulation.h"
+#include "stall_detector.h"
+
+#include <string.h>
+
+#include <chrono>
+#include <map>
+#include <thread>
+
+// ========== Clock ==========
+
+static unsigned long virtualMillis = 0;
+static unsigned long virtualMicrosExtra = 0;
+
+unsigned long millis() { return virtualMillis; }
+
+unsigned long micros() { return virtualMillis * 1000UL + virtualMicrosExtra; }
+
+void delay(unsigned long ms) { virtualMillis += ms; }
+
+void delayMicroseconds(unsigned int us) {
+    virtualMicrosExtra += us;
+    virtualMillis += virtualMicrosExtra / 1000;
+    virtualMicrosExtra %= 1000;
+}
+
+void yield() {}
+
+// Deterministic, so emulated backoffs repeat from run to run
+static unsigned long randomState = 1;
+
+void randomSeed(unsigned long seed) { randomState = seed ? seed : 1; }
+
+long random(long howbig) {
+    if (howbig <= 0) return 0;
+    randomState = randomState * 1103515245UL + 12345UL;
+    return (long)((randomState >> 16) % (unsigned long)howbig);
+}
+
+long random(long howsmall, long howbig) {
+    if (howsmall >= howbig) return howsmall;
+    return howsmall + random(howbig - howsmall);
+}
+
+void emu::setMillis(unsigned long ms) {
+    virtualMillis = ms;
+    virtualMicrosExtra = 0;
+}
+
+void emu::advanceMillis(unsigned long ms) { virtualMillis += ms; }
+
+// ========== GPIO ==========
+
+static std::map<int, int> pinLevels;
+static std::map<int, int> pinModes;
+
+void pinMode(int pin, int mode) { pinModes[pin] = mode; }
+
+int digitalRead(int pin) {
+    auto it = pinLevels.find(pin);
+    return it == pinLevels.end() ? HIGH : it->second; // floating pins read as pulled up
+}
+
+void digitalWrite(int pin, int value) { pinLevels[pin] = value; }
+
+int analogRead(int pin) { return (pin * 131 + (int)virtualMillis) & 0x3FF; }
+
+void emu::setPinLevel(int pin, int level) { pinLevels[pin] = level; }
+
+int emu::pinLevel(int pin) { return digitalRead(pin); }
+
+int emu::pinMode(int pin) {
+    auto it = pinModes.find(pin);
+    return it == pinModes.end() ? INPUT : it->second;
+}
+
+// ========== Stream ==========
+
+int Stream::timedRead() {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs_);
+    do {
+        int c = read();
+        if (c >= 0) return c;
+        if (exhausted()) return -1;
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    } while (std::chrono::steady_clock::now() < deadline);
+    return -1;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+    size_t n = 0;
+    while (n < length) {
+        int c = timedRead();
+        if (c < 0) break;
+        buffer[n++] = (char)c;
+    }
+    return n;
+}
+
+// ========== Serial ==========
+
+HardwareSerial Serial;
+static std::string serialCapture;
+
+void HardwareSerial::begin(unsigned long) {}
+
+namespace emu {
+void setHeapCounting(bool enabled); // mem_shim.cpp
+}
+
+// The capture buffer is emulator overhead, not sketch memory
+size_t HardwareSerial::write(uint8_t c) {
+    emu::setHeapCounting(false);
+    serialCapture += (char)c;
+    emu::setHeapCounting(true);
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t size) {
+    emu::setHeapCounting(false);
+    serialCapture.append(reinterpret_cast<const char*>(buf), size);
+    emu::setHeapCounting(true);
+    return size;
+}
+
+int HardwareSerial::availableForWrite() { return 256; }
+
+const std::string& emu::serialOutput() { return serialCapture; }
+
+void emu::clearSerialOutput() { serialCapture.clear(); }
+
+// ========== Watchdog ==========
+
+static bool watchdogOn = false;
+static bool watchdogFired = false;
+static unsigned long watchdogTimeoutMs = 0;
+static unsigned long watchdogKickedAt = 0;
+static unsigned long watchdogKickCount = 0;
+static StallRecord noinitStallRecord;
+
+void watchdogStart(unsigned long timeoutMs) {
+    watchdogOn = true;
+    watchdogTimeoutMs = timeoutMs;
+    watchdogKickedAt = millis();
+}
+
+void watchdogKick() {
+    if (!watchdogOn) return;
+    watchdogKickedAt = millis();
+    watchdogKickCount++;
+}
+
+bool resetByWatchdog() { return watchdogFired; }
+
+StallRecord* persistentStallRecord() { return &noinitStallRecord; }
+
+bool emu::watchdogRunning() { return watchdogOn; }
+
+bool emu::watchdogExpired() {
+    return watchdogOn && millis() - watchdogKickedAt >= watchdogTimeoutMs;
+}
+
+unsigned long emu::watchdogKicks() { return watchdogKickCount; }
+
+void emu::watchdogReset() {
+    StallRecord kept = noinitStallRecord;
+    powerCycle();
+    noinitStallRecord = kept;
+    watchdogFired = true;
+}
+
+// ========== Lifecycle ==========
+
+namespace emu {
+void resetWifi();    // wifi_shim.cpp
+void resetSockets(); // wifi_shim.cpp
+void resetMemory();  // mem_shim.cpp
+}
+
+void emu::powerCycle() {
+    setMillis(0);
+    pinLevels.clear();
+    pinModes.clear();
+    serialCapture.clear();
+    resetWifi();
+    resetSockets();
+    resetMemory();
+    watchdogOn = false;
+    watchdogFired = false;
+    watchdogKickCount = 0;
+    memset(&noinitStallRecord, 0, sizeof(noinitStallRecord)); // RAM lost with power
+}
+
+void emu::reset() {
+    powerCycle();
+    eraseFlash();
+}
@@ -0,0 +1,118 @@
+/**
+ * Test-side controls for the emulated Arduino environment.
+ *
+ * The shim headers (Arduino.h, WiFi.h, WiFiSSLClient.h, ...) present the
+ * Arduino API to the sketch; these functions let a test drive that
+ * environment: move the virtual clock, set pin levels, bring WiFi up or
+ * down, and route the sketch's hostnames to stand-in servers on localhost.
+ */
+#ifndef EMULATION_H_SHIM
+#define EMULATION_H_SHIM
+
+#include <cstdint>
+#include <string>
+
+namespace emu {
+
+// ========== Clock ==========
+
+void setMillis(unsigned long ms);
+void advanceMillis(unsigned long ms);
+
+// ========== GPIO ==========
+
+void setPinLevel(int pin, int level);
+int pinLevel(int pin);
+int pinMode(int pin);
+
+// ========== Serial ==========
+
+const std::string& serialOutput();
+void clearSerialOutput();
+
+// ========== WiFi ==========
+
+void setWifiConnected(bool connected);
+void setEpochTime(unsigned long epochSeconds); // 0 = NTP unavailable
+void setRssi(int dbm);
+
+// ========== Sockets ==========
+
+/**
+ * Routes connections for host:port to 127.0.0.1:localPort. Connections to
+ * unrouted hosts fail, as if DNS or the network were down.
+ */
+void routeHost(const std::string& host, uint16_t port, uint16_t localPort);
+void clearRoutes();
+
+/**
+ * Real and virtual milliseconds each successful connect() takes, standing
+ * in for the TCP and TLS handshakes that loopback does not have.
+ */
+void setConnectLatencyMs(unsigned ms);
+
+/**
+ * Wraps every emulated connection in real TLS (OpenSSL), verifying the
+ * server against certPem alone, as the board verifies against its root
+ * store; stand-ins serve it after StandinServer::enableTls(). An empty
+ * certPem goes back to plain TCP. Returns false if the shim was built
+ * without EMULATION_TLS.
+ */
+bool setTls(const std::string& certPem);
+
+/**
+ * Socket-level counters across all emulated clients, for measuring the
+ * number of write calls and bytes a request costs. Bytes are the
+ * application's, before TLS; handshakeUs is the real time spent in TLS
+ * handshakes.
+ */
+struct SocketStats {
+    unsigned long connects;
+    unsigned long writeCalls;
+    unsigned long bytesWritten;
+    unsigned long bytesRead;
+    unsigned long handshakes;
+    unsigned long long handshakeUs;
+};
+
+SocketStats socketStats();
+void resetSocketStats();
+
+// ========== Flash ==========
+
+/** Wipes the checkpoint flash region (checkpoint.h) to all 0xFF. */
+void eraseFlash();
+unsigned long flashEraseCount();
+
+// ========== Watchdog ==========
+
+/**
+ * The sketch's hardware watchdog (stall_detector.h). It never fires on its
+ * own: watchdogExpired() says whether it would have, and watchdogReset()
+ * performs the reset, keeping the .noinit stall record that powerCycle()
+ * loses.
+ */
+bool watchdogRunning();
+bool watchdogExpired();
+unsigned long watchdogKicks();
+void watchdogReset();
+
+// ========== Lifecycle ==========
+
+/**
+ * Restores the environment to power-on defaults: clock at 0, pins HIGH,
+ * WiFi connected, a fixed epoch, no routes, connect latency or TLS, empty
+ * Serial output. Also makes the calling thread the sketch thread, whose
+ * heap allocations are counted by readHeapCounters() (mem_stats.h).
+ * Flash keeps its contents, as it would across a reset or power blip.
+ */
+void powerCycle();
+
+/**
+ * powerCycle() plus erased flash: a factory-fresh board.
+ */
+void reset();
+
+} // namespace emu
+
+#endif // EMULATION_H_SHIM
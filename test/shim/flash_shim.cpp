@@ -0,0 +1,50 @@
+/**
+ * Host implementation of checkpointFlashRegion(): a MemoryFlashRegion in
+ * RAM that survives emu::powerCycle() but not emu::reset(), standing in for
+ * the QSPI sectors the Giga uses. The firmware slot and the play history's
+ * SD card are left out; their tests bring a MemoryFlashRegion or
+ * MemoryHistoryFile of their own. Nor is there a metrics listener; its
+ * test hands the MetricsServer connections directly.
+ */
+#include "checkpoint.h"
+#include "config.h"
+#include "emulation.h"
+#include "firmware_update.h"
+#include "metrics_server.h"
+#include "play_history.h"
+
+#define FLASH_SHIM_SECTOR_SIZE 4096
+
+static uint8_t flashStorage[CHECKPOINT_SECTORS * FLASH_SHIM_SECTOR_SIZE];
+static MemoryFlashRegion flashRegion(flashStorage, FLASH_SHIM_SECTOR_SIZE, CHECKPOINT_SECTORS);
+
+FlashRegion* checkpointFlashRegion() {
+    return &flashRegion;
+}
+
+unsigned long emu::flashEraseCount() {
+    return flashRegion.eraseCount();
+}
+
+void emu::eraseFlash() {
+    for (int i = 0; i < CHECKPOINT_SECTORS; i++) flashRegion.erase(i);
+}
+
+// The host has no spare bank: the sketch's updater finds no slot
+FlashRegion* firmwareFlashRegion() {
+    return nullptr;
+}
+
+void firmwareActivate() {}
+
+bool playHistoryFiles(HistoryFile**, HistoryFile**) {
+    return false;
+}
+
+bool metricsListen() {
+    return false;
+}
+
+Client* metricsAccept() {
+    return nullptr;
+}
@@ -0,0 +1,302 @@
+#include "ArduinoHttpClient.h"
+
+#include <chrono>
+#include <thread>
+
+HttpClient::HttpClient(Client& client, const char* serverName, uint16_t port)
+    : client(&client)
+    , serverName(serverName)
+    , serverPort(port)
+    , state(eIdle)
+    , keepAlive(false)
+    , defaultHeaders(true)
+    , responseTimeoutMs(30000)
+    , statusCode(0)
+    , bodyLength(-1)
+    , bodyRead(0)
+{
+}
+
+HttpClient::HttpClient(Client& client, const String& serverName, uint16_t port)
+    : HttpClient(client, serverName.c_str(), port)
+{
+}
+
+void HttpClient::resetResponse() {
+    statusCode = 0;
+    bodyLength = -1;
+    bodyRead = 0;
+}
+
+// ========== Request ==========
+
+void HttpClient::beginRequest() {
+    state = eRequestStarted;
+}
+
+int HttpClient::startRequest(const char* path, const char* method,
+                             const char* contentType, int contentLength,
+                             const uint8_t* body) {
+    bool withinBegin = (state == eRequestStarted);
+    if (state == eReadingHeaders || state == eReadingBody) {
+        // Discard the rest of the previous response on a reused connection
+        while (!endOfBodyReached() && read() >= 0) {}
+    }
+    resetResponse();
+
+    if (!client->connected()) {
+        client->stop();
+        if (!client->connect(serverName.c_str(), serverPort)) {
+            state = eIdle;
+            return HTTP_ERROR_CONNECTION_FAILED;
+        }
+    }
+
+    client->print(method);
+    client->print(" ");
+    client->print(path);
+    client->println(" HTTP/1.1");
+    if (defaultHeaders) {
+        client->print("Host: ");
+        client->print(serverName);
+        if (serverPort != 80 && serverPort != 443) {
+            client->print(":");
+            client->print((unsigned int)serverPort);
+        }
+        client->println();
+        client->println("User-Agent: Arduino/2.2.0");
+    }
+    if (!keepAlive) {
+        client->println("Connection: close");
+    }
+    if (contentType) sendHeader("Content-Type", contentType);
+    if (contentLength >= 0) sendHeader("Content-Length", contentLength);
+
+    state = eRequestStarted;
+    if (!withinBegin) {
+        finishHeaders();
+        if (body && contentLength > 0) client->write(body, (size_t)contentLength);
+    }
+    return HTTP_SUCCESS;
+}
+
+int HttpClient::get(const char* path) {
+    return startRequest(path, "GET");
+}
+
+int HttpClient::post(const char* path) {
+    return startRequest(path, "POST");
+}
+
+int HttpClient::post(const char* path, const char* contentType, const char* body) {
+    return startRequest(path, "POST", contentType, (int)std::strlen(body),
+                        reinterpret_cast<const uint8_t*>(body));
+}
+
+void HttpClient::sendHeader(const char* header) {
+    if (state != eRequestStarted) return;
+    client->println(header);
+}
+
+void HttpClient::sendHeader(const char* name, const char* value) {
+    if (state != eRequestStarted) return;
+    client->print(name);
+    client->print(": ");
+    client->println(value);
+}
+
+void HttpClient::sendHeader(const String& name, const String& value) {
+    sendHeader(name.c_str(), value.c_str());
+}
+
+void HttpClient::sendHeader(const char* name, const int value) {
+    if (state != eRequestStarted) return;
+    client->print(name);
+    client->print(": ");
+    client->println(value);
+}
+
+void HttpClient::finishHeaders() {
+    client->println();
+    state = eRequestSent;
+}
+
+void HttpClient::beginBody() {
+    if (state == eRequestStarted) finishHeaders();
+}
+
+void HttpClient::endRequest() {
+    if (state == eRequestStarted) finishHeaders();
+}
+
+void HttpClient::connectionKeepAlive() { keepAlive = true; }
+
+void HttpClient::noDefaultRequestHeaders() { defaultHeaders = false; }
+
+void HttpClient::setHttpResponseTimeout(uint32_t timeoutMs) { responseTimeoutMs = timeoutMs; }
+
+// ========== Response ==========
+
+int HttpClient::waitRead() {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(responseTimeoutMs);
+    for (;;) {
+        int c = client->read();
+        if (c >= 0) return c;
+        if (!client->connected()) return -1;
+        if (std::chrono::steady_clock::now() >= deadline) return -1;
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+    }
+}
+
+bool HttpClient::readLine(String& line) {
+    line = "";
+    for (;;) {
+        int c = waitRead();
+        if (c < 0) return false;
+        if (c == '\n') break;
+        if (c != '\r') line += (char)c;
+    }
+    return true;
+}
+
+int HttpClient::responseStatusCode() {
+    if (state < eRequestSent) return HTTP_ERROR_API;
+    if (statusCode > 0) return statusCode;
+
+    String line;
+    do {
+        if (!readLine(line)) return HTTP_ERROR_TIMED_OUT;
+        if (!line.startsWith("HTTP/")) return HTTP_ERROR_INVALID_RESPONSE;
+        int space = line.indexOf(' ');
+        if (space < 0) return HTTP_ERROR_INVALID_RESPONSE;
+        statusCode = line.substring(space + 1).toInt();
+        if (statusCode == 100) {
+            // Skip the interim response's headers
+            do {
+                if (!readLine(line)) return HTTP_ERROR_TIMED_OUT;
+            } while (line.length() > 0);
+        }
+    } while (statusCode == 100);
+
+    if (statusCode <= 0) return HTTP_ERROR_INVALID_RESPONSE;
+    state = eReadingHeaders;
+    return statusCode;
+}
+
+bool HttpClient::headerAvailable() {
+    if (state == eRequestSent) responseStatusCode();
+    if (state != eReadingHeaders) return false;
+
+    String line;
+    if (!readLine(line) || line.length() == 0) {
+        state = eReadingBody;
+        return false;
+    }
+    int colon = line.indexOf(':');
+    if (colon < 0) {
+        headerName = line;
+        headerValue = "";
+    } else {
+        headerName = line.substring(0, colon);
+        headerValue = line.substring(colon + 1);
+        headerValue.trim();
+    }
+    if (headerName.equalsIgnoreCase("Content-Length")) {
+        bodyLength = headerValue.toInt();
+    }
+    return true;
+}
+
+String HttpClient::readHeaderName() { return headerName; }
+
+String HttpClient::readHeaderValue() { return headerValue; }
+
+int HttpClient::skipResponseHeaders() {
+    while (headerAvailable()) {}
+    return state == eReadingBody ? HTTP_SUCCESS : HTTP_ERROR_TIMED_OUT;
+}
+
+int HttpClient::contentLength() {
+    skipResponseHeaders();
+    return (int)bodyLength;
+}
+
+bool HttpClient::endOfBodyReached() {
+    if (state != eReadingBody) return false;
+    if (bodyLength >= 0) return bodyRead >= bodyLength;
+    return !client->connected();
+}
+
+String HttpClient::responseBody() {
+    skipResponseHeaders();
+    String body;
+    if (bodyLength > 0) body.reserve((unsigned int)bodyLength);
+    while (!endOfBodyReached()) {
+        int c = waitRead();
+        if (c < 0) break;
+        bodyRead++;
+        body += (char)c;
+    }
+    return body;
+}
+
+bool HttpClient::exhausted() {
+    return endOfBodyReached() || (!client->connected() && client->available() == 0);
+}
+
+Stream& HttpClient::responseStream() {
+    skipResponseHeaders();
+    setTimeout(responseTimeoutMs);
+    return *this;
+}
+
+// ========== Client ==========
+
+int HttpClient::connect(IPAddress ip, uint16_t port) { return client->connect(ip, port); }
+
+int HttpClient::connect(const char* host, uint16_t port) { return client->connect(host, port); }
+
+size_t HttpClient::write(uint8_t c) { return client->write(c); }
+
+size_t HttpClient::write(const uint8_t* buf, size_t size) { return client->write(buf, size); }
+
+int HttpClient::available() {
+    if (state == eReadingBody && bodyLength >= 0) {
+        long remaining = bodyLength - bodyRead;
+        int avail = client->available();
+        return (int)(avail < remaining ? avail : remaining);
+    }
+    return client->available();
+}
+
+int HttpClient::read() {
+    if (state == eReadingBody && bodyLength >= 0 && bodyRead >= bodyLength) return -1;
+    int c = client->read();
+    if (c >= 0 && state == eReadingBody) bodyRead++;
+    return c;
+}
+
+int HttpClient::read(uint8_t* buf, size_t size) {
+    if (state == eReadingBody && bodyLength >= 0) {
+        long remaining = bodyLength - bodyRead;
+        if (remaining <= 0) return -1;
+        if ((long)size > remaining) size = (size_t)remaining;
+    }
+    int n = client->read(buf, size);
+    if (n > 0 && state == eReadingBody) bodyRead += n;
+    return n;
+}
+
+int HttpClient::peek() { return client->peek(); }
+
+void HttpClient::flush() { client->flush(); }
+
+void HttpClient::stop() {
+    client->stop();
+    state = eIdle;
+    resetResponse();
+}
+
+uint8_t HttpClient::connected() { return client->connected(); }
+
+HttpClient::operator bool() { return (bool)*client; }
@@ -0,0 +1,534 @@
+#include "ArduinoJson.h"
+
+#include <cmath>
+#include <functional>
+
+using ArduinoJsonShim::Node;
+
+static const int NESTING_LIMIT = 10;
+
+// ========== Node ==========
+
+Node* Node::member(const char* key) const {
+    for (const auto& m : members) {
+        if (m.first == key) return m.second.get();
+    }
+    return nullptr;
+}
+
+// ========== JsonVariant ==========
+
+JsonVariant JsonVariant::operator[](const char* key) const {
+    if (!node) return JsonVariant(nullptr);
+    if (node->type == Node::Null) node->type = Node::Object;
+    if (node->type != Node::Object) return JsonVariant(nullptr);
+    Node* existing = node->member(key);
+    if (existing) return JsonVariant(existing);
+    node->members.emplace_back(key, std::make_shared<Node>());
+    return JsonVariant(node->members.back().second.get());
+}
+
+JsonVariant JsonVariant::operator[](int index) const {
+    if (!node || node->type != Node::Array) return JsonVariant(nullptr);
+    if (index < 0 || (size_t)index >= node->elements.size()) return JsonVariant(nullptr);
+    return JsonVariant(node->elements[(size_t)index].get());
+}
+
+JsonVariant JsonVariant::operator=(bool value) const {
+    if (node) {
+        *node = Node();
+        node->type = Node::Bool;
+        node->boolean = value;
+    }
+    return *this;
+}
+
+JsonVariant JsonVariant::setInteger(long long value) const {
+    if (node) {
+        *node = Node();
+        node->type = Node::Integer;
+        node->integer = value;
+    }
+    return *this;
+}
+
+JsonVariant JsonVariant::operator=(double value) const {
+    if (node) {
+        *node = Node();
+        node->type = Node::Float;
+        node->real = value;
+    }
+    return *this;
+}
+
+JsonVariant JsonVariant::operator=(const char* value) const {
+    if (node) {
+        *node = Node();
+        if (value) {
+            node->type = Node::Str;
+            node->str = value;
+        }
+    }
+    return *this;
+}
+
+bool JsonVariant::isNull() const { return !node || node->type == Node::Null; }
+
+size_t JsonVariant::size() const {
+    if (!node) return 0;
+    if (node->type == Node::Object) return node->members.size();
+    if (node->type == Node::Array) return node->elements.size();
+    return 0;
+}
+
+template <> bool JsonVariant::is<bool>() const { return node && node->type == Node::Bool; }
+template <> bool JsonVariant::is<int>() const { return node && node->type == Node::Integer; }
+template <> bool JsonVariant::is<long>() const { return node && node->type == Node::Integer; }
+template <> bool JsonVariant::is<unsigned long>() const {
+    return node && node->type == Node::Integer && node->integer >= 0;
+}
+template <> bool JsonVariant::is<double>() const {
+    return node && (node->type == Node::Float || node->type == Node::Integer);
+}
+template <> bool JsonVariant::is<const char*>() const { return node && node->type == Node::Str; }
+template <> bool JsonVariant::is<String>() const { return node && node->type == Node::Str; }
+
+template <> bool JsonVariant::as<bool>() const {
+    if (!node) return false;
+    if (node->type == Node::Bool) return node->boolean;
+    if (node->type == Node::Integer) return node->integer != 0;
+    return false;
+}
+template <> long JsonVariant::as<long>() const {
+    if (!node) return 0;
+    if (node->type == Node::Integer) return (long)node->integer;
+    if (node->type == Node::Float) return (long)node->real;
+    return 0;
+}
+template <> int JsonVariant::as<int>() const { return (int)as<long>(); }
+template <> unsigned long JsonVariant::as<unsigned long>() const { return (unsigned long)as<long>(); }
+template <> double JsonVariant::as<double>() const {
+    if (!node) return 0;
+    if (node->type == Node::Float) return node->real;
+    if (node->type == Node::Integer) return (double)node->integer;
+    return 0;
+}
+template <> const char* JsonVariant::as<const char*>() const {
+    return (node && node->type == Node::Str) ? node->str.c_str() : nullptr;
+}
+
+const char* JsonVariant::operator|(const char* fallback) const {
+    return is<const char*>() ? as<const char*>() : fallback;
+}
+
+// ========== Serialization ==========
+
+static void writeEscaped(const std::string& s, std::string& out) {
+    out += '"';
+    for (unsigned char c : s) {
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            default:
+                if (c < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += (char)c;
+                }
+        }
+    }
+    out += '"';
+}
+
+static void writeNode(const Node* n, std::string& out) {
+    switch (n->type) {
+        case Node::Null: out += "null"; break;
+        case Node::Bool: out += n->boolean ? "true" : "false"; break;
+        case Node::Integer: out += std::to_string(n->integer); break;
+        case Node::Float: {
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "%.9g", n->real);
+            out += buf;
+            break;
+        }
+        case Node::Str: writeEscaped(n->str, out); break;
+        case Node::Object: {
+            out += '{';
+            bool first = true;
+            for (const auto& m : n->members) {
+                if (!first) out += ',';
+                first = false;
+                writeEscaped(m.first, out);
+                out += ':';
+                writeNode(m.second.get(), out);
+            }
+            out += '}';
+            break;
+        }
+        case Node::Array: {
+            out += '[';
+            for (size_t i = 0; i < n->elements.size(); i++) {
+                if (i) out += ',';
+                writeNode(n->elements[i].get(), out);
+            }
+            out += ']';
+            break;
+        }
+    }
+}
+
+template <> String JsonVariant::as<String>() const {
+    if (!node) return String("null");
+    if (node->type == Node::Str) return String(node->str.c_str());
+    std::string out;
+    writeNode(node, out);
+    return String(out.c_str());
+}
+
+// ========== JsonDocument ==========
+
+JsonDocument::JsonDocument() : root(std::make_shared<Node>()) {}
+
+JsonDocument::JsonDocument(const JsonDocument& other)
+    : root(std::make_shared<Node>(*other.root))
+{
+}
+
+JsonDocument& JsonDocument::operator=(const JsonDocument& other) {
+    root = std::make_shared<Node>(*other.root);
+    return *this;
+}
+
+void JsonDocument::clear() { *root = Node(); }
+
+// ========== Parsing ==========
+
+namespace {
+
+class Parser {
+public:
+    explicit Parser(std::function<int()> next) : next_(std::move(next)), peeked_(-2) {}
+
+    DeserializationError parse(Node& out) {
+        skipSpace();
+        if (peek() < 0) return DeserializationError::EmptyInput;
+        return parseValue(out, 0);
+    }
+
+private:
+    std::function<int()> next_;
+    int peeked_;
+
+    int peek() {
+        if (peeked_ == -2) peeked_ = next_();
+        return peeked_;
+    }
+    int get() {
+        int c = peek();
+        peeked_ = -2;
+        return c;
+    }
+    void skipSpace() {
+        while (peek() == ' ' || peek() == '\t' || peek() == '\n' || peek() == '\r') get();
+    }
+
+    DeserializationError parseValue(Node& out, int depth) {
+        skipSpace();
+        int c = peek();
+        if (c < 0) return DeserializationError::IncompleteInput;
+        if (c == '{' || c == '[') {
+            if (depth >= NESTING_LIMIT) return DeserializationError::TooDeep;
+            return c == '{' ? parseObject(out, depth + 1) : parseArray(out, depth + 1);
+        }
+        if (c == '"') {
+            out.type = Node::Str;
+            return parseString(out.str);
+        }
+        if (c == '-' || (c >= '0' && c <= '9')) return parseNumber(out);
+        if (c == 't') return parseLiteral("true", out, Node::Bool, true);
+        if (c == 'f') return parseLiteral("false", out, Node::Bool, false);
+        if (c == 'n') return parseLiteral("null", out, Node::Null, false);
+        return DeserializationError::InvalidInput;
+    }
+
+    DeserializationError parseLiteral(const char* word, Node& out, Node::Type type, bool value) {
+        for (const char* p = word; *p; p++) {
+            int c = get();
+            if (c < 0) return DeserializationError::IncompleteInput;
+            if (c != *p) return DeserializationError::InvalidInput;
+        }
+        out.type = type;
+        out.boolean = value;
+        return DeserializationError::Ok;
+    }
+
+    DeserializationError parseNumber(Node& out) {
+        std::string text;
+        while (peek() >= 0 && std::strchr("+-0123456789.eE", peek())) text += (char)get();
+        if (text.empty() || text == "-") return DeserializationError::InvalidInput;
+        if (text.find_first_of(".eE") == std::string::npos && text.size() < 19) {
+            out.type = Node::Integer;
+            out.integer = std::strtoll(text.c_str(), nullptr, 10);
+        } else {
+            char* end = nullptr;
+            out.type = Node::Float;
+            out.real = std::strtod(text.c_str(), &end);
+            if (!end || *end) return DeserializationError::InvalidInput;
+        }
+        return DeserializationError::Ok;
+    }
+
+    static void appendUtf8(std::string& s, unsigned long cp) {
+        if (cp < 0x80) {
+            s += (char)cp;
+        } else if (cp < 0x800) {
+            s += (char)(0xC0 | (cp >> 6));
+            s += (char)(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            s += (char)(0xE0 | (cp >> 12));
+            s += (char)(0x80 | ((cp >> 6) & 0x3F));
+            s += (char)(0x80 | (cp & 0x3F));
+        } else {
+            s += (char)(0xF0 | (cp >> 18));
+            s += (char)(0x80 | ((cp >> 12) & 0x3F));
+            s += (char)(0x80 | ((cp >> 6) & 0x3F));
+            s += (char)(0x80 | (cp & 0x3F));
+        }
+    }
+
+    DeserializationError parseHex4(unsigned long& cp) {
+        cp = 0;
+        for (int i = 0; i < 4; i++) {
+            int c = get();
+            if (c < 0) return DeserializationError::IncompleteInput;
+            if (!std::isxdigit(c)) return DeserializationError::InvalidInput;
+            cp = cp * 16 + (unsigned long)(std::isdigit(c) ? c - '0' : (std::tolower(c) - 'a' + 10));
+        }
+        return DeserializationError::Ok;
+    }
+
+    DeserializationError parseString(std::string& s) {
+        get(); // opening quote
+        for (;;) {
+            int c = get();
+            if (c < 0) return DeserializationError::IncompleteInput;
+            if (c == '"') return DeserializationError::Ok;
+            if (c != '\\') {
+                s += (char)c;
+                continue;
+            }
+            c = get();
+            switch (c) {
+                case '"': s += '"'; break;
+                case '\\': s += '\\'; break;
+                case '/': s += '/'; break;
+                case 'b': s += '\b'; break;
+                case 'f': s += '\f'; break;
+                case 'n': s += '\n'; break;
+                case 'r': s += '\r'; break;
+                case 't': s += '\t'; break;
+                case 'u': {
+                    unsigned long cp;
+                    DeserializationError err = parseHex4(cp);
+                    if (err) return err;
+                    if (cp >= 0xD800 && cp < 0xDC00 && peek() == '\\') {
+                        get();
+                        if (get() != 'u') return DeserializationError::InvalidInput;
+                        unsigned long lo;
+                        err = parseHex4(lo);
+                        if (err) return err;
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                    }
+                    appendUtf8(s, cp);
+                    break;
+                }
+                case -1: return DeserializationError::IncompleteInput;
+                default: return DeserializationError::InvalidInput;
+            }
+        }
+    }
+
+    DeserializationError parseObject(Node& out, int depth) {
+        get(); // {
+        out.type = Node::Object;
+        skipSpace();
+        if (peek() == '}') {
+            get();
+            return DeserializationError::Ok;
+        }
+        for (;;) {
+            skipSpace();
+            if (peek() < 0) return DeserializationError::IncompleteInput;
+            if (peek() != '"') return DeserializationError::InvalidInput;
+            std::string key;
+            DeserializationError err = parseString(key);
+            if (err) return err;
+            skipSpace();
+            int c = get();
+            if (c < 0) return DeserializationError::IncompleteInput;
+            if (c != ':') return DeserializationError::InvalidInput;
+            auto value = std::make_shared<Node>();
+            err = parseValue(*value, depth);
+            if (err) return err;
+            out.members.emplace_back(key, value);
+            skipSpace();
+            c = get();
+            if (c == '}') return DeserializationError::Ok;
+            if (c < 0) return DeserializationError::IncompleteInput;
+            if (c != ',') return DeserializationError::InvalidInput;
+        }
+    }
+
+    DeserializationError parseArray(Node& out, int depth) {
+        get(); // [
+        out.type = Node::Array;
+        skipSpace();
+        if (peek() == ']') {
+            get();
+            return DeserializationError::Ok;
+        }
+        for (;;) {
+            auto value = std::make_shared<Node>();
+            DeserializationError err = parseValue(*value, depth);
+            if (err) return err;
+            out.elements.push_back(value);
+            skipSpace();
+            int c = get();
+            if (c == ']') return DeserializationError::Ok;
+            if (c < 0) return DeserializationError::IncompleteInput;
+            if (c != ',') return DeserializationError::InvalidInput;
+        }
+    }
+};
+
+// Keeps only what the filter selects: `true` keeps a whole subtree, an
+// object keeps the listed members, and a one-element array applies its
+// element to every element of the input array.
+void applyFilter(Node& node, const Node* filter) {
+    if (!filter || filter->type == Node::Bool) {
+        if (!filter || !filter->boolean) node = Node();
+        return;
+    }
+    if (filter->type == Node::Object && node.type == Node::Object) {
+        std::vector<std::pair<std::string, std::shared_ptr<Node>>> kept;
+        for (auto& m : node.members) {
+            const Node* sub = filter->member(m.first.c_str());
+            if (!sub) sub = filter->member("*");
+            if (!sub) continue;
+            applyFilter(*m.second, sub);
+            kept.push_back(m);
+        }
+        node.members.swap(kept);
+        return;
+    }
+    if (filter->type == Node::Array && node.type == Node::Array && !filter->elements.empty()) {
+        for (auto& e : node.elements) applyFilter(*e, filter->elements[0].get());
+        return;
+    }
+    node = Node();
+}
+
+DeserializationError parseInto(JsonDocument& doc, std::function<int()> next,
+                               const JsonVariant* filter) {
+    doc.clear();
+    Node* root = doc.as().raw();
+    DeserializationError err = Parser(std::move(next)).parse(*root);
+    if (err) {
+        doc.clear();
+        return err;
+    }
+    if (filter) applyFilter(*root, filter->raw());
+    return err;
+}
+
+} // namespace
+
+const char* DeserializationError::c_str() const {
+    switch (code_) {
+        case Ok: return "Ok";
+        case EmptyInput: return "EmptyInput";
+        case IncompleteInput: return "IncompleteInput";
+        case InvalidInput: return "InvalidInput";
+        case NoMemory: return "NoMemory";
+        case TooDeep: return "TooDeep";
+    }
+    return "???";
+}
+
+static std::function<int()> streamSource(Stream& input) {
+    return [&input]() {
+        char c;
+        return input.readBytes(&c, 1) == 1 ? (int)(unsigned char)c : -1;
+    };
+}
+
+static std::function<int()> bufferSource(const char* input, size_t length) {
+    size_t pos = 0;
+    return [input, length, pos]() mutable {
+        return pos < length ? (int)(unsigned char)input[pos++] : -1;
+    };
+}
+
+DeserializationError deserializeJson(JsonDocument& doc, Stream& input) {
+    return parseInto(doc, streamSource(input), nullptr);
+}
+
+DeserializationError deserializeJson(JsonDocument& doc, Stream& input,
+                                     DeserializationOption::Filter filter) {
+    JsonVariant f = filter.variant();
+    return parseInto(doc, streamSource(input), &f);
+}
+
+DeserializationError deserializeJson(JsonDocument& doc, const char* input, size_t length) {
+    return parseInto(doc, bufferSource(input, length), nullptr);
+}
+
+DeserializationError deserializeJson(JsonDocument& doc, const char* input, size_t length,
+                                     DeserializationOption::Filter filter) {
+    JsonVariant f = filter.variant();
+    return parseInto(doc, bufferSource(input, length), &f);
+}
+
+DeserializationError deserializeJson(JsonDocument& doc, const char* input) {
+    return deserializeJson(doc, input, std::strlen(input));
+}
+
+DeserializationError deserializeJson(JsonDocument& doc, const String& input) {
+    return deserializeJson(doc, input.c_str(), input.length());
+}
+
+size_t serializeJson(const JsonDocument& doc, char* output, size_t size) {
+    std::string out;
+    writeNode(doc.as().raw(), out);
+    if (size == 0) return 0;
+    size_t n = out.size() < size - 1 ? out.size() : size - 1;
+    std::memcpy(output, out.data(), n);
+    output[n] = '\0';
+    return n;
+}
+
+size_t serializeJson(const JsonDocument& doc, String& output) {
+    std::string out;
+    writeNode(doc.as().raw(), out);
+    output = out.c_str();
+    return out.size();
+}
+
+size_t serializeJson(const JsonDocument& doc, Print& output) {
+    std::string out;
+    writeNode(doc.as().raw(), out);
+    return output.write(out.data(), out.size());
+}
+
+size_t measureJson(const JsonDocument& doc) {
+    std::string out;
+    writeNode(doc.as().raw(), out);
+    return out.size();
+}
@@ -0,0 +1,125 @@
+/**
+ * Host implementation of the mem_stats.h platform readings.
+ *
+ * Replaces global operator new/delete with a counting version. Only
+ * allocations made on the sketch thread (the one that last called
+ * emu::reset()) are counted; std::string, the String shim and the JSON shim
+ * all allocate through operator new, so the counts cover everything the
+ * sketch allocates. Frees are matched through a per-block header, so memory
+ * released on another thread is still accounted correctly.
+ */
+#include "mem_stats.h"
+#include "emulation.h"
+
+#include <malloc.h>
+#include <pthread.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+struct alignas(16) AllocHeader {
+    size_t size;
+    bool counted;
+};
+
+std::atomic<unsigned long> allocCount(0);
+std::atomic<unsigned long> freeCount(0);
+std::atomic<unsigned long> bytesInUse(0);
+std::atomic<unsigned long> peakMark(0);
+
+pthread_t sketchThread;
+std::atomic<bool> sketchThreadKnown(false);
+thread_local bool countingPaused = false;
+
+bool onSketchThread() {
+    return !countingPaused && sketchThreadKnown.load(std::memory_order_relaxed) &&
+           pthread_equal(pthread_self(), sketchThread);
+}
+
+void* countedAlloc(size_t size) {
+    AllocHeader* h = static_cast<AllocHeader*>(std::malloc(sizeof(AllocHeader) + size));
+    if (!h) return nullptr;
+    h->size = size;
+    h->counted = onSketchThread();
+    if (h->counted) {
+        allocCount++;
+        unsigned long now = bytesInUse += size;
+        unsigned long peak = peakMark.load();
+        while (now > peak && !peakMark.compare_exchange_weak(peak, now)) {}
+    }
+    return h + 1;
+}
+
+void countedFree(void* p) {
+    if (!p) return;
+    AllocHeader* h = static_cast<AllocHeader*>(p) - 1;
+    if (h->counted) {
+        freeCount++;
+        bytesInUse -= h->size;
+    }
+    std::free(h);
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    void* p = countedAlloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void operator delete(void* p) noexcept { countedFree(p); }
+void operator delete[](void* p) noexcept { countedFree(p); }
+void operator delete(void* p, size_t) noexcept { countedFree(p); }
+void operator delete[](void* p, size_t) noexcept { countedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { countedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { countedFree(p); }
+
+HeapCounters readHeapCounters() {
+    HeapCounters c;
+    c.allocs = allocCount.load();
+    c.frees = freeCount.load();
+    c.inUse = bytesInUse.load();
+    c.peak = peakMark.load();
+    if (c.inUse > c.peak) c.peak = c.inUse;
+    return c;
+}
+
+void setHeapPeak(unsigned long bytes) {
+    peakMark = bytes;
+}
+
+// glibc serves large blocks from mmap, so there is no meaningful largest
+// block; report the free space in the main arena instead.
+unsigned long largestFreeBlock() {
+    struct mallinfo2 mi = mallinfo2();
+    return (unsigned long)mi.fordblks;
+}
+
+// Current (not high-water) headroom of the calling thread's stack
+unsigned long stackFreeBytes() {
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) != 0) return 0;
+    void* base;
+    size_t size;
+    pthread_attr_getstack(&attr, &base, &size);
+    pthread_attr_destroy(&attr);
+    char marker;
+    return (unsigned long)(&marker - static_cast<char*>(base));
+}
+
+namespace emu {
+void setHeapCounting(bool enabled) {
+    countingPaused = !enabled;
+}
+
+void resetMemory() {
+    sketchThread = pthread_self();
+    sketchThreadKnown = true;
+}
+}
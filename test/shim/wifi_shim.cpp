@@ -0,0 +1,351 @@
+#include "WiFi.h"
+#include "WiFiSSLClient.h"
+#include "emulation.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#if EMULATION_TLS
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#endif
+
+// ========== WiFi ==========
+
+WiFiClass WiFi;
+
+static bool wifiConnected = true;
+static unsigned long epochBase = 1705345200UL; // Mon Jan 15 2024 19:00:00 UTC
+static int wifiRssi = -58;
+
+int WiFiClass::begin(const char*, const char*) { return status(); }
+
+void WiFiClass::disconnect() {}
+
+uint8_t WiFiClass::status() { return wifiConnected ? WL_CONNECTED : WL_DISCONNECTED; }
+
+String WiFiClass::macAddress() { return String("A8:61:0A:AE:00:00"); }
+
+IPAddress WiFiClass::localIP() {
+    return wifiConnected ? IPAddress(10, 0, 0, 2) : IPAddress();
+}
+
+unsigned long WiFiClass::getTime() {
+    if (!wifiConnected || epochBase == 0) return 0;
+    return epochBase + millis() / 1000;
+}
+
+int32_t WiFiClass::RSSI() { return wifiConnected ? wifiRssi : 0; }
+
+void emu::setWifiConnected(bool connected) { wifiConnected = connected; }
+
+void emu::setEpochTime(unsigned long epochSeconds) {
+    // Anchor to the virtual clock so getTime() keeps advancing with millis()
+    epochBase = epochSeconds == 0 ? 0 : epochSeconds - millis() / 1000;
+}
+
+void emu::setRssi(int dbm) { wifiRssi = dbm; }
+
+namespace emu {
+void resetWifi() {
+    wifiConnected = true;
+    epochBase = 1705345200UL;
+    wifiRssi = -58;
+}
+}
+
+// ========== Routing and stats ==========
+
+static std::mutex routesMutex;
+static std::map<std::pair<std::string, uint16_t>, uint16_t> routes;
+static emu::SocketStats stats = {0, 0, 0, 0, 0, 0};
+static unsigned connectLatencyMs = 0;
+
+void emu::routeHost(const std::string& host, uint16_t port, uint16_t localPort) {
+    std::lock_guard<std::mutex> lock(routesMutex);
+    routes[std::make_pair(host, port)] = localPort;
+}
+
+void emu::clearRoutes() {
+    std::lock_guard<std::mutex> lock(routesMutex);
+    routes.clear();
+}
+
+void emu::setConnectLatencyMs(unsigned ms) { connectLatencyMs = ms; }
+
+emu::SocketStats emu::socketStats() { return stats; }
+
+void emu::resetSocketStats() { stats = SocketStats{0, 0, 0, 0, 0, 0}; }
+
+// ========== TLS ==========
+
+#if EMULATION_TLS
+
+static SSL_CTX* tlsContext = nullptr; // null: plain TCP
+
+bool emu::setTls(const std::string& certPem) {
+    if (tlsContext) {
+        SSL_CTX_free(tlsContext);
+        tlsContext = nullptr;
+    }
+    if (certPem.empty()) return true;
+
+    BIO* bio = BIO_new_mem_buf(certPem.data(), (int)certPem.size());
+    X509* cert = bio ? PEM_read_bio_X509(bio, nullptr, nullptr, nullptr) : nullptr;
+    BIO_free(bio);
+    SSL_CTX* context = cert ? SSL_CTX_new(TLS_client_method()) : nullptr;
+    if (!context || !X509_STORE_add_cert(SSL_CTX_get_cert_store(context), cert)) {
+        X509_free(cert);
+        SSL_CTX_free(context);
+        ERR_clear_error();
+        return false;
+    }
+    X509_free(cert);
+    ::signal(SIGPIPE, SIG_IGN); // OpenSSL writes with write(), not send(MSG_NOSIGNAL)
+    SSL_CTX_set_min_proto_version(context, TLS1_2_VERSION);
+    SSL_CTX_set_verify(context, SSL_VERIFY_PEER, nullptr);
+    tlsContext = context;
+    return true;
+}
+
+#else
+
+bool emu::setTls(const std::string& certPem) { return certPem.empty(); }
+
+#endif
+
+namespace emu {
+void resetSockets() {
+    clearRoutes();
+    connectLatencyMs = 0;
+    setTls("");
+    resetSocketStats();
+}
+}
+
+static int lookupRoute(const char* host, uint16_t port) {
+    std::lock_guard<std::mutex> lock(routesMutex);
+    auto it = routes.find(std::make_pair(std::string(host), port));
+    return it == routes.end() ? -1 : it->second;
+}
+
+// ========== WiFiSSLClient ==========
+
+WiFiSSLClient::WiFiSSLClient()
+    : fd(-1)
+    , ssl(nullptr)
+    , peerClosed(false)
+    , rxLen(0)
+    , rxPos(0)
+{
+}
+
+WiFiSSLClient::~WiFiSSLClient() {
+    stop();
+}
+
+int WiFiSSLClient::connect(IPAddress, uint16_t) {
+    return 0; // the sketch only connects by hostname
+}
+
+int WiFiSSLClient::connect(const char* host, uint16_t port) {
+    stop();
+    if (!wifiConnected) return 0;
+    int localPort = lookupRoute(host, port);
+    if (localPort < 0) return 0;
+
+    fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return 0;
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)localPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        fd = -1;
+        return 0;
+    }
+    if (connectLatencyMs > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(connectLatencyMs));
+        delay(connectLatencyMs);
+    }
+    if (!handshake(host)) {
+        stop();
+        return 0;
+    }
+    stats.connects++;
+    peerClosed = false;
+    rxLen = rxPos = 0;
+    return 1;
+}
+
+// Runs the TLS handshake when emu::setTls() is on, then leaves the socket
+// non-blocking so reads can return "nothing yet" as for plain TCP.
+bool WiFiSSLClient::handshake(const char* host) {
+#if EMULATION_TLS
+    if (!tlsContext) return true;
+    ssl = SSL_new(tlsContext);
+    if (!ssl) return false;
+    SSL_set_fd(ssl, fd);
+    SSL_set_tlsext_host_name(ssl, host);
+
+    auto start = std::chrono::steady_clock::now();
+    bool ok = SSL_connect(ssl) == 1;
+    stats.handshakeUs += (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    if (!ok) {
+        ERR_clear_error();
+        return false;
+    }
+    stats.handshakes++;
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return true;
+#else
+    (void)host;
+    return true;
+#endif
+}
+
+size_t WiFiSSLClient::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t WiFiSSLClient::write(const uint8_t* buf, size_t size) {
+    if (fd < 0) return 0;
+    stats.writeCalls++;
+    size_t sent = 0;
+    while (sent < size) {
+#if EMULATION_TLS
+        if (ssl) {
+            int r = SSL_write(ssl, buf + sent, (int)(size - sent));
+            if (r > 0) {
+                sent += (size_t)r;
+                continue;
+            }
+            int error = SSL_get_error(ssl, r);
+            if (error != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE) break;
+            pollfd p = {fd, (short)(error == SSL_ERROR_WANT_READ ? POLLIN : POLLOUT), 0};
+            ::poll(&p, 1, 100);
+            continue;
+        }
+#endif
+        ssize_t n = ::send(fd, buf + sent, size - sent, MSG_NOSIGNAL);
+        if (n <= 0) break;
+        sent += (size_t)n;
+    }
+    stats.bytesWritten += sent;
+    return sent;
+}
+
+bool WiFiSSLClient::fill(bool wait) {
+    if (rxPos < rxLen) return true;
+    if (fd < 0 || peerClosed) return false;
+#if EMULATION_TLS
+    if (ssl) {
+        if (wait) {
+            pollfd p = {fd, POLLIN, 0};
+            if (SSL_pending(ssl) == 0) ::poll(&p, 1, -1);
+        }
+        int r = SSL_read(ssl, rxBuf, sizeof(rxBuf));
+        if (r <= 0) {
+            int error = SSL_get_error(ssl, r);
+            if (error != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE) {
+                peerClosed = true; // close_notify, reset or protocol error
+                ERR_clear_error();
+            }
+            return false;
+        }
+        stats.bytesRead += (unsigned long)r;
+        rxLen = (size_t)r;
+        rxPos = 0;
+        return true;
+    }
+#endif
+    ssize_t n = ::recv(fd, rxBuf, sizeof(rxBuf), wait ? 0 : MSG_DONTWAIT);
+    if (n == 0) {
+        peerClosed = true;
+        return false;
+    }
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) peerClosed = true; // reset
+        return false; // EAGAIN: nothing yet
+    }
+    stats.bytesRead += (unsigned long)n;
+    rxLen = (size_t)n;
+    rxPos = 0;
+    return true;
+}
+
+int WiFiSSLClient::available() {
+    if (!fill(false) && fd >= 0 && !peerClosed) {
+        // Callers poll available() between delay()s, which cost no real
+        // time; give the stand-in a moment so a wait is not over in an
+        // instant of wall time but seconds of virtual time.
+        pollfd p = {fd, POLLIN, 0};
+        if (::poll(&p, 1, 1) > 0) fill(false);
+    }
+    return (int)(rxLen - rxPos);
+}
+
+int WiFiSSLClient::read() {
+    if (!fill(false)) return -1;
+    return rxBuf[rxPos++];
+}
+
+int WiFiSSLClient::read(uint8_t* buf, size_t size) {
+    if (!fill(false)) return -1;
+    size_t n = rxLen - rxPos;
+    if (n > size) n = size;
+    std::memcpy(buf, rxBuf + rxPos, n);
+    rxPos += n;
+    return (int)n;
+}
+
+int WiFiSSLClient::peek() {
+    if (!fill(false)) return -1;
+    return rxBuf[rxPos];
+}
+
+void WiFiSSLClient::flush() {}
+
+void WiFiSSLClient::stop() {
+#if EMULATION_TLS
+    if (ssl) {
+        SSL_shutdown(ssl); // best effort; never waits
+        SSL_free(ssl);
+        ssl = nullptr;
+        ERR_clear_error();
+    }
+#endif
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    peerClosed = false;
+    rxLen = rxPos = 0;
+}
+
+uint8_t WiFiSSLClient::connected() {
+    if (fd < 0) return 0;
+    fill(false);
+    return (!peerClosed || rxPos < rxLen) ? 1 : 0;
+}
+
+WiFiSSLClient::operator bool() { return fd >= 0; }
@@ -0,0 +1,104 @@
+/**
+ * Request-path benchmark for the flowsheet client stack, built by the `size`
+ * target for each FLOWSHEET_BACKEND both as the sketch builds it (backend
+ * hooks bound at compile time) and with FLOWSHEET_DISPATCH_VIRTUAL=1 (hooks
+ * behind a vtable). Like the sketch, each build constructs the one backend
+ * it selects. Each entry is queued, composed, written and its response read
+ * against an in-memory Transport, so the time is the client's own work.
+ */
+#include "backend_service_client.h"
+#include "config.h"
+#include "flowsheet_client.h"
+#include "log_buffer.h"
+#include "mem_stats.h"
+#include "loopback_transport.h"
+#include "stall_detector.h"
+
+#include <chrono>
+#include <cstdio>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// The globals the sketch defines
+MemStats memStats;
+static char logStorage[LOG_BUFFER_SIZE];
+LogBuffer serialLog(logStorage, sizeof(logStorage));
+StallDetector stallDetector(WATCHDOG_TIMEOUT_MS);
+
+static const int ROUNDS = 10;
+static const int ENTRIES = 2000; // per round
+static const unsigned long SHOW_HOUR_MS = 1705345200000UL;
+
+static MemoryTransport transport;
+static NetworkManager network(LINK_FAILURE_THRESHOLD, LINK_COOLDOWN_MS, LINK_PREFERENCE_MS);
+
+static unsigned long long ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Runs ROUNDS shows of ENTRIES entries, as the sketch would: startShow()
+// answered with `started`, each entry and the sign-off with `answer`. Prints
+// the mean ticks per entry of the quickest round, the one least disturbed by
+// the host.
+template <class Client>
+static void bench(const char* name, Client& client, const std::string& started,
+                  const std::string& answer) {
+    unsigned long long best = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        transport.client.load(started);
+        int showID = client.startShow(SHOW_HOUR_MS);
+        if (showID < 0) {
+            printf("%s: startShow failed\n", name);
+            return;
+        }
+        unsigned long long total = 0;
+        for (int i = 0; i < ENTRIES; i++) {
+            transport.client.load(answer);
+            String title = String("Track ") + String(i % 64); // revisits cached tracks
+            unsigned long long start = ticks();
+            if (!client.addEntry(showID, SHOW_HOUR_MS, "Artist", title, "Album", i % 64)) {
+                printf("%s: entry %d failed\n", name, i);
+                return;
+            }
+            total += ticks() - start;
+            drainSerialLog();
+        }
+        transport.client.load(answer);
+        client.endShow(showID);
+        drainSerialLog();
+        if (round == 0 || total < best) best = total;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    printf("%-22s %8llu cycles/entry\n", name, best / ENTRIES);
+#else
+    printf("%-22s %8llu ns/entry\n", name, best / ENTRIES);
+#endif
+}
+
+int main() {
+    network.addTransport(transport);
+    network.setUp();
+
+    printf("%s dispatch: ", FLOWSHEET_DISPATCH_VIRTUAL ? "Virtual" : "Static");
+#if FLOWSHEET_BACKEND == BACKEND_SERVICE
+    BackendServiceClient flowsheet(network, BACKEND_SERVICE_HOST, BACKEND_SERVICE_PORT,
+                                   "token", 1);
+    bench("BackendServiceClient", flowsheet,
+          "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 9\r\n\r\n"
+          "{\"id\":42}",
+          "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 2\r\n\r\n{}");
+#else
+    FlowsheetClient flowsheet(network, TUBAFRENZY_HOST, TUBAFRENZY_PORT, "key");
+    bench("FlowsheetClient", flowsheet,
+          "HTTP/1.1 302 Found\r\nLocation: /playlists/flowsheet?radioShowID=42\r\n"
+          "Content-Length: 0\r\n\r\n",
+          "HTTP/1.1 302 Found\r\nLocation: /playlists/flowsheet\r\nContent-Length: 0\r\n\r\n");
+#endif
+    return 0;
+}
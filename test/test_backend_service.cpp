@@ -0,0 +1,291 @@
+/**
+ * BackendServiceClient against the stand-in Backend-Service server on
+ * localhost, over the emulated WiFiSSLClient, and its throughput next to
+ * the tubafrenzy FlowsheetClient.
+ */
+#include <gtest/gtest.h>
+
+#include "backend_service_client.h"
+#include "config.h"
+#include "emulation.h"
+#include "flowsheet_client.h"
+#include "log_buffer.h"
+#include "loopback_transport.h"
+#include "play_history.h"
+#include "standin_server.h"
+#include <WiFiSSLClient.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#define TOKEN "test-token"
+#define DJ_ID 42
+#define HOUR_MS 3600000UL
+#define SHOW_HOUR_MS 1705345200000UL
+
+// ========== Helpers ==========
+
+class BackendServiceTest : public ::testing::Test {
+protected:
+    BackendServiceStandin standin{TOKEN};
+    LoopbackTransport transport;
+    NetworkManager network{LINK_FAILURE_THRESHOLD, LINK_COOLDOWN_MS, LINK_PREFERENCE_MS};
+    BackendServiceClient client{network, BACKEND_SERVICE_HOST, BACKEND_SERVICE_PORT, TOKEN, DJ_ID};
+
+    void SetUp() override {
+        emu::reset();
+        emu::routeHost(BACKEND_SERVICE_HOST, BACKEND_SERVICE_PORT, standin.server().port());
+        network.addTransport(transport);
+        network.setUp();
+    }
+    void TearDown() override { drainSerialLog(); }
+
+    std::vector<StandinRequest> requestsTo(const std::string& path) {
+        std::vector<StandinRequest> matching;
+        for (const auto& r : standin.server().requests()) {
+            if (r.path == path) matching.push_back(r);
+        }
+        return matching;
+    }
+};
+
+// ========== Protocol ==========
+
+TEST_F(BackendServiceTest, JoinSendsJsonAndReadsShowId) {
+    EXPECT_EQ(client.startShow(SHOW_HOUR_MS), 789);
+    EXPECT_TRUE(standin.showOpen());
+
+    auto joins = requestsTo(BACKEND_SERVICE_PATH_JOIN);
+    ASSERT_EQ(joins.size(), 1u);
+    EXPECT_EQ(joins[0].body, "{\"dj_id\":42,\"show_name\":\"Auto DJ\"}");
+    EXPECT_EQ(joins[0].header("Authorization"), "Bearer " TOKEN);
+    EXPECT_EQ(joins[0].header("Content-Type"), "application/json");
+}
+
+TEST_F(BackendServiceTest, EntryIsFreeformSongJson) {
+    ASSERT_GT(client.startShow(SHOW_HOUR_MS), 0);
+    EXPECT_TRUE(client.addEntry(789, SHOW_HOUR_MS, "Yo La Tengo", "Autumn Sweater",
+                                "I Can Hear the Heart Beating as One"));
+
+    auto adds = requestsTo(BACKEND_SERVICE_PATH_ENTRY);
+    ASSERT_EQ(adds.size(), 1u);
+    EXPECT_EQ(adds[0].body,
+              "{\"artist_name\":\"Yo La Tengo\","
+              "\"album_title\":\"I Can Hear the Heart Beating as One\","
+              "\"track_title\":\"Autumn Sweater\",\"request_flag\":false,\"record_label\":\"\"}");
+}
+
+TEST_F(BackendServiceTest, FieldsAreEscaped) {
+    ASSERT_GT(client.startShow(SHOW_HOUR_MS), 0);
+    const char* artist = "Sigur R\xc3\xb3s \"live\"";
+    const char* title = "back\\slash\ttab\nnewline";
+    const char* album = "bell\x07";
+    EXPECT_TRUE(client.addEntry(789, SHOW_HOUR_MS, artist, title, album));
+
+    auto entries = standin.entries();
+    ASSERT_EQ(entries.size(), 1u);
+    EXPECT_EQ(entries[0].artist, artist);
+    EXPECT_EQ(entries[0].title, title);
+    EXPECT_EQ(entries[0].album, album);
+    EXPECT_NE(requestsTo(BACKEND_SERVICE_PATH_ENTRY)[0].body.find("\\u0007"), std::string::npos);
+}
+
+TEST_F(BackendServiceTest, BreakpointPrecedesFirstEntryOfEachHour) {
+    ASSERT_GT(client.startShow(SHOW_HOUR_MS), 0);
+    EXPECT_TRUE(client.addEntry(789, SHOW_HOUR_MS, "A", "One", "X"));
+    EXPECT_TRUE(client.addEntry(789, SHOW_HOUR_MS, "B", "Two", "X"));
+    EXPECT_TRUE(client.addEntry(789, SHOW_HOUR_MS + HOUR_MS, "C", "Three", "X"));
+    EXPECT_TRUE(client.addEntry(789, SHOW_HOUR_MS + HOUR_MS, "D", "Four", "X"));
+
+    auto entries = standin.entries();
+    ASSERT_EQ(entries.size(), 5u);
+    EXPECT_FALSE(entries[0].message);
+    EXPECT_FALSE(entries[1].message);
+    EXPECT_TRUE(entries[2].message);
+    EXPECT_EQ(entries[2].text, "BREAKPOINT");
+    EXPECT_EQ(entries[3].title, "Three");
+    EXPECT_FALSE(entries[4].message);
+}
+
+TEST_F(BackendServiceTest, EndShowTakesHeldEntriesAlong) {
+    ASSERT_GT(client.startShow(SHOW_HOUR_MS), 0);
+    client.queueEntry(789, SHOW_HOUR_MS, "A", "One", "X");
+    client.queueEntry(789, SHOW_HOUR_MS, "B", "Two", "X");
+    EXPECT_TRUE(client.endShow(789));
+
+    EXPECT_EQ(client.queuedEntries(), 0);
+    EXPECT_EQ(standin.entries().size(), 2u);
+    EXPECT_FALSE(standin.showOpen());
+    auto ends = requestsTo(BACKEND_SERVICE_PATH_END);
+    ASSERT_EQ(ends.size(), 1u);
+    EXPECT_EQ(ends[0].body, "{\"dj_id\":42}");
+}
+
+TEST_F(BackendServiceTest, RejectedTokenFails) {
+    BackendServiceClient wrong(network, BACKEND_SERVICE_HOST, BACKEND_SERVICE_PORT, "stale", DJ_ID);
+    EXPECT_EQ(wrong.startShow(SHOW_HOUR_MS), -1);
+    EXPECT_FALSE(wrong.addEntry(789, SHOW_HOUR_MS, "A", "One", "X"));
+    EXPECT_EQ(wrong.queuedEntries(), 0); // answered, so not resent
+    EXPECT_FALSE(standin.showOpen());
+}
+
+TEST_F(BackendServiceTest, EntryWithoutShowFails) {
+    EXPECT_FALSE(client.addEntry(789, SHOW_HOUR_MS, "A", "One", "X"));
+    EXPECT_FALSE(client.endShow(789));
+    EXPECT_TRUE(standin.entries().empty());
+}
+
+TEST_F(BackendServiceTest, OutcomesGoToPlayHistory) {
+    std::vector<uint8_t> recordStorage(PLAY_RECORD_SIZE * 16), indexStorage(64);
+    MemoryHistoryFile records(recordStorage.data(), recordStorage.size());
+    MemoryHistoryFile index(indexStorage.data(), indexStorage.size());
+    PlayHistory history;
+    ASSERT_TRUE(history.begin(records, index));
+    client.recordTo(&history);
+
+    ASSERT_GT(client.startShow(SHOW_HOUR_MS), 0);
+    EXPECT_TRUE(client.addEntry(789, SHOW_HOUR_MS, "A", "One", "X", 11));
+    client.queueEntry(789, SHOW_HOUR_MS, "B", "Two", "X", 12);
+    client.discardEntries();
+    EXPECT_TRUE(client.endShow(789));
+    EXPECT_FALSE(client.addEntry(789, SHOW_HOUR_MS, "C", "Three", "X", 13)); // no open show
+
+    // Track entries only; the hour's breakpoint is not a play
+    ASSERT_EQ(history.count(), 3u);
+    PlayRecord record;
+    ASSERT_TRUE(history.read(0, &record));
+    EXPECT_EQ(record.shId, 11);
+    EXPECT_EQ(record.radioShowID, 789);
+    EXPECT_EQ(record.status, PLAY_POSTED);
+    EXPECT_EQ(record.epoch, 1705345200u);
+    EXPECT_STREQ(record.title, "One");
+    ASSERT_TRUE(history.read(1, &record));
+    EXPECT_EQ(record.shId, 12);
+    EXPECT_EQ(record.status, PLAY_DROPPED);
+    ASSERT_TRUE(history.read(2, &record));
+    EXPECT_EQ(record.shId, 13);
+    EXPECT_EQ(record.status, PLAY_REJECTED);
+
+    // Counted whether or not a history is attached
+    EXPECT_EQ(client.entryCount(PLAY_POSTED), 1u);
+    EXPECT_EQ(client.entryCount(PLAY_DROPPED), 1u);
+    EXPECT_EQ(client.entryCount(PLAY_REJECTED), 1u);
+    EXPECT_EQ(client.entryCount(PLAY_UNANSWERED), 0u);
+}
+
+// ========== Connection reuse ==========
+
+TEST_F(BackendServiceTest, ShowRunsOnOneConnection) {
+    emu::resetSocketStats();
+    ASSERT_GT(client.startShow(SHOW_HOUR_MS), 0);
+    for (int i = 0; i < 5; i++) {
+        EXPECT_TRUE(client.addEntry(789, SHOW_HOUR_MS, "A", String("Track ") + String(i), "X"));
+    }
+    EXPECT_TRUE(client.endShow(789));
+
+    EXPECT_EQ(emu::socketStats().connects, 1u);
+    for (const auto& r : standin.server().requests()) EXPECT_EQ(r.connection, 1u);
+}
+
+TEST_F(BackendServiceTest, IdleConnectionIsReplaced) {
+    ASSERT_GT(client.startShow(SHOW_HOUR_MS), 0);
+    emu::advanceMillis(FLOWSHEET_KEEPALIVE_MS + 1);
+    EXPECT_TRUE(client.addEntry(789, SHOW_HOUR_MS, "A", "One", "X"));
+    EXPECT_EQ(standin.server().requests().back().connection, 2u);
+}
+
+TEST_F(BackendServiceTest, ServerClosedConnectionIsReplaced) {
+    standin.server().setRequestsPerConnection(1);
+    ASSERT_GT(client.startShow(SHOW_HOUR_MS), 0);
+    EXPECT_TRUE(client.addEntry(789, SHOW_HOUR_MS, "A", "One", "X"));
+    EXPECT_TRUE(client.addEntry(789, SHOW_HOUR_MS, "B", "Two", "X"));
+    EXPECT_TRUE(client.endShow(789));
+    EXPECT_EQ(standin.server().requests().back().connection, 4u);
+}
+
+// Fields too long for the request are clipped to whole characters; the
+// entry is still posted, on the show's connection
+TEST_F(BackendServiceTest, LongFieldsAreClippedNotDropped) {
+    std::string title;
+    for (int i = 0; i < FLOWSHEET_REQUEST_MAX; i++) title += "\xC3\xA9"; // two bytes each
+    ASSERT_GT(client.startShow(SHOW_HOUR_MS), 0);
+    EXPECT_TRUE(client.addEntry(789, SHOW_HOUR_MS, "A", String(title.c_str()), "X"));
+    EXPECT_EQ(client.entryCount(PLAY_DROPPED), 0u);
+
+    auto entries = standin.entries();
+    ASSERT_EQ(entries.size(), 1u);
+    EXPECT_EQ(entries[0].title, title.substr(0, FLOWSHEET_FIELD_MAX));
+    EXPECT_EQ(standin.server().requests().back().connection, 1u);
+}
+
+// Entries behind a "Connection: close" are resent on a new connection
+TEST_F(BackendServiceTest, EntriesAfterCloseAreResent) {
+    standin.server().setRequestsPerConnection(2); // the join and one more
+    ASSERT_GT(client.startShow(SHOW_HOUR_MS), 0);
+    client.queueEntry(789, SHOW_HOUR_MS, "A", "One", "X", 7);
+    client.queueEntry(789, SHOW_HOUR_MS, "B", "Two", "X", 8);
+    client.queueEntry(789, SHOW_HOUR_MS, "C", "Three", "X");
+    EXPECT_TRUE(client.flush());
+
+    auto entries = standin.entries();
+    ASSERT_EQ(entries.size(), 3u);
+    EXPECT_EQ(entries[1].title, "Two");
+    EXPECT_EQ(entries[2].title, "Three");
+    EXPECT_EQ(standin.server().requests().back().connection, 2u);
+}
+
+// Another module's request (an AzuraCast poll) needs the transport's one
+// client, so it closes the kept connection first.
+TEST_F(BackendServiceTest, KeptConnectionYieldsToOtherRequests) {
+    ASSERT_GT(client.startShow(SHOW_HOUR_MS), 0);
+    ASSERT_NE(network.open(), nullptr);
+    network.close(true);
+    EXPECT_TRUE(client.addEntry(789, SHOW_HOUR_MS, "A", "One", "X"));
+    EXPECT_EQ(standin.server().requests().back().connection, 2u);
+}
+
+// ========== Throughput ==========
+
+// The same run of entries through each backend, one addEntry() at a time
+// as tracks change. Each connect costs CONNECT_MS, standing in for the TCP
+// and TLS handshakes: tubafrenzy pays it per entry, Backend-Service once.
+TEST_F(BackendServiceTest, ThroughputComparedWithTubafrenzy) {
+    const unsigned CONNECT_MS = 20;
+    const int ENTRIES = 20;
+    TubafrenzyStandin tubafrenzy{"test-key"};
+    emu::routeHost(TUBAFRENZY_HOST, TUBAFRENZY_PORT, tubafrenzy.server().port());
+    FlowsheetClient tubafrenzyClient(network, TUBAFRENZY_HOST, TUBAFRENZY_PORT, "test-key");
+    emu::setConnectLatencyMs(CONNECT_MS);
+
+    struct Result { double seconds; unsigned long connects; };
+    auto run = [&](auto& backend) {
+        int showID = backend.startShow(SHOW_HOUR_MS);
+        EXPECT_GT(showID, 0);
+        emu::resetSocketStats();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ENTRIES; i++) {
+            EXPECT_TRUE(backend.addEntry(showID, SHOW_HOUR_MS, "Artist",
+                                         String("Track ") + String(i), "Album"));
+        }
+        Result result;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.connects = emu::socketStats().connects;
+        EXPECT_TRUE(backend.endShow(showID));
+        return result;
+    };
+
+    Result tuba = run(tubafrenzyClient);
+    Result backend = run(client);
+    printf("[BackendService] %d entries: tubafrenzy %.0f entries/s (%lu connects), "
+           "Backend-Service %.0f entries/s (%lu connects)\n",
+           ENTRIES, ENTRIES / tuba.seconds, tuba.connects, ENTRIES / backend.seconds,
+           backend.connects);
+    RecordProperty("tubafrenzy_per_sec", (int)(ENTRIES / tuba.seconds));
+    RecordProperty("backend_service_per_sec", (int)(ENTRIES / backend.seconds));
+
+    EXPECT_EQ(tuba.connects, (unsigned long)ENTRIES);
+    EXPECT_EQ(backend.connects, 0u); // the join's connection carries them all
+    EXPECT_LT(backend.seconds, tuba.seconds);
+    EXPECT_EQ(standin.entries().size(), (size_t)ENTRIES);
+}
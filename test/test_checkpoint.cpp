@@ -0,0 +1,256 @@
+#include <gtest/gtest.h>
+#include "checkpoint.h"
+
+#include <string.h>
+#include <vector>
+
+// ========== Helpers ==========
+
+static const size_t SECTOR = 256; // 8 records per sector
+static const int SECTORS = 3;
+
+class CheckpointTest : public ::testing::Test {
+protected:
+    uint8_t storage[SECTOR * SECTORS];
+    MemoryFlashRegion flash{storage, SECTOR, SECTORS};
+
+    void SetUp() override { memset(storage, 0xFF, sizeof(storage)); }
+
+    // A fresh store over the same flash, as after a reset
+    bool reboot(Checkpoint* restored) {
+        CheckpointStore store;
+        return store.begin(flash, restored);
+    }
+};
+
+static Checkpoint makeCp(State state, int showID, int shId, uint32_t pollDue = 0) {
+    Checkpoint cp;
+    cp.state = state;
+    cp.radioShowID = showID;
+    cp.lastShId = shId;
+    cp.pollDueEpoch = pollDue;
+    return cp;
+}
+
+/**
+ * Fails every program() that touches one offset, like a worn-out cell.
+ */
+class BadCellFlash : public FlashRegion {
+public:
+    BadCellFlash(FlashRegion& inner, size_t badOffset) : inner(inner), bad(badOffset) {}
+    size_t sectorSize() const { return inner.sectorSize(); }
+    int sectorCount() const { return inner.sectorCount(); }
+    bool read(size_t o, void* b, size_t n) { return inner.read(o, b, n); }
+    bool program(size_t o, const void* d, size_t n) {
+        if (bad >= o && bad < o + n) return false;
+        return inner.program(o, d, n);
+    }
+    bool erase(int s) { return inner.erase(s); }
+
+private:
+    FlashRegion& inner;
+    size_t bad;
+};
+
+// ========== CRC ==========
+
+TEST(Crc32, CheckValue) {
+    EXPECT_EQ(crc32Ieee("123456789", 9), 0xCBF43926u);
+}
+
+TEST(Crc32, Incremental) {
+    uint32_t crc = crc32Ieee("12345", 5);
+    EXPECT_EQ(crc32Ieee("6789", 4, crc), 0xCBF43926u);
+}
+
+// ========== Store ==========
+
+TEST_F(CheckpointTest, EmptyFlashHasNoRecord) {
+    Checkpoint cp;
+    EXPECT_FALSE(reboot(&cp));
+}
+
+TEST_F(CheckpointTest, SavedCheckpointSurvivesReset) {
+    CheckpointStore store;
+    store.begin(flash, nullptr);
+    ASSERT_TRUE(store.save(makeCp(AUTO_DJ_ACTIVE, 5001, 90210, 1705345220)));
+
+    Checkpoint cp;
+    ASSERT_TRUE(reboot(&cp));
+    EXPECT_EQ(cp.state, AUTO_DJ_ACTIVE);
+    EXPECT_EQ(cp.radioShowID, 5001);
+    EXPECT_EQ(cp.lastShId, 90210);
+    EXPECT_EQ(cp.pollDueEpoch, 1705345220u);
+}
+
+TEST_F(CheckpointTest, NewestRecordWins) {
+    CheckpointStore store;
+    store.begin(flash, nullptr);
+    for (int i = 1; i <= 5; i++) store.save(makeCp(AUTO_DJ_ACTIVE, 5001, 100 + i));
+
+    Checkpoint cp;
+    ASSERT_TRUE(reboot(&cp));
+    EXPECT_EQ(cp.lastShId, 105);
+}
+
+TEST_F(CheckpointTest, PollDeadlineAloneIsNotWritten) {
+    CheckpointStore store;
+    store.begin(flash, nullptr);
+    store.save(makeCp(AUTO_DJ_ACTIVE, 5001, 100, 1000));
+    store.save(makeCp(AUTO_DJ_ACTIVE, 5001, 100, 1020));
+    store.save(makeCp(AUTO_DJ_ACTIVE, 5001, 100, 1040));
+    EXPECT_EQ(store.writeCount(), 1u);
+
+    store.save(makeCp(ENDING_SHOW, 5001, 100, 1060));
+    EXPECT_EQ(store.writeCount(), 2u);
+}
+
+TEST_F(CheckpointTest, SaveBeforeBeginFails) {
+    CheckpointStore store;
+    EXPECT_FALSE(store.save(makeCp(IDLE, -1, 0)));
+}
+
+TEST_F(CheckpointTest, TornRecordFallsBackToPreviousOne) {
+    CheckpointStore store;
+    store.begin(flash, nullptr);
+    store.save(makeCp(AUTO_DJ_ACTIVE, 5001, 100));
+    store.save(makeCp(AUTO_DJ_ACTIVE, 5001, 101));
+
+    // Reset while programming the second record: its tail never made it
+    memset(storage + CHECKPOINT_RECORD_SIZE + 20, 0xFF, CHECKPOINT_RECORD_SIZE - 20);
+
+    Checkpoint cp;
+    ASSERT_TRUE(reboot(&cp));
+    EXPECT_EQ(cp.lastShId, 100);
+
+    // The torn slot is skipped, not reused
+    CheckpointStore after;
+    after.begin(flash, nullptr);
+    ASSERT_TRUE(after.save(makeCp(AUTO_DJ_ACTIVE, 5001, 102)));
+    ASSERT_TRUE(reboot(&cp));
+    EXPECT_EQ(cp.lastShId, 102);
+}
+
+TEST_F(CheckpointTest, CorruptedRecordIsIgnored) {
+    CheckpointStore store;
+    store.begin(flash, nullptr);
+    store.save(makeCp(AUTO_DJ_ACTIVE, 5001, 100));
+    store.save(makeCp(AUTO_DJ_ACTIVE, 5001, 101));
+    storage[CHECKPOINT_RECORD_SIZE + 16] ^= 0x01; // bit flip in lastShId
+
+    Checkpoint cp;
+    ASSERT_TRUE(reboot(&cp));
+    EXPECT_EQ(cp.lastShId, 100);
+}
+
+TEST_F(CheckpointTest, WearMovesRoundAllSectors) {
+    const int SAVES = 100;
+    const int PER_SECTOR = SECTOR / CHECKPOINT_RECORD_SIZE;
+    CheckpointStore store;
+    store.begin(flash, nullptr);
+    for (int i = 0; i < SAVES; i++) ASSERT_TRUE(store.save(makeCp(AUTO_DJ_ACTIVE, 5001, i)));
+
+    // One erase per sector's worth of records, spread evenly
+    EXPECT_EQ(flash.eraseCount(), (unsigned long)((SAVES + PER_SECTOR - 1) / PER_SECTOR));
+
+    Checkpoint cp;
+    ASSERT_TRUE(reboot(&cp));
+    EXPECT_EQ(cp.lastShId, SAVES - 1);
+}
+
+TEST_F(CheckpointTest, ResetAfterErasingNextSectorKeepsNewest) {
+    const int PER_SECTOR = SECTOR / CHECKPOINT_RECORD_SIZE;
+    CheckpointStore store;
+    store.begin(flash, nullptr);
+    for (int i = 0; i < PER_SECTOR; i++) store.save(makeCp(AUTO_DJ_ACTIVE, 5001, i));
+
+    // The next save erases sector 1; reset before its record is written
+    flash.erase(1);
+
+    Checkpoint cp;
+    ASSERT_TRUE(reboot(&cp));
+    EXPECT_EQ(cp.lastShId, PER_SECTOR - 1);
+
+    CheckpointStore after;
+    after.begin(flash, nullptr);
+    ASSERT_TRUE(after.save(makeCp(AUTO_DJ_ACTIVE, 5001, 999)));
+    ASSERT_TRUE(reboot(&cp));
+    EXPECT_EQ(cp.lastShId, 999);
+}
+
+TEST_F(CheckpointTest, SurvivesResumingMidSectorAcrossResets) {
+    for (int boot = 0; boot < 20; boot++) {
+        CheckpointStore store;
+        Checkpoint cp;
+        bool restored = store.begin(flash, &cp);
+        if (boot > 0) {
+            ASSERT_TRUE(restored);
+            EXPECT_EQ(cp.lastShId, boot * 10 - 1);
+        }
+        for (int i = 0; i < 10; i++) store.save(makeCp(AUTO_DJ_ACTIVE, 5001, boot * 10 + i));
+    }
+}
+
+TEST_F(CheckpointTest, FailedProgramMovesToNextSlot) {
+    BadCellFlash bad(flash, 0); // first slot of sector 0 is bad
+    CheckpointStore store;
+    store.begin(bad, nullptr);
+    ASSERT_TRUE(store.save(makeCp(AUTO_DJ_ACTIVE, 5001, 100)));
+
+    Checkpoint cp;
+    ASSERT_TRUE(reboot(&cp));
+    EXPECT_EQ(cp.lastShId, 100);
+}
+
+TEST_F(CheckpointTest, RegionNeedsTwoSectors) {
+    MemoryFlashRegion small(storage, SECTOR, 1);
+    CheckpointStore store;
+    EXPECT_FALSE(store.begin(small, nullptr));
+    EXPECT_FALSE(store.isReady());
+}
+
+// ========== Context mapping ==========
+
+TEST(ResumeContext, NoCheckpointStartsFresh) {
+    Context ctx = resumeContext(nullptr, 3000, 0, 20000);
+    EXPECT_EQ(ctx.state, CONNECTING_WIFI);
+    EXPECT_EQ(ctx.radioShowID, -1);
+    EXPECT_EQ(ctx.retryCount, 0);
+}
+
+TEST(ResumeContext, OpenShowIsCarried) {
+    Checkpoint cp = makeCp(AUTO_DJ_ACTIVE, 5001, 100);
+    Context ctx = resumeContext(&cp, 3000, 0, 20000);
+    EXPECT_EQ(ctx.state, CONNECTING_WIFI);
+    EXPECT_EQ(ctx.radioShowID, 5001);
+    EXPECT_EQ(reconnectState(ctx.radioShowID, true), AUTO_DJ_ACTIVE);
+    EXPECT_EQ(reconnectState(ctx.radioShowID, false), ENDING_SHOW);
+}
+
+TEST(ResumeContext, ClosedShowIsNotCarried) {
+    Checkpoint cp = makeCp(IDLE, -1, 100);
+    Context ctx = resumeContext(&cp, 3000, 0, 20000);
+    EXPECT_EQ(ctx.radioShowID, -1);
+}
+
+// Right after boot millis() is smaller than the poll interval; the poll
+// must still be due immediately.
+TEST(ResumeContext, PollDueImmediatelyAtBoot) {
+    Checkpoint cp = makeCp(AUTO_DJ_ACTIVE, 5001, 100);
+    Context ctx = resumeContext(&cp, 3000, 0, 20000);
+    EXPECT_GE(3000UL - ctx.lastPollTime, 20000UL);
+}
+
+TEST(ResumeContext, PollDueLater) {
+    Checkpoint cp = makeCp(AUTO_DJ_ACTIVE, 5001, 100);
+    Context ctx = resumeContext(&cp, 3000, 5000, 20000);
+    EXPECT_LT(3000UL - ctx.lastPollTime, 20000UL);
+    EXPECT_LT(7999UL - ctx.lastPollTime, 20000UL);
+    EXPECT_GE(8000UL - ctx.lastPollTime, 20000UL);
+}
+
+TEST(ResumeContext, PollDeadlineIsCappedAtOneInterval) {
+    Checkpoint cp = makeCp(AUTO_DJ_ACTIVE, 5001, 100);
+    Context ctx = resumeContext(&cp, 3000, 600000, 20000);
+    EXPECT_GE(23000UL - ctx.lastPollTime, 20000UL);
+}
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <limits.h>
+#include "debounce_filter.h"
+
+#include <utility>
+#include <vector>
+
+// A recorded contact trace: the level changes to `second` at `first` ms
+typedef std::vector<std::pair<unsigned long, int>> Trace;
+
+// Samples the trace every millisecond from `from` to `until`, as loop() would,
+// and returns when the debounced level changed
+static std::vector<unsigned long> replay(DebounceFilter& f, const Trace& trace,
+                                         unsigned long from, unsigned long until) {
+    std::vector<unsigned long> changes;
+    size_t next = 0;
+    int level = f.level();
+    for (unsigned long t = from; t != until; t++) {
+        while (next < trace.size() && trace[next].first == t) level = trace[next++].second;
+        if (f.update(level, t)) changes.push_back(t);
+    }
+    return changes;
+}
+
+// The contact moving to level `to` at `at`, bouncing back `bounces` times:
+// each bounce holds `to` for `closedMs`, then the old level for `openMs`
+static void bouncyEdge(Trace& trace, unsigned long at, int to, int bounces,
+                       unsigned long openMs, unsigned long closedMs) {
+    unsigned long t = at;
+    for (int i = 0; i < bounces; i++) {
+        trace.push_back({t, to});
+        t += closedMs;
+        trace.push_back({t, !to});
+        t += openMs;
+    }
+    trace.push_back({t, to});
+}
+
+// ========== Fixed behaviour ==========
+
+TEST(DebounceFilter, CleanEdgeAcceptedAfterStartingWindow) {
+    DebounceFilter f(50, 10, 80);
+    f.reset(1);
+    Trace trace = {{1000, 0}};
+    std::vector<unsigned long> changes = replay(f, trace, 0, 2000);
+    ASSERT_EQ(changes.size(), 1u);
+    EXPECT_EQ(changes[0], 1051UL);
+    EXPECT_EQ(f.level(), 0);
+}
+
+TEST(DebounceFilter, GlitchIsCountedNotAccepted) {
+    DebounceFilter f(50, 10, 80);
+    f.reset(1);
+    Trace trace = {{1000, 0}, {1004, 1}};
+    EXPECT_TRUE(replay(f, trace, 0, 2000).empty());
+    EXPECT_EQ(f.level(), 1);
+    EXPECT_EQ(f.stats().glitches, 1UL);
+    EXPECT_EQ(f.stats().transitions, 0UL);
+    EXPECT_EQ(f.stats().edges, 2UL);
+}
+
+TEST(DebounceFilter, BouncesNeverAddTransitions) {
+    DebounceFilter f(50, 10, 80);
+    f.reset(1);
+    Trace trace;
+    for (int i = 0; i < 20; i++) {
+        bouncyEdge(trace, 1000 + i * 2000, 0, 4, 2, 1); // close
+        bouncyEdge(trace, 2000 + i * 2000, 1, 3, 1, 3); // open
+    }
+    std::vector<unsigned long> changes = replay(f, trace, 0, 42000);
+    EXPECT_EQ(changes.size(), 40u);
+    EXPECT_EQ(f.stats().transitions, 40UL);
+    EXPECT_EQ(f.level(), 1);
+}
+
+// ========== Adaptation ==========
+
+TEST(DebounceFilter, QuietContactShortensWindowToMinimum) {
+    DebounceFilter f(50, 10, 80);
+    f.reset(1);
+    Trace trace;
+    for (int i = 0; i < 40; i++) {
+        bouncyEdge(trace, 1000 + i * 1000, i % 2 == 0 ? 0 : 1, 2, 1, 1);
+    }
+    replay(f, trace, 0, 42000);
+    EXPECT_EQ(f.settleMs(), 10UL);
+
+    // Relay-to-transition latency is now the bounce plus the minimum window
+    Trace close;
+    bouncyEdge(close, 50000, 0, 2, 1, 1);
+    std::vector<unsigned long> changes = replay(f, close, 42000, 51000);
+    ASSERT_EQ(changes.size(), 1u);
+    EXPECT_EQ(changes[0], 50004UL + 11);
+}
+
+TEST(DebounceFilter, LongHoldWidensWindowAtOnce) {
+    DebounceFilter f(50, 10, 80);
+    f.reset(1);
+    Trace trace;
+    for (int i = 0; i < 40; i++) {
+        bouncyEdge(trace, 1000 + i * 1000, i % 2 == 0 ? 0 : 1, 1, 1, 1);
+    }
+    replay(f, trace, 0, 42000);
+    ASSERT_EQ(f.settleMs(), 10UL);
+
+    // A glitch just inside the window is held 8 ms: the window doubles it
+    Trace glitch = {{45000, 0}, {45008, 1}};
+    EXPECT_TRUE(replay(f, glitch, 42000, 46000).empty());
+    EXPECT_EQ(f.settleMs(), 16UL);
+}
+
+TEST(DebounceFilter, WindowStaysWithinBounds) {
+    DebounceFilter f(50, 10, 80);
+    f.reset(1);
+    // Bounces held up to 45 ms would want a 90 ms window
+    Trace trace;
+    bouncyEdge(trace, 1000, 0, 1, 45, 45);
+    replay(f, trace, 0, 2000);
+    EXPECT_EQ(f.settleMs(), 80UL);
+}
+
+TEST(DebounceFilter, LearnedHoldDecaysSlowly) {
+    DebounceFilter f(20, 10, 80);
+    f.reset(1);
+    Trace trace;
+    bouncyEdge(trace, 1000, 0, 1, 20, 20); // learned hold 20 ms
+    bouncyEdge(trace, 2000, 1, 0, 0, 0);   // then a clean edge
+    replay(f, trace, 0, 3000);
+    // One quiet episode takes off an eighth: 20 - 3 (rounded up) = 17
+    EXPECT_EQ(f.settleMs(), 34UL);
+}
+
+// ========== Statistics ==========
+
+TEST(DebounceFilter, HistogramsBounceLengths) {
+    DebounceFilter f(50, 10, 80);
+    f.reset(1);
+    Trace trace;
+    bouncyEdge(trace, 1000, 0, 0, 0, 0); // clean: 0 ms
+    bouncyEdge(trace, 2000, 1, 1, 1, 1); // 2 ms
+    bouncyEdge(trace, 3000, 0, 3, 2, 2); // 12 ms
+    replay(f, trace, 0, 4000);
+
+    const DebounceStats& s = f.stats();
+    EXPECT_EQ(s.transitions, 3UL);
+    EXPECT_EQ(s.histogram[0], 1UL); // <1
+    EXPECT_EQ(s.histogram[2], 1UL); // <5
+    EXPECT_EQ(s.histogram[4], 1UL); // <20
+    EXPECT_EQ(s.longestBounceMs, 12UL);
+    EXPECT_EQ(f.lastBounceMs(), 12UL);
+}
+
+TEST(DebounceFilter, BinBounds) {
+    EXPECT_EQ(DebounceFilter::binUpperMs(0), 1UL);
+    EXPECT_EQ(DebounceFilter::binUpperMs(DEBOUNCE_HISTOGRAM_BINS - 2), 100UL);
+    EXPECT_EQ(DebounceFilter::binUpperMs(DEBOUNCE_HISTOGRAM_BINS - 1), 0UL);
+}
+
+TEST(DebounceFilter, SurvivesMillisWrap) {
+    DebounceFilter f(50, 10, 80);
+    f.reset(1);
+    unsigned long start = ULONG_MAX - 20;
+    Trace trace = {{start + 10, 0}};
+    std::vector<unsigned long> changes = replay(f, trace, start, 100);
+    ASSERT_EQ(changes.size(), 1u);
+    EXPECT_EQ(changes[0], start + 61);
+}
@@ -0,0 +1,276 @@
+/**
+ * FirmwareUpdater against the stand-in firmware host on localhost, over
+ * the emulated WiFiSSLClient, into a RAM-backed flash slot.
+ */
+#include <gtest/gtest.h>
+
+#include "config.h"
+#include "emulation.h"
+#include "firmware_update.h"
+#include "log_buffer.h"
+#include "loopback_transport.h"
+#include "stall_detector.h"
+#include "standin_server.h"
+#include <WiFiSSLClient.h>
+
+#include <string>
+#include <vector>
+
+#define SLOT_SECTOR_SIZE 4096
+#define SLOT_SECTORS 64 // 256 KB
+
+// ========== Helpers ==========
+
+static std::string sha256Hex(const std::string& data) {
+    static const char digits[] = "0123456789abcdef";
+    Sha256 hash;
+    hash.update(data.data(), data.size());
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    hash.finish(digest);
+    std::string out;
+    for (uint8_t b : digest) {
+        out += digits[b >> 4];
+        out += digits[b & 0xF];
+    }
+    return out;
+}
+
+/** An image whose every byte depends on its offset, so a misplaced chunk shows. */
+static std::string makeImage(size_t size) {
+    std::string image(size, '\0');
+    uint32_t x = 2463534242u;
+    for (size_t i = 0; i < size; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        image[i] = (char)x;
+    }
+    return image;
+}
+
+class FirmwareUpdateTest : public ::testing::Test {
+protected:
+    FirmwareStandin standin;
+    LoopbackTransport transport;
+    NetworkManager network{LINK_FAILURE_THRESHOLD, LINK_COOLDOWN_MS, LINK_PREFERENCE_MS};
+    FirmwareUpdater updater{network, FIRMWARE_HOST, FIRMWARE_PORT};
+    std::vector<uint8_t> storage = std::vector<uint8_t>(SLOT_SECTOR_SIZE * SLOT_SECTORS, 0x00);
+    MemoryFlashRegion slot{storage.data(), SLOT_SECTOR_SIZE, SLOT_SECTORS};
+    std::string image = makeImage(200000); // a few windows, ending mid-chunk
+
+    void SetUp() override {
+        emu::reset();
+        emu::routeHost(FIRMWARE_HOST, FIRMWARE_PORT, standin.server().port());
+        network.addTransport(transport);
+        network.setUp();
+        standin.setRelease("1.2.0", image, sha256Hex(image));
+    }
+    void TearDown() override { drainSerialLog(); }
+
+    /**
+     * Calls update() like loop() would, a few milliseconds apart, letting
+     * the backoff pass after a window that made no progress.
+     */
+    FirmwareStatus run(int maxCalls = 100) {
+        FirmwareStatus status = updater.status();
+        for (int i = 0; i < maxCalls && status == FIRMWARE_DOWNLOADING; i++) {
+            uint32_t before = updater.received();
+            status = updater.update();
+            emu::advanceMillis(updater.received() == before ? RETRY_BACKOFF_MAX_MS : 10);
+        }
+        return status;
+    }
+
+    bool slotHoldsImage() const {
+        return std::string(storage.begin(), storage.begin() + image.size()) == image;
+    }
+
+    std::vector<StandinRequest> imageRequests() {
+        std::vector<StandinRequest> matching;
+        for (const auto& r : standin.server().requests()) {
+            if (r.path == standin.imagePath()) matching.push_back(r);
+        }
+        return matching;
+    }
+};
+
+// ========== Manifest ==========
+
+TEST(FirmwareManifest, ParsesAllFields) {
+    const char* json = "{\"version\":\"1.3.0\",\"url\":\"/fw/v1.3.0.bin\",\"size\":612345,"
+                       "\"sha256\":\"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad\","
+                       "\"notes\":\"ignored\"}";
+    FirmwareManifest manifest;
+    ASSERT_TRUE(parseFirmwareManifest(json, strlen(json), &manifest));
+    EXPECT_STREQ(manifest.version, "1.3.0");
+    EXPECT_STREQ(manifest.path, "/fw/v1.3.0.bin");
+    EXPECT_EQ(manifest.size, 612345u);
+    EXPECT_EQ(manifest.sha256[0], 0xba);
+    EXPECT_EQ(manifest.sha256[31], 0xad);
+}
+
+TEST(FirmwareManifest, RejectsMissingOrMalformedFields) {
+    const char* bad[] = {
+        "{\"url\":\"/a.bin\",\"size\":1,\"sha256\":\"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad\"}",
+        "{\"version\":\"1\",\"url\":\"https://elsewhere/a.bin\",\"size\":1,"
+        "\"sha256\":\"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad\"}",
+        "{\"version\":\"1\",\"url\":\"/a.bin\",\"size\":0,"
+        "\"sha256\":\"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad\"}",
+        "{\"version\":\"1\",\"url\":\"/a.bin\",\"size\":1,\"sha256\":\"ba7816bf\"}",
+        "{\"version\":\"1\",\"url\":\"/a.bin\",\"size\":\"1\","
+        "\"sha256\":\"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad\"}",
+        "not json",
+    };
+    for (const char* json : bad) {
+        FirmwareManifest manifest;
+        EXPECT_FALSE(parseFirmwareManifest(json, strlen(json), &manifest)) << json;
+    }
+}
+
+TEST(FirmwareManifest, ComparesDottedVersions) {
+    EXPECT_GT(compareFirmwareVersions("1.10.0", "1.9.2"), 0);
+    EXPECT_LT(compareFirmwareVersions("1.2", "1.2.1"), 0);
+    EXPECT_EQ(compareFirmwareVersions("1.2", "1.2.0"), 0);
+    EXPECT_EQ(compareFirmwareVersions("2.0.0", "2.0.0"), 0);
+    EXPECT_LT(compareFirmwareVersions("0.9", "1"), 0);
+}
+
+// ========== Check ==========
+
+TEST_F(FirmwareUpdateTest, CheckFindsNewerRelease) {
+    FirmwareManifest manifest;
+    ASSERT_TRUE(updater.check(FIRMWARE_MANIFEST_PATH, "1.1.9", &manifest));
+    EXPECT_STREQ(manifest.version, "1.2.0");
+    EXPECT_EQ(manifest.size, image.size());
+    EXPECT_EQ(std::string(manifest.path), standin.imagePath());
+}
+
+TEST_F(FirmwareUpdateTest, CheckIgnoresSameOrOlderRelease) {
+    FirmwareManifest manifest;
+    EXPECT_FALSE(updater.check(FIRMWARE_MANIFEST_PATH, "1.2.0", &manifest));
+    EXPECT_FALSE(updater.check(FIRMWARE_MANIFEST_PATH, "1.10.0", &manifest));
+}
+
+// ========== Download ==========
+
+TEST_F(FirmwareUpdateTest, DownloadsIntoSlotAndVerifies) {
+    FirmwareManifest manifest;
+    ASSERT_TRUE(updater.check(FIRMWARE_MANIFEST_PATH, FIRMWARE_VERSION, &manifest));
+    ASSERT_TRUE(updater.begin(manifest, slot));
+
+    EXPECT_EQ(run(), FIRMWARE_VERIFIED);
+    EXPECT_EQ(updater.received(), image.size());
+    EXPECT_TRUE(slotHoldsImage());
+
+    // One Range request per window, all on one kept-alive connection
+    auto requests = imageRequests();
+    size_t windows = (image.size() + FIRMWARE_WINDOW_BYTES - 1) / FIRMWARE_WINDOW_BYTES;
+    ASSERT_EQ(requests.size(), windows);
+    EXPECT_EQ(requests[0].header("Range"), "bytes=0-65535");
+    EXPECT_EQ(requests[1].header("Range"), "bytes=65536-131071");
+    EXPECT_EQ(requests.back().header("Range"), "bytes=196608-199999");
+    EXPECT_EQ(emu::socketStats().connects, 2u); // the manifest's, then one for the image
+    EXPECT_EQ(updater.resumeCount(), 0u);
+
+    // Only the sectors the image covers were erased
+    EXPECT_EQ(slot.eraseCount(), (image.size() + SLOT_SECTOR_SIZE - 1) / SLOT_SECTOR_SIZE);
+}
+
+TEST_F(FirmwareUpdateTest, ResumesAfterDisconnects) {
+    FirmwareManifest manifest;
+    ASSERT_TRUE(updater.check(FIRMWARE_MANIFEST_PATH, FIRMWARE_VERSION, &manifest));
+    ASSERT_TRUE(updater.begin(manifest, slot));
+
+    // The first window: cut twice, mid-chunk each time
+    standin.cutNext(2, 5000);
+    EXPECT_EQ(run(), FIRMWARE_VERIFIED);
+    EXPECT_TRUE(slotHoldsImage());
+    EXPECT_EQ(updater.resumeCount(), 2u);
+
+    // Each retry's window starts after the last whole chunk programmed
+    auto requests = imageRequests();
+    ASSERT_GE(requests.size(), 3u);
+    EXPECT_EQ(requests[0].header("Range"), "bytes=0-65535");
+    EXPECT_EQ(requests[1].header("Range"), "bytes=4096-69631");
+    EXPECT_EQ(requests[2].header("Range"), "bytes=8192-73727");
+}
+
+TEST_F(FirmwareUpdateTest, GivesUpAfterRepeatedDisconnects) {
+    FirmwareManifest manifest;
+    ASSERT_TRUE(updater.check(FIRMWARE_MANIFEST_PATH, FIRMWARE_VERSION, &manifest));
+    ASSERT_TRUE(updater.begin(manifest, slot));
+
+    standin.cutNext(1000, 10);
+    EXPECT_EQ(run(), FIRMWARE_FAILED);
+    EXPECT_EQ(imageRequests().size(), (size_t)FIRMWARE_MAX_FAILURES);
+}
+
+TEST_F(FirmwareUpdateTest, WaitsOutBackoffAfterDisconnect) {
+    FirmwareManifest manifest;
+    ASSERT_TRUE(updater.check(FIRMWARE_MANIFEST_PATH, FIRMWARE_VERSION, &manifest));
+    ASSERT_TRUE(updater.begin(manifest, slot));
+
+    standin.cutNext(1, 10);
+    EXPECT_EQ(updater.update(), FIRMWARE_DOWNLOADING);
+    EXPECT_EQ(updater.update(), FIRMWARE_DOWNLOADING); // still backing off
+    EXPECT_EQ(imageRequests().size(), 1u);
+}
+
+TEST_F(FirmwareUpdateTest, RejectsImageWithWrongHash) {
+    standin.setRelease("1.2.0", image, sha256Hex(image + "x"));
+    FirmwareManifest manifest;
+    ASSERT_TRUE(updater.check(FIRMWARE_MANIFEST_PATH, FIRMWARE_VERSION, &manifest));
+    ASSERT_TRUE(updater.begin(manifest, slot));
+
+    EXPECT_EQ(run(), FIRMWARE_FAILED);
+    EXPECT_NE(serialLog.pending(), 0u);
+}
+
+TEST_F(FirmwareUpdateTest, RejectsImageLargerThanSlot) {
+    std::string big = makeImage(SLOT_SECTOR_SIZE * SLOT_SECTORS + 1);
+    standin.setRelease("1.2.0", big, sha256Hex(big));
+    FirmwareManifest manifest;
+    ASSERT_TRUE(updater.check(FIRMWARE_MANIFEST_PATH, FIRMWARE_VERSION, &manifest));
+
+    EXPECT_FALSE(updater.begin(manifest, slot));
+    EXPECT_EQ(updater.status(), FIRMWARE_FAILED);
+    EXPECT_TRUE(imageRequests().empty());
+}
+
+TEST_F(FirmwareUpdateTest, FailsIfServerIgnoresRange) {
+    standin.setIgnoreRange(true);
+    FirmwareManifest manifest;
+    ASSERT_TRUE(updater.check(FIRMWARE_MANIFEST_PATH, FIRMWARE_VERSION, &manifest));
+    ASSERT_TRUE(updater.begin(manifest, slot));
+
+    // Nothing is programmed from a 200 that holds more than the window
+    EXPECT_EQ(run(), FIRMWARE_FAILED);
+    EXPECT_EQ(imageRequests().size(), 1u);
+    EXPECT_EQ(updater.received(), 0u);
+}
+
+TEST_F(FirmwareUpdateTest, SingleWindowImageTakesWholeImage200) {
+    image = makeImage(5000);
+    standin.setRelease("1.2.0", image, sha256Hex(image));
+    standin.setIgnoreRange(true);
+    FirmwareManifest manifest;
+    ASSERT_TRUE(updater.check(FIRMWARE_MANIFEST_PATH, FIRMWARE_VERSION, &manifest));
+    ASSERT_TRUE(updater.begin(manifest, slot));
+
+    EXPECT_EQ(run(), FIRMWARE_VERIFIED);
+    EXPECT_TRUE(slotHoldsImage());
+}
+
+// A window on a slow link takes longer than the watchdog allows; it is fed
+// per chunk rather than once per window
+TEST_F(FirmwareUpdateTest, FeedsWatchdogPerChunk) {
+    FirmwareManifest manifest;
+    ASSERT_TRUE(updater.check(FIRMWARE_MANIFEST_PATH, FIRMWARE_VERSION, &manifest));
+    ASSERT_TRUE(updater.begin(manifest, slot));
+
+    watchdogStart(WATCHDOG_TIMEOUT_MS);
+    unsigned long kicks = emu::watchdogKicks();
+    EXPECT_EQ(updater.update(), FIRMWARE_DOWNLOADING);
+    EXPECT_EQ(updater.received(), FIRMWARE_WINDOW_BYTES);
+    EXPECT_GE(emu::watchdogKicks() - kicks, FIRMWARE_WINDOW_BYTES / FIRMWARE_CHUNK_BYTES);
+}
@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+#include "http_response.h"
+#include "mem_stats.h"
+#include "utils.h"
+#include "loopback_transport.h"
+
+#include <string>
+
+static MemoryClient client;
+
+static void serve(const std::string& response) {
+    client.load(response);
+    client.connect("host", 80);
+}
+
+TEST(HttpResponseReader, StatusAndHeaders) {
+    serve("HTTP/1.1 302 Found\r\n"
+          "Location: http://host/x?radioShowID=7\r\n"
+          "Content-Length: 0\r\n"
+          "\r\n");
+    HttpResponseReader response(client, 1000);
+    EXPECT_EQ(response.readStatus(), 302);
+
+    const char* name;
+    const char* value;
+    ASSERT_TRUE(response.readHeader(&name, &value));
+    EXPECT_STREQ(name, "Location");
+    EXPECT_STREQ(value, "http://host/x?radioShowID=7");
+    ASSERT_TRUE(response.readHeader(&name, &value));
+    EXPECT_FALSE(response.readHeader(&name, &value));
+    EXPECT_EQ(response.contentLength(), 0);
+    EXPECT_TRUE(response.skipBody());
+}
+
+TEST(HttpResponseReader, SkipsContinue) {
+    serve("HTTP/1.1 100 Continue\r\n\r\n"
+          "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok");
+    HttpResponseReader response(client, 1000);
+    EXPECT_EQ(response.readStatus(), 200);
+    EXPECT_TRUE(response.skipBody());
+}
+
+TEST(HttpResponseReader, ChunkedBody) {
+    serve("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+          "5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n");
+    HttpResponseReader response(client, 1000);
+    EXPECT_EQ(response.readStatus(), 200);
+    EXPECT_TRUE(response.skipBody());
+    EXPECT_TRUE(response.isChunked());
+    EXPECT_EQ(client.available(), 0);
+}
+
+TEST(HttpResponseReader, ConnectionClose) {
+    serve("HTTP/1.1 200 OK\r\nConnection: close\r\n\r\nuntil the end");
+    HttpResponseReader response(client, 1000);
+    EXPECT_EQ(response.readStatus(), 200);
+    EXPECT_TRUE(response.skipBody());
+    EXPECT_TRUE(response.closeRequested());
+}
+
+TEST(HttpResponseReader, ReadBodyKeepsWhatFits) {
+    serve("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+          "5\r\n{\"id\"\r\n6\r\n:789}!\r\n0\r\n\r\n");
+    HttpResponseReader response(client, 1000);
+    EXPECT_EQ(response.readStatus(), 200);
+    char body[8];
+    size_t stored = 0;
+    EXPECT_TRUE(response.readBody(body, sizeof(body), &stored));
+    EXPECT_EQ(stored, 7u);
+    EXPECT_STREQ(body, "{\"id\":7");
+    EXPECT_EQ(client.available(), 0); // the rest was still consumed
+}
+
+TEST(HttpResponseReader, TruncatedBodyFails) {
+    serve("HTTP/1.1 200 OK\r\nContent-Length: 100\r\n\r\nshort");
+    HttpResponseReader response(client, 1000);
+    EXPECT_EQ(response.readStatus(), 200);
+    EXPECT_FALSE(response.skipBody());
+}
+
+TEST(HttpResponseReader, StreamsBodyInPieces) {
+    serve("HTTP/1.1 206 Partial Content\r\nContent-Range: bytes 100-109/4096\r\n"
+          "Content-Length: 10\r\n\r\n0123456789");
+    HttpResponseReader response(client, 1000);
+    EXPECT_EQ(response.readStatus(), 206);
+    uint8_t buf[4];
+    EXPECT_EQ(response.readBodyBytes(buf, sizeof(buf)), 4);
+    EXPECT_EQ(response.rangeStart(), 100);
+    EXPECT_EQ(std::string((char*)buf, 4), "0123");
+    EXPECT_EQ(response.readBodyBytes(buf, sizeof(buf)), 4);
+    EXPECT_FALSE(response.bodyComplete());
+    EXPECT_EQ(response.readBodyBytes(buf, sizeof(buf)), 2);
+    EXPECT_EQ(std::string((char*)buf, 2), "89");
+    EXPECT_TRUE(response.bodyComplete());
+    EXPECT_EQ(response.readBodyBytes(buf, sizeof(buf)), 0);
+}
+
+TEST(HttpResponseReader, StreamCutShortFails) {
+    serve("HTTP/1.1 200 OK\r\nContent-Length: 100\r\n\r\nshort");
+    HttpResponseReader response(client, 1000);
+    EXPECT_EQ(response.readStatus(), 200);
+    EXPECT_EQ(response.rangeStart(), -1);
+    uint8_t buf[64];
+    EXPECT_EQ(response.readBodyBytes(buf, sizeof(buf)), 5);
+    EXPECT_FALSE(response.bodyComplete());
+    EXPECT_EQ(response.readBodyBytes(buf, sizeof(buf)), -1);
+}
+
+TEST(HttpResponseReader, GarbageStatus) {
+    serve("SSH-2.0-OpenSSH\r\n");
+    HttpResponseReader response(client, 1000);
+    EXPECT_EQ(response.readStatus(), HTTP_RESPONSE_INVALID);
+
+    serve("");
+    HttpResponseReader empty(client, 1000);
+    EXPECT_EQ(empty.readStatus(), HTTP_RESPONSE_TIMED_OUT);
+}
+
+TEST(HttpResponseReader, LongHeaderIsTruncated) {
+    serve("HTTP/1.1 200 OK\r\nX-Long: " + std::string(1000, 'a') +
+          "\r\nContent-Length: 0\r\n\r\n");
+    HttpResponseReader response(client, 1000);
+    EXPECT_EQ(response.readStatus(), 200);
+    const char* name;
+    const char* value;
+    ASSERT_TRUE(response.readHeader(&name, &value));
+    EXPECT_LT(strlen(value), (size_t)HTTP_LINE_MAX);
+    ASSERT_TRUE(response.readHeader(&name, &value));
+    EXPECT_STREQ(name, "Content-Length");
+    EXPECT_TRUE(response.skipBody());
+}
+
+TEST(HttpResponseReader, KeepsLocationAndEtag) {
+    serve("HTTP/1.1 302 Found\r\n"
+          "Set-Cookie: JSESSIONID=abc\r\n"
+          "location: /flowsheet?radioShowID=42\r\n"
+          "ETag: \"v7\"\r\n"
+          "Content-Length: 0\r\n"
+          "\r\n");
+    HttpResponseReader response(client, 1000);
+    EXPECT_EQ(response.readStatus(), 302);
+    EXPECT_TRUE(response.readHeaders());
+    EXPECT_STREQ(response.location(), "/flowsheet?radioShowID=42");
+    EXPECT_STREQ(response.etag(), "\"v7\"");
+    EXPECT_EQ(response.contentLength(), 0);
+}
+
+TEST(HttpResponseReader, OverlongLocationIsDropped) {
+    serve("HTTP/1.1 302 Found\r\nLocation: /x?radioShowID=4" +
+          std::string(HTTP_LOCATION_MAX, '2') + "\r\nContent-Length: 0\r\n\r\n");
+    HttpResponseReader response(client, 1000);
+    EXPECT_EQ(response.readStatus(), 302);
+    EXPECT_TRUE(response.skipBody());
+    EXPECT_STREQ(response.location(), "");
+}
+
+TEST(HttpResponseReader, FinishWithoutReuseLeavesBody) {
+    serve("HTTP/1.1 302 Found\r\nLocation: /next\r\nContent-Length: 9\r\n\r\nredirect!");
+    HttpResponseReader response(client, 1000);
+    EXPECT_EQ(response.readStatus(), 302);
+    EXPECT_TRUE(response.finish(false));
+    EXPECT_STREQ(response.location(), "/next");
+    EXPECT_EQ(client.available(), 9); // dropped with the connection
+}
+
+TEST(HttpResponseReader, FinishWithReuseSkipsBody) {
+    serve("HTTP/1.1 404 Not Found\r\nContent-Length: 9\r\n\r\nnot here!");
+    HttpResponseReader response(client, 1000);
+    EXPECT_EQ(response.readStatus(), 404);
+    EXPECT_TRUE(response.finish(true));
+    EXPECT_EQ(client.available(), 0);
+}
+
+TEST(HttpResponseReader, ReadingAllocatesNothing) {
+    std::string page(4000, 'x');
+    serve("HTTP/1.1 302 Found\r\n"
+          "Server: Apache-Coyote/1.1\r\n"
+          "Location: /flowsheet?radioShowID=42\r\n"
+          "ETag: \"v7\"\r\n"
+          "Content-Length: " + std::to_string(page.size()) + "\r\n"
+          "\r\n" + page);
+
+    unsigned long before = readHeapCounters().allocs;
+    HttpResponseReader response(client, 1000);
+    int status = response.readStatus();
+    bool ok = response.skipBody();
+    int radioShowID = parseRadioShowID(response.location());
+    unsigned long allocs = readHeapCounters().allocs - before;
+
+    EXPECT_EQ(status, 302);
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(radioShowID, 42);
+    EXPECT_EQ(allocs, 0UL);
+}
@@ -0,0 +1,283 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "emulation.h"
+#include "loopback_transport.h"
+#include "link_selector.h"
+#include "log_buffer.h"
+#include "network_manager.h"
+
+// ========== Helpers ==========
+
+static const int FAILURE_THRESHOLD = 2;
+static const unsigned long COOLDOWN_MS = 60000;
+static const unsigned long PREFERENCE_MS = 250;
+
+static LinkSelector makeSelector(int& ethernet, int& wifi) {
+    LinkSelector s(FAILURE_THRESHOLD, COOLDOWN_MS, PREFERENCE_MS);
+    ethernet = s.addLink();
+    wifi = s.addLink();
+    s.setLinkUp(ethernet, true);
+    s.setLinkUp(wifi, true);
+    return s;
+}
+
+/**
+ * Host stand-in for a Transport: a link with a fixed request latency that
+ * can be unplugged (isUp false) or black-holed (up, but every request times
+ * out), on the emulated clock.
+ */
+class MockTransport : public Transport {
+public:
+    MemoryClient client;
+    unsigned long latencyMs;
+    bool up = true;
+    bool blackHoled = false;
+    int requests = 0;
+
+    MockTransport(const char* label, unsigned long latencyMs) : latencyMs(latencyMs), label(label) {}
+
+    const char* name() const override { return label; }
+    void setUp() override {}
+    void update() override {}
+    bool isUp() override { return up; }
+    Client* openClient() override {
+        requests++;
+        return &client;
+    }
+    void closeClient() override { client.stop(); }
+    unsigned long getEpochTime() override { return 0; }
+
+private:
+    const char* label;
+};
+
+/**
+ * Two mock links behind the sketch's NetworkManager, Ethernet preferred.
+ * runRequest() brackets one request with open()/failover()/close() as the
+ * clients do, and advances the clock by the time it takes.
+ */
+class NetworkFailoverTest : public ::testing::Test {
+protected:
+    MockTransport ethernet{"Ethernet", 80};
+    MockTransport wifi{"WiFi", 300};
+    NetworkManager network{FAILURE_THRESHOLD, COOLDOWN_MS, PREFERENCE_MS};
+
+    void SetUp() override {
+        emu::reset();
+        network.addTransport(ethernet);
+        network.addTransport(wifi);
+        network.setUp();
+    }
+    void TearDown() override { drainSerialLog(); }
+
+    bool runRequest(unsigned long timeoutMs) {
+        network.update();
+        for (Client* c = network.open(); c; c = network.failover()) {
+            MockTransport& link = c == &ethernet.client ? ethernet : wifi;
+            if (link.blackHoled) {
+                emu::advanceMillis(timeoutMs);
+                continue;
+            }
+            emu::advanceMillis(link.latencyMs);
+            network.close(true);
+            return true;
+        }
+        return false;
+    }
+};
+
+// ========== Selection ==========
+
+TEST(LinkSelector, NoLinksUpSelectsNothing) {
+    LinkSelector s(FAILURE_THRESHOLD, COOLDOWN_MS, PREFERENCE_MS);
+    int link = s.addLink();
+    EXPECT_EQ(s.select(0), -1);
+    s.setLinkUp(link, true);
+    EXPECT_EQ(s.select(0), link);
+}
+
+TEST(LinkSelector, PrefersFirstRegisteredLink) {
+    int ethernet, wifi;
+    LinkSelector s = makeSelector(ethernet, wifi);
+    EXPECT_EQ(s.select(0), ethernet);
+}
+
+TEST(LinkSelector, FallsBackWhenPreferredDown) {
+    int ethernet, wifi;
+    LinkSelector s = makeSelector(ethernet, wifi);
+    s.setLinkUp(ethernet, false);
+    EXPECT_EQ(s.select(0), wifi);
+    s.setLinkUp(ethernet, true);
+    EXPECT_EQ(s.select(0), ethernet);
+}
+
+TEST(LinkSelector, RejectsMaxPlusOneLinks) {
+    LinkSelector s(FAILURE_THRESHOLD, COOLDOWN_MS, PREFERENCE_MS);
+    for (int i = 0; i < LINK_SELECTOR_MAX_LINKS; i++) EXPECT_EQ(s.addLink(), i);
+    EXPECT_EQ(s.addLink(), -1);
+}
+
+// ========== RTT ==========
+
+TEST(LinkSelector, FirstSampleSeedsSmoothedRtt) {
+    int ethernet, wifi;
+    LinkSelector s = makeSelector(ethernet, wifi);
+    s.recordSuccess(wifi, 400);
+    EXPECT_EQ(s.smoothedRttMs(wifi), 400UL);
+    s.recordSuccess(wifi, 800);
+    EXPECT_EQ(s.smoothedRttMs(wifi), 450UL); // 400 + (800 - 400) / 8
+}
+
+TEST(LinkSelector, SmallRttAdvantageDoesNotSwitch) {
+    int ethernet, wifi;
+    LinkSelector s = makeSelector(ethernet, wifi);
+    s.recordSuccess(ethernet, 500);
+    s.recordSuccess(wifi, 400);
+    EXPECT_EQ(s.select(0), ethernet);
+}
+
+TEST(LinkSelector, ClearlyFasterFallbackTakesOver) {
+    int ethernet, wifi;
+    LinkSelector s = makeSelector(ethernet, wifi);
+    s.recordSuccess(ethernet, 900);
+    s.recordSuccess(wifi, 300);
+    EXPECT_EQ(s.select(0), wifi);
+}
+
+// ========== Health ==========
+
+TEST(LinkSelector, BenchesAfterConsecutiveFailures) {
+    int ethernet, wifi;
+    LinkSelector s = makeSelector(ethernet, wifi);
+    s.recordFailure(ethernet, 1000);
+    EXPECT_EQ(s.select(1000), ethernet); // one failure is not enough
+    s.recordFailure(ethernet, 2000);
+    EXPECT_FALSE(s.isHealthy(ethernet, 2000));
+    EXPECT_EQ(s.select(2000), wifi);
+}
+
+TEST(LinkSelector, SuccessResetsFailureCount) {
+    int ethernet, wifi;
+    LinkSelector s = makeSelector(ethernet, wifi);
+    s.recordFailure(ethernet, 1000);
+    s.recordSuccess(ethernet, 100);
+    s.recordFailure(ethernet, 2000);
+    EXPECT_EQ(s.select(2000), ethernet);
+}
+
+TEST(LinkSelector, ProbesBenchedLinkAfterCooldown) {
+    int ethernet, wifi;
+    LinkSelector s = makeSelector(ethernet, wifi);
+    s.recordFailure(ethernet, 0);
+    s.recordFailure(ethernet, 0);
+    EXPECT_EQ(s.select(COOLDOWN_MS - 1), wifi);
+    EXPECT_EQ(s.select(COOLDOWN_MS), ethernet);
+
+    // A failed probe benches it again for a full cooldown
+    s.recordFailure(ethernet, COOLDOWN_MS);
+    EXPECT_EQ(s.select(COOLDOWN_MS + 1), wifi);
+    EXPECT_EQ(s.select(2 * COOLDOWN_MS), ethernet);
+}
+
+TEST(LinkSelector, BenchedLinkUsedWhenNothingElseIsUp) {
+    int ethernet, wifi;
+    LinkSelector s = makeSelector(ethernet, wifi);
+    s.setLinkUp(wifi, false);
+    s.recordFailure(ethernet, 0);
+    s.recordFailure(ethernet, 0);
+    EXPECT_EQ(s.select(1), ethernet);
+}
+
+TEST(LinkSelector, SelectExcludingSkipsFailedLink) {
+    int ethernet, wifi;
+    LinkSelector s = makeSelector(ethernet, wifi);
+    EXPECT_EQ(s.selectExcluding(ethernet, 0), wifi);
+    s.setLinkUp(wifi, false);
+    EXPECT_EQ(s.selectExcluding(ethernet, 0), -1);
+}
+
+TEST(LinkSelector, CountsFailovers) {
+    int ethernet, wifi;
+    LinkSelector s = makeSelector(ethernet, wifi);
+    s.select(0);
+    s.selectExcluding(ethernet, 0);
+    s.select(0);
+    EXPECT_EQ(s.failoverCount(), 2UL);
+}
+
+// ========== Failover simulation ==========
+
+TEST_F(NetworkFailoverTest, UnpluggedCableCostsNoExtraLatency) {
+    ASSERT_TRUE(runRequest(10000));
+    ethernet.up = false; // cable pulled between entries
+
+    unsigned long before = millis();
+    ASSERT_TRUE(runRequest(10000));
+    EXPECT_EQ(millis() - before, 300UL); // straight to WiFi
+    EXPECT_EQ(wifi.requests, 1);
+}
+
+TEST_F(NetworkFailoverTest, BlackHoledLinkFailsOverMidShowWithoutDroppingEntries) {
+    const unsigned long timeoutMs = 10000;
+
+    // Link stays "up" but upstream is dead: every request times out
+    ethernet.blackHoled = true;
+
+    std::vector<unsigned long> latencies;
+    for (int entry = 0; entry < 10; entry++) {
+        unsigned long before = millis();
+        ASSERT_TRUE(runRequest(timeoutMs)) << "entry " << entry << " dropped";
+        latencies.push_back(millis() - before);
+        emu::advanceMillis(5000); // next entry, well inside the cooldown
+    }
+
+    // The first FAILURE_THRESHOLD entries pay one timeout each, then the
+    // benched link is skipped and entries go straight over WiFi.
+    for (int i = 0; i < FAILURE_THRESHOLD; i++) EXPECT_EQ(latencies[i], timeoutMs + 300);
+    for (size_t i = FAILURE_THRESHOLD; i < latencies.size(); i++) EXPECT_EQ(latencies[i], 300UL);
+    EXPECT_EQ(ethernet.requests, FAILURE_THRESHOLD);
+}
+
+TEST_F(NetworkFailoverTest, RecoveredLinkReclaimedAfterCooldown) {
+    ethernet.blackHoled = true;
+    for (int i = 0; i < FAILURE_THRESHOLD; i++) runRequest(10000);
+    ethernet.blackHoled = false;
+
+    emu::advanceMillis(COOLDOWN_MS);
+    unsigned long before = millis();
+    ASSERT_TRUE(runRequest(10000));
+    EXPECT_EQ(millis() - before, 80UL);
+    EXPECT_STREQ(network.activeTransportName(), "Ethernet");
+}
+
+TEST_F(NetworkFailoverTest, EveryLinkBlackHoledFailsOnceEach) {
+    ethernet.blackHoled = true;
+    wifi.blackHoled = true;
+    EXPECT_FALSE(runRequest(10000));
+    EXPECT_EQ(ethernet.requests, 1);
+    EXPECT_EQ(wifi.requests, 1);
+}
+
+// ========== Signal strength ==========
+
+TEST(LinkSelector, SignalIsSmoothedAndWeakestKept) {
+    LinkSelector sel(FAILURE_THRESHOLD, COOLDOWN_MS, PREFERENCE_MS);
+    int wifi = sel.addLink();
+    EXPECT_EQ(sel.signalDbm(wifi), 0);
+
+    sel.recordSignal(wifi, -60);
+    EXPECT_EQ(sel.signalDbm(wifi), -60);
+    sel.recordSignal(wifi, -80);
+    EXPECT_EQ(sel.signalDbm(wifi), -65); // a quarter of the way
+    EXPECT_EQ(sel.weakestSignalDbm(wifi), -80);
+    for (int i = 0; i < 20; i++) sel.recordSignal(wifi, -80);
+    EXPECT_LE(sel.signalDbm(wifi), -77);
+}
+
+TEST(LinkSelector, LinkWithoutSignalReportsNone) {
+    LinkSelector sel(FAILURE_THRESHOLD, COOLDOWN_MS, PREFERENCE_MS);
+    int ethernet = sel.addLink();
+    sel.recordSignal(ethernet, 0);
+    EXPECT_EQ(sel.signalDbm(ethernet), 0);
+    EXPECT_EQ(sel.signalDbm(5), 0);
+}
@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include "log_buffer.h"
+
+// ========== Helpers ==========
+
+// Drains everything currently committed, as the orchestrator would over
+// several loop iterations.
+static std::string drainAll(LogBuffer& log, size_t chunkSize = 64) {
+    std::string out;
+    const char* chunk;
+    size_t n;
+    while ((n = log.peek(&chunk, chunkSize)) > 0) {
+        out.append(chunk, n);
+        log.consume(n);
+    }
+    return out;
+}
+
+// ========== Staging and commit ==========
+
+TEST(LogBuffer, PartialLineNotVisibleUntilPrintln) {
+    char storage[64];
+    LogBuffer log(storage, sizeof(storage));
+
+    log.print("[AzuraCast] Polling...");
+    EXPECT_EQ(log.pending(), 0u);
+
+    log.println(" same track.");
+    EXPECT_EQ(drainAll(log), "[AzuraCast] Polling... same track.\n");
+}
+
+TEST(LogBuffer, FormatsNumbers) {
+    char storage[64];
+    LogBuffer log(storage, sizeof(storage));
+
+    log.print(-1);
+    log.print(' ');
+    log.print(302u);
+    log.print(' ');
+    log.println(1705345200000UL);
+
+    EXPECT_EQ(drainAll(log), "-1 302 1705345200000\n");
+}
+
+TEST(LogBuffer, PrintsArduinoStrings) {
+    char storage[64];
+    LogBuffer log(storage, sizeof(storage));
+
+    log.println(String("Broadcast"));
+
+    EXPECT_EQ(drainAll(log), "Broadcast\n");
+}
+
+TEST(LogBuffer, TruncatesOverlongLine) {
+    char storage[512];
+    LogBuffer log(storage, sizeof(storage));
+
+    std::string longTitle(LOG_LINE_MAX * 2, 'x');
+    log.println(longTitle.c_str());
+
+    std::string out = drainAll(log);
+    EXPECT_EQ(out.size(), (size_t)LOG_LINE_MAX);
+    EXPECT_EQ(out.back(), '\n');
+}
+
+// ========== Ring behaviour ==========
+
+TEST(LogBuffer, PeekStopsAtWrapPoint) {
+    char storage[16];
+    LogBuffer log(storage, sizeof(storage));
+
+    log.println("0123456789"); // 11 bytes
+    const char* chunk;
+    log.consume(log.peek(&chunk, 8));
+    log.println("abcdefgh"); // 9 bytes, wraps
+
+    size_t n = log.peek(&chunk, 64);
+    EXPECT_EQ(std::string(chunk, n), "89\nabcde");
+    log.consume(n);
+    EXPECT_EQ(drainAll(log), "fgh\n");
+}
+
+TEST(LogBuffer, PeekRespectsMaxLen) {
+    char storage[64];
+    LogBuffer log(storage, sizeof(storage));
+
+    log.println("hello world");
+    const char* chunk;
+    EXPECT_EQ(log.peek(&chunk, 5), 5u);
+    EXPECT_EQ(std::string(chunk, 5), "hello");
+}
+
+TEST(LogBuffer, DropsWholeLinesWhenFull) {
+    char storage[32];
+    LogBuffer log(storage, sizeof(storage));
+
+    log.println("first line....."); // 16 bytes
+    log.println("second line...."); // 16 bytes, exactly fills
+    log.println("third");           // no room
+
+    EXPECT_EQ(log.droppedCount(), 1ul);
+    EXPECT_EQ(drainAll(log), "first line.....\nsecond line....\n");
+
+    log.println("fourth");
+    EXPECT_EQ(log.droppedCount(), 1ul);
+    EXPECT_EQ(drainAll(log), "fourth\n");
+}
+
+// ========== Burst ==========
+
+TEST(LogBuffer, BurstNeverWaitsOnSerial) {
+    // A burst much larger than the ring, with nothing draining it. At 115200
+    // baud (~87us per byte) a blocking Serial.print would need seconds for
+    // this; the buffered sink must absorb it in a tiny fraction of that.
+    char storage[4096];
+    LogBuffer log(storage, sizeof(storage));
+
+    const int lines = 2000;
+    String artist("Stereolab");
+    String title("Metronomic Underground (Live at the Roundhouse, 1996)");
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < lines; i++) {
+        log.print("[AzuraCast] Polling... new track: ");
+        log.print(artist);
+        log.print(" - ");
+        log.println(title);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    const double bytesPerLine = 34 + artist.length() + 3 + title.length() + 1;
+    const double serialSeconds = lines * bytesPerLine * 10.0 / 115200.0;
+    const double burstSeconds = std::chrono::duration<double>(elapsed).count();
+
+    EXPECT_LT(burstSeconds, serialSeconds / 100.0);
+    EXPECT_GT(log.droppedCount(), 0ul);
+    EXPECT_LE(log.pending(), log.capacity());
+}
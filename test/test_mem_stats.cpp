@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+#include "mem_stats.h"
+
+// ========== Helpers ==========
+
+static HeapCounters heap(unsigned long allocs, unsigned long frees,
+                         unsigned long inUse, unsigned long peak) {
+    return HeapCounters{allocs, frees, inUse, peak};
+}
+
+// ========== Scope attribution ==========
+
+TEST(MemStats, ScopeChargesDeltaToModule) {
+    MemStats stats;
+    stats.enter(MEM_AZURACAST, heap(10, 8, 1000, 1000));
+    EXPECT_EQ(stats.currentModule(), MEM_AZURACAST);
+    stats.exit(heap(15, 12, 1200, 3000));
+
+    const ModuleMemStats& m = stats.module(MEM_AZURACAST);
+    EXPECT_EQ(m.scopes, 1u);
+    EXPECT_EQ(m.allocs, 5u);
+    EXPECT_EQ(m.frees, 4u);
+    EXPECT_EQ(m.retained, 200);
+    EXPECT_EQ(m.peak, 2000u); // 3000 peak - 1000 at entry
+    EXPECT_EQ(stats.currentModule(), MEM_OTHER);
+}
+
+TEST(MemStats, BalancedScopeRetainsNothing) {
+    MemStats stats;
+    for (int i = 0; i < 3; i++) {
+        stats.enter(MEM_FLOWSHEET, heap(i * 4, i * 4, 500, 500));
+        stats.exit(heap(i * 4 + 4, i * 4 + 4, 500, 900));
+    }
+    const ModuleMemStats& m = stats.module(MEM_FLOWSHEET);
+    EXPECT_EQ(m.scopes, 3u);
+    EXPECT_EQ(m.allocs, 12u);
+    EXPECT_EQ(m.frees, 12u);
+    EXPECT_EQ(m.retained, 0);
+    EXPECT_EQ(m.peak, 400u);
+}
+
+TEST(MemStats, PeakIsLargestAcrossScopes) {
+    MemStats stats;
+    stats.enter(MEM_AZURACAST, heap(0, 0, 100, 100));
+    stats.exit(heap(1, 1, 100, 600));
+    stats.enter(MEM_AZURACAST, heap(1, 1, 100, 100));
+    stats.exit(heap(2, 2, 100, 300));
+    EXPECT_EQ(stats.module(MEM_AZURACAST).peak, 500u);
+}
+
+TEST(MemStats, NestedScopeChargedToInnermostOnly) {
+    MemStats stats;
+    stats.enter(MEM_FLOWSHEET, heap(0, 0, 1000, 1000));
+    stats.enter(MEM_NETWORK, heap(2, 0, 1100, 1100));
+    EXPECT_EQ(stats.currentModule(), MEM_NETWORK);
+    stats.exit(heap(5, 1, 1300, 1500));
+    EXPECT_EQ(stats.currentModule(), MEM_FLOWSHEET);
+    stats.exit(heap(6, 6, 1000, 1500));
+
+    EXPECT_EQ(stats.module(MEM_NETWORK).allocs, 3u);
+    EXPECT_EQ(stats.module(MEM_NETWORK).frees, 1u);
+    EXPECT_EQ(stats.module(MEM_NETWORK).retained, 200);
+    EXPECT_EQ(stats.module(MEM_FLOWSHEET).allocs, 3u); // 6 total - 3 inner
+    EXPECT_EQ(stats.module(MEM_FLOWSHEET).frees, 5u);
+    EXPECT_EQ(stats.module(MEM_FLOWSHEET).retained, -200); // freed what the inner scope kept
+}
+
+TEST(MemStats, ExitReturnsPeakForEnclosingScope) {
+    MemStats stats;
+    stats.enter(MEM_FLOWSHEET, heap(0, 0, 1000, 4000));
+    // Inner scope saw a lower peak than the outer one had already reached
+    stats.enter(MEM_NETWORK, heap(0, 0, 1000, 1000));
+    EXPECT_EQ(stats.exit(heap(0, 0, 1000, 2500)), 2500u);
+    EXPECT_EQ(stats.exit(heap(0, 0, 1000, 2500)), 4000u);
+}
+
+TEST(MemStats, ScopesBeyondMaxDepthAreIgnored) {
+    MemStats stats;
+    for (int i = 0; i < MEM_SCOPE_MAX_DEPTH + 2; i++) {
+        stats.enter(MEM_LOG, heap(0, 0, 0, 0));
+    }
+    for (int i = 0; i < MEM_SCOPE_MAX_DEPTH + 2; i++) {
+        stats.exit(heap(0, 0, 0, 0));
+    }
+    EXPECT_EQ(stats.module(MEM_LOG).scopes, (unsigned long)MEM_SCOPE_MAX_DEPTH);
+    EXPECT_EQ(stats.currentModule(), MEM_OTHER);
+}
+
+TEST(MemStats, UnbalancedExitIsHarmless) {
+    MemStats stats;
+    EXPECT_EQ(stats.exit(heap(0, 0, 10, 20)), 20u);
+    EXPECT_EQ(stats.currentModule(), MEM_OTHER);
+}
+
+// ========== Global samples ==========
+
+TEST(MemStats, UnscopedUseIsChargedToOther) {
+    MemStats stats;
+    stats.enter(MEM_AZURACAST, heap(0, 0, 0, 0));
+    stats.exit(heap(4, 2, 300, 300));
+    stats.sampleHeap(heap(10, 5, 1000, 1000));
+
+    EXPECT_EQ(stats.module(MEM_OTHER).allocs, 6u);
+    EXPECT_EQ(stats.module(MEM_OTHER).frees, 3u);
+    EXPECT_EQ(stats.module(MEM_OTHER).retained, 700);
+    EXPECT_EQ(stats.heapInUse(), 1000u);
+    EXPECT_EQ(stats.totalAllocs(), 10u);
+}
+
+TEST(MemStats, HeapPeakSurvivesLowerSamples) {
+    MemStats stats;
+    stats.sampleHeap(heap(0, 0, 800, 900));
+    stats.sampleHeap(heap(0, 0, 200, 200));
+    EXPECT_EQ(stats.heapInUse(), 200u);
+    EXPECT_EQ(stats.heapPeak(), 900u);
+}
+
+TEST(MemStats, LargestFreeAndStackKeepMinimum) {
+    MemStats stats;
+    stats.sampleLargestFree(50000);
+    stats.sampleLargestFree(20000);
+    stats.sampleLargestFree(40000);
+    EXPECT_EQ(stats.largestFree(), 40000u);
+    EXPECT_EQ(stats.minLargestFree(), 20000u);
+
+    stats.sampleStack(6000);
+    stats.sampleStack(3500);
+    stats.sampleStack(5000);
+    EXPECT_EQ(stats.stackFree(), 5000u);
+    EXPECT_EQ(stats.minStackFree(), 3500u);
+}
+
+TEST(MemStats, ResetClearsEverything) {
+    MemStats stats;
+    stats.enter(MEM_LOG, heap(0, 0, 0, 0));
+    stats.exit(heap(3, 0, 100, 100));
+    stats.sampleStack(1000);
+    stats.reset();
+    EXPECT_EQ(stats.module(MEM_LOG).allocs, 0u);
+    EXPECT_EQ(stats.minStackFree(), 0u);
+    EXPECT_EQ(stats.heapPeak(), 0u);
+}
+
+TEST(MemStats, ModuleNames) {
+    EXPECT_STREQ(memModuleName(MEM_AZURACAST), "azuracast");
+    EXPECT_STREQ(memModuleName(MEM_FLOWSHEET), "flowsheet");
+    EXPECT_STREQ(memModuleName(MEM_OTHER), "other");
+}
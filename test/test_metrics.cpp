@@ -0,0 +1,325 @@
+#include <gtest/gtest.h>
+#include "log_buffer.h"
+#include "loopback_transport.h"
+#include "mem_stats.h"
+#include "metrics.h"
+#include "metrics_server.h"
+
+#include <climits>
+#include <cstring>
+#include <string>
+
+// ========== Helpers ==========
+
+/**
+ * A scraper's end of the connection: hands the server a request, keeps
+ * what it writes (into storage reserved up front, so a scrape can be
+ * checked for allocations), and can take writes a few bytes at a time.
+ */
+class ScraperClient : public Client {
+public:
+    std::string request;
+    std::string received;
+    size_t maxWrite = SIZE_MAX;
+    int writes = 0;
+    bool open = true;
+    bool stopped = false;
+
+    ScraperClient() { received.reserve(16384); }
+
+    int connect(IPAddress, uint16_t) override { return 0; }
+    int connect(const char*, uint16_t) override { return 0; }
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buf, size_t size) override {
+        if (!open) return 0;
+        size_t n = size < maxWrite ? size : maxWrite;
+        received.append((const char*)buf, n);
+        writes++;
+        return n;
+    }
+    using Print::write;
+    int available() override { return (int)(request.size() - pos); }
+    int read() override { return pos < request.size() ? (uint8_t)request[pos++] : -1; }
+    int read(uint8_t* buf, size_t size) override {
+        size_t n = 0;
+        while (n < size && pos < request.size()) buf[n++] = (uint8_t)request[pos++];
+        return n > 0 ? (int)n : -1;
+    }
+    int peek() override { return pos < request.size() ? (uint8_t)request[pos] : -1; }
+    void flush() override {}
+    void stop() override {
+        stopped = true;
+        open = false;
+    }
+    uint8_t connected() override { return open; }
+    operator bool() override { return open; }
+
+    std::string body() const {
+        size_t end = received.find("\r\n\r\n");
+        return end == std::string::npos ? "" : received.substr(end + 4);
+    }
+
+private:
+    size_t pos = 0;
+};
+
+static LoopHistogram testLoop;
+static int samplesTaken = 0;
+
+static void fillSample(MetricsSample* sample) {
+    samplesTaken++;
+    sample->state = AUTO_DJ_ACTIVE;
+    sample->uptimeS = 3600;
+    sample->polls = 100;
+    sample->pollsUnchanged = 80;
+    sample->pollsFailed = 5;
+    for (int i = 0; i < PLAY_STATUS_COUNT; i++) sample->entries[i] = (unsigned long)i;
+    sample->retries = 2;
+    sample->heapInUse = 40000;
+    sample->heapPeak = 52000;
+    sample->stackFree = 6000;
+    sample->linkCount = 2;
+    sample->linkNames[0] = "Ethernet";
+    sample->linkSignalDbm[0] = 0;
+    sample->linkNames[1] = "WiFi";
+    sample->linkSignalDbm[1] = -67;
+    sample->scrapes = 0;
+    sample->loop = &testLoop;
+}
+
+static bool contains(const std::string& text, const std::string& line) {
+    return text.find(line) != std::string::npos;
+}
+
+class MetricsServerTest : public ::testing::Test {
+protected:
+    MetricsServer server{fillSample};
+    ScraperClient scraper;
+    unsigned long now = 1000;
+
+    void SetUp() override {
+        testLoop = LoopHistogram();
+        samplesTaken = 0;
+    }
+    void TearDown() override { drainSerialLog(); }
+
+    /** Runs update() until the scrape ends; returns how many it took. */
+    int scrape() {
+        int updates = 0;
+        while (server.busy() && updates < 1000) {
+            server.update(now++);
+            updates++;
+        }
+        return updates;
+    }
+};
+
+// ========== Writer ==========
+
+TEST(MetricsWriterTest, WritesFamilyAndSamples) {
+    char buf[256];
+    MetricsWriter w(buf, sizeof(buf));
+    w.family("auto_dj_polls_total", "counter", "Polls.");
+    w.value("auto_dj_polls_total", "result", "new", 12);
+    w.value("auto_dj_uptime_seconds", 0);
+    w.sample("auto_dj_link_signal_dbm", "link", "WiFi", -67);
+
+    EXPECT_FALSE(w.overflowed());
+    EXPECT_EQ(std::string(buf, w.length()),
+              "# HELP auto_dj_polls_total Polls.\n"
+              "# TYPE auto_dj_polls_total counter\n"
+              "auto_dj_polls_total{result=\"new\"} 12\n"
+              "auto_dj_uptime_seconds 0\n"
+              "auto_dj_link_signal_dbm{link=\"WiFi\"} -67\n");
+}
+
+TEST(MetricsWriterTest, LargestValuesFit) {
+    char buf[128];
+    MetricsWriter w(buf, sizeof(buf));
+    w.value("a", ULONG_MAX);
+    w.sample("b", nullptr, nullptr, LONG_MIN);
+    EXPECT_EQ(std::string(buf, w.length()),
+              "a " + std::to_string(ULONG_MAX) + "\nb " + std::to_string(LONG_MIN) + "\n");
+}
+
+TEST(MetricsWriterTest, OverflowKeepsWholeLines) {
+    char buf[40];
+    MetricsWriter w(buf, sizeof(buf));
+    w.value("auto_dj_heap_in_use_bytes", 40000); // 32 bytes
+    w.value("auto_dj_heap_peak_bytes", 52000);   // would end past 40
+    w.value("x", 1);                             // fits, but the writer has stopped
+
+    EXPECT_TRUE(w.overflowed());
+    EXPECT_EQ(std::string(buf, w.length()), "auto_dj_heap_in_use_bytes 40000\n");
+
+    w.clear();
+    w.value("x", 1);
+    EXPECT_FALSE(w.overflowed());
+    EXPECT_EQ(std::string(buf, w.length()), "x 1\n");
+}
+
+// ========== Rendering ==========
+
+TEST(MetricsRenderTest, HistogramBucketsAreCumulative) {
+    LoopHistogram h;
+    h.observe(0);
+    h.observe(3);
+    h.observe(3);
+    h.observe(700);
+    h.observe(9000); // past the last bound: +Inf only
+
+    char buf[1024];
+    MetricsWriter w(buf, sizeof(buf));
+    w.histogram("loop", h);
+    std::string text(buf, w.length());
+    EXPECT_TRUE(contains(text, "loop_bucket{le=\"1\"} 1\n"));
+    EXPECT_TRUE(contains(text, "loop_bucket{le=\"2\"} 1\n"));
+    EXPECT_TRUE(contains(text, "loop_bucket{le=\"5\"} 3\n"));
+    EXPECT_TRUE(contains(text, "loop_bucket{le=\"500\"} 3\n"));
+    EXPECT_TRUE(contains(text, "loop_bucket{le=\"1000\"} 4\n"));
+    EXPECT_TRUE(contains(text, "loop_bucket{le=\"5000\"} 4\n"));
+    EXPECT_TRUE(contains(text, "loop_bucket{le=\"+Inf\"} 5\n"));
+    EXPECT_TRUE(contains(text, "loop_sum 9706\n"));
+    EXPECT_TRUE(contains(text, "loop_count 5\n"));
+    EXPECT_EQ(h.maxMs(), 9000u);
+}
+
+TEST(MetricsRenderTest, EveryFamilyFitsTheChunkAtItsLargest) {
+    LoopHistogram loop;
+    MetricsSample sample;
+    fillSample(&sample);
+    sample.uptimeS = ULONG_MAX;
+    sample.polls = ULONG_MAX;
+    for (int i = 0; i < PLAY_STATUS_COUNT; i++) sample.entries[i] = ULONG_MAX;
+    sample.linkCount = LINK_SELECTOR_MAX_LINKS;
+    for (int i = 0; i < LINK_SELECTOR_MAX_LINKS; i++) {
+        sample.linkNames[i] = "Ethernet";
+        sample.linkSignalDbm[i] = -100;
+    }
+    for (int i = 0; i < 1000; i++) loop.observe(ULONG_MAX / 1000);
+    sample.loop = &loop;
+
+    char chunk[METRICS_CHUNK_MAX];
+    MetricsWriter w(chunk, sizeof(chunk));
+    int section = 0;
+    for (; renderMetrics(section, sample, w); section++) {
+        EXPECT_FALSE(w.overflowed()) << "section " << section;
+        w.clear();
+    }
+    EXPECT_GT(section, 10);
+}
+
+// ========== Server ==========
+
+TEST_F(MetricsServerTest, ServesMetricsAFamilyPerUpdate) {
+    testLoop.observe(4);
+    scraper.request = "GET /metrics HTTP/1.1\r\nHost: autodj.local:9100\r\n"
+                      "Accept: text/plain\r\n\r\n";
+    ASSERT_TRUE(server.begin(&scraper, now));
+    int updates = scrape();
+
+    EXPECT_TRUE(scraper.stopped);
+    EXPECT_EQ(samplesTaken, 1);
+    EXPECT_EQ(server.scrapeCount(), 1u);
+    EXPECT_EQ(scraper.received.compare(0, 17, "HTTP/1.1 200 OK\r\n"), 0);
+    EXPECT_TRUE(contains(scraper.received, "Content-Type: text/plain; version=0.0.4\r\n"));
+    // Read, headers, then one write per family
+    EXPECT_EQ(scraper.writes, updates - 2);
+
+    std::string body = scraper.body();
+    EXPECT_TRUE(contains(body, "# TYPE auto_dj_state gauge\n"));
+    EXPECT_TRUE(contains(body, "auto_dj_state{state=\"AUTO_DJ_ACTIVE\"} 1\n"));
+    EXPECT_TRUE(contains(body, "auto_dj_state{state=\"IDLE\"} 0\n"));
+    EXPECT_TRUE(contains(body, "auto_dj_polls_total{result=\"new\"} 15\n"));
+    EXPECT_TRUE(contains(body, "auto_dj_polls_total{result=\"unchanged\"} 80\n"));
+    EXPECT_TRUE(contains(body, "auto_dj_polls_total{result=\"failed\"} 5\n"));
+    EXPECT_TRUE(contains(body, "auto_dj_flowsheet_entries_total{result=\"dropped\"} 3\n"));
+    EXPECT_TRUE(contains(body, "auto_dj_retries_total 2\n"));
+    EXPECT_TRUE(contains(body, "auto_dj_loop_duration_milliseconds_bucket{le=\"5\"} 1\n"));
+    EXPECT_TRUE(contains(body, "auto_dj_heap_in_use_bytes 40000\n"));
+    EXPECT_TRUE(contains(body, "auto_dj_link_signal_dbm{link=\"WiFi\"} -67\n"));
+    EXPECT_FALSE(contains(body, "link=\"Ethernet\"")); // no signal to report
+    EXPECT_TRUE(contains(body, "auto_dj_scrapes_total 1\n"));
+}
+
+TEST_F(MetricsServerTest, WaitsForTheWholeRequest) {
+    scraper.request = "GET /metrics HTTP/1.1\r\nHo";
+    ASSERT_TRUE(server.begin(&scraper, now));
+    for (int i = 0; i < 5; i++) server.update(now++);
+    EXPECT_TRUE(scraper.received.empty());
+    EXPECT_EQ(samplesTaken, 0);
+
+    scraper.request += "st: autodj\r\n\r\n";
+    scrape();
+    EXPECT_TRUE(contains(scraper.body(), "auto_dj_uptime_seconds 3600\n"));
+}
+
+TEST_F(MetricsServerTest, FinishesPartialWrites) {
+    scraper.maxWrite = 7;
+    scraper.request = "GET /metrics?name[]=x HTTP/1.0\r\n\r\n";
+    ASSERT_TRUE(server.begin(&scraper, now));
+    while (server.busy()) server.update(now); // the clock stands still
+
+    EXPECT_EQ(server.dropCount(), 0u);
+    EXPECT_TRUE(contains(scraper.body(), "auto_dj_scrapes_total 1\n"));
+}
+
+TEST_F(MetricsServerTest, OtherPathsAreNotFound) {
+    scraper.request = "GET / HTTP/1.1\r\n\r\n";
+    ASSERT_TRUE(server.begin(&scraper, now));
+    scrape();
+
+    EXPECT_EQ(scraper.received.compare(0, 24, "HTTP/1.1 404 Not Found\r\n"), 0);
+    EXPECT_EQ(scraper.body(), "Not found\n");
+    EXPECT_EQ(samplesTaken, 0);
+    EXPECT_EQ(server.scrapeCount(), 0u);
+
+    ScraperClient post;
+    post.request = "POST /metrics HTTP/1.1\r\nContent-Length: 0\r\n\r\n";
+    ASSERT_TRUE(server.begin(&post, now));
+    scrape();
+    EXPECT_EQ(post.body(), "Not found\n");
+}
+
+TEST_F(MetricsServerTest, OneScrapeAtATime) {
+    scraper.request = "GET /metrics HTTP/1.1\r\n\r\n";
+    ScraperClient second;
+    ASSERT_TRUE(server.begin(&scraper, now));
+    EXPECT_FALSE(server.begin(&second, now));
+    scrape();
+    EXPECT_TRUE(server.begin(&second, now));
+}
+
+TEST_F(MetricsServerTest, DropsSilentScraper) {
+    scraper.request = "GET /met";
+    ASSERT_TRUE(server.begin(&scraper, now));
+    server.update(now + METRICS_TIMEOUT_MS - 1);
+    EXPECT_TRUE(server.busy());
+    server.update(now + METRICS_TIMEOUT_MS);
+
+    EXPECT_FALSE(server.busy());
+    EXPECT_TRUE(scraper.stopped);
+    EXPECT_TRUE(scraper.received.empty());
+    EXPECT_EQ(server.dropCount(), 1u);
+}
+
+TEST_F(MetricsServerTest, ClosedBeforeAsking) {
+    scraper.request = "GET /met";
+    ASSERT_TRUE(server.begin(&scraper, now));
+    server.update(now);
+    scraper.open = false;
+    server.update(now);
+    EXPECT_FALSE(server.busy());
+    EXPECT_EQ(samplesTaken, 0);
+}
+
+TEST_F(MetricsServerTest, ScrapeAllocatesNothing) {
+    scraper.request = "GET /metrics HTTP/1.1\r\nHost: autodj.local:9100\r\n\r\n";
+    unsigned long before = readHeapCounters().allocs;
+    ASSERT_TRUE(server.begin(&scraper, now));
+    scrape();
+    unsigned long allocs = readHeapCounters().allocs - before;
+
+    EXPECT_TRUE(contains(scraper.body(), "auto_dj_scrapes_total 1\n"));
+    EXPECT_EQ(allocs, 0UL);
+}
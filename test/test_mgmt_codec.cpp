@@ -0,0 +1,499 @@
+#include <gtest/gtest.h>
+#include "mgmt_codec.h"
+#include "msgpack.h"
+#include "mem_stats.h"
+
+#include <ArduinoJson.h>
+#include <chrono>
+#include <string>
+
+// ========== Helpers ==========
+
+// The example heartbeat from networking-spec §3.6.2
+static Heartbeat specHeartbeat() {
+    Heartbeat hb;
+    hb.state = AUTO_DJ_ACTIVE;
+    hb.transport = MGMT_TRANSPORT_ETHERNET;
+    hb.uptimeS = 86402;
+    hb.hasWifiRssi = false;
+    hb.wifiRssi = 0;
+    hb.freeRam = 524288;
+    hb.radioShowID = 12345;
+    hb.lastTrackArtist = "Yo La Tengo";
+    hb.lastTrackTitle = "Autumn Sweater";
+    hb.lastTrackPostedAt = 1708400000;
+    hb.lastError = nullptr;
+    hb.firmwareVersion = "1.2.0";
+    hb.configHash = "a3f2c8";
+    hb.loopMaxMs = 45;
+    hb.reconnectCount = 0;
+    hb.tracksDetected = 142;
+    hb.tracksPosted = 140;
+    hb.errorsSinceBoot = 2;
+    return hb;
+}
+
+// 30 s later, one more track
+static void advance(Heartbeat& hb) {
+    hb.uptimeS += 30;
+    hb.tracksDetected++;
+    hb.tracksPosted++;
+    hb.lastTrackPostedAt += 30;
+    hb.loopMaxMs = 40 + hb.uptimeS % 7;
+}
+
+static void expectSame(const Heartbeat& a, const Heartbeat& b) {
+    EXPECT_EQ(a.state, b.state);
+    EXPECT_EQ(a.transport, b.transport);
+    EXPECT_EQ(a.uptimeS, b.uptimeS);
+    EXPECT_EQ(a.hasWifiRssi, b.hasWifiRssi);
+    if (a.hasWifiRssi) {
+        EXPECT_EQ(a.wifiRssi, b.wifiRssi);
+    }
+    EXPECT_EQ(a.freeRam, b.freeRam);
+    EXPECT_EQ(a.radioShowID, b.radioShowID);
+    ASSERT_EQ(a.lastTrackArtist == nullptr, b.lastTrackArtist == nullptr);
+    if (a.lastTrackArtist) {
+        EXPECT_STREQ(a.lastTrackArtist, b.lastTrackArtist);
+        EXPECT_STREQ(a.lastTrackTitle, b.lastTrackTitle);
+        EXPECT_EQ(a.lastTrackPostedAt, b.lastTrackPostedAt);
+    }
+    ASSERT_EQ(a.lastError == nullptr, b.lastError == nullptr);
+    if (a.lastError) {
+        EXPECT_STREQ(a.lastError, b.lastError);
+    }
+    EXPECT_STREQ(a.firmwareVersion, b.firmwareVersion);
+    EXPECT_STREQ(a.configHash, b.configHash);
+    EXPECT_EQ(a.loopMaxMs, b.loopMaxMs);
+    EXPECT_EQ(a.reconnectCount, b.reconnectCount);
+    EXPECT_EQ(a.tracksDetected, b.tracksDetected);
+    EXPECT_EQ(a.tracksPosted, b.tracksPosted);
+    EXPECT_EQ(a.errorsSinceBoot, b.errorsSinceBoot);
+}
+
+// ========== Negotiation ==========
+
+TEST(MgmtEncoding, ServerSelectsSubprotocol) {
+    EXPECT_EQ(mgmtEncodingFor(MGMT_SUBPROTOCOL_MSGPACK), MGMT_MSGPACK);
+    EXPECT_EQ(mgmtEncodingFor(MGMT_SUBPROTOCOL_JSON), MGMT_JSON);
+    EXPECT_EQ(mgmtEncodingFor(nullptr), MGMT_JSON);
+    EXPECT_EQ(mgmtEncodingFor("something-else"), MGMT_JSON);
+    EXPECT_STREQ(MGMT_SUBPROTOCOLS_OFFERED, "wxyc-auto-dj.msgpack, wxyc-auto-dj.json");
+}
+
+// ========== JSON heartbeat ==========
+
+TEST(HeartbeatJson, MatchesSpecExample) {
+    HeartbeatEncoder enc(10);
+    enc.reset(MGMT_JSON);
+    uint8_t buf[1024];
+    size_t n = enc.encode(specHeartbeat(), buf, sizeof(buf));
+    ASSERT_GT(n, 0u);
+
+    JsonDocument doc;
+    ASSERT_FALSE(deserializeJson(doc, (const char*)buf, n));
+    EXPECT_STREQ(doc["type"] | "", "heartbeat");
+    EXPECT_STREQ(doc["state"] | "", "AUTO_DJ_ACTIVE");
+    EXPECT_STREQ(doc["transport"] | "", "ethernet");
+    EXPECT_EQ(doc["uptime_s"] | 0L, 86402L);
+    EXPECT_TRUE(doc["wifi_rssi"].isNull());
+    EXPECT_EQ(doc["radio_show_id"] | 0L, 12345L);
+    EXPECT_STREQ(doc["last_track"]["artist"] | "", "Yo La Tengo");
+    EXPECT_EQ(doc["last_track"]["posted_at"] | 0L, 1708400000L);
+    EXPECT_TRUE(doc["last_error"].isNull());
+    EXPECT_STREQ(doc["config_hash"] | "", "a3f2c8");
+    EXPECT_EQ(doc["errors_since_boot"] | 0L, 2L);
+}
+
+TEST(HeartbeatJson, TooSmallBufferFails) {
+    HeartbeatEncoder enc(10);
+    uint8_t buf[64];
+    EXPECT_EQ(enc.encode(specHeartbeat(), buf, sizeof(buf)), 0u);
+}
+
+// ========== MessagePack heartbeat ==========
+
+TEST(HeartbeatMsgPack, KeyframeRoundTrip) {
+    HeartbeatEncoder enc(10);
+    enc.reset(MGMT_MSGPACK);
+    HeartbeatDecoder dec;
+    uint8_t buf[256];
+    Heartbeat hb = specHeartbeat();
+    size_t n = enc.encode(hb, buf, sizeof(buf));
+    ASSERT_GT(n, 0u);
+
+    Heartbeat out;
+    ASSERT_EQ(dec.decode(buf, n, &out), MGMT_DECODE_OK);
+    expectSame(hb, out);
+}
+
+TEST(HeartbeatMsgPack, DeltasCarryOnlyChanges) {
+    HeartbeatEncoder enc(10);
+    enc.reset(MGMT_MSGPACK);
+    HeartbeatDecoder dec;
+    uint8_t buf[256];
+    Heartbeat hb = specHeartbeat();
+    Heartbeat out;
+    size_t keyframe = enc.encode(hb, buf, sizeof(buf));
+    ASSERT_EQ(dec.decode(buf, keyframe, &out), MGMT_DECODE_OK);
+
+    // Nothing but uptime and loop time moved
+    hb.uptimeS += 30;
+    size_t idle = enc.encode(hb, buf, sizeof(buf));
+    ASSERT_EQ(dec.decode(buf, idle, &out), MGMT_DECODE_OK);
+    expectSame(hb, out);
+    EXPECT_LE(idle, 12u);
+
+    // A new track
+    hb.lastTrackArtist = "Stereolab";
+    hb.lastTrackTitle = "French Disko";
+    advance(hb);
+    size_t track = enc.encode(hb, buf, sizeof(buf));
+    ASSERT_EQ(dec.decode(buf, track, &out), MGMT_DECODE_OK);
+    expectSame(hb, out);
+    EXPECT_LT(track, keyframe);
+}
+
+TEST(HeartbeatMsgPack, NullsAndChangesToNull) {
+    HeartbeatEncoder enc(10);
+    enc.reset(MGMT_MSGPACK);
+    HeartbeatDecoder dec;
+    uint8_t buf[256];
+    Heartbeat hb = specHeartbeat();
+    hb.hasWifiRssi = true;
+    hb.wifiRssi = -67;
+    hb.lastError = "HTTP_TIMEOUT";
+    Heartbeat out;
+    ASSERT_EQ(dec.decode(buf, enc.encode(hb, buf, sizeof(buf)), &out), MGMT_DECODE_OK);
+    expectSame(hb, out);
+
+    hb.hasWifiRssi = false;
+    hb.lastError = nullptr;
+    hb.radioShowID = -1;
+    hb.lastTrackArtist = hb.lastTrackTitle = nullptr;
+    hb.state = IDLE;
+    ASSERT_EQ(dec.decode(buf, enc.encode(hb, buf, sizeof(buf)), &out), MGMT_DECODE_OK);
+    expectSame(hb, out);
+}
+
+TEST(HeartbeatMsgPack, PeriodicKeyframes) {
+    HeartbeatEncoder enc(4);
+    enc.reset(MGMT_MSGPACK);
+    uint8_t buf[256];
+    Heartbeat hb = specHeartbeat();
+    std::vector<size_t> sizes;
+    for (int i = 0; i < 9; i++) {
+        sizes.push_back(enc.encode(hb, buf, sizeof(buf)));
+        advance(hb);
+    }
+    EXPECT_EQ(sizes[4], sizes[0]);
+    EXPECT_EQ(sizes[8], sizes[0]);
+    EXPECT_LT(sizes[1], sizes[0]);
+
+    // A late decoder can join at a keyframe
+    HeartbeatDecoder late;
+    Heartbeat out;
+    hb = specHeartbeat();
+    enc.reset(MGMT_MSGPACK);
+    size_t n = enc.encode(hb, buf, sizeof(buf));
+    advance(hb);
+    n = enc.encode(hb, buf, sizeof(buf));
+    EXPECT_EQ(late.decode(buf, n, &out), MGMT_DECODE_NEED_KEYFRAME);
+}
+
+TEST(HeartbeatMsgPack, MissedDeltaNeedsKeyframe) {
+    HeartbeatEncoder enc(10);
+    enc.reset(MGMT_MSGPACK);
+    HeartbeatDecoder dec;
+    uint8_t buf[256];
+    Heartbeat hb = specHeartbeat();
+    Heartbeat out;
+    ASSERT_EQ(dec.decode(buf, enc.encode(hb, buf, sizeof(buf)), &out), MGMT_DECODE_OK);
+    advance(hb);
+    enc.encode(hb, buf, sizeof(buf)); // lost
+    advance(hb);
+    EXPECT_EQ(dec.decode(buf, enc.encode(hb, buf, sizeof(buf)), &out),
+              MGMT_DECODE_NEED_KEYFRAME);
+
+    enc.forceKeyframe();
+    advance(hb);
+    ASSERT_EQ(dec.decode(buf, enc.encode(hb, buf, sizeof(buf)), &out), MGMT_DECODE_OK);
+    expectSame(hb, out);
+}
+
+TEST(HeartbeatMsgPack, CounterResetForcesKeyframe) {
+    HeartbeatEncoder enc(10);
+    enc.reset(MGMT_MSGPACK);
+    HeartbeatDecoder dec;
+    uint8_t buf[256];
+    Heartbeat hb = specHeartbeat();
+    Heartbeat out;
+    size_t keyframe = enc.encode(hb, buf, sizeof(buf));
+    dec.decode(buf, keyframe, &out);
+
+    hb.errorsSinceBoot = 0;
+    size_t n = enc.encode(hb, buf, sizeof(buf));
+    EXPECT_EQ(n, keyframe);
+    ASSERT_EQ(dec.decode(buf, n, &out), MGMT_DECODE_OK);
+    EXPECT_EQ(out.errorsSinceBoot, 0u);
+}
+
+TEST(HeartbeatMsgPack, FailedEncodeKeepsBase) {
+    HeartbeatEncoder enc(10);
+    enc.reset(MGMT_MSGPACK);
+    HeartbeatDecoder dec;
+    uint8_t buf[256];
+    uint8_t tiny[8];
+    Heartbeat hb = specHeartbeat();
+    Heartbeat out;
+    ASSERT_EQ(dec.decode(buf, enc.encode(hb, buf, sizeof(buf)), &out), MGMT_DECODE_OK);
+    advance(hb);
+    hb.lastError = "a long error message that will not fit";
+    EXPECT_EQ(enc.encode(hb, tiny, sizeof(tiny)), 0u);
+    ASSERT_EQ(dec.decode(buf, enc.encode(hb, buf, sizeof(buf)), &out), MGMT_DECODE_OK);
+    expectSame(hb, out);
+}
+
+TEST(HeartbeatMsgPack, LongStringsAreClippedAtCharacterBoundary) {
+    HeartbeatEncoder enc(10);
+    enc.reset(MGMT_MSGPACK);
+    HeartbeatDecoder dec;
+    uint8_t buf[512];
+    Heartbeat hb = specHeartbeat();
+    std::string title(MGMT_STRING_MAX - 2, 'x');
+    title += "\xc3\xa9 and more"; // é straddles the limit
+    hb.lastTrackTitle = title.c_str();
+    Heartbeat out;
+    ASSERT_EQ(dec.decode(buf, enc.encode(hb, buf, sizeof(buf)), &out), MGMT_DECODE_OK);
+    EXPECT_EQ(std::string(out.lastTrackTitle), std::string(MGMT_STRING_MAX - 2, 'x'));
+
+    // Unchanged (clipped) string is not resent
+    hb.uptimeS += 30;
+    size_t n = enc.encode(hb, buf, sizeof(buf));
+    EXPECT_LE(n, 12u);
+    ASSERT_EQ(dec.decode(buf, n, &out), MGMT_DECODE_OK);
+    EXPECT_EQ(std::string(out.lastTrackTitle), std::string(MGMT_STRING_MAX - 2, 'x'));
+}
+
+TEST(HeartbeatMsgPack, DecoderRejectsOtherMessages) {
+    HeartbeatDecoder dec;
+    Heartbeat out;
+    uint8_t buf[128];
+    size_t n = encodeAck(MGMT_MSGPACK, "x1", MGMT_ACK_OK, nullptr, buf, sizeof(buf));
+    EXPECT_EQ(dec.decode(buf, n, &out), MGMT_DECODE_INVALID);
+    EXPECT_EQ(dec.decode(buf, 0, &out), MGMT_DECODE_INVALID);
+}
+
+// The emulation build counts every operator new (mem_shim.cpp)
+TEST(HeartbeatMsgPack, NothingAllocates) {
+    HeartbeatEncoder enc(10);
+    HeartbeatDecoder dec;
+    Heartbeat hb = specHeartbeat();
+    Heartbeat out;
+    MgmtCommand cmd = {"abc123", MGMT_ACTION_SET_CONFIG, "poll_interval_ms", "30000"};
+    uint8_t buf[96];
+    uint8_t cmdBuf[64];
+
+    unsigned long before = readHeapCounters().allocs;
+    enc.reset(MGMT_MSGPACK);
+    for (int i = 0; i < 20; i++) {
+        size_t n = enc.encode(hb, buf, sizeof(buf));
+        ASSERT_GT(n, 0u);
+        ASSERT_EQ(dec.decode(buf, n, &out), MGMT_DECODE_OK);
+        advance(hb);
+    }
+    size_t n = encodeCommand(MGMT_MSGPACK, cmd, cmdBuf, sizeof(cmdBuf));
+    ASSERT_EQ(decodeCommand(MGMT_MSGPACK, cmdBuf, n, &cmd), MGMT_DECODE_OK);
+    ASSERT_GT(encodeAck(MGMT_MSGPACK, cmd.id, MGMT_ACK_OK, nullptr, buf, sizeof(buf)), 0u);
+    EXPECT_EQ(readHeapCounters().allocs, before);
+}
+
+// ========== Commands and acks ==========
+
+TEST(MgmtCommandCodec, RoundTripBothEncodings) {
+    for (MgmtEncoding e : {MGMT_JSON, MGMT_MSGPACK}) {
+        MgmtCommand cmd = {"abc123", MGMT_ACTION_SET_CONFIG, "poll_interval_ms", "30000"};
+        uint8_t buf[256];
+        size_t n = encodeCommand(e, cmd, buf, sizeof(buf));
+        ASSERT_GT(n, 0u);
+        MgmtCommand out;
+        ASSERT_EQ(decodeCommand(e, buf, n, &out), MGMT_DECODE_OK);
+        EXPECT_STREQ(out.id, "abc123");
+        EXPECT_EQ(out.action, MGMT_ACTION_SET_CONFIG);
+        EXPECT_STREQ(out.key, "poll_interval_ms");
+        EXPECT_STREQ(out.value, "30000");
+    }
+}
+
+TEST(MgmtCommandCodec, SpecJsonCommand) {
+    const char* json = "{\"type\": \"command\", \"id\": \"x1\", \"action\": \"pause\"}";
+    MgmtCommand out;
+    ASSERT_EQ(decodeCommand(MGMT_JSON, (const uint8_t*)json, strlen(json), &out), MGMT_DECODE_OK);
+    EXPECT_STREQ(out.id, "x1");
+    EXPECT_EQ(out.action, MGMT_ACTION_PAUSE);
+    EXPECT_STREQ(out.key, "");
+}
+
+TEST(MgmtCommandCodec, UnknownActionIsDecoded) {
+    const char* json = "{\"type\": \"command\", \"id\": \"x2\", \"action\": \"dance\"}";
+    MgmtCommand out;
+    ASSERT_EQ(decodeCommand(MGMT_JSON, (const uint8_t*)json, strlen(json), &out), MGMT_DECODE_OK);
+    EXPECT_EQ(out.action, MGMT_ACTION_UNKNOWN);
+
+    uint8_t buf[32];
+    MsgPackWriter w(buf, sizeof(buf));
+    w.writeMapHeader(3);
+    w.writeUint(0); w.writeUint(1);
+    w.writeUint(1); w.writeStr("x3");
+    w.writeUint(2); w.writeUint(99);
+    ASSERT_EQ(decodeCommand(MGMT_MSGPACK, buf, w.length(), &out), MGMT_DECODE_OK);
+    EXPECT_EQ(out.action, MGMT_ACTION_UNKNOWN);
+}
+
+TEST(MgmtCommandCodec, UnknownKeysAreSkipped) {
+    uint8_t buf[64];
+    MsgPackWriter w(buf, sizeof(buf));
+    w.writeMapHeader(4);
+    w.writeUint(0); w.writeUint(1);
+    w.writeUint(9); w.writeArrayHeader(2); w.writeStr("future"); w.writeNil();
+    w.writeUint(1); w.writeStr("x4");
+    w.writeUint(2); w.writeUint(MGMT_ACTION_PING);
+    MgmtCommand out;
+    ASSERT_EQ(decodeCommand(MGMT_MSGPACK, buf, w.length(), &out), MGMT_DECODE_OK);
+    EXPECT_EQ(out.action, MGMT_ACTION_PING);
+}
+
+TEST(MgmtCommandCodec, RejectsInvalid) {
+    MgmtCommand out;
+    const char* noId = "{\"type\": \"command\", \"action\": \"ping\"}";
+    EXPECT_EQ(decodeCommand(MGMT_JSON, (const uint8_t*)noId, strlen(noId), &out),
+              MGMT_DECODE_INVALID);
+    const char* ack = "{\"type\": \"ack\", \"id\": \"x1\"}";
+    EXPECT_EQ(decodeCommand(MGMT_JSON, (const uint8_t*)ack, strlen(ack), &out),
+              MGMT_DECODE_INVALID);
+    const char* garbage = "{\"type\": ";
+    EXPECT_EQ(decodeCommand(MGMT_JSON, (const uint8_t*)garbage, strlen(garbage), &out),
+              MGMT_DECODE_INVALID);
+
+    std::string longId(MGMT_ID_MAX, 'i');
+    uint8_t buf[128];
+    MsgPackWriter w(buf, sizeof(buf));
+    w.writeMapHeader(3);
+    w.writeUint(0); w.writeUint(1);
+    w.writeUint(1); w.writeStr(longId.c_str());
+    w.writeUint(2); w.writeUint(MGMT_ACTION_PING);
+    EXPECT_EQ(decodeCommand(MGMT_MSGPACK, buf, w.length(), &out), MGMT_DECODE_INVALID);
+
+    // Truncated message
+    MgmtCommand ping = {"x5", MGMT_ACTION_PING, "", ""};
+    size_t n = encodeCommand(MGMT_MSGPACK, ping, buf, sizeof(buf));
+    EXPECT_EQ(decodeCommand(MGMT_MSGPACK, buf, n - 1, &out), MGMT_DECODE_INVALID);
+}
+
+TEST(MgmtAckCodec, BothEncodings) {
+    uint8_t buf[128];
+    size_t n = encodeAck(MGMT_JSON, "abc123", MGMT_ACK_ERROR, "bad key", buf, sizeof(buf));
+    ASSERT_GT(n, 0u);
+    JsonDocument doc;
+    ASSERT_FALSE(deserializeJson(doc, (const char*)buf, n));
+    EXPECT_STREQ(doc["type"] | "", "ack");
+    EXPECT_STREQ(doc["id"] | "", "abc123");
+    EXPECT_STREQ(doc["status"] | "", "error");
+    EXPECT_STREQ(doc["error"] | "", "bad key");
+
+    n = encodeAck(MGMT_MSGPACK, "abc123", MGMT_ACK_UNKNOWN_COMMAND, nullptr, buf, sizeof(buf));
+    MsgPackReader r(buf, n);
+    size_t fields;
+    uint32_t k, v;
+    const char* s;
+    size_t len;
+    ASSERT_TRUE(r.readMapHeader(&fields));
+    EXPECT_EQ(fields, 3u);
+    ASSERT_TRUE(r.readUint(&k) && r.readUint(&v));
+    EXPECT_EQ(v, 2u); // ack
+    ASSERT_TRUE(r.readUint(&k) && r.readStr(&s, &len));
+    EXPECT_EQ(std::string(s, len), "abc123");
+    ASSERT_TRUE(r.readUint(&k) && r.readUint(&v));
+    EXPECT_EQ(v, (uint32_t)MGMT_ACK_UNKNOWN_COMMAND);
+}
+
+// ========== Benchmark ==========
+
+// Bytes on the wire and encode/decode time for an hour of heartbeats (120,
+// one per 30 s) and for command/ack pairs, JSON versus MessagePack. The
+// JSON figures come from the host ArduinoJson shim, which builds a DOM with
+// heap nodes, so its times are an upper bound for the real library; the
+// byte counts are exact.
+TEST(MgmtCodecBenchmark, JsonVersusMsgPack) {
+    const int HEARTBEATS = 120;
+    const int ROUNDS = 50;
+    uint8_t buf[1024];
+
+    auto heartbeats = [&](MgmtEncoding e, size_t* bytes, double* encodeUs, double* decodeUs) {
+        *bytes = 0;
+        *encodeUs = *decodeUs = 0;
+        for (int round = 0; round < ROUNDS; round++) {
+            HeartbeatEncoder enc(10);
+            enc.reset(e);
+            HeartbeatDecoder dec;
+            Heartbeat hb = specHeartbeat();
+            for (int i = 0; i < HEARTBEATS; i++) {
+                auto t0 = std::chrono::steady_clock::now();
+                size_t n = enc.encode(hb, buf, sizeof(buf));
+                auto t1 = std::chrono::steady_clock::now();
+                ASSERT_GT(n, 0u);
+                if (e == MGMT_MSGPACK) {
+                    Heartbeat out;
+                    ASSERT_EQ(dec.decode(buf, n, &out), MGMT_DECODE_OK);
+                } else {
+                    JsonDocument doc;
+                    ASSERT_FALSE(deserializeJson(doc, (const char*)buf, n));
+                }
+                auto t2 = std::chrono::steady_clock::now();
+                if (round == 0) *bytes += n;
+                *encodeUs += std::chrono::duration<double, std::micro>(t1 - t0).count();
+                *decodeUs += std::chrono::duration<double, std::micro>(t2 - t1).count();
+                advance(hb);
+                if (i % 20 == 0) hb.freeRam -= 64;
+            }
+        }
+        *encodeUs /= ROUNDS * HEARTBEATS;
+        *decodeUs /= ROUNDS * HEARTBEATS;
+    };
+
+    auto commands = [&](MgmtEncoding e, size_t* bytes, double* us) {
+        MgmtCommand cmd = {"abc123", MGMT_ACTION_SET_CONFIG, "poll_interval_ms", "30000"};
+        size_t cmdLen = encodeCommand(e, cmd, buf, sizeof(buf));
+        uint8_t ack[128];
+        auto t0 = std::chrono::steady_clock::now();
+        size_t ackLen = 0;
+        for (int i = 0; i < ROUNDS * 10; i++) {
+            MgmtCommand out;
+            ASSERT_EQ(decodeCommand(e, buf, cmdLen, &out), MGMT_DECODE_OK);
+            ackLen = encodeAck(e, out.id, MGMT_ACK_OK, nullptr, ack, sizeof(ack));
+        }
+        *us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0)
+                  .count() / (ROUNDS * 10);
+        *bytes = cmdLen + ackLen;
+    };
+
+    size_t jsonBytes, packBytes, jsonCmdBytes, packCmdBytes;
+    double jsonEnc, jsonDec, packEnc, packDec, jsonCmdUs, packCmdUs;
+    heartbeats(MGMT_JSON, &jsonBytes, &jsonEnc, &jsonDec);
+    heartbeats(MGMT_MSGPACK, &packBytes, &packEnc, &packDec);
+    commands(MGMT_JSON, &jsonCmdBytes, &jsonCmdUs);
+    commands(MGMT_MSGPACK, &packCmdBytes, &packCmdUs);
+
+    printf("[Mgmt] heartbeats/hour: JSON %zu bytes (%.1f us enc, %.1f us dec), "
+           "MessagePack %zu bytes (%.2f us enc, %.2f us dec)\n",
+           jsonBytes, jsonEnc, jsonDec, packBytes, packEnc, packDec);
+    printf("[Mgmt] command + ack: JSON %zu bytes (%.1f us), MessagePack %zu bytes (%.2f us)\n",
+           jsonCmdBytes, jsonCmdUs, packCmdBytes, packCmdUs);
+
+    EXPECT_LT(packBytes * 5, jsonBytes);
+    EXPECT_LT(packCmdBytes * 2, jsonCmdBytes);
+    EXPECT_LT(packEnc, jsonEnc);
+    EXPECT_LT(packDec, jsonDec);
+    RecordProperty("json_bytes_per_hour", (int)jsonBytes);
+    RecordProperty("msgpack_bytes_per_hour", (int)packBytes);
+}
@@ -0,0 +1,213 @@
+#include <gtest/gtest.h>
+#include "msgpack.h"
+
+#include <string>
+#include <vector>
+
+// ========== Helpers ==========
+
+static std::vector<uint8_t> bytes(std::initializer_list<int> b) {
+    std::vector<uint8_t> v;
+    for (int x : b) v.push_back((uint8_t)x);
+    return v;
+}
+
+static std::vector<uint8_t> written(const MsgPackWriter& w, const uint8_t* buf) {
+    return std::vector<uint8_t>(buf, buf + w.length());
+}
+
+// ========== Writer ==========
+
+TEST(MsgPackWriter, UintUsesSmallestForm) {
+    uint8_t buf[32];
+    MsgPackWriter w(buf, sizeof(buf));
+    w.writeUint(0);
+    w.writeUint(127);
+    w.writeUint(128);
+    w.writeUint(65535);
+    w.writeUint(65536);
+    EXPECT_EQ(written(w, buf), bytes({0x00, 0x7f, 0xcc, 0x80, 0xcd, 0xff, 0xff,
+                                      0xce, 0x00, 0x01, 0x00, 0x00}));
+}
+
+TEST(MsgPackWriter, IntUsesSmallestForm) {
+    uint8_t buf[32];
+    MsgPackWriter w(buf, sizeof(buf));
+    w.writeInt(5);
+    w.writeInt(-1);
+    w.writeInt(-32);
+    w.writeInt(-33);
+    w.writeInt(-200);
+    w.writeInt(-70000);
+    EXPECT_EQ(written(w, buf), bytes({0x05, 0xff, 0xe0, 0xd0, 0xdf, 0xd1, 0xff, 0x38,
+                                      0xd2, 0xff, 0xfe, 0xee, 0x90}));
+}
+
+TEST(MsgPackWriter, Strings) {
+    uint8_t buf[64];
+    MsgPackWriter w(buf, sizeof(buf));
+    w.writeStr("abc");
+    std::string s32(32, 'x');
+    w.writeStr(s32.c_str());
+    EXPECT_EQ(buf[0], 0xa3);
+    EXPECT_EQ(buf[4], 0xd9);
+    EXPECT_EQ(buf[5], 32);
+    EXPECT_EQ(w.length(), 4u + 2 + 32);
+}
+
+TEST(MsgPackWriter, NilAndBool) {
+    uint8_t buf[8];
+    MsgPackWriter w(buf, sizeof(buf));
+    w.writeNil();
+    w.writeBool(false);
+    w.writeBool(true);
+    EXPECT_EQ(written(w, buf), bytes({0xc0, 0xc2, 0xc3}));
+}
+
+TEST(MsgPackWriter, SmallMapKeepsOneByteHeader) {
+    uint8_t buf[16];
+    MsgPackWriter w(buf, sizeof(buf));
+    size_t map = w.beginMap();
+    w.writeUint(1);
+    w.writeUint(2);
+    w.endMap(map, 1);
+    EXPECT_EQ(written(w, buf), bytes({0x81, 0x01, 0x02}));
+}
+
+TEST(MsgPackWriter, LargeMapGetsMap16Header) {
+    uint8_t buf[64];
+    MsgPackWriter w(buf, sizeof(buf));
+    size_t map = w.beginMap();
+    for (int i = 0; i < 16; i++) {
+        w.writeUint(i);
+        w.writeUint(i);
+    }
+    w.endMap(map, 16);
+    ASSERT_FALSE(w.overflowed());
+    EXPECT_EQ(w.length(), 3u + 32);
+    EXPECT_EQ(buf[0], 0xde);
+    EXPECT_EQ(buf[1], 0x00);
+    EXPECT_EQ(buf[2], 16);
+    EXPECT_EQ(buf[3], 0);
+    EXPECT_EQ(buf[34], 15);
+}
+
+TEST(MsgPackWriter, LargeMapWithoutRoomForHeaderOverflows) {
+    uint8_t buf[33];
+    MsgPackWriter w(buf, sizeof(buf));
+    size_t map = w.beginMap();
+    for (int i = 0; i < 16; i++) {
+        w.writeUint(i);
+        w.writeUint(i);
+    }
+    w.endMap(map, 16);
+    EXPECT_TRUE(w.overflowed());
+}
+
+TEST(MsgPackWriter, OverflowIsSticky) {
+    uint8_t buf[4];
+    MsgPackWriter w(buf, sizeof(buf));
+    w.writeStr("abcdef");
+    EXPECT_TRUE(w.overflowed());
+    w.writeUint(1); // would fit, but the message is already lost
+    EXPECT_EQ(w.length(), 0u);
+}
+
+// ========== Reader ==========
+
+TEST(MsgPackReader, RoundTrip) {
+    uint8_t buf[128];
+    MsgPackWriter w(buf, sizeof(buf));
+    size_t map = w.beginMap();
+    w.writeUint(1); w.writeUint(4000000000u);
+    w.writeUint(2); w.writeInt(-70000);
+    w.writeUint(3); w.writeStr("Yo La Tengo");
+    w.writeUint(4); w.writeNil();
+    w.writeUint(5); w.writeBool(true);
+    w.endMap(map, 5);
+
+    MsgPackReader r(buf, w.length());
+    size_t n;
+    uint32_t k, u;
+    int32_t i;
+    const char* s;
+    size_t len;
+    bool b;
+    ASSERT_TRUE(r.readMapHeader(&n));
+    EXPECT_EQ(n, 5u);
+    ASSERT_TRUE(r.readUint(&k) && r.readUint(&u));
+    EXPECT_EQ(u, 4000000000u);
+    ASSERT_TRUE(r.readUint(&k) && r.readInt(&i));
+    EXPECT_EQ(i, -70000);
+    ASSERT_TRUE(r.readUint(&k) && r.readStr(&s, &len));
+    EXPECT_EQ(std::string(s, len), "Yo La Tengo");
+    ASSERT_TRUE(r.readUint(&k));
+    EXPECT_TRUE(r.isNil());
+    EXPECT_TRUE(r.readNil());
+    ASSERT_TRUE(r.readUint(&k) && r.readBool(&b));
+    EXPECT_TRUE(b);
+    EXPECT_TRUE(r.atEnd());
+    EXPECT_FALSE(r.failed());
+}
+
+TEST(MsgPackReader, WrongTypeFails) {
+    auto data = bytes({0xa1, 'x', 0x01});
+    MsgPackReader r(data.data(), data.size());
+    uint32_t v;
+    EXPECT_FALSE(r.readUint(&v));
+    EXPECT_TRUE(r.failed());
+    EXPECT_FALSE(r.skip()); // sticky
+}
+
+TEST(MsgPackReader, NegativeIsNotUint) {
+    auto data = bytes({0xff});
+    MsgPackReader r(data.data(), data.size());
+    uint32_t v;
+    EXPECT_FALSE(r.readUint(&v));
+}
+
+TEST(MsgPackReader, Uint64ThatFitsIsAccepted) {
+    auto data = bytes({0xcf, 0, 0, 0, 0, 0, 0, 0x01, 0x00, 0xcf, 0, 0, 0, 1, 0, 0, 0, 0});
+    MsgPackReader r(data.data(), data.size());
+    uint32_t v;
+    EXPECT_TRUE(r.readUint(&v));
+    EXPECT_EQ(v, 256u);
+    EXPECT_FALSE(r.readUint(&v));
+}
+
+TEST(MsgPackReader, TruncatedStringFails) {
+    auto data = bytes({0xa5, 'a', 'b'});
+    MsgPackReader r(data.data(), data.size());
+    const char* s;
+    size_t len;
+    EXPECT_FALSE(r.readStr(&s, &len));
+}
+
+TEST(MsgPackReader, SkipsEveryType) {
+    auto data = bytes({
+        0x82,                                // map of 2
+        0xa1, 'k', 0x92, 0xcb, 0, 0, 0, 0, 0, 0, 0, 0, 0xc4, 2, 'x', 'y', // "k": [1.0?, bin]
+        0xd4, 1, 2,                          // fixext1 as key
+        0xc7, 2, 9, 'a', 'b',                // ext8
+        0x2a                                 // trailing value
+    });
+    MsgPackReader r(data.data(), data.size());
+    ASSERT_TRUE(r.skip());
+    uint32_t v;
+    ASSERT_TRUE(r.readUint(&v));
+    EXPECT_EQ(v, 42u);
+    EXPECT_TRUE(r.atEnd());
+}
+
+TEST(MsgPackReader, SkipLimitsNesting) {
+    std::vector<uint8_t> data(MSGPACK_MAX_DEPTH + 2, 0x91);
+    data.push_back(0x01);
+    MsgPackReader r(data.data(), data.size());
+    EXPECT_FALSE(r.skip());
+}
+
+TEST(MsgPackReader, HugeCountsFailWithoutReadingPastEnd) {
+    auto data = bytes({0xdd, 0xff, 0xff, 0xff, 0xff});
+    MsgPackReader r(data.data(), data.size());
+    EXPECT_FALSE(r.skip());
+}
@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+#include "azuracast_client.h"
+#include "emulation.h"
+#include "loopback_transport.h"
+#include "log_buffer.h"
+#include "mem_stats.h"
+
+#include <string>
+#include <vector>
+
+// ========== Helpers ==========
+
+struct Delivery {
+    std::string shortcode;
+    NowPlayingTrack track;
+};
+
+class RecordingConsumer : public NowPlayingConsumer {
+public:
+    std::vector<Delivery> deliveries;
+    void onTrackChange(const char* shortcode, const NowPlayingTrack& track) override {
+        deliveries.push_back(Delivery{shortcode, track});
+    }
+};
+
+// One element of the all-stations array, padded like the real one (~10KB)
+static std::string station(const std::string& shortcode, int shId, const std::string& title,
+                           bool live = false) {
+    std::string history;
+    for (int i = 1; i <= 15; i++) {
+        if (i > 1) history += ",";
+        history += "{\"sh_id\":" + std::to_string(shId - i) + ",\"song\":{\"artist\":\"History "
+                 "Artist\",\"title\":\"History Title " + std::to_string(i) + "\",\"art\":"
+                 "\"https://remote.wxyc.org/api/station/" + shortcode + "/art/" +
+                 std::to_string(i) + "-1700000000.jpg\",\"lyrics\":\"" +
+                 std::string(400, 'x') + "\"}}";
+    }
+    return "{\"station\":{\"id\":1,\"name\":\"" + shortcode + "\",\"shortcode\":\"" + shortcode +
+           "\"},\"live\":{\"is_live\":" + (live ? "true" : "false") +
+           "},\"now_playing\":{\"sh_id\":" + std::to_string(shId) +
+           ",\"song\":{\"artist\":\"Artist " + shortcode + "\",\"title\":\"" + title +
+           "\",\"album\":\"Album\"}},\"song_history\":[" + history + "]}";
+}
+
+static std::string response(const std::string& body) {
+    return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+           "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+class NowPlayingFanoutTest : public ::testing::Test {
+protected:
+    MemoryTransport transport;
+    NetworkManager network{LINK_FAILURE_THRESHOLD, LINK_COOLDOWN_MS, LINK_PREFERENCE_MS};
+    NowPlayingFanout fanout{network, AZURACAST_HOST, AZURACAST_PORT, AZURACAST_ALL_PATH};
+
+    void SetUp() override {
+        network.addTransport(transport);
+        network.setUp();
+    }
+    void TearDown() override { drainSerialLog(); }
+
+    int pollWith(const std::string& body) {
+        transport.client.load(response(body));
+        return fanout.poll();
+    }
+};
+
+// ========== Dispatch ==========
+
+TEST_F(NowPlayingFanoutTest, DispatchesByShortcode) {
+    RecordingConsumer hd2, hd3;
+    ASSERT_TRUE(fanout.subscribe("hd2", hd2));
+    ASSERT_TRUE(fanout.subscribe("hd3", hd3));
+
+    EXPECT_EQ(pollWith("[" + station("main", 10, "M") + "," + station("hd2", 20, "Two", true) +
+                       ",\n " + station("hd3", 30, "Three") + "]"), 2);
+    EXPECT_EQ(fanout.stationCount(), 3);
+    ASSERT_EQ(hd2.deliveries.size(), 1u);
+    EXPECT_EQ(hd2.deliveries[0].shortcode, "hd2");
+    EXPECT_EQ(hd2.deliveries[0].track.shId, 20);
+    EXPECT_STREQ(hd2.deliveries[0].track.title.c_str(), "Two");
+    EXPECT_STREQ(hd2.deliveries[0].track.artist.c_str(), "Artist hd2");
+    EXPECT_TRUE(hd2.deliveries[0].track.liveDJ);
+    ASSERT_EQ(hd3.deliveries.size(), 1u);
+    EXPECT_EQ(hd3.deliveries[0].track.shId, 30);
+    EXPECT_FALSE(hd3.deliveries[0].track.liveDJ);
+}
+
+TEST_F(NowPlayingFanoutTest, OnlyChangesAreDelivered) {
+    RecordingConsumer hd2, hd3;
+    fanout.subscribe("hd2", hd2);
+    fanout.subscribe("hd3", hd3);
+
+    pollWith("[" + station("hd2", 20, "Two") + "," + station("hd3", 30, "Three") + "]");
+    EXPECT_EQ(pollWith("[" + station("hd2", 21, "Two again") + "," + station("hd3", 30, "Three") +
+                       "]"), 1);
+    ASSERT_EQ(hd2.deliveries.size(), 2u);
+    EXPECT_EQ(hd2.deliveries[1].track.shId, 21);
+    EXPECT_EQ(hd3.deliveries.size(), 1u);
+}
+
+TEST_F(NowPlayingFanoutTest, ConsumersOfOneStationAreIndependent) {
+    RecordingConsumer first, second;
+    fanout.subscribe("hd2", first);
+    EXPECT_EQ(pollWith("[" + station("hd2", 20, "Two") + "]"), 1);
+
+    // A late subscriber still hears the current track
+    fanout.subscribe("hd2", second);
+    EXPECT_EQ(pollWith("[" + station("hd2", 20, "Two") + "]"), 1);
+    EXPECT_EQ(first.deliveries.size(), 1u);
+    EXPECT_EQ(second.deliveries.size(), 1u);
+}
+
+TEST_F(NowPlayingFanoutTest, SubscriptionsAreBounded) {
+    RecordingConsumer consumer;
+    for (int i = 0; i < NOWPLAYING_FANOUT_MAX; i++) EXPECT_TRUE(fanout.subscribe("s", consumer));
+    EXPECT_FALSE(fanout.subscribe("s", consumer));
+}
+
+TEST_F(NowPlayingFanoutTest, EmptyAndMalformedDocuments) {
+    RecordingConsumer hd2;
+    fanout.subscribe("hd2", hd2);
+
+    EXPECT_EQ(pollWith(" [ ] "), 0);
+    EXPECT_EQ(fanout.stationCount(), 0);
+    EXPECT_EQ(pollWith(station("hd2", 20, "Two")), -1);                    // not an array
+    EXPECT_EQ(pollWith("[" + station("hd2", 20, "Two") + " x"), -1);        // bad separator
+    EXPECT_EQ(pollWith("[" + station("hd2", 21, "Two") + "," + "{\"sta"), -1); // truncated
+    // Changes before the fault were still delivered
+    ASSERT_EQ(hd2.deliveries.size(), 2u);
+    EXPECT_EQ(hd2.deliveries[1].track.shId, 21);
+}
+
+TEST_F(NowPlayingFanoutTest, HttpErrorDeliversNothing) {
+    RecordingConsumer hd2;
+    fanout.subscribe("hd2", hd2);
+    transport.client.load("HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n");
+    EXPECT_EQ(fanout.poll(), -1);
+    EXPECT_TRUE(hd2.deliveries.empty());
+}
+
+// The document is walked one element at a time, so the heap used by a poll
+// does not grow with the number of stations in it.
+TEST_F(NowPlayingFanoutTest, MemoryDoesNotGrowWithStations) {
+    RecordingConsumer consumer;
+    fanout.subscribe("s1", consumer);
+    emu::reset(); // counts this thread's allocations
+
+    auto peakFor = [&](int stations) {
+        std::string body = "[";
+        for (int i = 0; i < stations; i++) {
+            if (i > 0) body += ",";
+            body += station("s" + std::to_string(i), 100 + i, "Title");
+        }
+        body += "]";
+        transport.client.load(response(body));
+        memStats = MemStats();
+        EXPECT_GE(fanout.poll(), 0);
+        return memStats.module(MEM_AZURACAST).peak;
+    };
+
+    unsigned long few = peakFor(2);
+    unsigned long many = peakFor(40);
+    printf("[Fanout] heap peak per poll: %lu bytes for 2 stations, %lu for 40\n", few, many);
+    EXPECT_EQ(fanout.stationCount(), 40);
+    EXPECT_LT(many, few * 2);
+}
+
+// ========== AzuraCastClient ==========
+
+TEST_F(NowPlayingFanoutTest, FollowingClientPollsWithoutFetching) {
+    AzuraCastClient hd2(network, AZURACAST_HOST, AZURACAST_PORT, "/unused");
+    ASSERT_TRUE(hd2.follow(fanout, "hd2"));
+
+    EXPECT_FALSE(hd2.poll()); // nothing delivered yet
+    pollWith("[" + station("main", 10, "M") + "," + station("hd2", 20, "Two", true) + "]");
+    transport.client.load(""); // a fetch by the client would now fail
+    EXPECT_TRUE(hd2.poll());
+    EXPECT_EQ(hd2.getShId(), 20);
+    EXPECT_STREQ(hd2.getTitle().c_str(), "Two");
+    EXPECT_TRUE(hd2.isLiveDJ());
+    EXPECT_FALSE(hd2.poll()); // taken once
+    EXPECT_EQ(hd2.stats().polls, 3u);
+    EXPECT_EQ(hd2.stats().unchanged, 2u);
+    EXPECT_EQ(hd2.stats().failed, 0u);
+}
+
+TEST_F(NowPlayingFanoutTest, PollStatsCountOutcomes) {
+    AzuraCastClient main(network, AZURACAST_HOST, AZURACAST_PORT, AZURACAST_PATH);
+
+    transport.client.load(response(station("main", 10, "M")));
+    EXPECT_TRUE(main.poll());
+    transport.client.load(response(station("main", 10, "M")));
+    EXPECT_FALSE(main.poll());
+    transport.client.load("");
+    EXPECT_FALSE(main.poll());
+    main.warm(); // not a poll
+
+    EXPECT_EQ(main.stats().polls, 3u);
+    EXPECT_EQ(main.stats().unchanged, 1u);
+    EXPECT_EQ(main.stats().failed, 1u);
+}
+
+TEST_F(NowPlayingFanoutTest, FollowingClientKeepsRestoredTrack) {
+    AzuraCastClient hd2(network, AZURACAST_HOST, AZURACAST_PORT, "/unused");
+    hd2.follow(fanout, "hd2");
+    hd2.restoreShId(20);
+
+    // The fan-out's first delivery is the track already posted before a reset
+    pollWith("[" + station("hd2", 20, "Two") + "]");
+    EXPECT_FALSE(hd2.poll());
+    pollWith("[" + station("hd2", 21, "Next") + "]");
+    EXPECT_TRUE(hd2.poll());
+    EXPECT_EQ(hd2.getShId(), 21);
+}
+
+TEST_F(NowPlayingFanoutTest, TrackSlotLooksUpBySongId) {
+    AzuraCastClient hd2(network, AZURACAST_HOST, AZURACAST_PORT, "/unused");
+    hd2.follow(fanout, "hd2");
+
+    pollWith("[" + station("hd2", 20, "Two") + "]");
+    ASSERT_TRUE(hd2.poll());
+    const NowPlayingTrack* track = hd2.track(20);
+    ASSERT_NE(track, nullptr);
+    EXPECT_STREQ(track->title.c_str(), "Two");
+    EXPECT_EQ(track, hd2.track(20)); // the client's own slot, not a copy
+
+    // A newer track takes the slot; the old id no longer resolves
+    pollWith("[" + station("hd2", 21, "Next") + "]");
+    ASSERT_TRUE(hd2.poll());
+    EXPECT_EQ(hd2.track(20), nullptr);
+    EXPECT_EQ(hd2.track(0), nullptr);
+    EXPECT_STREQ(hd2.track(21)->title.c_str(), "Next");
+}
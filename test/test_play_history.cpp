@@ -0,0 +1,244 @@
+#include <gtest/gtest.h>
+#include "play_history.h"
+
+#include <string>
+#include <vector>
+
+#define BASE_EPOCH 1705345200UL // 2024-01-15 19:00 UTC, on the hour
+#define HOUR 3600UL
+
+// ========== Helpers ==========
+
+class PlayHistoryTest : public ::testing::Test {
+protected:
+    std::vector<uint8_t> recordStorage = std::vector<uint8_t>(PLAY_RECORD_SIZE * 4096);
+    std::vector<uint8_t> indexStorage = std::vector<uint8_t>(PLAY_INDEX_ENTRY_SIZE * 4096);
+    MemoryHistoryFile records{recordStorage.data(), recordStorage.size()};
+    MemoryHistoryFile index{indexStorage.data(), indexStorage.size()};
+    PlayHistory history;
+
+    void SetUp() override { ASSERT_TRUE(history.begin(records, index)); }
+
+    void play(uint32_t epoch, int shId, PlayStatus status = PLAY_POSTED) {
+        std::string artist = "Artist " + std::to_string(shId);
+        std::string title = "Title " + std::to_string(shId);
+        history.record(epoch, shId, 42, status, artist.c_str(), title.c_str(), "Album");
+    }
+
+    /** Reopens the files, as after a reset. */
+    void reopen() {
+        history = PlayHistory();
+        ASSERT_TRUE(history.begin(records, index));
+    }
+};
+
+// ========== Records ==========
+
+TEST_F(PlayHistoryTest, RecordsReadBack) {
+    history.record(BASE_EPOCH, 7, 42, PLAY_REJECTED, "Stereolab", "Metronomic Underground",
+                   "Emperor Tomato Ketchup");
+    ASSERT_TRUE(history.flush());
+    reopen();
+
+    ASSERT_EQ(history.count(), 1u);
+    PlayRecord record;
+    ASSERT_TRUE(history.read(0, &record));
+    EXPECT_EQ(record.epoch, BASE_EPOCH);
+    EXPECT_EQ(record.shId, 7);
+    EXPECT_EQ(record.radioShowID, 42);
+    EXPECT_EQ(record.status, PLAY_REJECTED);
+    EXPECT_STREQ(record.artist, "Stereolab");
+    EXPECT_STREQ(record.title, "Metronomic Underground");
+    EXPECT_STREQ(record.album, "Emperor Tomato Ketchup");
+    EXPECT_FALSE(history.read(1, &record));
+}
+
+TEST_F(PlayHistoryTest, LongFieldsCutOnCharacterBoundary) {
+    // 31 ASCII bytes, then a two-byte character straddling the limit
+    std::string artist = std::string(31, 'a') + "\xC3\xA9" + "tc";
+    std::string title(100, 't');
+    history.record(BASE_EPOCH, 1, 42, PLAY_POSTED, artist.c_str(), title.c_str(), "");
+
+    PlayRecord record;
+    ASSERT_TRUE(history.read(0, &record));
+    EXPECT_EQ(std::string(record.artist), std::string(31, 'a'));
+    EXPECT_EQ(std::string(record.title), std::string(PLAY_FIELD_MAX, 't'));
+    EXPECT_STREQ(record.album, "");
+}
+
+TEST_F(PlayHistoryTest, KeepsTimeOrder) {
+    play(BASE_EPOCH + 100, 1);
+    play(BASE_EPOCH + 50, 2); // the clock stepped back
+    play(0, 3);               // time unknown
+
+    PlayRecord record;
+    ASSERT_TRUE(history.read(1, &record));
+    EXPECT_EQ(record.epoch, BASE_EPOCH + 100);
+    ASSERT_TRUE(history.read(2, &record));
+    EXPECT_EQ(record.epoch, BASE_EPOCH + 100);
+}
+
+TEST_F(PlayHistoryTest, StatusNames) {
+    EXPECT_STREQ(playStatusName(PLAY_POSTED), "posted");
+    EXPECT_STREQ(playStatusName(PLAY_REJECTED), "rejected");
+    EXPECT_STREQ(playStatusName(PLAY_UNANSWERED), "unanswered");
+    EXPECT_STREQ(playStatusName(PLAY_DROPPED), "dropped");
+}
+
+// ========== Batching ==========
+
+TEST_F(PlayHistoryTest, WritesFullBatchAtOnce) {
+    for (int i = 0; i < PLAY_HISTORY_BATCH - 1; i++) {
+        play(BASE_EPOCH + i, i);
+        EXPECT_TRUE(history.update(1000));
+    }
+    EXPECT_EQ(records.writeCount(), 0u);
+    EXPECT_EQ(records.size(), 0u);
+
+    play(BASE_EPOCH + 10, 10);
+    EXPECT_TRUE(history.update(1000));
+    EXPECT_EQ(records.writeCount(), 1u);
+    EXPECT_EQ(records.size(), (uint32_t)(PLAY_HISTORY_BATCH * PLAY_RECORD_SIZE));
+    EXPECT_EQ(history.pending(), 0u);
+    EXPECT_EQ(history.batchCount(), 1u);
+}
+
+TEST_F(PlayHistoryTest, WritesPartialBatchAfterDelay) {
+    play(BASE_EPOCH, 1);
+    history.update(1000);
+    history.update(1000 + PLAY_HISTORY_FLUSH_MS - 1);
+    EXPECT_EQ(records.writeCount(), 0u);
+
+    history.update(1000 + PLAY_HISTORY_FLUSH_MS);
+    EXPECT_EQ(records.writeCount(), 1u);
+    EXPECT_EQ(history.pending(), 0u);
+}
+
+TEST_F(PlayHistoryTest, WritesItselfWhenNothingDrains) {
+    for (int i = 0; i < PLAY_HISTORY_PENDING + 1; i++) play(BASE_EPOCH + i, i);
+    EXPECT_EQ(records.writeCount(), 1u);
+    EXPECT_EQ(history.pending(), 1u);
+    EXPECT_EQ(history.count(), (uint32_t)(PLAY_HISTORY_PENDING + 1));
+}
+
+TEST_F(PlayHistoryTest, UnwrittenRecordsAreReadable) {
+    play(BASE_EPOCH, 1);
+    PlayRecord record;
+    ASSERT_TRUE(history.read(0, &record));
+    EXPECT_EQ(record.shId, 1);
+}
+
+// ========== Lookup ==========
+
+TEST_F(PlayHistoryTest, FindsPlaysBetweenTimes) {
+    // Three days at one play per 7 minutes, with a quiet afternoon
+    std::vector<uint32_t> epochs;
+    for (uint32_t t = BASE_EPOCH; t < BASE_EPOCH + 72 * HOUR; t += 420) {
+        if (t >= BASE_EPOCH + 30 * HOUR && t < BASE_EPOCH + 35 * HOUR) continue;
+        epochs.push_back(t);
+        play(t, (int)epochs.size());
+        history.update(0);
+    }
+    ASSERT_TRUE(history.flush());
+
+    auto expected = [&](uint32_t from, uint32_t to) {
+        uint32_t first = 0, end = 0;
+        while (first < epochs.size() && epochs[first] < from) first++;
+        end = first;
+        while (end < epochs.size() && epochs[end] < to) end++;
+        return std::make_pair(first, end);
+    };
+    const std::pair<uint32_t, uint32_t> ranges[] = {
+        {BASE_EPOCH - HOUR, BASE_EPOCH},                     // before any
+        {BASE_EPOCH, BASE_EPOCH + HOUR},                     // the first hour
+        {BASE_EPOCH + 10 * HOUR + 1000, BASE_EPOCH + 12 * HOUR + 59},
+        {BASE_EPOCH + 31 * HOUR, BASE_EPOCH + 34 * HOUR},    // the quiet spell
+        {BASE_EPOCH + 29 * HOUR + 1800, BASE_EPOCH + 36 * HOUR},
+        {BASE_EPOCH + 70 * HOUR, BASE_EPOCH + 100 * HOUR},   // past the end
+        {BASE_EPOCH + 420, BASE_EPOCH + 421},                // exactly one
+    };
+    for (const auto& range : ranges) {
+        uint32_t first, end;
+        ASSERT_TRUE(history.find(range.first, range.second, &first, &end));
+        auto want = expected(range.first, range.second);
+        EXPECT_EQ(first, want.first) << range.first - BASE_EPOCH;
+        EXPECT_EQ(end, want.second) << range.first - BASE_EPOCH;
+    }
+}
+
+TEST_F(PlayHistoryTest, LookupReadsAreLogarithmic) {
+    for (uint32_t i = 0; i < 2000; i++) play(BASE_EPOCH + i * 300, (int)i);
+    ASSERT_TRUE(history.flush());
+
+    unsigned long before = records.readCount() + index.readCount();
+    uint32_t first, end;
+    ASSERT_TRUE(history.find(BASE_EPOCH + 1000 * 300, BASE_EPOCH + 1010 * 300, &first, &end));
+    EXPECT_EQ(first, 1000u);
+    EXPECT_EQ(end, 1010u);
+    // Two searches of ~170 index entries and of one hour's 12 records each
+    EXPECT_LE(records.readCount() + index.readCount() - before, 2u * (9 + 2 + 4));
+}
+
+TEST_F(PlayHistoryTest, LookupIncludesUnwrittenPlays) {
+    play(BASE_EPOCH, 1);
+    uint32_t first, end;
+    ASSERT_TRUE(history.find(BASE_EPOCH, BASE_EPOCH + 1, &first, &end));
+    EXPECT_EQ(first, 0u);
+    EXPECT_EQ(end, 1u);
+}
+
+// ========== Recovery ==========
+
+TEST_F(PlayHistoryTest, DropsTornRecordAndOverwritesIt) {
+    for (int i = 0; i < 4; i++) play(BASE_EPOCH + i, i);
+    ASSERT_TRUE(history.flush());
+    // A reset in the middle of the last record's write
+    records.truncate(3 * PLAY_RECORD_SIZE + 50);
+    reopen();
+    EXPECT_EQ(history.count(), 3u);
+
+    play(BASE_EPOCH + 10, 10);
+    ASSERT_TRUE(history.flush());
+    reopen();
+    ASSERT_EQ(history.count(), 4u);
+    PlayRecord record;
+    ASSERT_TRUE(history.read(3, &record));
+    EXPECT_EQ(record.shId, 10);
+}
+
+TEST_F(PlayHistoryTest, DropsCorruptLastRecord) {
+    for (int i = 0; i < 2; i++) play(BASE_EPOCH + i, i);
+    ASSERT_TRUE(history.flush());
+    recordStorage[PLAY_RECORD_SIZE + 30] ^= 0xFF;
+    reopen();
+    EXPECT_EQ(history.count(), 1u);
+}
+
+TEST_F(PlayHistoryTest, RebuildsLostIndexEntries) {
+    for (uint32_t i = 0; i < 40; i++) play(BASE_EPOCH + i * 600, (int)i); // ~7 hours
+    ASSERT_TRUE(history.flush());
+    // The index writes after the first two hours never made it
+    index.truncate(2 * PLAY_INDEX_ENTRY_SIZE);
+    reopen();
+    EXPECT_EQ(index.size(), 7u * PLAY_INDEX_ENTRY_SIZE);
+
+    uint32_t first, end;
+    ASSERT_TRUE(history.find(BASE_EPOCH + 5 * HOUR, BASE_EPOCH + 6 * HOUR, &first, &end));
+    EXPECT_EQ(first, 30u);
+    EXPECT_EQ(end, 36u);
+}
+
+TEST_F(PlayHistoryTest, DropsIndexEntriesPastLastRecord) {
+    for (uint32_t i = 0; i < 8; i++) play(BASE_EPOCH + i * HOUR, (int)i);
+    ASSERT_TRUE(history.flush());
+    records.truncate(5 * PLAY_RECORD_SIZE);
+    reopen();
+    EXPECT_EQ(history.count(), 5u);
+
+    play(BASE_EPOCH + 20 * HOUR, 20);
+    ASSERT_TRUE(history.flush());
+    uint32_t first, end;
+    ASSERT_TRUE(history.find(BASE_EPOCH + 6 * HOUR, BASE_EPOCH + 21 * HOUR, &first, &end));
+    EXPECT_EQ(first, 5u);
+    EXPECT_EQ(end, 6u);
+}
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include "request_template.h"
+#include "utils.h"
+
+#include <string>
+
+static constexpr auto ENCODED = urlEncodeLiteral("Auto DJ & co/1~");
+static_assert(ENCODED.len == 19, "encoded at compile time");
+
+TEST(UrlEncodeLiteral, MatchesUrlEncode) {
+    EXPECT_EQ(String(ENCODED.str), urlEncode("Auto DJ & co/1~"));
+    EXPECT_EQ(ENCODED.len, strlen(ENCODED.str));
+}
+
+TEST(UrlEncodeLiteral, HighBytesUseLowercaseHex) {
+    constexpr auto encoded = urlEncodeLiteral("\xC3\xA9");
+    EXPECT_STREQ(encoded.str, "%c3%a9");
+}
+
+TEST(UrlEncodeLiteral, Empty) {
+    constexpr auto encoded = urlEncodeLiteral("");
+    EXPECT_EQ(encoded.len, 0u);
+    EXPECT_STREQ(encoded.str, "");
+}
+
+TEST(FormRequest, AppendEncodedMatchesUrlEncode) {
+    const char* raw = "AC/DC - Highway to Hell (Live) 100% \xE2\x98\x85";
+    char storage[256];
+    FormRequest form(storage, sizeof(storage), 0);
+    form.appendEncoded(raw);
+    EXPECT_EQ(std::string(storage, form.bodyLength()), urlEncode(raw).c_str());
+}
+
+TEST(FormRequest, AppendEncodedClipsOnCharacterBoundary) {
+    char storage[64];
+    FormRequest form(storage, sizeof(storage), 0);
+    form.appendEncoded("a \xC3\xA9\xE2\x98\x85", 10); // a + %c3%a9 fit, %e2%98%85 does not
+    EXPECT_EQ(std::string(form.body(), form.bodyLength()), "a+%c3%a9");
+
+    FormRequest exact(storage, sizeof(storage), 0);
+    exact.appendEncoded("ab", 2);
+    EXPECT_EQ(std::string(exact.body(), exact.bodyLength()), "ab");
+}
+
+TEST(FormRequest, JsonStringClipsOnCharacterBoundary) {
+    char storage[64];
+    FormRequest form(storage, sizeof(storage), 0);
+    form.appendJsonString("\"\xC3\xA9\xF0\x9F\x8E\xB5", 6); // \" + \xC3\xA9 fit, the emoji does not
+    EXPECT_EQ(std::string(form.body(), form.bodyLength()), "\"\\\"\xC3\xA9\"");
+    EXPECT_FALSE(form.overflowed());
+}
+
+TEST(FormRequest, FinishPlacesHeadersBeforeBody) {
+    char storage[256];
+    FormRequest form(storage, sizeof(storage), 100);
+    form.append("radioShowID=").appendNumber(42).append("&mode=signoffConfirm");
+
+    const char* data;
+    size_t length;
+    ASSERT_TRUE(form.finish("POST /end HTTP/1.1\r\n", "Host: x\r\nContent-Length: ",
+                            &data, &length));
+    EXPECT_EQ(std::string(data, length),
+              "POST /end HTTP/1.1\r\n"
+              "Host: x\r\n"
+              "Content-Length: 34\r\n"
+              "\r\n"
+              "radioShowID=42&mode=signoffConfirm");
+}
+
+TEST(FormRequest, Numbers) {
+    char storage[64];
+    FormRequest form(storage, sizeof(storage), 0);
+    form.appendNumber(0).append(",").appendNumber(-7L).append(",").appendNumber(3600000UL);
+    EXPECT_EQ(std::string(storage, form.bodyLength()), "0,-7,3600000");
+}
+
+TEST(FormRequest, JsonStringIsEscaped) {
+    char storage[128];
+    FormRequest form(storage, sizeof(storage), 0);
+    form.appendJsonString("say \"hi\"\\ \t\r\n\x01 \xC3\xB3");
+    EXPECT_EQ(std::string(storage, form.bodyLength()),
+              "\"say \\\"hi\\\"\\\\ \\t\\r\\n\\u0001 \xC3\xB3\"");
+}
+
+TEST(FormRequest, BodyOverflowFailsFinish) {
+    char storage[32];
+    FormRequest form(storage, sizeof(storage), 16);
+    form.append("0123456789").append("0123456789");
+    EXPECT_TRUE(form.overflowed());
+
+    const char* data;
+    size_t length;
+    EXPECT_FALSE(form.finish("L\r\n", "Content-Length: ", &data, &length));
+}
+
+TEST(FormRequest, HeaderOverflowFailsFinish) {
+    char storage[64];
+    FormRequest form(storage, sizeof(storage), 8);
+    form.append("a=b");
+
+    const char* data;
+    size_t length;
+    EXPECT_FALSE(form.finish("POST / HTTP/1.1\r\n", "Content-Length: ", &data, &length));
+    EXPECT_TRUE(form.overflowed());
+}
@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+#include "retry_policy.h"
+
+// ========== backoffDelayMs ==========
+
+TEST(Backoff, CeilingDoublesPerAttempt) {
+    // The largest random value gives the whole ceiling
+    EXPECT_EQ(backoffDelayMs(2000, 30000, 1, 1000), 2000UL);
+    EXPECT_EQ(backoffDelayMs(2000, 30000, 2, 2000), 4000UL);
+    EXPECT_EQ(backoffDelayMs(2000, 30000, 3, 4000), 8000UL);
+}
+
+TEST(Backoff, CeilingIsCapped) {
+    EXPECT_EQ(backoffDelayMs(2000, 30000, 5, 15000), 30000UL);
+    EXPECT_EQ(backoffDelayMs(2000, 30000, 40, 15000), 30000UL); // no overflow
+}
+
+TEST(Backoff, JitterStaysInUpperHalf) {
+    for (unsigned long r = 0; r < 5000; r += 7) {
+        unsigned long d = backoffDelayMs(2000, 30000, 2, r);
+        EXPECT_GE(d, 2000UL);
+        EXPECT_LE(d, 4000UL);
+    }
+    EXPECT_EQ(backoffDelayMs(2000, 30000, 2, 0), 2000UL);
+}
+
+TEST(Backoff, DifferentRandomValuesSpreadRetries) {
+    EXPECT_NE(backoffDelayMs(2000, 30000, 3, 12345), backoffDelayMs(2000, 30000, 3, 54321));
+}
+
+// ========== CircuitBreaker ==========
+
+TEST(CircuitBreaker, ClosedUntilThreshold) {
+    CircuitBreaker breaker(3, 60000);
+    EXPECT_TRUE(breaker.allow(0));
+    EXPECT_FALSE(breaker.record(false, 0));
+    EXPECT_FALSE(breaker.record(false, 0));
+    EXPECT_EQ(breaker.state(), CircuitBreaker::CLOSED);
+    EXPECT_TRUE(breaker.record(false, 1000));
+    EXPECT_EQ(breaker.state(), CircuitBreaker::OPEN);
+}
+
+TEST(CircuitBreaker, SuccessResetsFailureCount) {
+    CircuitBreaker breaker(3, 60000);
+    breaker.record(false, 0);
+    breaker.record(false, 0);
+    breaker.record(true, 0);
+    breaker.record(false, 0);
+    EXPECT_EQ(breaker.consecutiveFailures(), 1);
+    EXPECT_EQ(breaker.state(), CircuitBreaker::CLOSED);
+}
+
+TEST(CircuitBreaker, OpenRefusesUntilProbe) {
+    CircuitBreaker breaker(1, 60000);
+    breaker.record(false, 1000);
+    EXPECT_FALSE(breaker.allow(1000));
+    EXPECT_FALSE(breaker.allow(60999));
+    EXPECT_EQ(breaker.refusedCount(), 2u);
+
+    EXPECT_TRUE(breaker.allow(61000)); // the probe
+    EXPECT_EQ(breaker.state(), CircuitBreaker::HALF_OPEN);
+    EXPECT_FALSE(breaker.allow(61000)); // only one
+}
+
+TEST(CircuitBreaker, RefusingForCountsDownToProbe) {
+    CircuitBreaker breaker(1, 60000);
+    EXPECT_EQ(breaker.refusingForMs(0), 0u);
+    breaker.record(false, 1000);
+    EXPECT_EQ(breaker.refusingForMs(1000), 60000u);
+    EXPECT_EQ(breaker.refusingForMs(60999), 1u);
+    EXPECT_EQ(breaker.refusingForMs(61000), 0u);
+    ASSERT_TRUE(breaker.allow(61000));
+    EXPECT_EQ(breaker.refusingForMs(61000), 60000u); // the probe is out
+}
+
+TEST(CircuitBreaker, ProbeSuccessCloses) {
+    CircuitBreaker breaker(1, 60000);
+    breaker.record(false, 0);
+    ASSERT_TRUE(breaker.allow(60000));
+    EXPECT_TRUE(breaker.record(true, 60100));
+    EXPECT_EQ(breaker.state(), CircuitBreaker::CLOSED);
+    EXPECT_TRUE(breaker.allow(60100));
+}
+
+TEST(CircuitBreaker, ProbeFailureReopens) {
+    CircuitBreaker breaker(3, 60000);
+    for (int i = 0; i < 3; i++) breaker.record(false, 0);
+    ASSERT_TRUE(breaker.allow(60000));
+    EXPECT_TRUE(breaker.record(false, 60500)); // one failure is enough now
+    EXPECT_EQ(breaker.state(), CircuitBreaker::OPEN);
+    EXPECT_FALSE(breaker.allow(120000));
+    EXPECT_TRUE(breaker.allow(120500));
+}
+
+TEST(CircuitBreaker, UnreportedProbeIsReplaced) {
+    CircuitBreaker breaker(1, 60000);
+    breaker.record(false, 0);
+    ASSERT_TRUE(breaker.allow(60000));
+    EXPECT_FALSE(breaker.allow(100000));
+    EXPECT_TRUE(breaker.allow(120000));
+}
+
+TEST(CircuitBreaker, OpensAcrossMillisWrap) {
+    CircuitBreaker breaker(1, 60000);
+    breaker.record(false, (unsigned long)-1000);
+    EXPECT_FALSE(breaker.allow(1000));
+    EXPECT_TRUE(breaker.allow(59000));
+}
+
+// ========== RttEstimator ==========
+
+TEST(RttEstimator, InitialTimeoutUntilFirstSample) {
+    RttEstimator rtt(10000, 2000, 20000);
+    EXPECT_EQ(rtt.timeoutMs(), 10000UL);
+    EXPECT_EQ(rtt.sampleCount(), 0UL);
+}
+
+TEST(RttEstimator, FirstSampleFollowsRfc6298) {
+    RttEstimator rtt(10000, 100, 20000);
+    rtt.sample(400);
+    // SRTT = R, RTTVAR = R/2, RTO = SRTT + 4 * RTTVAR
+    EXPECT_EQ(rtt.smoothedMs(), 400UL);
+    EXPECT_EQ(rtt.deviationMs(), 200UL);
+    EXPECT_EQ(rtt.timeoutMs(), 1200UL);
+}
+
+TEST(RttEstimator, SteadyServerConvergesToFloor) {
+    RttEstimator rtt(10000, 2000, 20000);
+    for (int i = 0; i < 50; i++) rtt.sample(300);
+    EXPECT_EQ(rtt.smoothedMs(), 300UL);
+    EXPECT_EQ(rtt.timeoutMs(), 2000UL); // a dead server is noticed in 2 s, not 10
+}
+
+TEST(RttEstimator, ErraticServerGetsRoom) {
+    RttEstimator rtt(10000, 2000, 20000);
+    for (int i = 0; i < 50; i++) rtt.sample(i % 2 ? 500 : 3500);
+    // Mean 2000 ms with a 1500 ms deviation: well past any single answer
+    EXPECT_GT(rtt.timeoutMs(), 3500UL);
+    EXPECT_LE(rtt.timeoutMs(), 20000UL);
+}
+
+TEST(RttEstimator, SlowdownRaisesTimeoutWithinFewSamples) {
+    RttEstimator rtt(10000, 2000, 20000);
+    for (int i = 0; i < 20; i++) rtt.sample(300);
+    for (int i = 0; i < 3; i++) rtt.sample(4000);
+    EXPECT_GT(rtt.timeoutMs(), 4000UL);
+}
+
+TEST(RttEstimator, TimeoutDoublesUntilNextSample) {
+    RttEstimator rtt(10000, 2000, 20000);
+    for (int i = 0; i < 20; i++) rtt.sample(300);
+    ASSERT_EQ(rtt.timeoutMs(), 2000UL);
+    rtt.timedOut();
+    EXPECT_EQ(rtt.timeoutMs(), 4000UL);
+    rtt.timedOut();
+    EXPECT_EQ(rtt.timeoutMs(), 8000UL);
+    EXPECT_EQ(rtt.timeoutCount(), 2UL);
+
+    rtt.sample(300);
+    EXPECT_EQ(rtt.timeoutMs(), 2000UL);
+}
+
+TEST(RttEstimator, BackoffIsCapped) {
+    RttEstimator rtt(10000, 2000, 20000);
+    for (int i = 0; i < 40; i++) rtt.timedOut();
+    EXPECT_EQ(rtt.timeoutMs(), 20000UL);
+    EXPECT_EQ(rtt.timeoutCount(), 40UL);
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include "sha256.h"
+
+#include <string>
+
+// ========== Helpers ==========
+
+static std::string hex(const uint8_t digest[SHA256_DIGEST_SIZE]) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    for (int i = 0; i < SHA256_DIGEST_SIZE; i++) {
+        out += digits[digest[i] >> 4];
+        out += digits[digest[i] & 0xF];
+    }
+    return out;
+}
+
+static std::string sha256(const std::string& message) {
+    Sha256 hash;
+    hash.update(message.data(), message.size());
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    hash.finish(digest);
+    return hex(digest);
+}
+
+// ========== FIPS 180-4 test vectors ==========
+
+TEST(Sha256, EmptyMessage) {
+    EXPECT_EQ(sha256(""), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+}
+
+TEST(Sha256, OneBlock) {
+    EXPECT_EQ(sha256("abc"), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+}
+
+TEST(Sha256, TwoBlocks) {
+    EXPECT_EQ(sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+              "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+}
+
+TEST(Sha256, MillionAs) {
+    EXPECT_EQ(sha256(std::string(1000000, 'a')),
+              "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+// ========== Incremental ==========
+
+TEST(Sha256, PiecesMatchOneUpdate) {
+    std::string message;
+    for (int i = 0; i < 3000; i++) message += (char)(i * 7);
+    std::string whole = sha256(message);
+
+    // Pieces that straddle block boundaries every which way
+    const size_t sizes[] = {1, 63, 64, 65, 127, 1024};
+    for (size_t size : sizes) {
+        Sha256 hash;
+        for (size_t pos = 0; pos < message.size(); pos += size) {
+            size_t n = message.size() - pos < size ? message.size() - pos : size;
+            hash.update(message.data() + pos, n);
+        }
+        uint8_t digest[SHA256_DIGEST_SIZE];
+        hash.finish(digest);
+        EXPECT_EQ(hex(digest), whole) << "pieces of " << size;
+    }
+}
+
+TEST(Sha256, ResetStartsOver) {
+    Sha256 hash;
+    hash.update("garbage", 7);
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    hash.finish(digest);
+    hash.reset();
+    hash.update("abc", 3);
+    hash.finish(digest);
+    EXPECT_EQ(hex(digest), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+}
+
+// ========== Hex ==========
+
+TEST(Sha256, ParsesHexDigest) {
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    ASSERT_TRUE(sha256FromHex(
+        "BA7816BF8F01CFEA414140DE5DAE2223b00361a396177a9cb410ff61f20015ad", digest));
+    EXPECT_EQ(hex(digest), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+}
+
+TEST(Sha256, RejectsMalformedHex) {
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    EXPECT_FALSE(sha256FromHex("", digest));
+    EXPECT_FALSE(sha256FromHex("ba7816bf", digest));
+    EXPECT_FALSE(sha256FromHex(
+        "za7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", digest));
+    EXPECT_FALSE(sha256FromHex(
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad00", digest));
+}
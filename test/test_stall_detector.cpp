@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+#include <limits.h>
+#include <string.h>
+#include "stall_detector.h"
+
+static StallRecord blankRecord() {
+    StallRecord r;
+    memset(&r, 0xA5, sizeof(r)); // what RAM holds after power-up
+    return r;
+}
+
+// Runs a detector that leaves `op` in flight in `persistent`, as a hang would
+static void hangIn(StallRecord* persistent, StallOp op, unsigned long startedMs,
+                   unsigned long kickedMs) {
+    StallDetector before(30000);
+    StallReport ignored;
+    before.attach(persistent, false, &ignored);
+    before.begin(op, startedMs);
+    before.kicked(kickedMs);
+}
+
+// ========== In flight ==========
+
+TEST(StallDetector, BeginMarksOperationInFlight) {
+    StallDetector d(30000);
+    EXPECT_EQ(d.current(), STALL_NONE);
+    EXPECT_EQ(d.inFlightMs(5000), 0UL);
+
+    StallOp outer = d.begin(STALL_POLL, 1000);
+    EXPECT_EQ(outer, STALL_NONE);
+    EXPECT_EQ(d.current(), STALL_POLL);
+    EXPECT_EQ(d.inFlightMs(3500), 2500UL);
+
+    d.end(outer, 0, 4000);
+    EXPECT_EQ(d.current(), STALL_NONE);
+}
+
+TEST(StallDetector, NestedOperationRestoresOuter) {
+    StallDetector d(30000);
+    StallOp none = d.begin(STALL_END_SHOW, 1000);
+    StallOp outer = d.begin(STALL_ADD_ENTRY, 1500);
+    EXPECT_EQ(outer, STALL_END_SHOW);
+    EXPECT_EQ(d.current(), STALL_ADD_ENTRY);
+
+    d.end(outer, 1000, 2000);
+    EXPECT_EQ(d.current(), STALL_END_SHOW);
+    EXPECT_EQ(d.startedMs(), 1000UL);
+    EXPECT_EQ(d.inFlightMs(3000), 2000UL);
+
+    d.end(none, 0, 3000);
+    EXPECT_EQ(d.current(), STALL_NONE);
+}
+
+TEST(StallDetector, KeepsLongestRunPerOperation) {
+    StallDetector d(30000);
+    StallOp outer = d.begin(STALL_POLL, 1000);
+    d.end(outer, 0, 1800);
+    outer = d.begin(STALL_POLL, 2000);
+    d.end(outer, 0, 6000);
+    outer = d.begin(STALL_POLL, 7000);
+    d.end(outer, 0, 7100);
+    outer = d.begin(STALL_START_SHOW, 8000);
+    d.end(outer, 0, 8300);
+
+    EXPECT_EQ(d.longestMs(STALL_POLL), 4000UL);
+    EXPECT_EQ(d.longestMs(STALL_START_SHOW), 300UL);
+    EXPECT_EQ(d.longestMs(STALL_END_SHOW), 0UL);
+    EXPECT_EQ(d.longestMs(STALL_OP_COUNT), 0UL);
+}
+
+TEST(StallDetector, DurationsSurviveMillisWrap) {
+    StallDetector d(30000);
+    StallOp outer = d.begin(STALL_POLL, ULONG_MAX - 999);
+    EXPECT_EQ(d.inFlightMs(1000), 2000UL);
+    d.end(outer, 0, 1000);
+    EXPECT_EQ(d.longestMs(STALL_POLL), 2000UL);
+}
+
+// ========== After a reset ==========
+
+TEST(StallDetector, WatchdogResetReportsOperationInFlight) {
+    StallRecord persistent = blankRecord();
+    hangIn(&persistent, STALL_START_SHOW, 10000, 12000);
+
+    StallDetector d(30000);
+    StallReport report;
+    ASSERT_TRUE(d.attach(&persistent, true, &report));
+    EXPECT_EQ(report.op, STALL_START_SHOW);
+    EXPECT_TRUE(report.watchdog);
+    // Started at 10000, last kicked at 12000, reset a timeout later
+    EXPECT_EQ(report.inFlightMs, 32000UL);
+}
+
+TEST(StallDetector, OtherResetReportsTimeToLastKick) {
+    StallRecord persistent = blankRecord();
+    hangIn(&persistent, STALL_END_SHOW, 10000, 12000);
+
+    StallDetector d(30000);
+    StallReport report;
+    ASSERT_TRUE(d.attach(&persistent, false, &report));
+    EXPECT_EQ(report.op, STALL_END_SHOW);
+    EXPECT_FALSE(report.watchdog);
+    EXPECT_EQ(report.inFlightMs, 2000UL);
+}
+
+TEST(StallDetector, WatchdogResetOutsideAnyOperation) {
+    StallRecord persistent = blankRecord();
+    hangIn(&persistent, STALL_NONE, 0, 5000);
+
+    StallDetector d(30000);
+    StallReport report;
+    ASSERT_TRUE(d.attach(&persistent, true, &report));
+    EXPECT_EQ(report.op, STALL_NONE);
+    EXPECT_TRUE(report.watchdog);
+    EXPECT_EQ(report.inFlightMs, 0UL);
+}
+
+TEST(StallDetector, CleanResetReportsNothing) {
+    StallRecord persistent = blankRecord();
+    hangIn(&persistent, STALL_NONE, 0, 5000);
+
+    StallDetector d(30000);
+    StallReport report;
+    EXPECT_FALSE(d.attach(&persistent, false, &report));
+}
+
+TEST(StallDetector, PowerUpGarbageIsIgnored) {
+    StallRecord persistent = blankRecord();
+    StallDetector d(30000);
+    StallReport report;
+    EXPECT_FALSE(d.attach(&persistent, false, &report));
+}
+
+TEST(StallDetector, CorruptedRecordIsIgnored) {
+    StallRecord persistent = blankRecord();
+    hangIn(&persistent, STALL_POLL, 10000, 12000);
+    persistent.startedMs ^= 0x100;
+
+    StallDetector d(30000);
+    StallReport report;
+    ASSERT_TRUE(d.attach(&persistent, true, &report));
+    EXPECT_EQ(report.op, STALL_NONE); // still a watchdog reset, but unattributed
+}
+
+TEST(StallDetector, AttachStartsRecordAfresh) {
+    StallRecord persistent = blankRecord();
+    hangIn(&persistent, STALL_POLL, 10000, 12000);
+
+    StallDetector d(30000);
+    StallReport report;
+    d.attach(&persistent, true, &report);
+    EXPECT_EQ(d.current(), STALL_NONE);
+
+    // A clean reboot after this one has nothing to report
+    StallDetector next(30000);
+    EXPECT_FALSE(next.attach(&persistent, false, &report));
+}
+
+TEST(StallDetector, OperationBegunBeforeAttachCarriesOver) {
+    StallRecord persistent = blankRecord();
+    StallDetector d(30000);
+    StallOp outer = d.begin(STALL_RECONNECT, 100);
+    StallReport report;
+    d.attach(&persistent, false, &report);
+    EXPECT_EQ(d.current(), STALL_RECONNECT);
+    d.end(outer, 0, 200);
+    EXPECT_EQ(d.current(), STALL_NONE);
+}
+
+TEST(StallDetector, OperationNames) {
+    EXPECT_STREQ(stallOpName(STALL_POLL), "poll");
+    EXPECT_STREQ(stallOpName(STALL_START_SHOW), "startShow");
+    EXPECT_STREQ(stallOpName(STALL_ADD_ENTRY), "addEntry");
+    EXPECT_STREQ(stallOpName(STALL_END_SHOW), "endShow");
+    EXPECT_STREQ(stallOpName(STALL_RECONNECT), "reconnect");
+    EXPECT_STREQ(stallOpName(STALL_FIRMWARE), "firmware");
+    EXPECT_STREQ(stallOpName(STALL_HISTORY), "history");
+}
@@ -1,7 +1,10 @@
 #include <gtest/gtest.h>
 #include "state_machine.h"
+#include "retry_policy.h"
 #include "utils.h"
 
+#include <limits.h>
+
 // ========== Helpers ==========
 
 Context makeContext(State state, int radioShowID = -1, int retryCount = 0,
@@ -11,6 +14,8 @@ Context makeContext(State state, int radioShowID = -1, int retryCount = 0,
     ctx.radioShowID = radioShowID;
     ctx.retryCount = retryCount;
     ctx.lastPollTime = lastPollTime;
+    ctx.backingOff = false;
+    ctx.retryAt = 0;
     return ctx;
 }
 
@@ -23,11 +28,15 @@ Inputs makeInputs() {
     in.currentMillis = 100000;
     in.startShowResult = -1;
     in.endShowResult = false;
+    in.breakerWaitMs = 0;
     in.pollNewTrack = false;
     in.pollLiveDJ = false;
+    in.pollShId = 0;
     in.pollIntervalMs = 20000;
     in.maxRetries = 3;
     in.retryBackoffMs = 2000;
+    in.retryBackoffMaxMs = 30000;
+    in.jitter = 0; // the shortest backoff: half the ceiling
     return in;
 }
 
@@ -41,7 +50,7 @@ TEST(StateMachine, BootingStaysInBooting) {
 
     EXPECT_EQ(r.context.state, BOOTING);
     EXPECT_FALSE(r.addEntry);
-    EXPECT_EQ(r.delayMs, 0UL);
+    EXPECT_FALSE(r.context.backingOff);
 }
 
 // ========== CONNECTING_WIFI ==========
@@ -61,6 +70,7 @@ TEST(StateMachine, ConnectingWifiToAutoDJActiveWhenConnectedWithPriorShow) {
     Context ctx = makeContext(CONNECTING_WIFI, /*radioShowID=*/42);
     Inputs in = makeInputs();
     in.wifiConnected = true;
+    in.autoDJActive = true;
 
     TickResult r = tick(ctx, in);
 
@@ -69,6 +79,32 @@ TEST(StateMachine, ConnectingWifiToAutoDJActiveWhenConnectedWithPriorShow) {
     EXPECT_EQ(r.context.retryCount, 0);
 }
 
+// The relay opened while offline (or powered down): no change event will
+// come, so the level decides.
+TEST(StateMachine, ConnectingWifiToEndingShowWhenRelayOpenedWithPriorShow) {
+    Context ctx = makeContext(CONNECTING_WIFI, /*radioShowID=*/42);
+    Inputs in = makeInputs();
+    in.wifiConnected = true;
+    in.autoDJActive = false;
+
+    TickResult r = tick(ctx, in);
+
+    EXPECT_EQ(r.context.state, ENDING_SHOW);
+    EXPECT_EQ(r.context.radioShowID, 42);
+}
+
+TEST(StateMachine, ConnectingWifiToStartingShowWhenAutoDJActiveNoPriorShow) {
+    Context ctx = makeContext(CONNECTING_WIFI);
+    Inputs in = makeInputs();
+    in.wifiConnected = true;
+    in.autoDJActive = true;
+
+    TickResult r = tick(ctx, in);
+
+    EXPECT_EQ(r.context.state, STARTING_SHOW);
+    EXPECT_EQ(r.context.retryCount, 0);
+}
+
 TEST(StateMachine, ConnectingWifiStaysWhenNotConnected) {
     Context ctx = makeContext(CONNECTING_WIFI);
     Inputs in = makeInputs();
@@ -128,6 +164,37 @@ TEST(StateMachine, StartingShowSuccessSavesShowIDAndTransitions) {
     EXPECT_EQ(r.context.lastPollTime, 0UL);
 }
 
+TEST(StateMachine, StartingShowSuccessLogsWarmTrack) {
+    Context ctx = makeContext(STARTING_SHOW);
+    Inputs in = makeInputs();
+    in.currentMillis = 100000;
+    in.startShowResult = 42;
+    in.pollNewTrack = true;
+    in.pollShId = 7001;
+
+    TickResult r = tick(ctx, in);
+
+    EXPECT_EQ(r.context.state, AUTO_DJ_ACTIVE);
+    EXPECT_TRUE(r.addEntry);
+    EXPECT_EQ(r.addEntryShId, 7001);
+    // Counts as the first poll: the next is a full interval away
+    EXPECT_EQ(r.context.lastPollTime, 100000UL);
+}
+
+TEST(StateMachine, StartingShowWarmTrackNotLoggedForLiveDJ) {
+    Context ctx = makeContext(STARTING_SHOW);
+    Inputs in = makeInputs();
+    in.currentMillis = 100000;
+    in.startShowResult = 42;
+    in.pollNewTrack = true;
+    in.pollLiveDJ = true;
+
+    TickResult r = tick(ctx, in);
+
+    EXPECT_EQ(r.context.state, AUTO_DJ_ACTIVE);
+    EXPECT_FALSE(r.addEntry);
+}
+
 TEST(StateMachine, StartingShowErrorOnNoNTP) {
     Context ctx = makeContext(STARTING_SHOW);
     Inputs in = makeInputs();
@@ -147,19 +214,49 @@ TEST(StateMachine, StartingShowRetryOnFailure) {
 
     EXPECT_EQ(r.context.state, STARTING_SHOW);
     EXPECT_EQ(r.context.retryCount, 1);
-    EXPECT_EQ(r.delayMs, 2000UL); // retryBackoffMs * 1
+    EXPECT_TRUE(r.context.backingOff);
+    EXPECT_EQ(r.context.retryAt, 101000UL); // half of retryBackoffMs, no jitter
 }
 
 TEST(StateMachine, StartingShowRetryBackoffScales) {
     Context ctx = makeContext(STARTING_SHOW, /*radioShowID=*/-1, /*retryCount=*/1);
     Inputs in = makeInputs();
     in.startShowResult = -1;
+    in.jitter = 2000; // the longest backoff: the whole ceiling
 
     TickResult r = tick(ctx, in);
 
     EXPECT_EQ(r.context.state, STARTING_SHOW);
     EXPECT_EQ(r.context.retryCount, 2);
-    EXPECT_EQ(r.delayMs, 4000UL); // retryBackoffMs * 2
+    EXPECT_EQ(r.context.retryAt, 104000UL); // retryBackoffMs doubled
+}
+
+TEST(StateMachine, StartingShowIgnoresResultWhileBackingOff) {
+    Context ctx = makeContext(STARTING_SHOW, /*radioShowID=*/-1, /*retryCount=*/1);
+    ctx.backingOff = true;
+    ctx.retryAt = 100500;
+    Inputs in = makeInputs();
+    in.startShowResult = -1; // not attempted
+
+    TickResult r = tick(ctx, in);
+
+    EXPECT_EQ(r.context.state, STARTING_SHOW);
+    EXPECT_EQ(r.context.retryCount, 1);
+    EXPECT_TRUE(r.context.backingOff);
+    EXPECT_EQ(r.context.retryAt, 100500UL);
+}
+
+TEST(StateMachine, StartingShowAttemptsOnceDue) {
+    Context ctx = makeContext(STARTING_SHOW, /*radioShowID=*/-1, /*retryCount=*/1);
+    ctx.backingOff = true;
+    ctx.retryAt = 100000;
+    Inputs in = makeInputs();
+    in.startShowResult = 42;
+
+    TickResult r = tick(ctx, in);
+
+    EXPECT_EQ(r.context.state, AUTO_DJ_ACTIVE);
+    EXPECT_FALSE(r.context.backingOff);
 }
 
 TEST(StateMachine, StartingShowErrorOnMaxRetries) {
@@ -172,6 +269,20 @@ TEST(StateMachine, StartingShowErrorOnMaxRetries) {
 
     EXPECT_EQ(r.context.state, ERROR_STATE);
     EXPECT_EQ(r.context.retryCount, 0);
+    EXPECT_TRUE(r.context.backingOff); // ERROR_STATE waits before moving on
+}
+
+TEST(StateMachine, StartingShowWaitsForBreakerWithoutCountingRetry) {
+    Context ctx = makeContext(STARTING_SHOW, /*radioShowID=*/-1, /*retryCount=*/1);
+    Inputs in = makeInputs();
+    in.breakerWaitMs = 45000; // not attempted
+
+    TickResult r = tick(ctx, in);
+
+    EXPECT_EQ(r.context.state, STARTING_SHOW);
+    EXPECT_EQ(r.context.retryCount, 1);
+    EXPECT_TRUE(r.context.backingOff);
+    EXPECT_EQ(r.context.retryAt, 145000UL); // when the breaker lets a probe through
 }
 
 // ========== AUTO_DJ_ACTIVE ==========
@@ -196,17 +307,13 @@ TEST(StateMachine, AutoDJActiveAddsEntryOnNewTrackNotLiveDJ) {
     in.pollIntervalMs = 20000;
     in.pollNewTrack = true;
     in.pollLiveDJ = false;
-    in.artist = "Broadcast";
-    in.title = "Echo's Answer";
-    in.album = "Tender Buttons";
+    in.pollShId = 7001;
 
     TickResult r = tick(ctx, in);
 
     EXPECT_EQ(r.context.state, AUTO_DJ_ACTIVE);
     EXPECT_TRUE(r.addEntry);
-    EXPECT_EQ(r.addEntryArtist, "Broadcast");
-    EXPECT_EQ(r.addEntryTitle, "Echo's Answer");
-    EXPECT_EQ(r.addEntryAlbum, "Tender Buttons");
+    EXPECT_EQ(r.addEntryShId, 7001);
     EXPECT_EQ(r.addEntryHourMs, currentHourMs(in.epochTime));
 }
 
@@ -289,7 +396,8 @@ TEST(StateMachine, EndingShowRetryOnFailure) {
 
     EXPECT_EQ(r.context.state, ENDING_SHOW);
     EXPECT_EQ(r.context.retryCount, 1);
-    EXPECT_EQ(r.delayMs, 2000UL);
+    EXPECT_TRUE(r.context.backingOff);
+    EXPECT_EQ(r.context.retryAt, 101000UL);
 }
 
 TEST(StateMachine, EndingShowForcedIdleOnMaxRetries) {
@@ -305,6 +413,41 @@ TEST(StateMachine, EndingShowForcedIdleOnMaxRetries) {
     EXPECT_EQ(r.context.retryCount, 0);
 }
 
+// An open breaker outlasts every backoff; only the probes it lets through
+// count against maxRetries, so the show is not abandoned (and its queued
+// entries discarded) before a single request is sent.
+TEST(StateMachine, EndingShowKeepsRetriesWhileBreakerOpen) {
+    const unsigned long openMs = 60000;
+    CircuitBreaker breaker(1, openMs);
+    breaker.record(false, 100000); // opened by the last request of the show
+    Context ctx = makeContext(ENDING_SHOW, /*radioShowID=*/42);
+    Inputs in = makeInputs();
+
+    int attempts = 0;
+    unsigned long t = 100000;
+    for (; ctx.state == ENDING_SHOW && t < 1000000; t += 500) {
+        // As loop() does: the host is down, so every request sent fails
+        in.currentMillis = t;
+        in.breakerWaitMs = 0;
+        in.endShowResult = false;
+        if (retryDue(ctx, t)) {
+            in.breakerWaitMs = breaker.refusingForMs(t);
+            if (in.breakerWaitMs == 0 && breaker.allow(t)) {
+                attempts++;
+                breaker.record(false, t);
+            }
+        }
+        ctx = tick(ctx, in).context;
+        if (t < 100000 + openMs) {
+            ASSERT_EQ(ctx.retryCount, 0);
+        }
+    }
+
+    EXPECT_EQ(ctx.state, IDLE);
+    EXPECT_EQ(attempts, in.maxRetries);
+    EXPECT_GE(t, 100000 + in.maxRetries * openMs); // one probe per opening
+}
+
 // ========== ERROR_STATE ==========
 
 TEST(StateMachine, ErrorStateToConnectingWifiOnWifiLost) {
@@ -340,15 +483,38 @@ TEST(StateMachine, ErrorStateToIdleWhenAutoDJInactive) {
     EXPECT_EQ(r.context.retryCount, 0);
 }
 
-TEST(StateMachine, ErrorStateAlwaysReturnsDelay) {
+TEST(StateMachine, ErrorStateWaitsOutItsBackoff) {
     Context ctx = makeContext(ERROR_STATE);
+    ctx.backingOff = true;
+    ctx.retryAt = 101000;
     Inputs in = makeInputs();
-    in.autoDJActive = false; // will transition to IDLE
+    in.autoDJActive = false; // would go to IDLE
+
+    EXPECT_EQ(tick(ctx, in).context.state, ERROR_STATE);
+    in.currentMillis = 101000;
+    EXPECT_EQ(tick(ctx, in).context.state, IDLE);
+}
+
+TEST(StateMachine, ErrorStateRearmsWhenStuck) {
+    Context ctx = makeContext(ERROR_STATE, /*radioShowID=*/42);
+    Inputs in = makeInputs();
+    in.autoDJActive = true; // open show, active relay: nowhere to go
 
     TickResult r = tick(ctx, in);
 
-    EXPECT_EQ(r.context.state, IDLE); // transition occurred
-    EXPECT_EQ(r.delayMs, in.retryBackoffMs); // delay still fires
+    EXPECT_EQ(r.context.state, ERROR_STATE);
+    EXPECT_TRUE(r.context.backingOff);
+    EXPECT_EQ(r.context.retryAt, 101000UL);
+}
+
+TEST(StateMachine, RetryDueAcrossMillisWrap) {
+    Context ctx = makeContext(STARTING_SHOW);
+    EXPECT_TRUE(retryDue(ctx, 0));
+    ctx.backingOff = true;
+    ctx.retryAt = 500; // scheduled just before millis() wrapped
+    EXPECT_FALSE(retryDue(ctx, ULONG_MAX - 255));
+    EXPECT_TRUE(retryDue(ctx, 500));
+    EXPECT_TRUE(retryDue(ctx, 600));
 }
 
 // ========== WiFi Loss (parameterized) ==========
@@ -358,6 +524,8 @@ class WifiLossTest : public ::testing::TestWithParam<State> {};
 TEST_P(WifiLossTest, TransitionsToConnectingWifiAndPreservesShowID) {
     State state = GetParam();
     Context ctx = makeContext(state, /*radioShowID=*/42, /*retryCount=*/2);
+    ctx.backingOff = true;
+    ctx.retryAt = 200000;
     Inputs in = makeInputs();
     in.wifiConnected = false;
 
@@ -365,6 +533,7 @@ TEST_P(WifiLossTest, TransitionsToConnectingWifiAndPreservesShowID) {
 
     EXPECT_EQ(r.context.state, CONNECTING_WIFI);
     EXPECT_EQ(r.context.radioShowID, 42);
+    EXPECT_FALSE(r.context.backingOff);
 }
 
 INSTANTIATE_TEST_SUITE_P(